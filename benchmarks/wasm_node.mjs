@@ -0,0 +1,103 @@
+// WebAssembly ビルドの数値ベンチマークを Node で実行する
+//
+//   make bench-wasm
+//   node benchmarks/wasm_node.mjs <hajimu_wasm.mjs> [<比較用 hajimu_wasm.mjs>] [--native=./nihongo]
+//
+// 各ベンチマークをセッション API で繰り返し評価し、中央値を表示する。
+// ベンチマーク自身の期待値チェックに加えて、出力が比較用ビルド・ネイティブ版と
+// 一致することを確かめる（一致しなければ終了コード 1）。
+
+import { execFileSync } from 'node:child_process';
+import { readFileSync } from 'node:fs';
+import path from 'node:path';
+import { performance } from 'node:perf_hooks';
+import { fileURLToPath, pathToFileURL } from 'node:url';
+
+const BENCH_DIR = path.dirname(fileURLToPath(import.meta.url));
+const BENCHMARKS = ['vector_sum', 'vector_dot', 'vector_mul', 'matrix_mul', 'linalg_core'];
+const ITERATIONS = 20;
+
+async function loadRuntime(modulePath) {
+    const { default: createModule } = await import(pathToFileURL(path.resolve(modulePath)).href);
+    const module = await createModule();
+    return {
+        name: path.basename(path.dirname(path.resolve(modulePath))),
+        sessionNew: module.cwrap('hajimu_session_new', 'number', []),
+        sessionEval: module.cwrap('hajimu_session_eval', 'number', ['number', 'string']),
+        sessionOutput: module.cwrap('hajimu_session_output', 'string', ['number']),
+        sessionError: module.cwrap('hajimu_session_error', 'string', ['number']),
+        sessionReset: module.cwrap('hajimu_session_reset', 'number', ['number']),
+        sessionFree: module.cwrap('hajimu_session_free', null, ['number']),
+    };
+}
+
+function runBenchmark(runtime, source) {
+    const session = runtime.sessionNew();
+    const times = [];
+    let output = '';
+    try {
+        for (let i = 0; i < ITERATIONS; i++) {
+            // 前回の変数定義を持ち越さないよう毎回まっさらな評価器で測る
+            runtime.sessionReset(session);
+            const start = performance.now();
+            const status = runtime.sessionEval(session, source);
+            times.push(performance.now() - start);
+            if (status !== 0) {
+                return { error: runtime.sessionError(session) };
+            }
+            output = runtime.sessionOutput(session);
+        }
+    } catch (e) {
+        // 期待値と異なるベンチマークは 終了(1) で抜ける
+        return { error: String(e && e.message ? e.message : e) };
+    } finally {
+        runtime.sessionFree(session);
+    }
+    times.sort((a, b) => a - b);
+    return { output: output.trim(), median: times[times.length >> 1] };
+}
+
+async function main() {
+    const args = process.argv.slice(2);
+    const nativeArg = args.find((arg) => arg.startsWith('--native='));
+    const native = nativeArg ? nativeArg.slice('--native='.length) : null;
+    const modules = args.filter((arg) => !arg.startsWith('--'));
+    if (modules.length === 0) {
+        console.error('使い方: node benchmarks/wasm_node.mjs <hajimu_wasm.mjs> [<比較用>] [--native=./nihongo]');
+        process.exit(2);
+    }
+
+    const runtimes = [];
+    for (const modulePath of modules) runtimes.push(await loadRuntime(modulePath));
+
+    let failed = false;
+    console.log(['benchmark', ...runtimes.map((r) => `${r.name} (ms)`), 'result'].join('\t'));
+    for (const name of BENCHMARKS) {
+        const file = path.join(BENCH_DIR, `${name}.jp`);
+        const source = readFileSync(file, 'utf8');
+        const results = runtimes.map((runtime) => runBenchmark(runtime, source));
+        const expected = native
+            ? execFileSync(native, [file], { encoding: 'utf8' }).trim()
+            : results[0].output;
+
+        let status = 'ok';
+        const broken = results.find((result) => result.error !== undefined);
+        if (broken) {
+            status = `error: ${broken.error}`;
+        } else if (results.some((result) => result.output !== expected)) {
+            status = `mismatch: ${results.map((result) => JSON.stringify(result.output)).join(' / ')}` +
+                     ` (expected ${JSON.stringify(expected)})`;
+        }
+        if (status !== 'ok') failed = true;
+
+        const times = results.map((result) => (result.median !== undefined ? result.median.toFixed(3) : '-'));
+        console.log([name, ...times, status].join('\t'));
+    }
+
+    process.exit(failed ? 1 : 0);
+}
+
+main().catch((e) => {
+    console.error(e);
+    process.exit(1);
+});
@@ -70,6 +70,25 @@
   #define HAJIMU_PLUGIN_EXPORT __attribute__((visibility("default")))
 #endif
 
+// =============================================================================
+// プラグイン ABI バージョン
+// =============================================================================
+
+/**
+ * Value のレイアウトやインライン関数の意味が変わると上がる。
+ * インタプリタは hajimu_plugin_abi_version が一致しないプラグインを読み込まない
+ * （古いヘッダーでビルドした .hjp は再ビルドが必要）。
+ *   2: hajimu_numeric_raw_data が view の offset を反映した先頭要素を返すよう変更
+ */
+#define HAJIMU_PLUGIN_ABI_VERSION 2
+
+// 複数の翻訳単位でインクルードしても 1 つにまとまるよう weak / selectany で定義する
+#ifdef _WIN32
+  HAJIMU_PLUGIN_EXPORT __declspec(selectany) const int hajimu_plugin_abi_version = HAJIMU_PLUGIN_ABI_VERSION;
+#else
+  HAJIMU_PLUGIN_EXPORT __attribute__((weak)) const int hajimu_plugin_abi_version = HAJIMU_PLUGIN_ABI_VERSION;
+#endif
+
 // =============================================================================
 // プラットフォーム検出マクロ
 // =============================================================================
@@ -144,6 +163,9 @@ typedef enum {
     VALUE_CLASS         = 10,
     VALUE_INSTANCE      = 11,
     VALUE_GENERATOR     = 12,
+    VALUE_FILE          = 13,
+    VALUE_BYTES         = 14,
+    VALUE_REGEX         = 15,
 } ValueType;
 
 typedef enum {
@@ -158,6 +180,8 @@ typedef enum {
 struct ASTNode;
 struct Environment;
 struct GeneratorState;
+struct FileHandle;
+struct RegexHandle;
 
 typedef struct Value Value;
 typedef Value (*BuiltinFn)(int argc, Value *argv);
@@ -190,6 +214,9 @@ struct Value {
             void *data;
             int length;
             int capacity;
+            int offset;
+            int stride;
+            int *ref_count;
         } numeric_array;
 
         struct {
@@ -242,6 +269,21 @@ struct Value {
         struct {
             struct GeneratorState *state;
         } generator;
+        
+        struct {
+            struct FileHandle *handle;
+        } file;
+        
+        struct {
+            uint8_t *data;
+            int offset;
+            int length;
+            int *ref_count;
+        } bytes;
+        
+        struct {
+            struct RegexHandle *handle;
+        } regex;
     };
 };
 
@@ -324,16 +366,42 @@ static inline bool hajimu_is_matrix(Value *v) {
     return v != NULL && v->type == VALUE_MATRIX;
 }
 
-/** 数値ベクトルの f64 データポインタ（借用。保持したい場合はコピーすること） */
+/** 数値ベクトルの f64 データポインタ（借用・読み取り専用。連続でない view では NULL） */
 static inline double *hajimu_numeric_f64_data(Value *v) {
-    return hajimu_is_numeric_array(v) && v->numeric_array.dtype == NUMERIC_DTYPE_F64
-        ? (double *)v->numeric_array.data
+    return hajimu_is_numeric_array(v) && v->numeric_array.dtype == NUMERIC_DTYPE_F64 &&
+           v->numeric_array.stride == 1 && v->numeric_array.data != NULL
+        ? (double *)v->numeric_array.data + v->numeric_array.offset
         : NULL;
 }
 
-/** 数値ベクトルの raw データポインタ（dtype を確認してから扱うこと） */
+/** dtype の要素バイト数 */
+static inline size_t hajimu_numeric_dtype_size(NumericDType dtype) {
+    switch (dtype) {
+        case NUMERIC_DTYPE_F32:
+        case NUMERIC_DTYPE_I32:  return 4;
+        case NUMERIC_DTYPE_BOOL: return 1;
+        default:                 return 8;
+    }
+}
+
+/**
+ * 数値ベクトルの raw データポインタ（view の先頭要素を指す。dtype・stride を確認してから扱うこと）
+ * 要素 i は (char *)raw + i * stride * hajimu_numeric_dtype_size(dtype) にある
+ */
 static inline void *hajimu_numeric_raw_data(Value *v) {
-    return hajimu_is_numeric_array(v) ? v->numeric_array.data : NULL;
+    return hajimu_is_numeric_array(v) && v->numeric_array.data != NULL
+        ? (char *)v->numeric_array.data +
+              (size_t)v->numeric_array.offset * hajimu_numeric_dtype_size(v->numeric_array.dtype)
+        : NULL;
+}
+
+/** 数値ベクトル view の先頭位置と要素間隔（要素単位） */
+static inline int hajimu_numeric_offset(Value *v) {
+    return hajimu_is_numeric_array(v) ? v->numeric_array.offset : 0;
+}
+
+static inline int hajimu_numeric_stride(Value *v) {
+    return hajimu_is_numeric_array(v) ? v->numeric_array.stride : 1;
 }
 
 /** 数値ベクトルの dtype */
@@ -394,6 +462,9 @@ static inline Value hajimu_numeric_from_f64_copy(const double *data, int length)
     v.numeric_array.dtype = NUMERIC_DTYPE_F64;
     v.numeric_array.length = length > 0 ? length : 0;
     v.numeric_array.capacity = v.numeric_array.length > 0 ? v.numeric_array.length : 1;
+    v.numeric_array.offset = 0;
+    v.numeric_array.stride = 1;
+    v.numeric_array.ref_count = NULL;
     v.numeric_array.data = calloc((size_t)v.numeric_array.capacity, sizeof(double));
     if (data != NULL && length > 0 && v.numeric_array.data != NULL) {
         memcpy(v.numeric_array.data, data, sizeof(double) * (size_t)length);
@@ -258,6 +258,8 @@ void method_add_param(ASTNode *method, const char *name, ValueType type, bool ha
     method->method.params[count].name = strdup(name);
     method->method.params[count].type = type;
     method->method.params[count].has_type = has_type;
+    method->method.params[count].is_variadic = false;
+    method->method.params[count].default_value = NULL;
     method->method.param_count++;
 }
 
@@ -11,6 +11,7 @@
 #include "async.h"
 #include "evaluator.h"
 #include "environment.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,6 +34,21 @@
 #    include <Security/SecureTransport.h>
 #  endif
 #endif
+#include <sys/stat.h>
+#include <limits.h>
+#include <stdint.h>
+
+// 非同期ファイルI/O は Linux では io_uring を使う（liburing には依存しない）
+#if defined(__linux__) && !defined(HAJIMU_WASM) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define HAJIMU_HAVE_IO_URING 1
+#    include <linux/io_uring.h>
+#    include <linux/stat.h>
+#    include <sys/eventfd.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#  endif
+#endif
 
 // =============================================================================
 // グローバル状態
@@ -40,6 +56,17 @@
 
 static AsyncRuntime g_runtime;
 
+static void file_io_shutdown(void);
+
+// トレース: 「ラベル #ID」を詳細に付けて現在のスレッドの区間を記録する
+static void trace_id_span(const char *name, const char *category, double start_us,
+                          const char *label, int id) {
+    if (!trace_enabled() || start_us <= 0.0) return;
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%s #%d", label, id);
+    trace_complete(name, category, start_us, detail);
+}
+
 // 非同期タスク実行用の評価器を取得
 static Evaluator *get_async_evaluator(void) {
     return evaluator_current();
@@ -135,6 +162,29 @@ static AsyncTask *find_task_locked(int task_id) {
     return NULL;
 }
 
+// 空きスロットに新しいタスクを確保して初期化する（task_mutex をロックした状態で呼ぶ）
+static AsyncTask *task_alloc_locked(void) {
+    for (int i = 0; i < MAX_ASYNC_TASKS; i++) {
+        if (g_runtime.tasks[i].used) continue;
+        AsyncTask *task = &g_runtime.tasks[i];
+        memset(task, 0, sizeof(AsyncTask));
+        task->id = g_runtime.next_task_id++;
+        task->status = TASK_PENDING;
+        task->used = true;
+        task_index_insert_locked(task);
+        task->function = value_null();
+        task->result = value_null();
+        task->then_fn = value_null();
+        task->catch_fn = value_null();
+        task->chain_next_id = -1;
+        pthread_mutex_init(&task->completion_mutex, NULL);
+        pthread_cond_init(&task->completion_cond, NULL);
+        task->completion_signaled = false;
+        return task;
+    }
+    return NULL;
+}
+
 // タスクを1つ実行する共通ロジック
 static void execute_task(AsyncTask *task) {
     Evaluator *eval = get_async_evaluator();
@@ -145,8 +195,11 @@ static void execute_task(AsyncTask *task) {
     }
     
     task->status = TASK_RUNNING;
+    TRACE_BEGIN(trace_start_us);
+    const char *trace_name = "非同期タスク";
     
     if (task->function.type == VALUE_BUILTIN) {
+        trace_name = task->function.builtin.name;
         task->result = task->function.builtin.fn(task->arg_count, task->args);
         task->status = TASK_COMPLETED;
     } else if (task->function.type == VALUE_FUNCTION) {
@@ -175,7 +228,15 @@ static void execute_task(AsyncTask *task) {
         Environment *prev = thread_eval->current;
         thread_eval->current = local;
         
+        // スタックトレースとサンプリングプロファイルにタスクの関数名を出す
+        thread_eval->call_stack[0].func_name =
+            def->type == NODE_LAMBDA ? "無名関数" : def->function.name;
+        trace_name = thread_eval->call_stack[0].func_name;
+        thread_eval->call_stack[0].line = def->location.line;
+        thread_eval->call_stack_depth = 1;
+        
         Value result = evaluate(thread_eval, body);
+        thread_eval->call_stack_depth = 0;
         
         if (thread_eval->returning) {
             value_free(&result);
@@ -203,6 +264,7 @@ static void execute_task(AsyncTask *task) {
         task->status = TASK_FAILED;
         snprintf(task->error_message, sizeof(task->error_message), "呼び出し可能ではありません");
     }
+    trace_id_span(trace_name, "async_task", trace_start_us, "タスク", task->id);
 }
 
 // Promise チェーンを処理（タスク完了後に呼ばれる）
@@ -267,6 +329,51 @@ static void process_promise_chain(AsyncTask *task) {
     }
 }
 
+// ネイティブ並列ループの共有状態。
+// キューに残ったジョブが呼び出し元の復帰後に動いても安全なよう、参照数で解放する。
+typedef struct ParallelBatch {
+    AsyncParallelFn fn;
+    void *arg;
+    int count;
+    int next;
+    int done;
+    int refs;
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;
+} ParallelBatch;
+
+static void parallel_batch_work(ParallelBatch *batch) {
+    while (1) {
+        pthread_mutex_lock(&batch->mutex);
+        if (batch->next >= batch->count) {
+            pthread_mutex_unlock(&batch->mutex);
+            return;
+        }
+        int index = batch->next++;
+        pthread_mutex_unlock(&batch->mutex);
+
+        batch->fn(index, batch->arg);
+
+        pthread_mutex_lock(&batch->mutex);
+        batch->done++;
+        if (batch->done == batch->count) {
+            pthread_cond_broadcast(&batch->done_cond);
+        }
+        pthread_mutex_unlock(&batch->mutex);
+    }
+}
+
+static void parallel_batch_release(ParallelBatch *batch) {
+    pthread_mutex_lock(&batch->mutex);
+    bool last = --batch->refs == 0;
+    pthread_mutex_unlock(&batch->mutex);
+    if (last) {
+        pthread_mutex_destroy(&batch->mutex);
+        pthread_cond_destroy(&batch->done_cond);
+        free(batch);
+    }
+}
+
 // タスク完了を通知する（条件変数をシグナル）
 static void signal_task_completion(AsyncTask *task) {
     pthread_mutex_lock(&task->completion_mutex);
@@ -279,6 +386,7 @@ static void signal_task_completion(AsyncTask *task) {
 static void *pool_worker_thread(void *arg) {
     (void)arg;
     ThreadPool *pool = &g_runtime.pool;
+    trace_thread_name("プールワーカー");
     
     while (1) {
         pthread_mutex_lock(&pool->queue_mutex);
@@ -300,12 +408,42 @@ static void *pool_worker_thread(void *arg) {
         
         pthread_cond_signal(&pool->queue_not_full);
         pthread_mutex_unlock(&pool->queue_mutex);
+
+        if (trace_enabled() && job.enqueued_us > 0.0) {
+            trace_async_span("キュー待ち", "pool_queue", job.enqueued_us, trace_now_us(),
+                             job.batch != NULL ? "並列バッチ" : NULL);
+        }
+
+        if (job.batch != NULL) {
+            TRACE_BEGIN(batch_start_us);
+            parallel_batch_work(job.batch);
+            TRACE_END(batch_start_us, "並列バッチ", "parallel", NULL);
+            parallel_batch_release(job.batch);
+            pthread_mutex_lock(&pool->queue_mutex);
+            pool->completed_jobs++;
+            pthread_mutex_unlock(&pool->queue_mutex);
+            continue;
+        }
         
         // タスクを実行
         pthread_mutex_lock(&g_runtime.task_mutex);
         AsyncTask *task = find_task_locked(job.task_id);
         pthread_mutex_unlock(&g_runtime.task_mutex);
         
+        if (job.chain_only) {
+            // 非同期I/O の完了後のコールバックはワーカーで実行する
+            if (task) {
+                TRACE_BEGIN(chain_start_us);
+                process_promise_chain(task);
+                trace_id_span("Promise チェーン", "async_task", chain_start_us, "タスク", task->id);
+                signal_task_completion(task);
+            }
+            pthread_mutex_lock(&pool->queue_mutex);
+            pool->completed_jobs++;
+            pthread_mutex_unlock(&pool->queue_mutex);
+            continue;
+        }
+        
         if (task && task->used && task->status == TASK_PENDING) {
             execute_task(task);
             process_promise_chain(task);
@@ -351,7 +489,7 @@ static void thread_pool_init(int num_threads) {
 }
 
 // スレッドプールにジョブを投入
-static bool thread_pool_submit(int task_id) {
+static bool thread_pool_push(int task_id, bool chain_only) {
     ThreadPool *pool = &g_runtime.pool;
     if (!pool->initialized) {
         thread_pool_init(THREAD_POOL_DEFAULT_SIZE);
@@ -377,6 +515,9 @@ static bool thread_pool_submit(int task_id) {
     }
     
     pool->queue[pool->queue_tail].task_id = task_id;
+    pool->queue[pool->queue_tail].batch = NULL;
+    pool->queue[pool->queue_tail].chain_only = chain_only;
+    pool->queue[pool->queue_tail].enqueued_us = trace_enabled() ? trace_now_us() : 0.0;
     pool->queue_tail = (pool->queue_tail + 1) % pool->queue_capacity;
     pool->queue_count++;
     pool->total_jobs++;
@@ -387,6 +528,62 @@ static bool thread_pool_submit(int task_id) {
     return true;
 }
 
+static bool thread_pool_submit(int task_id) {
+    return thread_pool_push(task_id, false);
+}
+
+void async_parallel_for(int count, AsyncParallelFn fn, void *arg) {
+    if (count <= 0) return;
+    ThreadPool *pool = &g_runtime.pool;
+    if (count == 1 || !pool->initialized) {
+        for (int i = 0; i < count; i++) fn(i, arg);
+        return;
+    }
+
+    ParallelBatch *batch = calloc(1, sizeof(ParallelBatch));
+    if (batch == NULL) {
+        for (int i = 0; i < count; i++) fn(i, arg);
+        return;
+    }
+    batch->fn = fn;
+    batch->arg = arg;
+    batch->count = count;
+    batch->refs = 1;
+    pthread_mutex_init(&batch->mutex, NULL);
+    pthread_cond_init(&batch->done_cond, NULL);
+
+    // キューが空いている分だけ投入する。満杯なら待たずに呼び出し元が処理する。
+    int helpers = count - 1 < pool->thread_count ? count - 1 : pool->thread_count;
+    pthread_mutex_lock(&pool->queue_mutex);
+    for (int i = 0; i < helpers && !pool->shutdown && pool->queue_count < pool->queue_capacity; i++) {
+        pool->queue[pool->queue_tail].task_id = -1;
+        pool->queue[pool->queue_tail].batch = batch;
+        pool->queue[pool->queue_tail].chain_only = false;
+        pool->queue[pool->queue_tail].enqueued_us = trace_enabled() ? trace_now_us() : 0.0;
+        pool->queue_tail = (pool->queue_tail + 1) % pool->queue_capacity;
+        pool->queue_count++;
+        pool->total_jobs++;
+        pthread_mutex_lock(&batch->mutex);
+        batch->refs++;
+        pthread_mutex_unlock(&batch->mutex);
+    }
+    pthread_cond_broadcast(&pool->queue_not_empty);
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    TRACE_BEGIN(batch_start_us);
+    parallel_batch_work(batch);
+    TRACE_END(batch_start_us, "並列バッチ", "parallel", NULL);
+
+    TRACE_BEGIN(wait_start_us);
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->done < batch->count) {
+        pthread_cond_wait(&batch->done_cond, &batch->mutex);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+    TRACE_END(wait_start_us, "並列バッチ待ち", "wait", NULL);
+    parallel_batch_release(batch);
+}
+
 // スレッドプールをシャットダウン
 static void thread_pool_shutdown(void) {
     ThreadPool *pool = &g_runtime.pool;
@@ -447,6 +644,9 @@ void async_runtime_init(void) {
 void async_runtime_cleanup(void) {
     if (!g_runtime.initialized) return;
     
+    // 非同期ファイルI/O の完了はプールへ回ることがあるので先に止める
+    file_io_shutdown();
+    
     // スレッドプールをシャットダウン
     thread_pool_shutdown();
     
@@ -459,8 +659,12 @@ void async_runtime_cleanup(void) {
     }
     pthread_mutex_unlock(&g_runtime.schedule_mutex);
     
-    // 少し待ってスレッドが終了するのを待つ
-    usleep(100000);  // 100ms
+    // 切り離したスレッドの終了を最大 100ms 待つ（動いていなければ待たない）
+    for (int waited_ms = 0;
+         waited_ms < 100 && __atomic_load_n(&g_runtime.detached_threads, __ATOMIC_ACQUIRE) > 0;
+         waited_ms++) {
+        usleep(1000);
+    }
     
     // 非同期タスクをクリーンアップ
     pthread_mutex_lock(&g_runtime.task_mutex);
@@ -599,11 +803,23 @@ Value builtin_pool_stats(int argc, Value *argv) {
 // 非同期タスク - スレッドラッパー（プール未使用時のフォールバック）
 // =============================================================================
 
+// プール外のスレッドを切り離して起動し、終了時に待つために数える
+static void spawn_detached_thread(pthread_t *thread, void *(*fn)(void *), void *arg) {
+    __atomic_add_fetch(&g_runtime.detached_threads, 1, __ATOMIC_RELAXED);
+    if (pthread_create(thread, NULL, fn, arg) != 0) {
+        __atomic_sub_fetch(&g_runtime.detached_threads, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    pthread_detach(*thread);
+}
+
 static void *async_task_runner_standalone(void *arg) {
     AsyncTask *task = (AsyncTask *)arg;
+    trace_thread_name("非同期タスク");
     execute_task(task);
     process_promise_chain(task);
     signal_task_completion(task);
+    __atomic_sub_fetch(&g_runtime.detached_threads, 1, __ATOMIC_RELEASE);
     return NULL;
 }
 
@@ -622,36 +838,12 @@ Value builtin_async_run(int argc, Value *argv) {
     
     pthread_mutex_lock(&g_runtime.task_mutex);
     
-    // 空きスロットを探す
-    int slot = -1;
-    for (int i = 0; i < MAX_ASYNC_TASKS; i++) {
-        if (!g_runtime.tasks[i].used) {
-            slot = i;
-            break;
-        }
-    }
-    
-    if (slot < 0) {
+    AsyncTask *task = task_alloc_locked();
+    if (task == NULL) {
         pthread_mutex_unlock(&g_runtime.task_mutex);
         return value_number(-1);
     }
-    
-    AsyncTask *task = &g_runtime.tasks[slot];
-    memset(task, 0, sizeof(AsyncTask));
-    task->id = g_runtime.next_task_id++;
-    task->status = TASK_PENDING;
-    task->used = true;
-    task_index_insert_locked(task);
     task->function = value_copy(argv[0]);
-    task->result = value_null();
-    task->then_fn = value_null();
-    task->catch_fn = value_null();
-    task->chain_next_id = -1;
-    
-    // 条件変数を初期化
-    pthread_mutex_init(&task->completion_mutex, NULL);
-    pthread_cond_init(&task->completion_cond, NULL);
-    task->completion_signaled = false;
     
     // 引数をコピー
     if (argc > 1) {
@@ -674,13 +866,11 @@ Value builtin_async_run(int argc, Value *argv) {
         if (!thread_pool_submit(task_id)) {
             // プールに投入できなかった場合はフォールバック
             task->use_pool = false;
-            pthread_create(&task->thread, NULL, async_task_runner_standalone, task);
-            pthread_detach(task->thread);
+            spawn_detached_thread(&task->thread, async_task_runner_standalone, task);
         }
     } else {
         task->use_pool = false;
-        pthread_create(&task->thread, NULL, async_task_runner_standalone, task);
-        pthread_detach(task->thread);
+        spawn_detached_thread(&task->thread, async_task_runner_standalone, task);
     }
     
     return value_number(task_id);
@@ -706,6 +896,7 @@ Value builtin_async_await(int argc, Value *argv) {
     // 条件変数で完了を待機（ポーリングの代わり）
     pthread_mutex_lock(&task->completion_mutex);
     if (!task->completion_signaled) {
+        TRACE_BEGIN(wait_start_us);
         if (timeout_sec < 0) {
             // 無制限待機
             while (!task->completion_signaled) {
@@ -726,10 +917,12 @@ Value builtin_async_await(int argc, Value *argv) {
                 int ret = pthread_cond_timedwait(&task->completion_cond, &task->completion_mutex, &ts);
                 if (ret == ETIMEDOUT) {
                     pthread_mutex_unlock(&task->completion_mutex);
+                    trace_id_span("待機（タイムアウト）", "wait", wait_start_us, "タスク", task_id);
                     return value_null();  // タイムアウト
                 }
             }
         }
+        trace_id_span("待機", "wait", wait_start_us, "タスク", task_id);
     }
     pthread_mutex_unlock(&task->completion_mutex);
     
@@ -852,6 +1045,697 @@ Value builtin_task_cancel(int argc, Value *argv) {
     return value_bool(false);
 }
 
+// =============================================================================
+// 非同期ファイルI/O
+// =============================================================================
+//
+// Linux では io_uring に open / statx / read / write / close を投入し、専用の
+// リアクタースレッド 1 本が完了を刈り取ってタスクを完了させる。何千件の
+// 読み書きが同時に進んでもワーカーを占有しない。io_uring が使えない環境
+// （非 Linux、カーネルが古い、seccomp で禁止）では同じ処理をブロッキングの
+// 組み込み関数としてスレッドプールに投入する。どちらも通常のタスクIDを返す。
+
+typedef enum {
+    FILE_IO_READ,
+    FILE_IO_WRITE,
+    FILE_IO_APPEND,
+    FILE_IO_STAT
+} FileIoKind;
+
+// ブロッキング版（スレッドプールのフォールバック）
+
+static Value file_io_stat_value(double size, double mtime, bool is_dir) {
+    Value dict = value_dict();
+    dict_set(&dict, "サイズ", value_number(size));
+    dict_set(&dict, "更新時刻", value_number(mtime));
+    dict_set(&dict, "ディレクトリ", value_bool(is_dir));
+    return dict;
+}
+
+static Value file_io_read_result(char *buffer, size_t length, bool as_bytes) {
+    if (as_bytes) {
+        if (length > INT_MAX) {
+            free(buffer);
+            return value_null();
+        }
+        return value_bytes_take(buffer, (int)length);
+    }
+    buffer[length] = '\0';
+    Value result = value_string(buffer);
+    free(buffer);
+    return result;
+}
+
+static Value file_io_read_blocking(int argc, Value *argv) {
+    bool as_bytes = argc > 1 && value_is_truthy(argv[1]);
+    FILE *file = fopen(argv[0].string.data, "rb");
+    if (file == NULL) return value_null();
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *buffer = malloc(capacity + 1);
+    while (buffer != NULL) {
+        size_t n = fread(buffer + length, 1, capacity - length, file);
+        length += n;
+        if (length < capacity) break;
+        capacity *= 2;
+        char *grown = realloc(buffer, capacity + 1);
+        if (grown == NULL) {
+            free(buffer);
+            buffer = NULL;
+            break;
+        }
+        buffer = grown;
+    }
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (buffer == NULL) return value_null();
+    if (failed) {
+        free(buffer);
+        return value_null();
+    }
+    return file_io_read_result(buffer, length, as_bytes);
+}
+
+static Value file_io_write_blocking(int argc, Value *argv) {
+    bool append = argc > 2 && value_is_truthy(argv[2]);
+    const char *data;
+    size_t length;
+    if (argv[1].type == VALUE_BYTES) {
+        data = (const char *)bytes_data(&argv[1]);
+        length = (size_t)argv[1].bytes.length;
+    } else {
+        data = argv[1].string.data;
+        length = (size_t)argv[1].string.byte_length;
+    }
+
+    FILE *file = fopen(argv[0].string.data, append ? "ab" : "wb");
+    if (file == NULL) return value_bool(false);
+    size_t written = length > 0 ? fwrite(data, 1, length, file) : 0;
+    bool ok = fclose(file) == 0 && written == length;
+    return value_bool(ok);
+}
+
+static Value file_io_stat_blocking(int argc, Value *argv) {
+    (void)argc;
+    struct stat st;
+    if (stat(argv[0].string.data, &st) != 0) return value_null();
+    return file_io_stat_value((double)st.st_size, (double)st.st_mtime, S_ISDIR(st.st_mode));
+}
+
+// io_uring 版
+
+#ifdef HAJIMU_HAVE_IO_URING
+
+#define FILE_IO_RING_ENTRIES 256
+#define FILE_IO_WAKE_TAG 0       // eventfd 読み取りの user_data
+
+typedef enum {
+    FILE_IO_STAGE_STATX,
+    FILE_IO_STAGE_OPEN,
+    FILE_IO_STAGE_TRANSFER,
+    FILE_IO_STAGE_CLOSE
+} FileIoStage;
+
+typedef struct FileIoRequest {
+    int task_id;
+    FileIoKind kind;
+    FileIoStage stage;
+    char *path;
+    Value content;              // 書き込む文字列またはバイト列
+    bool as_bytes;
+    int fd;
+    struct statx stx;
+    char *buffer;               // 読み込み先
+    size_t capacity;
+    size_t done;                // 読み書き済みバイト数
+    bool ok;
+    struct FileIoRequest *next;
+} FileIoRequest;
+
+typedef struct {
+    int ring_fd;
+    int wake_fd;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;
+    uint64_t wake_value;
+
+    pthread_t reactor;
+    pthread_mutex_t mutex;      // pending と stopping を保護
+    FileIoRequest *pending_head;
+    FileIoRequest *pending_tail;
+    int in_flight;
+    bool stopping;
+    bool running;
+} FileIoRing;
+
+static FileIoRing g_file_io;
+static pthread_once_t g_file_io_once = PTHREAD_ONCE_INIT;
+
+static int io_uring_setup_sys(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter_sys(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register_sys(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// 使う opcode がすべてカーネルで対応しているか確認する
+static bool file_io_probe_ops(int ring_fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (probe == NULL) return false;
+    bool ok = io_uring_register_sys(ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    const int ops[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ,
+                        IORING_OP_WRITE, IORING_OP_CLOSE };
+    for (size_t i = 0; ok && i < sizeof(ops) / sizeof(ops[0]); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+static void file_io_ring_unmap(FileIoRing *ring) {
+    if (ring->sqes != NULL) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != NULL && ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    if (ring->sq_ptr != NULL) munmap(ring->sq_ptr, ring->sq_size);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    if (ring->wake_fd >= 0) close(ring->wake_fd);
+    ring->sqes = NULL;
+    ring->sq_ptr = ring->cq_ptr = NULL;
+    ring->ring_fd = ring->wake_fd = -1;
+}
+
+static bool file_io_ring_map(FileIoRing *ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = io_uring_setup_sys(FILE_IO_RING_ENTRIES, &params);
+    ring->wake_fd = -1;
+    if (ring->ring_fd < 0) return false;
+    if (!file_io_probe_ops(ring->ring_fd)) {
+        file_io_ring_unmap(ring);
+        return false;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        file_io_ring_unmap(ring);
+        return false;
+    }
+    if (single) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = NULL;
+            file_io_ring_unmap(ring);
+            return false;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        file_io_ring_unmap(ring);
+        return false;
+    }
+
+    char *sq = ring->sq_ptr;
+    char *cq = ring->cq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    ring->wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (ring->wake_fd < 0) {
+        file_io_ring_unmap(ring);
+        return false;
+    }
+    return true;
+}
+
+static int file_io_submit(FileIoRing *ring, unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        ret = io_uring_enter_sys(ring->ring_fd, ring->to_submit, min_complete, flags);
+    } while (ret < 0 && errno == EINTR);
+    if (ret > 0) ring->to_submit -= (unsigned)ret < ring->to_submit ? (unsigned)ret : ring->to_submit;
+    return ret;
+}
+
+// SQE を 1 つ取り出す（リアクタースレッドだけが呼ぶ）
+static struct io_uring_sqe *file_io_get_sqe(FileIoRing *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail;
+    if (tail - head >= ring->sq_entries) {
+        file_io_submit(ring, 0);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= ring->sq_entries) return NULL;
+    }
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return sqe;
+}
+
+static void file_io_arm_wake(FileIoRing *ring) {
+    struct io_uring_sqe *sqe = file_io_get_sqe(ring);
+    if (sqe == NULL) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ring->wake_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&ring->wake_value;
+    sqe->len = sizeof(ring->wake_value);
+    sqe->user_data = FILE_IO_WAKE_TAG;
+}
+
+static void file_io_request_free(FileIoRequest *req) {
+    free(req->path);
+    free(req->buffer);
+    value_free(&req->content);
+    free(req);
+}
+
+// タスクを完了させる。Promise チェーンがあればワーカーへ回し、
+// ユーザー関数でリアクターを塞がないようにする
+static void file_io_finish(FileIoRequest *req, Value result) {
+    pthread_mutex_lock(&g_runtime.task_mutex);
+    AsyncTask *task = find_task_locked(req->task_id);
+    bool chained = false;
+    if (task != NULL) {
+        task->result = result;
+        task->status = TASK_COMPLETED;
+        chained = task->then_fn.type != VALUE_NULL || task->catch_fn.type != VALUE_NULL;
+    } else {
+        value_free(&result);
+    }
+    pthread_mutex_unlock(&g_runtime.task_mutex);
+
+    if (task != NULL && !(chained && thread_pool_push(req->task_id, true))) {
+        if (chained) process_promise_chain(task);
+        signal_task_completion(task);
+    }
+    file_io_request_free(req);
+}
+
+static Value file_io_failure_value(FileIoKind kind) {
+    return kind == FILE_IO_WRITE || kind == FILE_IO_APPEND ? value_bool(false) : value_null();
+}
+
+// 要求の現在の段階に対応する SQE を積む
+static bool file_io_queue_stage(FileIoRing *ring, FileIoRequest *req) {
+    struct io_uring_sqe *sqe = file_io_get_sqe(ring);
+    if (sqe == NULL) return false;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+
+    switch (req->stage) {
+        case FILE_IO_STAGE_STATX:
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)req->path;
+            sqe->len = STATX_BASIC_STATS;
+            sqe->off = (uint64_t)(uintptr_t)&req->stx;
+            break;
+        case FILE_IO_STAGE_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)req->path;
+            sqe->len = 0644;
+            if (req->kind == FILE_IO_READ) {
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            } else {
+                sqe->open_flags = O_WRONLY | O_CREAT | O_CLOEXEC |
+                                  (req->kind == FILE_IO_APPEND ? O_APPEND : O_TRUNC);
+            }
+            break;
+        case FILE_IO_STAGE_TRANSFER:
+            sqe->fd = req->fd;
+            if (req->kind == FILE_IO_READ) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->addr = (uint64_t)(uintptr_t)(req->buffer + req->done);
+                sqe->len = (unsigned)(req->capacity - req->done);
+                sqe->off = req->done;
+            } else {
+                const char *data;
+                size_t length;
+                if (req->content.type == VALUE_BYTES) {
+                    data = (const char *)bytes_data(&req->content);
+                    length = (size_t)req->content.bytes.length;
+                } else {
+                    data = req->content.string.data;
+                    length = (size_t)req->content.string.byte_length;
+                }
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->addr = (uint64_t)(uintptr_t)(data + req->done);
+                sqe->len = (unsigned)(length - req->done);
+                // O_APPEND では位置は無視され常に末尾へ書かれる
+                sqe->off = req->done;
+            }
+            break;
+        case FILE_IO_STAGE_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = req->fd;
+            break;
+    }
+    return true;
+}
+
+static size_t file_io_content_length(const FileIoRequest *req) {
+    if (req->content.type == VALUE_BYTES) return (size_t)req->content.bytes.length;
+    if (req->content.type == VALUE_STRING) return (size_t)req->content.string.byte_length;
+    return 0;
+}
+
+// 完了を受けて次の段階へ進める。要求が終わったら真
+static bool file_io_advance(FileIoRequest *req, int res) {
+    switch (req->stage) {
+        case FILE_IO_STAGE_STATX:
+            if (res < 0) {
+                file_io_finish(req, value_null());
+                return true;
+            }
+            if (req->kind == FILE_IO_STAT) {
+                bool is_dir = (req->stx.stx_mode & S_IFMT) == S_IFDIR;
+                double mtime = (double)req->stx.stx_mtime.tv_sec;
+                file_io_finish(req, file_io_stat_value((double)req->stx.stx_size, mtime, is_dir));
+                return true;
+            }
+            // 読み込みはサイズ分を先に確保しておく（伸びた場合は後で広げる）
+            req->capacity = req->stx.stx_size > 0 ? (size_t)req->stx.stx_size : 4096;
+            req->buffer = malloc(req->capacity + 1);
+            if (req->buffer == NULL) {
+                file_io_finish(req, value_null());
+                return true;
+            }
+            req->stage = FILE_IO_STAGE_OPEN;
+            return false;
+        case FILE_IO_STAGE_OPEN:
+            if (res < 0) {
+                file_io_finish(req, file_io_failure_value(req->kind));
+                return true;
+            }
+            req->fd = res;
+            req->stage = file_io_content_length(req) > 0 || req->kind == FILE_IO_READ
+                ? FILE_IO_STAGE_TRANSFER : FILE_IO_STAGE_CLOSE;
+            req->ok = true;
+            return false;
+        case FILE_IO_STAGE_TRANSFER:
+            if (res < 0) {
+                req->ok = false;
+                req->stage = FILE_IO_STAGE_CLOSE;
+                return false;
+            }
+            req->done += (size_t)res;
+            if (req->kind == FILE_IO_READ) {
+                if (res == 0) {
+                    req->stage = FILE_IO_STAGE_CLOSE;
+                } else if (req->done == req->capacity) {
+                    size_t capacity = req->capacity * 2;
+                    char *grown = realloc(req->buffer, capacity + 1);
+                    if (grown == NULL) {
+                        req->ok = false;
+                        req->stage = FILE_IO_STAGE_CLOSE;
+                    } else {
+                        req->buffer = grown;
+                        req->capacity = capacity;
+                    }
+                }
+            } else if (res == 0 || req->done >= file_io_content_length(req)) {
+                req->ok = res > 0 || req->done >= file_io_content_length(req);
+                req->stage = FILE_IO_STAGE_CLOSE;
+            }
+            return false;
+        case FILE_IO_STAGE_CLOSE:
+            if (!req->ok || res < 0) {
+                file_io_finish(req, file_io_failure_value(req->kind));
+            } else if (req->kind == FILE_IO_READ) {
+                char *buffer = req->buffer;
+                req->buffer = NULL;
+                file_io_finish(req, file_io_read_result(buffer, req->done, req->as_bytes));
+            } else {
+                file_io_finish(req, value_bool(true));
+            }
+            return true;
+    }
+    return true;
+}
+
+static void *file_io_reactor(void *arg) {
+    FileIoRing *ring = arg;
+    file_io_arm_wake(ring);
+
+    while (1) {
+        // 新しい要求を取り込む。同時実行数は SQ の大きさまで（CQ 溢れ防止）
+        pthread_mutex_lock(&ring->mutex);
+        bool stop = ring->stopping && ring->pending_head == NULL && ring->in_flight == 0;
+        while (ring->pending_head != NULL && ring->in_flight < (int)ring->sq_entries - 1) {
+            FileIoRequest *req = ring->pending_head;
+            ring->pending_head = req->next;
+            if (ring->pending_head == NULL) ring->pending_tail = NULL;
+            req->next = NULL;
+            ring->in_flight++;
+            pthread_mutex_unlock(&ring->mutex);
+            if (!file_io_queue_stage(ring, req)) {
+                pthread_mutex_lock(&ring->mutex);
+                ring->in_flight--;
+                req->next = ring->pending_head;
+                ring->pending_head = req;
+                if (ring->pending_tail == NULL) ring->pending_tail = req;
+                break;
+            }
+            pthread_mutex_lock(&ring->mutex);
+        }
+        pthread_mutex_unlock(&ring->mutex);
+        if (stop) break;
+
+        if (file_io_submit(ring, 1) < 0 && errno != EBUSY && errno != EAGAIN) break;
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+            head++;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+            if (cqe.user_data == FILE_IO_WAKE_TAG) {
+                file_io_arm_wake(ring);
+                continue;
+            }
+            FileIoRequest *req = (FileIoRequest *)(uintptr_t)cqe.user_data;
+            if (file_io_advance(req, cqe.res)) {
+                pthread_mutex_lock(&ring->mutex);
+                ring->in_flight--;
+                pthread_mutex_unlock(&ring->mutex);
+            } else if (!file_io_queue_stage(ring, req)) {
+                // SQ が詰まっている場合は次の周回まで待たせる
+                file_io_submit(ring, 0);
+                if (!file_io_queue_stage(ring, req)) {
+                    req->ok = false;
+                    file_io_finish(req, file_io_failure_value(req->kind));
+                    pthread_mutex_lock(&ring->mutex);
+                    ring->in_flight--;
+                    pthread_mutex_unlock(&ring->mutex);
+                }
+            }
+            tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    return NULL;
+}
+
+static void file_io_ring_init(void) {
+    FileIoRing *ring = &g_file_io;
+    memset(ring, 0, sizeof(*ring));
+    ring->ring_fd = ring->wake_fd = -1;
+    if (!file_io_ring_map(ring)) return;
+    pthread_mutex_init(&ring->mutex, NULL);
+    if (pthread_create(&ring->reactor, NULL, file_io_reactor, ring) != 0) {
+        pthread_mutex_destroy(&ring->mutex);
+        file_io_ring_unmap(ring);
+        return;
+    }
+    ring->running = true;
+}
+
+static bool file_io_ring_available(void) {
+    pthread_once(&g_file_io_once, file_io_ring_init);
+    return g_file_io.running;
+}
+
+static void file_io_wake(FileIoRing *ring) {
+    uint64_t one = 1;
+    ssize_t n = write(ring->wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+static void file_io_enqueue(FileIoRequest *req) {
+    FileIoRing *ring = &g_file_io;
+    pthread_mutex_lock(&ring->mutex);
+    if (ring->pending_tail != NULL) {
+        ring->pending_tail->next = req;
+    } else {
+        ring->pending_head = req;
+    }
+    ring->pending_tail = req;
+    pthread_mutex_unlock(&ring->mutex);
+    file_io_wake(ring);
+}
+
+// 実行中の要求を完了させてからリアクターを止める
+static void file_io_shutdown(void) {
+    FileIoRing *ring = &g_file_io;
+    if (!ring->running) return;
+    pthread_mutex_lock(&ring->mutex);
+    ring->stopping = true;
+    pthread_mutex_unlock(&ring->mutex);
+    file_io_wake(ring);
+    pthread_join(ring->reactor, NULL);
+    pthread_mutex_destroy(&ring->mutex);
+    file_io_ring_unmap(ring);
+    ring->running = false;
+}
+
+// io_uring に要求を投入してタスクIDを返す
+static Value file_io_submit_ring(FileIoKind kind, Value *argv, bool as_bytes) {
+    FileIoRequest *req = calloc(1, sizeof(FileIoRequest));
+    if (req == NULL) return value_null();
+    req->path = strdup(argv[0].string.data);
+    if (req->path == NULL) {
+        free(req);
+        return value_null();
+    }
+    req->kind = kind;
+    req->as_bytes = as_bytes;
+    req->fd = -1;
+    req->content = kind == FILE_IO_WRITE || kind == FILE_IO_APPEND ? value_copy(argv[1]) : value_null();
+    req->stage = kind == FILE_IO_READ || kind == FILE_IO_STAT ? FILE_IO_STAGE_STATX : FILE_IO_STAGE_OPEN;
+
+    pthread_mutex_lock(&g_runtime.task_mutex);
+    AsyncTask *task = task_alloc_locked();
+    if (task == NULL) {
+        pthread_mutex_unlock(&g_runtime.task_mutex);
+        file_io_request_free(req);
+        return value_number(-1);
+    }
+    // 実行中扱いにしてタスクキャンセルの対象から外す
+    task->status = TASK_RUNNING;
+    req->task_id = task->id;
+    pthread_mutex_unlock(&g_runtime.task_mutex);
+
+    int task_id = req->task_id;
+    file_io_enqueue(req);
+    return value_number(task_id);
+}
+
+#else
+
+static void file_io_shutdown(void) {}
+
+#endif
+
+// io_uring が使えなければブロッキング版をスレッドプールのタスクとして投入する
+static Value file_io_start(FileIoKind kind, Value *argv, bool as_bytes) {
+    if (!g_runtime.initialized) async_runtime_init();
+#ifdef HAJIMU_HAVE_IO_URING
+    if (file_io_ring_available()) return file_io_submit_ring(kind, argv, as_bytes);
+#endif
+    Value call[4];
+    int count = 0;
+    switch (kind) {
+        case FILE_IO_READ:
+            call[count++] = value_builtin(file_io_read_blocking, "非同期読込", 1, 2);
+            call[count++] = argv[0];
+            call[count++] = value_bool(as_bytes);
+            break;
+        case FILE_IO_WRITE:
+        case FILE_IO_APPEND:
+            call[count++] = value_builtin(file_io_write_blocking, "非同期書込", 2, 3);
+            call[count++] = argv[0];
+            call[count++] = argv[1];
+            call[count++] = value_bool(kind == FILE_IO_APPEND);
+            break;
+        case FILE_IO_STAT:
+            call[count++] = value_builtin(file_io_stat_blocking, "非同期ファイル情報", 1, 1);
+            call[count++] = argv[0];
+            break;
+    }
+    Value task_id = builtin_async_run(count, call);
+    value_free(&call[0]);
+    return task_id;
+}
+
+// 非同期読込(パス, バイト列で=偽) → タスクID
+Value builtin_async_read_file(int argc, Value *argv) {
+    if (argc < 1 || argv[0].type != VALUE_STRING) return value_null();
+    bool as_bytes = argc > 1 && value_is_truthy(argv[1]);
+    return file_io_start(FILE_IO_READ, argv, as_bytes);
+}
+
+// 非同期書込(パス, 内容) → タスクID
+Value builtin_async_write_file(int argc, Value *argv) {
+    if (argc < 2 || argv[0].type != VALUE_STRING) return value_null();
+    if (argv[1].type != VALUE_STRING && argv[1].type != VALUE_BYTES) return value_null();
+    return file_io_start(FILE_IO_WRITE, argv, false);
+}
+
+// 非同期追記(パス, 内容) → タスクID
+Value builtin_async_append_file(int argc, Value *argv) {
+    if (argc < 2 || argv[0].type != VALUE_STRING) return value_null();
+    if (argv[1].type != VALUE_STRING && argv[1].type != VALUE_BYTES) return value_null();
+    return file_io_start(FILE_IO_APPEND, argv, false);
+}
+
+// 非同期ファイル情報(パス) → タスクID
+Value builtin_async_stat(int argc, Value *argv) {
+    if (argc < 1 || argv[0].type != VALUE_STRING) return value_null();
+    return file_io_start(FILE_IO_STAT, argv, false);
+}
+
+// 非同期IO方式() → "io_uring" / "スレッドプール"
+Value builtin_async_io_backend(int argc, Value *argv) {
+    (void)argc; (void)argv;
+#ifdef HAJIMU_HAVE_IO_URING
+    if (file_io_ring_available()) return value_string("io_uring");
+#endif
+    return value_string("スレッドプール");
+}
+
 // =============================================================================
 // Promise チェーン - 組み込み関数
 // =============================================================================
@@ -875,33 +1759,12 @@ Value builtin_then(int argc, Value *argv) {
     }
     
     // 新しいスロットを確保（チェーン結果の受け皿）
-    int slot = -1;
-    for (int i = 0; i < MAX_ASYNC_TASKS; i++) {
-        if (!g_runtime.tasks[i].used) {
-            slot = i;
-            break;
-        }
-    }
-    if (slot < 0) {
+    AsyncTask *chain_task = task_alloc_locked();
+    if (chain_task == NULL) {
         pthread_mutex_unlock(&g_runtime.task_mutex);
         return value_number(-1);
     }
     
-    AsyncTask *chain_task = &g_runtime.tasks[slot];
-    memset(chain_task, 0, sizeof(AsyncTask));
-    chain_task->id = g_runtime.next_task_id++;
-    chain_task->status = TASK_PENDING;
-    chain_task->used = true;
-    task_index_insert_locked(chain_task);
-    chain_task->function = value_null();
-    chain_task->result = value_null();
-    chain_task->then_fn = value_null();
-    chain_task->catch_fn = value_null();
-    chain_task->chain_next_id = -1;
-    pthread_mutex_init(&chain_task->completion_mutex, NULL);
-    pthread_cond_init(&chain_task->completion_cond, NULL);
-    chain_task->completion_signaled = false;
-    
     int chain_id = chain_task->id;
     
     // ソースタスクに then コールバックを設定
@@ -939,31 +1802,11 @@ Value builtin_catch(int argc, Value *argv) {
     // チェーン先タスクが既にあればそれを使う、なければ新規作成
     int chain_id = source->chain_next_id;
     if (chain_id < 0) {
-        int slot = -1;
-        for (int i = 0; i < MAX_ASYNC_TASKS; i++) {
-            if (!g_runtime.tasks[i].used) {
-                slot = i;
-                break;
-            }
-        }
-        if (slot < 0) {
+        AsyncTask *chain_task = task_alloc_locked();
+        if (chain_task == NULL) {
             pthread_mutex_unlock(&g_runtime.task_mutex);
             return value_number(-1);
         }
-        AsyncTask *chain_task = &g_runtime.tasks[slot];
-        memset(chain_task, 0, sizeof(AsyncTask));
-        chain_task->id = g_runtime.next_task_id++;
-        chain_task->status = TASK_PENDING;
-        chain_task->used = true;
-        task_index_insert_locked(chain_task);
-        chain_task->function = value_null();
-        chain_task->result = value_null();
-        chain_task->then_fn = value_null();
-        chain_task->catch_fn = value_null();
-        chain_task->chain_next_id = -1;
-        pthread_mutex_init(&chain_task->completion_mutex, NULL);
-        pthread_cond_init(&chain_task->completion_cond, NULL);
-        chain_task->completion_signaled = false;
         chain_id = chain_task->id;
         source->chain_next_id = chain_id;
     }
@@ -1230,8 +2073,12 @@ Value builtin_semaphore_acquire(int argc, Value *argv) {
     UserSemaphore *sem = &g_runtime.semaphores[sem_id];
     
     pthread_mutex_lock(&sem->mutex);
-    while (sem->count <= 0) {
-        pthread_cond_wait(&sem->cond, &sem->mutex);
+    if (sem->count <= 0) {
+        TRACE_BEGIN(wait_start_us);
+        while (sem->count <= 0) {
+            pthread_cond_wait(&sem->cond, &sem->mutex);
+        }
+        trace_id_span("セマフォ待ち", "wait", wait_start_us, "セマフォ", sem_id);
     }
     sem->count--;
     pthread_mutex_unlock(&sem->mutex);
@@ -1451,8 +2298,12 @@ Value builtin_channel_send(int argc, Value *argv) {
     pthread_mutex_lock(&ch->mutex);
     
     // バッファが満杯なら待機
-    while (ch->count >= ch->capacity && !ch->closed) {
-        pthread_cond_wait(&ch->not_full, &ch->mutex);
+    if (ch->count >= ch->capacity && !ch->closed) {
+        TRACE_BEGIN(wait_start_us);
+        while (ch->count >= ch->capacity && !ch->closed) {
+            pthread_cond_wait(&ch->not_full, &ch->mutex);
+        }
+        trace_id_span("チャネル送信待ち", "channel", wait_start_us, "チャネル", ch_id);
     }
     
     if (ch->closed) {
@@ -1483,8 +2334,12 @@ Value builtin_channel_receive(int argc, Value *argv) {
     pthread_mutex_lock(&ch->mutex);
     
     // バッファが空なら待機
-    while (ch->count == 0 && !ch->closed) {
-        pthread_cond_wait(&ch->not_empty, &ch->mutex);
+    if (ch->count == 0 && !ch->closed) {
+        TRACE_BEGIN(wait_start_us);
+        while (ch->count == 0 && !ch->closed) {
+            pthread_cond_wait(&ch->not_empty, &ch->mutex);
+        }
+        trace_id_span("チャネル受信待ち", "channel", wait_start_us, "チャネル", ch_id);
     }
     
     if (ch->count == 0) {
@@ -1720,7 +2575,8 @@ static void *schedule_task_runner(void *arg) {
             Environment *prev = thread_eval->current;
             thread_eval->current = local;
             
-            evaluate(thread_eval, body);
+            Value body_result = evaluate(thread_eval, body);
+            value_free(&body_result);
             
             if (thread_eval->returning) {
                 thread_eval->returning = false;
@@ -1739,6 +2595,7 @@ static void *schedule_task_runner(void *arg) {
     } while (task->active && task->repeat);
     
     task->active = false;
+    __atomic_sub_fetch(&g_runtime.detached_threads, 1, __ATOMIC_RELEASE);
     return NULL;
 }
 
@@ -1782,8 +2639,7 @@ Value builtin_schedule_interval(int argc, Value *argv) {
     int task_id = task->id;
     
     // スレッドを作成
-    pthread_create(&task->thread, NULL, schedule_task_runner, task);
-    pthread_detach(task->thread);
+    spawn_detached_thread(&task->thread, schedule_task_runner, task);
     
     pthread_mutex_unlock(&g_runtime.schedule_mutex);
     
@@ -1825,8 +2681,7 @@ Value builtin_schedule_delay(int argc, Value *argv) {
     
     int task_id = task->id;
     
-    pthread_create(&task->thread, NULL, schedule_task_runner, task);
-    pthread_detach(task->thread);
+    spawn_detached_thread(&task->thread, schedule_task_runner, task);
     
     pthread_mutex_unlock(&g_runtime.schedule_mutex);
     
@@ -1988,14 +2843,15 @@ static bool ws_handshake(int sockfd, const char *host, int port, const char *pat
 }
 
 // WebSocketフレーム送信
-static bool ws_send_frame(int sockfd, const char *data, int len) {
+// opcode: 0x1 = テキスト, 0x2 = バイナリ
+static bool ws_send_frame(int sockfd, const char *data, int len, int opcode) {
     int frame_size = 14 + len;  // ヘッダー最大10 + マスク4 + データ
     unsigned char *frame = malloc(frame_size);
     if (!frame) return false;
     int offset = 0;
     
-    // FIN + TEXT opcode
-    frame[offset++] = 0x81;
+    // FIN + opcode
+    frame[offset++] = (unsigned char)(0x80 | (opcode & 0x0F));
     
     // マスクビット + ペイロード長
     if (len <= 125) {
@@ -2036,7 +2892,8 @@ static bool ws_send_frame(int sockfd, const char *data, int len) {
 }
 
 // WebSocketフレーム受信
-static int ws_recv_frame(int sockfd, char *buffer, int buf_size, double timeout_sec) {
+// out_opcodeにはフレームのopcode（0x1 テキスト / 0x2 バイナリ）を格納
+static int ws_recv_frame(int sockfd, char *buffer, int buf_size, double timeout_sec, int *out_opcode) {
     // タイムアウト設定
     struct timeval tv;
     tv.tv_sec = (long)timeout_sec;
@@ -2054,6 +2911,7 @@ static int ws_recv_frame(int sockfd, char *buffer, int buf_size, double timeout_
     // opcode確認
     int opcode = header[0] & 0x0F;
     if (opcode == 0x8) return -2;  // Close frame
+    if (out_opcode) *out_opcode = opcode;
     
     bool masked = (header[1] & 0x80) != 0;
     int payload_len = header[1] & 0x7F;
@@ -2180,9 +3038,10 @@ Value builtin_ws_connect(int argc, Value *argv) {
     return value_number(ws_id);
 }
 
-// WS送信(接続ID, メッセージ) → 真偽
+// WS送信(接続ID, メッセージ) → 真偽（バイト列はバイナリフレーム）
 Value builtin_ws_send(int argc, Value *argv) {
-    if (argc < 2 || argv[0].type != VALUE_NUMBER || argv[1].type != VALUE_STRING) {
+    if (argc < 2 || argv[0].type != VALUE_NUMBER ||
+        (argv[1].type != VALUE_STRING && argv[1].type != VALUE_BYTES)) {
         return value_bool(false);
     }
     
@@ -2201,13 +3060,16 @@ Value builtin_ws_send(int argc, Value *argv) {
     if (conn == NULL || !conn->connected) return value_bool(false);
     
     pthread_mutex_lock(&conn->mutex);
-    bool result = ws_send_frame(conn->sockfd, argv[1].string.data, argv[1].string.byte_length);
+    // バイト列はバイナリフレームとしてそのまま送る
+    bool result = argv[1].type == VALUE_BYTES
+        ? ws_send_frame(conn->sockfd, (const char *)bytes_data(&argv[1]), argv[1].bytes.length, 0x2)
+        : ws_send_frame(conn->sockfd, argv[1].string.data, argv[1].string.byte_length, 0x1);
     pthread_mutex_unlock(&conn->mutex);
     
     return value_bool(result);
 }
 
-// WS受信(接続ID, タイムアウト秒=5) → メッセージ文字列
+// WS受信(接続ID, タイムアウト秒=5) → メッセージ文字列（バイナリフレームはバイト列）
 Value builtin_ws_receive(int argc, Value *argv) {
     if (argc < 1 || argv[0].type != VALUE_NUMBER) return value_null();
     
@@ -2231,7 +3093,8 @@ Value builtin_ws_receive(int argc, Value *argv) {
     
     char buffer[65536];
     pthread_mutex_lock(&conn->mutex);
-    int len = ws_recv_frame(conn->sockfd, buffer, sizeof(buffer), timeout);
+    int opcode = 0x1;
+    int len = ws_recv_frame(conn->sockfd, buffer, sizeof(buffer), timeout, &opcode);
     pthread_mutex_unlock(&conn->mutex);
     
     if (len < 0) {
@@ -2242,6 +3105,8 @@ Value builtin_ws_receive(int argc, Value *argv) {
         return value_null();
     }
     
+    // バイナリフレームはNULを含み得るのでバイト列で返す
+    if (opcode == 0x2) return value_bytes(buffer, len);
     return value_string(buffer);
 }
 
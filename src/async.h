@@ -78,8 +78,13 @@ typedef struct {
 // スレッドプール
 // =============================================================================
 
+struct ParallelBatch;
+
 typedef struct {
     int task_id;                // 実行するタスクID
+    struct ParallelBatch *batch; // ネイティブ並列ループ（NULL なら task_id を実行）
+    bool chain_only;            // 完了済みタスクの Promise チェーンだけを処理する
+    double enqueued_us;         // トレース用の投入時刻（0 ならキュー待ちを記録しない）
 } PoolJob;
 
 typedef struct {
@@ -205,6 +210,7 @@ typedef struct {
     int next_atomic_id;
     pthread_mutex_t atomic_mgr_mutex;
     
+    int detached_threads;       // 実行中の切り離しスレッド数（終了時の待機用）
     bool initialized;
 } AsyncRuntime;
 
@@ -226,6 +232,14 @@ void async_runtime_cleanup(void);
 // スレッドプール
 // =============================================================================
 
+/**
+ * ネイティブ処理の並列ループ。fn(0) ... fn(count - 1) をスレッドプールで実行し、
+ * すべて終わるまで待つ。呼び出し元スレッドも処理に加わるため、ワーカーが
+ * 埋まっていても必ず完了する。fn から Value や評価器に触れてはいけない。
+ */
+typedef void (*AsyncParallelFn)(int index, void *arg);
+void async_parallel_for(int count, AsyncParallelFn fn, void *arg);
+
 /** プール作成(ワーカー数) → 真偽 */
 Value builtin_pool_create(int argc, Value *argv);
 
@@ -254,6 +268,26 @@ Value builtin_async_race(int argc, Value *argv);
 /** タスクキャンセル(タスクID) → 真偽 */
 Value builtin_task_cancel(int argc, Value *argv);
 
+// =============================================================================
+// 組み込み関数（非同期ファイルI/O）
+// Linux では io_uring、それ以外はスレッドプールで実行し、タスクIDを返す
+// =============================================================================
+
+/** 非同期読込(パス, バイト列で=偽) → タスクID（結果は文字列/バイト列、失敗時は無） */
+Value builtin_async_read_file(int argc, Value *argv);
+
+/** 非同期書込(パス, 内容) → タスクID（結果は真偽） */
+Value builtin_async_write_file(int argc, Value *argv);
+
+/** 非同期追記(パス, 内容) → タスクID（結果は真偽） */
+Value builtin_async_append_file(int argc, Value *argv);
+
+/** 非同期ファイル情報(パス) → タスクID（結果は辞書{サイズ, 更新時刻, ディレクトリ}、失敗時は無） */
+Value builtin_async_stat(int argc, Value *argv);
+
+/** 非同期IO方式() → "io_uring" / "スレッドプール" */
+Value builtin_async_io_backend(int argc, Value *argv);
+
 // =============================================================================
 // 組み込み関数（Promise チェーン）
 // =============================================================================
@@ -0,0 +1,540 @@
+/**
+ * はじむ - ベンチマークハーネス実装
+ *
+ * 計測対象は「新しいインタプリタプロセスで 1 ファイルを実行する」壁時計時間。
+ * 起動・パースも含めた実際の使われ方に揃えるため、自分自身の実行ファイルを
+ * 子プロセスとして起動し、標準出力・標準エラーは捨てる。
+ */
+
+#include "bench.h"
+#include "http.h"
+#include "value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  define TokenType  _winnt_TokenType_collision_guard_
+#  include <windows.h>   /* GetModuleFileNameA, FindFirstFile */
+#  undef TokenType
+#  include <process.h>   /* _spawnv */
+#  include <io.h>        /* _dup, _dup2 */
+#  include <fcntl.h>
+#else
+#  include <unistd.h>
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <sys/wait.h>
+#endif
+
+#define BENCH_PATH_MAX 4096
+
+typedef struct {
+    char *name;
+    double *samples;        // ミリ秒（昇順に並べ替え済み）
+    int sample_count;
+    bool failed;
+    double min_ms;
+    double median_ms;
+    double p95_ms;
+    double mean_ms;
+} BenchResult;
+
+typedef struct {
+    char *name;
+    double median_ms;
+} BenchBaseline;
+
+// =============================================================================
+// 計時・子プロセス
+// =============================================================================
+
+static double bench_now_ms(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static void bench_self_path(const char *argv0, char *out, size_t size) {
+#ifdef _WIN32
+    DWORD n = GetModuleFileNameA(NULL, out, (DWORD)size);
+    if (n > 0 && n < size) return;
+#elif defined(__linux__)
+    ssize_t n = readlink("/proc/self/exe", out, size - 1);
+    if (n > 0) {
+        out[n] = '\0';
+        return;
+    }
+#endif
+    snprintf(out, size, "%s", argv0);
+}
+
+// スクリプトを1回実行し、経過ミリ秒を返す（失敗時は負の値）
+static double bench_run_once(const char *exe, const char *script) {
+#ifdef _WIN32
+    fflush(stdout);
+    fflush(stderr);
+    int saved_out = _dup(1);
+    int saved_err = _dup(2);
+    int null_fd = _open("NUL", _O_WRONLY);
+    if (null_fd >= 0) {
+        _dup2(null_fd, 1);
+        _dup2(null_fd, 2);
+        _close(null_fd);
+    }
+    const char *args[] = {exe, script, NULL};
+    double start = bench_now_ms();
+    intptr_t status = _spawnv(_P_WAIT, exe, args);
+    double elapsed = bench_now_ms() - start;
+    _dup2(saved_out, 1);
+    _dup2(saved_err, 2);
+    _close(saved_out);
+    _close(saved_err);
+    return status == 0 ? elapsed : -1.0;
+#else
+    double start = bench_now_ms();
+    pid_t pid = fork();
+    if (pid < 0) return -1.0;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        execl(exe, exe, script, (char *)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1.0;
+    }
+    double elapsed = bench_now_ms() - start;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1.0;
+#endif
+}
+
+// =============================================================================
+// 統計
+// =============================================================================
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// 昇順の標本から線形補間で分位点を求める
+static double bench_percentile(const double *sorted, int count, double p) {
+    if (count <= 0) return 0.0;
+    double rank = p * (double)(count - 1);
+    int lo = (int)rank;
+    int hi = lo + 1 < count ? lo + 1 : lo;
+    double frac = rank - (double)lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * frac;
+}
+
+static bool bench_measure(const char *exe, const char *script, int warmup, int runs, BenchResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->name = strdup(script);
+    result->samples = malloc(sizeof(double) * (size_t)runs);
+    if (result->name == NULL || result->samples == NULL) return false;
+
+    for (int i = 0; i < warmup; i++) {
+        if (bench_run_once(exe, script) < 0) {
+            result->failed = true;
+            return true;
+        }
+    }
+    double sum = 0.0;
+    for (int i = 0; i < runs; i++) {
+        double ms = bench_run_once(exe, script);
+        if (ms < 0) {
+            result->failed = true;
+            return true;
+        }
+        result->samples[result->sample_count++] = ms;
+        sum += ms;
+    }
+    qsort(result->samples, (size_t)result->sample_count, sizeof(double), compare_doubles);
+    result->min_ms = result->samples[0];
+    result->median_ms = bench_percentile(result->samples, result->sample_count, 0.5);
+    result->p95_ms = bench_percentile(result->samples, result->sample_count, 0.95);
+    result->mean_ms = sum / (double)result->sample_count;
+    return true;
+}
+
+// 空のスクリプトの中央値を起動時間（プロセス生成・初期化・終了）とみなす
+static double bench_startup_ms(const char *exe, int warmup, int runs) {
+    char path[BENCH_PATH_MAX];
+#ifdef _WIN32
+    char dir[MAX_PATH];
+    if (GetTempPathA(sizeof(dir), dir) == 0) return -1.0;
+    snprintf(path, sizeof(path), "%shajimu_bench_empty_%lu.jp", dir, (unsigned long)GetCurrentProcessId());
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return -1.0;
+    fclose(fp);
+#else
+    const char *tmp = getenv("TMPDIR");
+    snprintf(path, sizeof(path), "%s/hajimu_bench_XXXXXX", tmp != NULL && tmp[0] != '\0' ? tmp : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) return -1.0;
+    close(fd);
+#endif
+    BenchResult empty;
+    double startup = -1.0;
+    if (bench_measure(exe, path, warmup, runs, &empty) && !empty.failed) {
+        startup = empty.median_ms;
+    }
+    free(empty.name);
+    free(empty.samples);
+    remove(path);
+    return startup;
+}
+
+// =============================================================================
+// ファイル列挙
+// =============================================================================
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static bool has_jp_extension(const char *name) {
+    size_t len = strlen(name);
+    return len > 3 && strcmp(name + len - 3, ".jp") == 0;
+}
+
+// dir 直下の *.jp を名前順に返す
+static char **bench_list_dir(const char *dir, int *count) {
+    *count = 0;
+    int capacity = 16;
+    char **files = malloc(sizeof(char *) * (size_t)capacity);
+    if (files == NULL) return NULL;
+
+#ifdef _WIN32
+    char pattern[BENCH_PATH_MAX];
+    snprintf(pattern, sizeof(pattern), "%s\\*.jp", dir);
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA(pattern, &data);
+    if (h == INVALID_HANDLE_VALUE) return files;
+    do {
+        const char *name = data.cFileName;
+#else
+    DIR *d = opendir(dir);
+    if (d == NULL) return files;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *name = entry->d_name;
+#endif
+        if (!has_jp_extension(name)) continue;
+        if (*count >= capacity) {
+            capacity *= 2;
+            char **grown = realloc(files, sizeof(char *) * (size_t)capacity);
+            if (grown == NULL) break;
+            files = grown;
+        }
+        char path[BENCH_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        files[(*count)++] = strdup(path);
+#ifdef _WIN32
+    } while (FindNextFileA(h, &data));
+    FindClose(h);
+#else
+    }
+    closedir(d);
+#endif
+
+    qsort(files, (size_t)*count, sizeof(char *), compare_strings);
+    return files;
+}
+
+// =============================================================================
+// JSON 入出力
+// =============================================================================
+
+static void bench_write_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static bool bench_write_json(const char *path, const BenchResult *results, int count,
+                             int runs, int warmup, double startup_ms) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) return false;
+
+    fprintf(out, "{\n  \"runs\": %d,\n  \"warmup\": %d,\n  \"startup_ms\": %.3f,\n  \"benchmarks\": [\n",
+            runs, warmup, startup_ms);
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"name\": ");
+        bench_write_json_string(out, r->name);
+        if (r->failed) {
+            fprintf(out, ", \"failed\": true}");
+        } else {
+            fprintf(out, ", \"min_ms\": %.3f, \"median_ms\": %.3f, \"p95_ms\": %.3f, \"mean_ms\": %.3f, \"samples_ms\": [",
+                    r->min_ms, r->median_ms, r->p95_ms, r->mean_ms);
+            for (int j = 0; j < r->sample_count; j++) {
+                fprintf(out, "%s%.3f", j > 0 ? ", " : "", r->samples[j]);
+            }
+            fprintf(out, "]}");
+        }
+        fprintf(out, "%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    return fclose(out) == 0;
+}
+
+static char *bench_read_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    if (size < 0) {
+        fclose(fp);
+        return NULL;
+    }
+    char *buf = malloc((size_t)size + 1);
+    if (buf == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    size_t n = fread(buf, 1, (size_t)size, fp);
+    buf[n] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+// bench_write_json が書いた JSON を json.c のパーサーで読み、benchmarks[].name と median_ms の組を拾う。
+// 失敗した項目（median_ms がない）は比較対象にしない
+static BenchBaseline *bench_load_baseline(const char *path, int *count) {
+    *count = 0;
+    char *text = bench_read_file(path);
+    if (text == NULL) return NULL;
+
+    Value root;
+    bool parsed = json_decode_checked(text, (int)strlen(text), &root);
+    free(text);
+    if (!parsed) return NULL;
+
+    Value benchmarks = root.type == VALUE_DICT ? dict_get(&root, "benchmarks") : value_null();
+    if (benchmarks.type != VALUE_ARRAY) {
+        value_free(&root);
+        return NULL;
+    }
+
+    BenchBaseline *entries = malloc(sizeof(BenchBaseline) * (size_t)(benchmarks.array.length > 0 ? benchmarks.array.length : 1));
+    for (int i = 0; entries != NULL && i < benchmarks.array.length; i++) {
+        Value *item = &benchmarks.array.elements[i];
+        if (item->type != VALUE_DICT) continue;
+        Value name = dict_get(item, "name");
+        Value median = dict_get(item, "median_ms");
+        if (name.type != VALUE_STRING || median.type != VALUE_NUMBER) continue;
+        entries[*count].name = strdup(name.string.data);
+        if (entries[*count].name == NULL) break;
+        entries[*count].median_ms = median.number;
+        (*count)++;
+    }
+    value_free(&root);
+    return entries;
+}
+
+// =============================================================================
+// コマンド本体
+// =============================================================================
+
+static void bench_usage(const char *program) {
+    printf("使用方法: %s bench [オプション] [ファイル...]\n", program);
+    printf("\n");
+    printf("ファイルを省略すると %s/*.jp を実行します。\n", BENCH_DEFAULT_DIR);
+    printf("\n");
+    printf("オプション:\n");
+    printf("  --runs=N            計測回数（既定: %d）\n", BENCH_DEFAULT_RUNS);
+    printf("  --warmup=N          計測前の捨て実行回数（既定: %d）\n", BENCH_DEFAULT_WARMUP);
+    printf("  --json=<file>       結果を JSON で保存\n");
+    printf("  --baseline=<file>   保存済み JSON と中央値を比較\n");
+    printf("  --threshold=<pct>   回帰とみなす悪化率（既定: %.0f%%）\n", BENCH_DEFAULT_THRESHOLD);
+}
+
+static bool parse_int_option(const char *arg, const char *prefix, int min, int *out) {
+    size_t len = strlen(prefix);
+    if (strncmp(arg, prefix, len) != 0) return false;
+    char *end = NULL;
+    long value = strtol(arg + len, &end, 10);
+    if (end == arg + len || *end != '\0' || value < min || value > 100000) {
+        fprintf(stderr, "エラー: %s には %d 以上の整数を指定してください\n", prefix, min);
+        exit(1);
+    }
+    *out = (int)value;
+    return true;
+}
+
+int bench_command(int argc, char **argv) {
+    int runs = BENCH_DEFAULT_RUNS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+
+    char **files = malloc(sizeof(char *) * (size_t)(argc > 2 ? argc : 1));
+    int file_count = 0;
+    if (files == NULL) return 1;
+
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            bench_usage(argv[0]);
+            free(files);
+            return 0;
+        } else if (parse_int_option(arg, "--runs=", 1, &runs) ||
+                   parse_int_option(arg, "--warmup=", 0, &warmup)) {
+            continue;
+        } else if (strncmp(arg, "--json=", 7) == 0) {
+            json_path = arg + 7;
+        } else if (strncmp(arg, "--baseline=", 11) == 0) {
+            baseline_path = arg + 11;
+        } else if (strncmp(arg, "--threshold=", 12) == 0) {
+            char *end = NULL;
+            threshold = strtod(arg + 12, &end);
+            if (end == arg + 12 || *end != '\0' || threshold < 0) {
+                fprintf(stderr, "エラー: --threshold には 0 以上の割合(%%)を指定してください\n");
+                free(files);
+                return 1;
+            }
+        } else if (arg[0] == '-') {
+            fprintf(stderr, "未知のオプション: %s\n", arg);
+            bench_usage(argv[0]);
+            free(files);
+            return 1;
+        } else {
+            files[file_count++] = strdup(arg);
+        }
+    }
+
+    if (file_count == 0) {
+        free(files);
+        files = bench_list_dir(BENCH_DEFAULT_DIR, &file_count);
+        if (files == NULL || file_count == 0) {
+            fprintf(stderr, "エラー: %s/*.jp が見つかりません\n", BENCH_DEFAULT_DIR);
+            free(files);
+            return 1;
+        }
+    }
+
+    BenchBaseline *baseline = NULL;
+    int baseline_count = 0;
+    if (baseline_path != NULL) {
+        baseline = bench_load_baseline(baseline_path, &baseline_count);
+        if (baseline == NULL) {
+            fprintf(stderr, "エラー: ベースラインを読み込めません: %s\n", baseline_path);
+            for (int i = 0; i < file_count; i++) free(files[i]);
+            free(files);
+            return 1;
+        }
+    }
+
+    char exe[BENCH_PATH_MAX];
+    bench_self_path(argv[0], exe, sizeof(exe));
+
+    double startup_ms = bench_startup_ms(exe, warmup, runs);
+    printf("ベンチマーク（ウォームアップ %d 回 + 計測 %d 回）\n", warmup, runs);
+    if (startup_ms >= 0) {
+        printf("起動時間（空スクリプトの中央値）: %.2f ms\n", startup_ms);
+    }
+    printf("\n%-32s %10s %10s %10s %10s", "benchmark", "min_ms", "median_ms", "p95_ms", "net_ms");
+    if (baseline != NULL) printf(" %10s", "vs base");
+    printf("\n");
+
+    BenchResult *results = calloc((size_t)file_count, sizeof(BenchResult));
+    int regressions = 0;
+    int failures = 0;
+    for (int i = 0; results != NULL && i < file_count; i++) {
+        BenchResult *r = &results[i];
+        if (!bench_measure(exe, files[i], warmup, runs, r) || r->failed) {
+            r->failed = true;
+            failures++;
+            printf("%-32s %10s\n", files[i], "失敗");
+            continue;
+        }
+        // net_ms は中央値から起動時間を引いたスクリプト本体の推定時間。
+        // 起動時間のばらつきより短く負になる場合は値を出さず、計測ノイズ以下と表示する
+        printf("%-32s %10.2f %10.2f %10.2f", r->name, r->min_ms, r->median_ms, r->p95_ms);
+        double net_ms = startup_ms >= 0 ? r->median_ms - startup_ms : r->median_ms;
+        if (net_ms < 0) {
+            printf(" %10s", "(ノイズ内)");
+        } else {
+            printf(" %10.2f", net_ms);
+        }
+        if (baseline != NULL) {
+            const BenchBaseline *base = NULL;
+            for (int b = 0; b < baseline_count; b++) {
+                if (strcmp(baseline[b].name, r->name) == 0) {
+                    base = &baseline[b];
+                    break;
+                }
+            }
+            if (base == NULL || base->median_ms <= 0) {
+                printf(" %10s", "(新規)");
+            } else {
+                double change = (r->median_ms - base->median_ms) / base->median_ms * 100.0;
+                printf(" %+9.1f%%", change);
+                if (change > threshold) {
+                    printf("  ← 回帰");
+                    regressions++;
+                }
+            }
+        }
+        printf("\n");
+    }
+
+    if (json_path != NULL && results != NULL) {
+        if (bench_write_json(json_path, results, file_count, runs, warmup, startup_ms)) {
+            printf("\n結果を %s に保存しました\n", json_path);
+        } else {
+            fprintf(stderr, "エラー: 結果を書き込めません: %s\n", json_path);
+            failures++;
+        }
+    }
+    if (baseline != NULL) {
+        if (regressions > 0) {
+            printf("\n%d 件のベンチマークがしきい値 %.1f%% を超えて遅くなりました\n", regressions, threshold);
+        } else {
+            printf("\n回帰なし（しきい値 %.1f%%）\n", threshold);
+        }
+    }
+
+    for (int i = 0; i < file_count; i++) {
+        free(files[i]);
+        if (results != NULL) {
+            free(results[i].name);
+            free(results[i].samples);
+        }
+    }
+    for (int i = 0; i < baseline_count; i++) {
+        free(baseline[i].name);
+    }
+    free(baseline);
+    free(results);
+    free(files);
+    return regressions > 0 || failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+/**
+ * はじむ - ベンチマークハーネス
+ *
+ * hajimu bench [オプション] [ファイル...]
+ *
+ * 各ベンチマークを別プロセスでウォームアップ後に N 回実行し、
+ * 最小・中央値・p95 と空スクリプトから推定した起動時間を表示する。
+ * 結果は JSON に保存でき、保存済みのベースラインと比べて中央値が
+ * しきい値を超えて遅くなったベンチマークを回帰として報告する。
+ *
+ * 結果 JSON:
+ *   {
+ *     "runs": 10, "warmup": 2, "startup_ms": 3.1,
+ *     "benchmarks": [
+ *       {"name": "benchmarks/vector_sum.jp", "min_ms": 4.2, "median_ms": 4.5,
+ *        "p95_ms": 5.0, "mean_ms": 4.6, "samples_ms": [...]}
+ *     ]
+ *   }
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#define BENCH_DEFAULT_RUNS       10
+#define BENCH_DEFAULT_WARMUP     2
+#define BENCH_DEFAULT_THRESHOLD  5.0    // 回帰とみなす中央値の悪化率（%）
+#define BENCH_DEFAULT_DIR        "benchmarks"
+
+/**
+ * bench サブコマンドを実行する（argv[1] は "bench" / "ベンチ"）。
+ * 回帰を検出した場合・失敗したベンチマークがある場合は 1 を返す
+ */
+int bench_command(int argc, char **argv);
+
+#endif // BENCH_H
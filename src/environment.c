@@ -15,6 +15,11 @@ extern GC *g_gc;
 // Environment の参照カウント更新はプロセス全体で直列化する。
 static pthread_mutex_t g_env_ref_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// 組み込み関数テーブル（評価器が登録する。グローバル環境には入れない）
+static EnvEntry *(*g_env_builtin_lookup)(const char *name) = NULL;
+static const EnvEntry *g_env_builtin_entries = NULL;
+static int g_env_builtin_count = 0;
+
 // =============================================================================
 // ハッシュ関数
 // =============================================================================
@@ -36,7 +41,9 @@ Environment *env_new(Environment *parent) {
     Environment *env = calloc(1, sizeof(Environment));
     if (env == NULL) return NULL;
 
+    // 子スコープ（呼び出しの局所環境・クロージャ）は親より長く生きうるので参照を持つ
     env->parent = parent;
+    env_retain(parent);
     env->depth = parent ? parent->depth + 1 : 0;
     env->ref_count = 1;
     
@@ -70,7 +77,9 @@ void env_free(Environment *env) {
         }
     }
     
+    Environment *parent = env->parent;
     free(env);
+    env_release(parent);
 }
 
 void env_retain(Environment *env) {
@@ -124,7 +133,13 @@ static EnvEntry *find_entry(Environment *env, const char *name) {
         env = env->parent;
     }
     
-    return NULL;
+    return g_env_builtin_lookup != NULL ? g_env_builtin_lookup(name) : NULL;
+}
+
+void env_set_builtins(EnvEntry *(*lookup)(const char *name), const EnvEntry *entries, int count) {
+    g_env_builtin_lookup = lookup;
+    g_env_builtin_entries = entries;
+    g_env_builtin_count = count;
 }
 
 // =============================================================================
@@ -145,6 +160,12 @@ bool env_define(Environment *env, const char *name, Value value, bool is_const)
         existing->is_const = is_const;
         return true;
     }
+
+    // 組み込み関数はグローバルスコープの定数と同じ扱い（内側のスコープでは隠せる）
+    if (env->parent == NULL && g_env_builtin_lookup != NULL &&
+        g_env_builtin_lookup(name) != NULL) {
+        return false;
+    }
     
     // 新しいエントリを作成
     EnvEntry *entry = malloc(sizeof(EnvEntry));
@@ -295,6 +316,13 @@ const char *env_find_similar(Environment *env, const char *name) {
             }
         }
     }
+    for (int i = 0; i < g_env_builtin_count; i++) {
+        int score = edit_distance(name, g_env_builtin_entries[i].name);
+        if (score < best_score) {
+            best_score = score;
+            best = g_env_builtin_entries[i].name;
+        }
+    }
 
     unsigned int cp[97];
     int len = utf8_to_codepoints(name, cp, 97);
@@ -35,7 +35,7 @@ typedef struct EnvEntry {
 typedef struct Environment {
     GCNode gc_node;                 // GC追跡ノード（先頭固定）
     EnvEntry *table[ENV_HASH_SIZE];  // ハッシュテーブル
-    struct Environment *parent;       // 親スコープ
+    struct Environment *parent;       // 親スコープ（子が参照を1つ持つ）
     int depth;                        // ネスト深度
     int ref_count;                    // 参照カウント
 } Environment;
@@ -124,6 +124,16 @@ bool env_is_const(Environment *env, const char *name);
  */
 bool env_exists_local(Environment *env, const char *name);
 
+/**
+ * 全スコープの外側にある読み取り専用の組み込みテーブルを登録する（プロセスで一度）。
+ * どのスコープにも無い名前は lookup で引き、グローバルスコープでは再定義できない。
+ * entries は「もしかして」の候補探索にも使う
+ * @param lookup 名前からエントリを引く関数（見つからなければNULL）
+ * @param entries エントリ配列
+ * @param count エントリ数
+ */
+void env_set_builtins(EnvEntry *(*lookup)(const char *name), const EnvEntry *entries, int count);
+
 /**
  * 近い名前の変数・関数を探す。
  * 未定義識別子エラーで「もしかして」を出すために使う。
@@ -11,6 +11,9 @@
 #include "diag.h"
 #include "bytecode.h"
 #include "gc.h"
+#include "mem_profile.h"
+#include "trace.h"
+#include "module_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +21,7 @@
 #include <math.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
 
 #if defined(HAJIMU_USE_ACCELERATE)
 #  include <Accelerate/Accelerate.h>
@@ -39,7 +43,11 @@
 #  include <unistd.h>
 #  include <regex.h>
 #  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
 #  include <dirent.h>
+#  include <signal.h>
+#  include <sys/time.h>
 #endif
 
 // グローバルevaluatorポインタ（高階関数・toStringプロトコル用）
@@ -54,12 +62,22 @@ static Evaluator *g_eval = NULL;
 #endif
 static HAJIMU_THREAD_LOCAL Evaluator *g_thread_eval = NULL;
 
+// 表示などスクリプト出力の書き出し先（NULL なら stdout。WASM セッションが差し替える）
+static FILE *g_evaluator_output = NULL;
+
 // グローバルGCインスタンス
 static GC g_gc_state;
 GC *g_gc = &g_gc_state;
 
+// プロファイル用の単調時計（CPU時間の clock() では待機やI/Oが見えず分解能も粗い）
 static double evaluator_now_ms(void) {
-    return (double)clock() * 1000.0 / (double)CLOCKS_PER_SEC;
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
 }
 
 static void maybe_collect_gc(void) {
@@ -118,6 +136,7 @@ static Value plugin_call_function(Value *func, int argc, Value *argv) {
         Value result = evaluate(g_eval, body);
         
         if (g_eval->returning) {
+            value_free(&result);
             result = g_eval->return_value;
             g_eval->returning = false;
         }
@@ -173,6 +192,8 @@ static const char *protected_runtime_name_kind(const char *name);
 static void protected_runtime_name_error(Evaluator *eval, ASTNode *node,
                                          const char *name, const char *action);
 static bool require_integer_index(Evaluator *eval, ASTNode *node, Value index, const char *target_name);
+static bool is_fresh_numeric_temporary(Evaluator *eval, ASTNode *node, Value value);
+static void release_builtin_arguments(Value *args, int count, Value result);
 static const char *find_similar_dict_key(Value *dict, const char *name);
 static const char *find_similar_instance_member(Value *instance, const char *name);
 static const char *find_similar_class_static_method(ASTNode *class_def, const char *name);
@@ -213,6 +234,9 @@ static Value builtin_variance(int argc, Value *argv);
 static Value builtin_std(int argc, Value *argv);
 static Value builtin_quantile(int argc, Value *argv);
 static Value builtin_median(int argc, Value *argv);
+static Value builtin_quantiles(int argc, Value *argv);
+static Value builtin_quantile_sketch(int argc, Value *argv);
+static Value builtin_quantile_sketch_add(int argc, Value *argv);
 static Value builtin_normalize(int argc, Value *argv);
 static Value builtin_norm(int argc, Value *argv);
 static Value builtin_minmax_scale(int argc, Value *argv);
@@ -221,6 +245,8 @@ static Value builtin_covariance(int argc, Value *argv);
 static Value builtin_correlation(int argc, Value *argv);
 static Value builtin_histogram(int argc, Value *argv);
 static Value builtin_train_test_split(int argc, Value *argv);
+static Value builtin_sliding_window(int argc, Value *argv);
+static Value builtin_shares_memory(int argc, Value *argv);
 static Value builtin_drop_missing(int argc, Value *argv);
 static Value builtin_fill_missing(int argc, Value *argv);
 static Value builtin_is_nan(int argc, Value *argv);
@@ -236,6 +262,14 @@ static Value builtin_vector_add(int argc, Value *argv);
 static Value builtin_vector_sub(int argc, Value *argv);
 static Value builtin_vector_mul(int argc, Value *argv);
 static Value builtin_vector_div(int argc, Value *argv);
+static Value builtin_vector_add_into(int argc, Value *argv);
+static Value builtin_vector_sub_into(int argc, Value *argv);
+static Value builtin_vector_mul_into(int argc, Value *argv);
+static Value builtin_vector_div_into(int argc, Value *argv);
+static Value builtin_vector_scale_inplace(int argc, Value *argv);
+static Value builtin_masked_select(int argc, Value *argv);
+static Value builtin_equal_mask(int argc, Value *argv);
+static Value builtin_not_equal_mask(int argc, Value *argv);
 static Value builtin_vector_abs(int argc, Value *argv);
 static Value builtin_vector_sqrt(int argc, Value *argv);
 static Value builtin_vector_sin(int argc, Value *argv);
@@ -254,6 +288,11 @@ static Value builtin_matrix_add(int argc, Value *argv);
 static Value builtin_matrix_sub(int argc, Value *argv);
 static Value builtin_matrix_scale(int argc, Value *argv);
 static Value builtin_matrix_hadamard(int argc, Value *argv);
+static Value builtin_matrix_add_into(int argc, Value *argv);
+static Value builtin_matrix_sub_into(int argc, Value *argv);
+static Value builtin_matrix_hadamard_into(int argc, Value *argv);
+static Value builtin_matrix_div_into(int argc, Value *argv);
+static Value builtin_matrix_scale_inplace(int argc, Value *argv);
 static Value builtin_identity(int argc, Value *argv);
 static Value builtin_determinant(int argc, Value *argv);
 static Value builtin_inverse(int argc, Value *argv);
@@ -267,9 +306,18 @@ static Value builtin_predict_logistic(int argc, Value *argv);
 static Value builtin_predict_logistic_class(int argc, Value *argv);
 static Value builtin_read_csv_numeric(int argc, Value *argv);
 static Value builtin_read_tsv_numeric(int argc, Value *argv);
+static Value builtin_npy_save(int argc, Value *argv);
+static Value builtin_npy_load(int argc, Value *argv);
 static Value builtin_read_csv(int argc, Value *argv);
 static Value builtin_csv_column(int argc, Value *argv);
 static Value builtin_read_json_lines(int argc, Value *argv);
+static Value builtin_csv_reader(int argc, Value *argv);
+static Value builtin_tsv_reader(int argc, Value *argv);
+static Value builtin_json_lines_reader(int argc, Value *argv);
+static Value builtin_read_batch(int argc, Value *argv);
+static Value builtin_read_numeric_block(int argc, Value *argv);
+static Value builtin_reader_close(int argc, Value *argv);
+static void data_readers_close_all(void);
 static Value builtin_describe(int argc, Value *argv);
 
 // 辞書関数
@@ -313,6 +361,8 @@ static Value builtin_foreach(int argc, Value *argv);
 static Value builtin_regex_match(int argc, Value *argv);
 static Value builtin_regex_search(int argc, Value *argv);
 static Value builtin_regex_replace(int argc, Value *argv);
+static Value builtin_regex_compile(int argc, Value *argv);
+static Value builtin_regex_find_all(int argc, Value *argv);
 
 // 型チェック関数
 static Value builtin_is_number(int argc, Value *argv);
@@ -368,6 +418,17 @@ static Value builtin_file_append(int argc, Value *argv);
 static Value builtin_dir_list(int argc, Value *argv);
 static Value builtin_dir_create(int argc, Value *argv);
 
+// ファイルハンドル
+static Value builtin_file_open(int argc, Value *argv);
+static Value builtin_file_read_line(int argc, Value *argv);
+static Value builtin_file_read_chunk(int argc, Value *argv);
+static Value builtin_file_handle_write(int argc, Value *argv);
+static Value builtin_file_handle_write_line(int argc, Value *argv);
+static Value builtin_file_flush(int argc, Value *argv);
+static Value builtin_file_close(int argc, Value *argv);
+static Value builtin_file_lines(int argc, Value *argv);
+static bool file_handle_read_line_into(FileHandle *handle, char **line, size_t *capacity, size_t *length);
+
 // その他ユーティリティ
 static Value builtin_assert(int argc, Value *argv);
 static Value builtin_typeof_check(int argc, Value *argv);
@@ -391,6 +452,11 @@ static Value builtin_dirname(int argc, Value *argv);
 static Value builtin_extension(int argc, Value *argv);
 
 // Base64関数
+static Value builtin_bytes(int argc, Value *argv);
+static Value builtin_bytes_to_string(int argc, Value *argv);
+static Value builtin_read_file_bytes(int argc, Value *argv);
+static Value builtin_write_file_bytes(int argc, Value *argv);
+static Value builtin_read_bytes(int argc, Value *argv);
 static Value builtin_base64_encode(int argc, Value *argv);
 static Value builtin_base64_decode(int argc, Value *argv);
 
@@ -486,6 +552,13 @@ static Evaluator *evaluator_new_internal(bool owns_runtime_context) {
     eval->ast_profile_entries = NULL;
     eval->ast_profile_count = 0;
     eval->ast_profile_capacity = 0;
+    eval->ast_profile_index = (ProfileIndex){0};
+    eval->ast_profile_child_ms = 0.0;
+    eval->function_profile_entries = NULL;
+    eval->function_profile_count = 0;
+    eval->function_profile_capacity = 0;
+    eval->function_profile_index = (ProfileIndex){0};
+    eval->function_profile_child_ms = 0.0;
     eval->owns_runtime_context = owns_runtime_context;
     
     if (owns_runtime_context) {
@@ -534,6 +607,7 @@ void evaluator_free(Evaluator *eval) {
     
     if (eval->owns_runtime_context && eval == g_eval) {
         async_runtime_cleanup();
+        data_readers_close_all();
         g_eval = NULL;
     }
     if (eval == g_thread_eval) {
@@ -557,6 +631,9 @@ void evaluator_free(Evaluator *eval) {
     // プラグインマネージャを解放
     plugin_manager_free(&eval->plugin_manager);
     free(eval->ast_profile_entries);
+    free(eval->ast_profile_index.slots);
+    free(eval->function_profile_entries);
+    free(eval->function_profile_index.slots);
     
     if (eval->owns_runtime_context) {
         gc_collect(g_gc);
@@ -578,51 +655,166 @@ void evaluator_set_ast_profile_enabled(Evaluator *eval, bool enabled) {
     }
 }
 
-static AstProfileEntry *find_or_add_ast_profile_entry(Evaluator *eval, const ASTNode *node) {
-    if (eval == NULL || node == NULL) return NULL;
+static size_t profile_index_hash(const ASTNode *node) {
+    uint64_t x = (uint64_t)(uintptr_t)node;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
 
-    for (int i = 0; i < eval->ast_profile_count; i++) {
-        if (eval->ast_profile_entries[i].node == node) {
-            return &eval->ast_profile_entries[i];
+// 見つかればエントリ番号、なければ -1
+static int profile_index_find(const ProfileIndex *index, const ASTNode *node) {
+    if (index->capacity == 0) return -1;
+    size_t mask = (size_t)index->capacity - 1;
+    for (size_t i = profile_index_hash(node) & mask;; i = (i + 1) & mask) {
+        const ProfileIndexSlot *slot = &index->slots[i];
+        if (slot->node == node) return slot->entry;
+        if (slot->node == NULL) return -1;
+    }
+}
+
+static bool profile_index_insert(ProfileIndex *index, const ASTNode *node, int entry) {
+    if ((index->count + 1) * 2 > index->capacity) {
+        int new_capacity = index->capacity < 64 ? 64 : index->capacity * 2;
+        ProfileIndexSlot *slots = calloc((size_t)new_capacity, sizeof(ProfileIndexSlot));
+        if (slots == NULL) return false;
+        size_t mask = (size_t)new_capacity - 1;
+        for (int i = 0; i < index->capacity; i++) {
+            if (index->slots[i].node == NULL) continue;
+            size_t j = profile_index_hash(index->slots[i].node) & mask;
+            while (slots[j].node != NULL) j = (j + 1) & mask;
+            slots[j] = index->slots[i];
         }
+        free(index->slots);
+        index->slots = slots;
+        index->capacity = new_capacity;
     }
 
+    size_t mask = (size_t)index->capacity - 1;
+    size_t i = profile_index_hash(node) & mask;
+    while (index->slots[i].node != NULL) i = (i + 1) & mask;
+    index->slots[i].node = node;
+    index->slots[i].entry = entry;
+    index->count++;
+    return true;
+}
+
+static int find_or_add_ast_profile_entry(Evaluator *eval, const ASTNode *node) {
+    if (eval == NULL || node == NULL) return -1;
+
+    int found = profile_index_find(&eval->ast_profile_index, node);
+    if (found >= 0) return found;
+
     if (eval->ast_profile_count >= eval->ast_profile_capacity) {
         int new_capacity = eval->ast_profile_capacity < 16 ? 16 : eval->ast_profile_capacity * 2;
         AstProfileEntry *entries = realloc(eval->ast_profile_entries,
                                            sizeof(AstProfileEntry) * (size_t)new_capacity);
-        if (entries == NULL) return NULL;
+        if (entries == NULL) return -1;
         eval->ast_profile_entries = entries;
         eval->ast_profile_capacity = new_capacity;
     }
+    if (!profile_index_insert(&eval->ast_profile_index, node, eval->ast_profile_count)) {
+        return -1;
+    }
 
-    AstProfileEntry *entry = &eval->ast_profile_entries[eval->ast_profile_count++];
+    AstProfileEntry *entry = &eval->ast_profile_entries[eval->ast_profile_count];
     entry->node = node;
     entry->type = node->type;
     entry->line = node->location.line;
     entry->column = node->location.column;
     entry->count = 0;
+    entry->active = 0;
     entry->total_ms = 0.0;
+    entry->self_ms = 0.0;
     entry->max_ms = 0.0;
+    return eval->ast_profile_count++;
+}
+
+// ノード評価の開始時に呼ぶ。戻り値のエントリ番号を record_ast_profile に渡す
+static int begin_ast_profile(Evaluator *eval, const ASTNode *node) {
+    int entry = find_or_add_ast_profile_entry(eval, node);
+    if (entry >= 0) {
+        eval->ast_profile_entries[entry].active++;
+    }
     return entry;
 }
 
-static void record_ast_profile(Evaluator *eval, const ASTNode *node, double elapsed_ms) {
-    if (eval == NULL || !eval->ast_profile_enabled || node == NULL) return;
-    AstProfileEntry *entry = find_or_add_ast_profile_entry(eval, node);
-    if (entry == NULL) return;
+static void record_ast_profile(Evaluator *eval, int entry_index, double elapsed_ms, double self_ms) {
+    if (entry_index < 0) return;
+    AstProfileEntry *entry = &eval->ast_profile_entries[entry_index];
     entry->count++;
-    entry->total_ms += elapsed_ms;
+    entry->self_ms += self_ms;
+    // 再帰では最も外側の評価だけを包括時間に数える
+    if (--entry->active == 0) {
+        entry->total_ms += elapsed_ms;
+    }
     if (elapsed_ms > entry->max_ms) {
         entry->max_ms = elapsed_ms;
     }
 }
 
+// 関数呼び出し1回分のプロファイル状態（呼び出し側のスタックに置く）
+typedef struct {
+    int entry;
+    double start_ms;
+    double saved_child_ms;
+} FunctionProfileFrame;
+
+static void function_profile_enter(Evaluator *eval, const ASTNode *def, const char *name,
+                                   FunctionProfileFrame *frame) {
+    frame->entry = -1;
+    if (eval == NULL || !eval->ast_profile_enabled || def == NULL) return;
+
+    int found = profile_index_find(&eval->function_profile_index, def);
+    if (found < 0) {
+        if (eval->function_profile_count >= eval->function_profile_capacity) {
+            int new_capacity = eval->function_profile_capacity < 16 ? 16 : eval->function_profile_capacity * 2;
+            FunctionProfileEntry *entries = realloc(eval->function_profile_entries,
+                                                    sizeof(FunctionProfileEntry) * (size_t)new_capacity);
+            if (entries == NULL) return;
+            eval->function_profile_entries = entries;
+            eval->function_profile_capacity = new_capacity;
+        }
+        found = eval->function_profile_count;
+        if (!profile_index_insert(&eval->function_profile_index, def, found)) return;
+        FunctionProfileEntry *entry = &eval->function_profile_entries[found];
+        entry->definition = def;
+        entry->name = name;
+        entry->line = def->location.line;
+        entry->calls = 0;
+        entry->active = 0;
+        entry->total_ms = 0.0;
+        entry->self_ms = 0.0;
+        eval->function_profile_count++;
+    }
+
+    eval->function_profile_entries[found].calls++;
+    eval->function_profile_entries[found].active++;
+    frame->entry = found;
+    frame->saved_child_ms = eval->function_profile_child_ms;
+    eval->function_profile_child_ms = 0.0;
+    frame->start_ms = evaluator_now_ms();
+}
+
+static void function_profile_leave(Evaluator *eval, FunctionProfileFrame *frame) {
+    if (frame->entry < 0) return;
+    double elapsed_ms = evaluator_now_ms() - frame->start_ms;
+    FunctionProfileEntry *entry = &eval->function_profile_entries[frame->entry];
+    entry->self_ms += elapsed_ms - eval->function_profile_child_ms;
+    // 再帰では最も外側の呼び出しだけを包括時間に数える
+    if (--entry->active == 0) {
+        entry->total_ms += elapsed_ms;
+    }
+    eval->function_profile_child_ms = frame->saved_child_ms + elapsed_ms;
+}
+
+// 自己時間の降順（包括時間順だとプログラム全体のブロックが常に上位を占める）
 static int compare_ast_profile_entries(const void *a, const void *b) {
     const AstProfileEntry *left = *(const AstProfileEntry * const *)a;
     const AstProfileEntry *right = *(const AstProfileEntry * const *)b;
-    if (left->total_ms < right->total_ms) return 1;
-    if (left->total_ms > right->total_ms) return -1;
+    if (left->self_ms < right->self_ms) return 1;
+    if (left->self_ms > right->self_ms) return -1;
     if (left->count < right->count) return 1;
     if (left->count > right->count) return -1;
     return 0;
@@ -651,12 +843,14 @@ void evaluator_print_ast_profile(Evaluator *eval, int limit) {
           compare_ast_profile_entries);
 
     fprintf(stderr, "ASTプロファイル（上位%d件 / 全%d件）:\n", limit, eval->ast_profile_count);
-    fprintf(stderr, "  %-22s %8s %12s %12s %10s\n", "node", "count", "total_ms", "max_ms", "line:col");
+    fprintf(stderr, "  %-22s %8s %12s %12s %12s %10s\n",
+            "node", "count", "self_ms", "total_ms", "max_ms", "line:col");
     for (int i = 0; i < limit; i++) {
         AstProfileEntry *entry = sorted[i];
-        fprintf(stderr, "  %-22s %8ld %12.3f %12.3f %5d:%-4d\n",
+        fprintf(stderr, "  %-22s %8ld %12.3f %12.3f %12.3f %5d:%-4d\n",
                 node_type_name(entry->type),
                 entry->count,
+                entry->self_ms,
                 entry->total_ms,
                 entry->max_ms,
                 entry->line,
@@ -665,6 +859,275 @@ void evaluator_print_ast_profile(Evaluator *eval, int limit) {
     free(sorted);
 }
 
+static int compare_function_profile_entries(const void *a, const void *b) {
+    const FunctionProfileEntry *left = *(const FunctionProfileEntry * const *)a;
+    const FunctionProfileEntry *right = *(const FunctionProfileEntry * const *)b;
+    if (left->self_ms < right->self_ms) return 1;
+    if (left->self_ms > right->self_ms) return -1;
+    if (left->calls < right->calls) return 1;
+    if (left->calls > right->calls) return -1;
+    return 0;
+}
+
+void evaluator_print_function_profile(Evaluator *eval, int limit) {
+    if (eval == NULL || eval->function_profile_count <= 0) {
+        fprintf(stderr, "関数別時間: 記録なし\n");
+        return;
+    }
+
+    if (limit <= 0 || limit > eval->function_profile_count) {
+        limit = eval->function_profile_count;
+    }
+
+    FunctionProfileEntry **sorted = malloc(sizeof(FunctionProfileEntry *) * (size_t)eval->function_profile_count);
+    if (sorted == NULL) {
+        fprintf(stderr, "関数別時間: 出力用メモリを確保できませんでした\n");
+        return;
+    }
+
+    for (int i = 0; i < eval->function_profile_count; i++) {
+        sorted[i] = &eval->function_profile_entries[i];
+    }
+    qsort(sorted, (size_t)eval->function_profile_count, sizeof(FunctionProfileEntry *),
+          compare_function_profile_entries);
+
+    fprintf(stderr, "関数別時間（上位%d件 / 全%d件）:\n", limit, eval->function_profile_count);
+    fprintf(stderr, "  %-22s %8s %12s %12s %6s\n", "function", "calls", "self_ms", "total_ms", "line");
+    for (int i = 0; i < limit; i++) {
+        FunctionProfileEntry *entry = sorted[i];
+        fprintf(stderr, "  %-22s %8ld %12.3f %12.3f %6d\n",
+                entry->name,
+                entry->calls,
+                entry->self_ms,
+                entry->total_ms,
+                entry->line);
+    }
+    free(sorted);
+}
+
+// =============================================================================
+// サンプリングプロファイル
+// =============================================================================
+//
+// SIGPROF（ITIMER_PROF）はプロセスのCPU時間で発火し、その時CPUを使っている
+// スレッドに届く。ハンドラは割り込まれたスレッドの評価器（g_thread_eval）の
+// コールスタックを読み、事前確保した表へ同じスタックごとに数えて積む。
+// ハンドラ内では malloc も stdio も使わない。
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+
+#define SAMPLE_PROFILE_MAX_DEPTH 64
+#define SAMPLE_PROFILE_TABLE_SIZE 4096   // 異なるスタックの最大数（2の累乗）
+
+typedef struct {
+    const char *name;
+    int line;
+} SampleFrame;
+
+typedef struct {
+    uint64_t hash;      // 0 は空き
+    int depth;
+    long count;
+    SampleFrame frames[SAMPLE_PROFILE_MAX_DEPTH];
+} SampleStack;
+
+static SampleStack *g_sample_stacks = NULL;
+static char g_sample_lock = 0;
+static long g_sample_dropped = 0;
+static struct sigaction g_sample_prev_action;
+static char *g_sample_path = NULL;
+static bool g_sample_atexit_registered = false;
+
+static bool sample_frames_equal(const SampleFrame *a, const SampleFrame *b, int depth) {
+    for (int i = 0; i < depth; i++) {
+        if (a[i].name != b[i].name || a[i].line != b[i].line) return false;
+    }
+    return true;
+}
+
+static int sample_capture_stack(const Evaluator *eval, SampleFrame *frames) {
+    int call_depth = eval->call_stack_depth;
+    if (call_depth > 128) call_depth = 128;
+    if (call_depth < 0) call_depth = 0;
+
+    // 各フレームの行はそのフレーム内で実行中の行（呼び出し先があれば呼び出し位置）
+    int depth = 0;
+    frames[depth].name = eval->owns_runtime_context ? "<トップレベル>" : "<非同期タスク>";
+    frames[depth].line = call_depth > 0 ? eval->call_stack[0].line : eval->current_line;
+    depth++;
+    for (int i = 0; i < call_depth && depth < SAMPLE_PROFILE_MAX_DEPTH; i++) {
+        const char *name = eval->call_stack[i].func_name;
+        frames[depth].name = name != NULL ? name : "?";
+        frames[depth].line = i + 1 < call_depth ? eval->call_stack[i + 1].line : eval->current_line;
+        depth++;
+    }
+    return depth;
+}
+
+static void sample_profile_signal(int sig) {
+    (void)sig;
+    Evaluator *eval = g_thread_eval;
+    if (eval == NULL || __atomic_load_n(&g_sample_stacks, __ATOMIC_ACQUIRE) == NULL) return;
+
+    int saved_errno = errno;
+    if (__atomic_test_and_set(&g_sample_lock, __ATOMIC_ACQUIRE)) {
+        // 他スレッドが記録中ならこのサンプルは捨てる
+        __atomic_add_fetch(&g_sample_dropped, 1, __ATOMIC_RELAXED);
+        errno = saved_errno;
+        return;
+    }
+    // 表はロックを取ってから読み直す。停止処理は表を外してからロックを待つので、
+    // ここで非 NULL なら解放されるのはこのハンドラがロックを放した後になる
+    SampleStack *table = __atomic_load_n(&g_sample_stacks, __ATOMIC_ACQUIRE);
+    if (table == NULL) {
+        __atomic_clear(&g_sample_lock, __ATOMIC_RELEASE);
+        errno = saved_errno;
+        return;
+    }
+
+    SampleFrame frames[SAMPLE_PROFILE_MAX_DEPTH];
+    int depth = sample_capture_stack(eval, frames);
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i].name) * 1099511628211ULL;
+        hash = (hash ^ (uint64_t)(unsigned)frames[i].line) * 1099511628211ULL;
+    }
+    if (hash == 0) hash = 1;
+
+    size_t mask = SAMPLE_PROFILE_TABLE_SIZE - 1;
+    size_t slot = (size_t)(hash ^ (hash >> 32)) & mask;
+    bool recorded = false;
+    for (size_t probe = 0; probe < SAMPLE_PROFILE_TABLE_SIZE; probe++, slot = (slot + 1) & mask) {
+        SampleStack *entry = &table[slot];
+        if (entry->hash == 0) {
+            entry->hash = hash;
+            entry->depth = depth;
+            entry->count = 1;
+            memcpy(entry->frames, frames, sizeof(SampleFrame) * (size_t)depth);
+            recorded = true;
+            break;
+        }
+        if (entry->hash == hash && entry->depth == depth &&
+            sample_frames_equal(entry->frames, frames, depth)) {
+            entry->count++;
+            recorded = true;
+            break;
+        }
+    }
+    if (!recorded) {
+        g_sample_dropped++;
+    }
+
+    __atomic_clear(&g_sample_lock, __ATOMIC_RELEASE);
+    errno = saved_errno;
+}
+
+// 終了() で exit() した場合など、main の停止処理を通らずに抜けても書き出す
+static void sample_profile_atexit(void) {
+    if (__atomic_load_n(&g_sample_stacks, __ATOMIC_ACQUIRE) != NULL) {
+        evaluator_stop_sample_profile();
+    }
+}
+
+bool evaluator_start_sample_profile(int hz, const char *path) {
+    if (hz <= 0 || hz > 10000 || path == NULL || g_sample_stacks != NULL) return false;
+
+    char *path_copy = strdup(path);
+    SampleStack *table = calloc(SAMPLE_PROFILE_TABLE_SIZE, sizeof(SampleStack));
+    if (path_copy == NULL || table == NULL) {
+        free(path_copy);
+        free(table);
+        return false;
+    }
+    free(g_sample_path);
+    g_sample_path = path_copy;
+    g_sample_dropped = 0;
+    __atomic_store_n(&g_sample_stacks, table, __ATOMIC_RELEASE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sample_profile_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &g_sample_prev_action) != 0) {
+        g_sample_stacks = NULL;
+        free(table);
+        return false;
+    }
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    if (timer.it_interval.tv_usec == 0) timer.it_interval.tv_usec = 1;
+    if (hz == 1) {
+        timer.it_interval.tv_sec = 1;
+        timer.it_interval.tv_usec = 0;
+    }
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        sigaction(SIGPROF, &g_sample_prev_action, NULL);
+        g_sample_stacks = NULL;
+        free(table);
+        return false;
+    }
+    if (!g_sample_atexit_registered) {
+        atexit(sample_profile_atexit);
+        g_sample_atexit_registered = true;
+    }
+    return true;
+}
+
+long evaluator_stop_sample_profile(void) {
+    // 表を取り出した1回だけが書き出す（main の停止処理と atexit が重ならない）
+    SampleStack *table = __atomic_exchange_n(&g_sample_stacks, NULL, __ATOMIC_ACQ_REL);
+    if (table == NULL) return -1;
+
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    // 既に保留中の SIGPROF が既定動作（終了）にならないよう無視してから外す
+    signal(SIGPROF, SIG_IGN);
+    while (__atomic_test_and_set(&g_sample_lock, __ATOMIC_ACQUIRE)) {
+        // 表を外す前に読んだハンドラが記録を終えるのを待つ（以降のハンドラは NULL を見て抜ける）
+    }
+    __atomic_clear(&g_sample_lock, __ATOMIC_RELEASE);
+
+    long samples = -1;
+    FILE *out = fopen(g_sample_path, "w");
+    if (out != NULL) {
+        samples = 0;
+        for (int i = 0; i < SAMPLE_PROFILE_TABLE_SIZE; i++) {
+            const SampleStack *entry = &table[i];
+            if (entry->hash == 0) continue;
+            for (int f = 0; f < entry->depth; f++) {
+                fprintf(out, "%s%s:%d", f > 0 ? ";" : "", entry->frames[f].name, entry->frames[f].line);
+            }
+            fprintf(out, " %ld\n", entry->count);
+            samples += entry->count;
+        }
+        if (fclose(out) != 0) samples = -1;
+    }
+    if (g_sample_dropped > 0) {
+        fprintf(stderr, "サンプリングプロファイル: %ld サンプルを記録できませんでした\n", g_sample_dropped);
+    }
+    free(table);
+    return samples;
+}
+
+#else
+
+bool evaluator_start_sample_profile(int hz, const char *path) {
+    (void)hz;
+    (void)path;
+    return false;
+}
+
+long evaluator_stop_sample_profile(void) {
+    return -1;
+}
+
+#endif
+
 // =============================================================================
 // 組み込み関数の登録
 // =============================================================================
@@ -799,6 +1262,22 @@ static const BuiltinEntry builtin_entries[] = {
     {"list_dir", builtin_dir_list, 1, 1},
     {"ディレクトリ作成", builtin_dir_create, 1, 1},
     {"make_dir", builtin_dir_create, 1, 1},
+    {"ファイル開く", builtin_file_open, 1, 3},
+    {"open_file", builtin_file_open, 1, 3},
+    {"行読込", builtin_file_read_line, 1, 1},
+    {"read_line", builtin_file_read_line, 1, 1},
+    {"チャンク読込", builtin_file_read_chunk, 2, 2},
+    {"read_chunk", builtin_file_read_chunk, 2, 2},
+    {"書出", builtin_file_handle_write, 2, 2},
+    {"write", builtin_file_handle_write, 2, 2},
+    {"行書出", builtin_file_handle_write_line, 2, 2},
+    {"write_line", builtin_file_handle_write_line, 2, 2},
+    {"フラッシュ", builtin_file_flush, 1, 1},
+    {"flush", builtin_file_flush, 1, 1},
+    {"ファイル閉じる", builtin_file_close, 1, 1},
+    {"close_file", builtin_file_close, 1, 1},
+    {"ファイル行", builtin_file_lines, 1, 2},
+    {"file_lines", builtin_file_lines, 1, 2},
     {"mkdir", builtin_dir_create, 1, 1},
     {"表明", builtin_assert, 1, 2},
     {"assert", builtin_assert, 1, 2},
@@ -841,6 +1320,12 @@ static const BuiltinEntry builtin_entries[] = {
     {"quantile", builtin_quantile, 2, 2},
     {"中央値", builtin_median, 1, 1},
     {"median", builtin_median, 1, 1},
+    {"分位点群", builtin_quantiles, 2, 3},
+    {"quantiles", builtin_quantiles, 2, 3},
+    {"分位点スケッチ", builtin_quantile_sketch, 0, 1},
+    {"quantile_sketch", builtin_quantile_sketch, 0, 1},
+    {"分位点スケッチ追加", builtin_quantile_sketch_add, 2, 2},
+    {"quantile_sketch_add", builtin_quantile_sketch_add, 2, 2},
     {"標準化", builtin_normalize, 1, 1},
     {"normalize", builtin_normalize, 1, 1},
     {"Zスコア", builtin_normalize, 1, 1},
@@ -859,6 +1344,10 @@ static const BuiltinEntry builtin_entries[] = {
     {"histogram", builtin_histogram, 2, 2},
     {"訓練テスト分割", builtin_train_test_split, 2, 3},
     {"train_test_split", builtin_train_test_split, 2, 3},
+    {"スライド窓", builtin_sliding_window, 2, 3},
+    {"sliding_window", builtin_sliding_window, 2, 3},
+    {"メモリ共有か", builtin_shares_memory, 2, 2},
+    {"shares_memory", builtin_shares_memory, 2, 2},
     {"欠損削除", builtin_drop_missing, 1, 1},
     {"drop_missing", builtin_drop_missing, 1, 1},
     {"欠損補完", builtin_fill_missing, 2, 2},
@@ -889,6 +1378,22 @@ static const BuiltinEntry builtin_entries[] = {
     {"vector_mul", builtin_vector_mul, 2, 2},
     {"ベクトル除算", builtin_vector_div, 2, 2},
     {"vector_div", builtin_vector_div, 2, 2},
+    {"ベクトル加算格納", builtin_vector_add_into, 3, 3},
+    {"vector_add_into", builtin_vector_add_into, 3, 3},
+    {"ベクトル減算格納", builtin_vector_sub_into, 3, 3},
+    {"vector_sub_into", builtin_vector_sub_into, 3, 3},
+    {"ベクトル乗算格納", builtin_vector_mul_into, 3, 3},
+    {"vector_mul_into", builtin_vector_mul_into, 3, 3},
+    {"ベクトル除算格納", builtin_vector_div_into, 3, 3},
+    {"vector_div_into", builtin_vector_div_into, 3, 3},
+    {"ベクトルその場スケール", builtin_vector_scale_inplace, 2, 2},
+    {"vector_scale_inplace", builtin_vector_scale_inplace, 2, 2},
+    {"マスク選択", builtin_masked_select, 2, 2},
+    {"masked_select", builtin_masked_select, 2, 2},
+    {"等しいマスク", builtin_equal_mask, 2, 2},
+    {"equal_mask", builtin_equal_mask, 2, 2},
+    {"等しくないマスク", builtin_not_equal_mask, 2, 2},
+    {"not_equal_mask", builtin_not_equal_mask, 2, 2},
     {"ベクトル絶対値", builtin_vector_abs, 1, 1},
     {"vector_abs", builtin_vector_abs, 1, 1},
     {"ベクトル平方根", builtin_vector_sqrt, 1, 1},
@@ -925,6 +1430,16 @@ static const BuiltinEntry builtin_entries[] = {
     {"matrix_scale", builtin_matrix_scale, 2, 2},
     {"行列要素積", builtin_matrix_hadamard, 2, 2},
     {"matrix_hadamard", builtin_matrix_hadamard, 2, 2},
+    {"行列加算格納", builtin_matrix_add_into, 3, 3},
+    {"matrix_add_into", builtin_matrix_add_into, 3, 3},
+    {"行列減算格納", builtin_matrix_sub_into, 3, 3},
+    {"matrix_sub_into", builtin_matrix_sub_into, 3, 3},
+    {"行列要素積格納", builtin_matrix_hadamard_into, 3, 3},
+    {"matrix_hadamard_into", builtin_matrix_hadamard_into, 3, 3},
+    {"行列除算格納", builtin_matrix_div_into, 3, 3},
+    {"matrix_div_into", builtin_matrix_div_into, 3, 3},
+    {"行列その場スケール", builtin_matrix_scale_inplace, 2, 2},
+    {"matrix_scale_inplace", builtin_matrix_scale_inplace, 2, 2},
     {"単位行列", builtin_identity, 1, 1},
     {"identity", builtin_identity, 1, 1},
     {"行列式", builtin_determinant, 1, 1},
@@ -948,10 +1463,14 @@ static const BuiltinEntry builtin_entries[] = {
     {"predict_logistic", builtin_predict_logistic, 2, 2},
     {"ロジスティック分類", builtin_predict_logistic_class, 2, 3},
     {"predict_logistic_class", builtin_predict_logistic_class, 2, 3},
-    {"CSV数値読込", builtin_read_csv_numeric, 1, 3},
-    {"read_csv_numeric", builtin_read_csv_numeric, 1, 3},
-    {"TSV数値読込", builtin_read_tsv_numeric, 1, 3},
-    {"read_tsv_numeric", builtin_read_tsv_numeric, 1, 3},
+    {"CSV数値読込", builtin_read_csv_numeric, 1, 4},
+    {"read_csv_numeric", builtin_read_csv_numeric, 1, 4},
+    {"TSV数値読込", builtin_read_tsv_numeric, 1, 4},
+    {"read_tsv_numeric", builtin_read_tsv_numeric, 1, 4},
+    {"NPY保存", builtin_npy_save, 2, 2},
+    {"npy_save", builtin_npy_save, 2, 2},
+    {"NPY読込", builtin_npy_load, 1, 1},
+    {"npy_load", builtin_npy_load, 1, 1},
     {"CSV読込", builtin_read_csv, 1, 2},
     {"read_csv", builtin_read_csv, 1, 2},
     {"CSV列", builtin_csv_column, 2, 2},
@@ -959,6 +1478,18 @@ static const BuiltinEntry builtin_entries[] = {
     {"JSON行読込", builtin_read_json_lines, 1, 2},
     {"JSONL読込", builtin_read_json_lines, 1, 2},
     {"read_json_lines", builtin_read_json_lines, 1, 2},
+    {"CSVリーダー", builtin_csv_reader, 1, 2},
+    {"csv_reader", builtin_csv_reader, 1, 2},
+    {"TSVリーダー", builtin_tsv_reader, 1, 2},
+    {"tsv_reader", builtin_tsv_reader, 1, 2},
+    {"JSON行リーダー", builtin_json_lines_reader, 1, 1},
+    {"json_lines_reader", builtin_json_lines_reader, 1, 1},
+    {"バッチ読込", builtin_read_batch, 2, 2},
+    {"read_batch", builtin_read_batch, 2, 2},
+    {"数値ブロック読込", builtin_read_numeric_block, 2, 3},
+    {"read_numeric_block", builtin_read_numeric_block, 2, 3},
+    {"リーダー閉じる", builtin_reader_close, 1, 1},
+    {"reader_close", builtin_reader_close, 1, 1},
     {"要約", builtin_describe, 1, 1},
     {"describe", builtin_describe, 1, 1},
     {"キー", builtin_dict_keys, 1, 1},
@@ -1003,12 +1534,16 @@ static const BuiltinEntry builtin_entries[] = {
     {"date", builtin_date, 0, 1},
     {"時間", builtin_time, 0, 1},
     {"time", builtin_time, 0, 1},
-    {"JSON化", builtin_json_encode, 1, 1},
-    {"json_encode", builtin_json_encode, 1, 1},
+    {"JSON化", builtin_json_encode, 1, 2},
+    {"json_encode", builtin_json_encode, 1, 2},
+    {"JSONファイル書込", builtin_json_write_file, 2, 3},
+    {"json_write_file", builtin_json_write_file, 2, 3},
     {"JSON解析", builtin_json_decode, 1, 1},
     {"json_decode", builtin_json_decode, 1, 1},
     {"HTTP取得", builtin_http_get, 1, 2},
     {"http_get", builtin_http_get, 1, 2},
+    {"HTTPバイト取得", builtin_http_get_bytes, 1, 2},
+    {"http_get_bytes", builtin_http_get_bytes, 1, 2},
     {"HTTP送信", builtin_http_post, 1, 3},
     {"http_post", builtin_http_post, 1, 3},
     {"HTTP更新", builtin_http_put, 1, 3},
@@ -1017,9 +1552,9 @@ static const BuiltinEntry builtin_entries[] = {
     {"http_delete", builtin_http_delete, 1, 2},
     {"HTTPリクエスト", builtin_http_request, 2, 4},
     {"http_request", builtin_http_request, 2, 4},
-    {"サーバー起動", builtin_http_serve, 1, 2},
-    {"server_start", builtin_http_serve, 1, 2},
-    {"serve", builtin_http_serve, 1, 2},
+    {"サーバー起動", builtin_http_serve, 1, 3},
+    {"server_start", builtin_http_serve, 1, 3},
+    {"serve", builtin_http_serve, 1, 3},
     {"サーバー停止", builtin_http_stop, 0, 0},
     {"server_stop", builtin_http_stop, 0, 0},
     {"URLエンコード", builtin_url_encode, 1, 1},
@@ -1040,6 +1575,10 @@ static const BuiltinEntry builtin_entries[] = {
     {"regex_search", builtin_regex_search, 2, 2},
     {"正規置換", builtin_regex_replace, 3, 3},
     {"regex_replace", builtin_regex_replace, 3, 3},
+    {"正規表現", builtin_regex_compile, 1, 2},
+    {"regex_compile", builtin_regex_compile, 1, 2},
+    {"正規全検索", builtin_regex_find_all, 2, 2},
+    {"regex_find_all", builtin_regex_find_all, 2, 2},
     {"待つ", builtin_sleep, 1, 1},
     {"sleep", builtin_sleep, 1, 1},
     {"実行", builtin_exec, 1, 1},
@@ -1064,6 +1603,16 @@ static const BuiltinEntry builtin_entries[] = {
     {"race", builtin_async_race, 1, 1},
     {"タスクキャンセル", builtin_task_cancel, 1, 1},
     {"task_cancel", builtin_task_cancel, 1, 1},
+    {"非同期読込", builtin_async_read_file, 1, 2},
+    {"async_read_file", builtin_async_read_file, 1, 2},
+    {"非同期書込", builtin_async_write_file, 2, 2},
+    {"async_write_file", builtin_async_write_file, 2, 2},
+    {"非同期追記", builtin_async_append_file, 2, 2},
+    {"async_append_file", builtin_async_append_file, 2, 2},
+    {"非同期ファイル情報", builtin_async_stat, 1, 1},
+    {"async_stat", builtin_async_stat, 1, 1},
+    {"非同期IO方式", builtin_async_io_backend, 0, 0},
+    {"async_io_backend", builtin_async_io_backend, 0, 0},
     {"成功時", builtin_then, 2, 2},
     {"then_do", builtin_then, 2, 2},
     {"失敗時", builtin_catch, 2, 2},
@@ -1151,6 +1700,16 @@ static const BuiltinEntry builtin_entries[] = {
     {"拡張子", builtin_extension, 1, 1},
     {"extension", builtin_extension, 1, 1},
     {"extname", builtin_extension, 1, 1},
+    {"バイト列", builtin_bytes, 1, 1},
+    {"bytes", builtin_bytes, 1, 1},
+    {"バイト文字列化", builtin_bytes_to_string, 1, 1},
+    {"bytes_to_string", builtin_bytes_to_string, 1, 1},
+    {"バイトファイル読込", builtin_read_file_bytes, 1, 1},
+    {"read_file_bytes", builtin_read_file_bytes, 1, 1},
+    {"バイトファイル書込", builtin_write_file_bytes, 2, 2},
+    {"write_file_bytes", builtin_write_file_bytes, 2, 2},
+    {"バイト読込", builtin_read_bytes, 2, 2},
+    {"read_bytes", builtin_read_bytes, 2, 2},
     {"Base64エンコード", builtin_base64_encode, 1, 1},
     {"base64_encode", builtin_base64_encode, 1, 1},
     {"Base64デコード", builtin_base64_decode, 1, 1},
@@ -1189,14 +1748,107 @@ static const BuiltinEntry builtin_entries[] = {
     {"type_alias", builtin_type_alias, 2, 2},
 };
 
-static void register_builtin_table(Evaluator *eval) {
-    size_t count = sizeof(builtin_entries) / sizeof(builtin_entries[0]);
-    for (size_t i = 0; i < count; i++) {
+// 組み込み関数は全評価器で共有する読み取り専用テーブルに置き、完全ハッシュで引く。
+// グローバル環境にはユーザー定義と定数だけが入り、評価器ごとの登録・確保は無い。
+// 変位値（hash and displace）は builtin_entries から初回に一度だけ求める。
+#define BUILTIN_COUNT ((int)(sizeof(builtin_entries) / sizeof(builtin_entries[0])))
+#define BUILTIN_HASH_BUCKETS 256    // 変位値の数（平均 2〜3 キー/バケット）
+#define BUILTIN_HASH_SLOTS 1024     // 2 のべき乗。BUILTIN_COUNT より十分大きくする
+
+_Static_assert(sizeof(builtin_entries) / sizeof(builtin_entries[0]) < BUILTIN_HASH_SLOTS,
+               "BUILTIN_HASH_SLOTS を増やしてください");
+
+static EnvEntry g_builtin_env_entries[sizeof(builtin_entries) / sizeof(builtin_entries[0])];
+static uint16_t g_builtin_displacements[BUILTIN_HASH_BUCKETS];  // 0 なら空バケット
+static int16_t g_builtin_slots[BUILTIN_HASH_SLOTS];             // -1 なら空き
+static pthread_once_t g_builtin_table_once = PTHREAD_ONCE_INIT;
+
+static uint64_t builtin_name_hash(const char *name) {
+    uint64_t hash = 1469598103934665603ULL;  // FNV-1a 64bit
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint32_t builtin_hash_slot(uint64_t hash, uint32_t displacement) {
+    uint64_t x = hash + (uint64_t)displacement * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    return (uint32_t)x & (BUILTIN_HASH_SLOTS - 1);
+}
+
+static EnvEntry *builtin_table_lookup(const char *name) {
+    uint64_t hash = builtin_name_hash(name);
+    uint16_t displacement = g_builtin_displacements[hash % BUILTIN_HASH_BUCKETS];
+    if (displacement == 0) return NULL;
+    int index = g_builtin_slots[builtin_hash_slot(hash, displacement)];
+    if (index < 0 || strcmp(g_builtin_env_entries[index].name, name) != 0) return NULL;
+    return &g_builtin_env_entries[index];
+}
+
+static void builtin_table_build(void) {
+    int bucket_head[BUILTIN_HASH_BUCKETS];
+    int bucket_size[BUILTIN_HASH_BUCKETS] = {0};
+    int next[sizeof(builtin_entries) / sizeof(builtin_entries[0])];
+    uint64_t hashes[sizeof(builtin_entries) / sizeof(builtin_entries[0])];
+
+    for (int b = 0; b < BUILTIN_HASH_BUCKETS; b++) bucket_head[b] = -1;
+    for (int i = 0; i < BUILTIN_HASH_SLOTS; i++) g_builtin_slots[i] = -1;
+
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
         const BuiltinEntry *entry = &builtin_entries[i];
-        env_define(eval->global, entry->name,
-                   value_builtin(entry->fn, entry->name, entry->min_args, entry->max_args),
-                   true);
+        g_builtin_env_entries[i] = (EnvEntry){
+            .name = (char *)entry->name,
+            .value = value_builtin(entry->fn, entry->name, entry->min_args, entry->max_args),
+            .is_const = true,
+            .next = NULL,
+        };
+        hashes[i] = builtin_name_hash(entry->name);
+        int bucket = (int)(hashes[i] % BUILTIN_HASH_BUCKETS);
+        // 同名が重複していれば先の定義を使う
+        bool duplicate = false;
+        for (int j = bucket_head[bucket]; j >= 0; j = next[j]) {
+            if (strcmp(builtin_entries[j].name, entry->name) == 0) duplicate = true;
+        }
+        if (duplicate) continue;
+        next[i] = bucket_head[bucket];
+        bucket_head[bucket] = i;
+        bucket_size[bucket]++;
+    }
+
+    // キーの多いバケットから順に、全キーが空きスロットに収まる変位値を探す
+    for (int size = BUILTIN_COUNT; size > 0; size--) {
+        for (int b = 0; b < BUILTIN_HASH_BUCKETS; b++) {
+            if (bucket_size[b] != size) continue;
+            uint32_t displacement = 1;
+            for (; displacement <= UINT16_MAX; displacement++) {
+                int placed = 0;
+                bool ok = true;
+                for (int i = bucket_head[b]; i >= 0; i = next[i]) {
+                    uint32_t slot = builtin_hash_slot(hashes[i], displacement);
+                    if (g_builtin_slots[slot] >= 0) {
+                        ok = false;
+                        break;
+                    }
+                    g_builtin_slots[slot] = (int16_t)i;
+                    placed++;
+                }
+                if (ok) break;
+                for (int i = bucket_head[b]; i >= 0 && placed > 0; i = next[i], placed--) {
+                    g_builtin_slots[builtin_hash_slot(hashes[i], displacement)] = -1;
+                }
+            }
+            if (displacement > UINT16_MAX) {
+                fprintf(stderr, "内部エラー: 組み込み関数の完全ハッシュを構成できません\n");
+                abort();
+            }
+            g_builtin_displacements[b] = (uint16_t)displacement;
+        }
     }
+
+    env_set_builtins(builtin_table_lookup, g_builtin_env_entries, BUILTIN_COUNT);
 }
 
 static bool is_runtime_constant_name(const char *name) {
@@ -1214,11 +1866,8 @@ static bool is_runtime_constant_name(const char *name) {
 }
 
 static bool is_builtin_alias_name(const char *name) {
-    size_t count = sizeof(builtin_entries) / sizeof(builtin_entries[0]);
-    for (size_t i = 0; i < count; i++) {
-        if (strcmp(name, builtin_entries[i].name) == 0) return true;
-    }
-    return false;
+    pthread_once(&g_builtin_table_once, builtin_table_build);
+    return builtin_table_lookup(name) != NULL;
 }
 
 static bool is_protected_runtime_name(const char *name) {
@@ -1250,8 +1899,15 @@ static void protected_runtime_name_error(Evaluator *eval, ASTNode *node,
                   protected_runtime_name_suggestion(name));
 }
 
+// dict_set は値を複製するので、作った文字列は渡した後に解放する
+static void system_dict_set(Value *dict, const char *key, const char *text) {
+    Value value = value_string(text);
+    dict_set(dict, key, value);
+    value_free(&value);
+}
+
 void register_builtins(Evaluator *eval) {
-    register_builtin_table(eval);
+    pthread_once(&g_builtin_table_once, builtin_table_build);
 
     // 数学定数
     env_define(eval->global, "円周率", value_number(3.14159265358979323846), true);
@@ -1294,31 +1950,31 @@ void register_builtins(Evaluator *eval) {
         env_define(eval->global, "arch",
                    value_string(arch), true);
         env_define(eval->global, "はじむバージョン",
-                   value_string("1.5.0"), true);
+                   value_string(HAJIMU_VERSION), true);
         env_define(eval->global, "hajimu_version",
-                   value_string("1.5.0"), true);
+                   value_string(HAJIMU_VERSION), true);
 
         /* システム辞書: システム["OS"] / system["architecture"] など二言語で参照できる。 */
         Value sys = value_dict();
-        dict_set(&sys, "OS",           value_string(os_name));
-        dict_set(&sys, "os",           value_string(os_name));
-        dict_set(&sys, "システム名",       value_string(os_name));
-        dict_set(&sys, "system_name",  value_string(os_name));
-        dict_set(&sys, "アーキテクチャ",    value_string(arch));
-        dict_set(&sys, "architecture", value_string(arch));
-        dict_set(&sys, "arch",         value_string(arch));
-        dict_set(&sys, "バージョン",       value_string("1.5.0"));
-        dict_set(&sys, "version",      value_string("1.5.0"));
+        system_dict_set(&sys, "OS",           os_name);
+        system_dict_set(&sys, "os",           os_name);
+        system_dict_set(&sys, "システム名",       os_name);
+        system_dict_set(&sys, "system_name",  os_name);
+        system_dict_set(&sys, "アーキテクチャ",    arch);
+        system_dict_set(&sys, "architecture", arch);
+        system_dict_set(&sys, "arch",         arch);
+        system_dict_set(&sys, "バージョン",       HAJIMU_VERSION);
+        system_dict_set(&sys, "version",      HAJIMU_VERSION);
 #if defined(_WIN32)
-        dict_set(&sys, "区切り文字",       value_string("\\"));
-        dict_set(&sys, "path_separator", value_string("\\"));
-        dict_set(&sys, "改行",            value_string("\r\n"));
-        dict_set(&sys, "newline",      value_string("\r\n"));
+        system_dict_set(&sys, "区切り文字",       "\\");
+        system_dict_set(&sys, "path_separator", "\\");
+        system_dict_set(&sys, "改行",            "\r\n");
+        system_dict_set(&sys, "newline",      "\r\n");
 #else
-        dict_set(&sys, "区切り文字",       value_string("/"));
-        dict_set(&sys, "path_separator", value_string("/"));
-        dict_set(&sys, "改行",            value_string("\n"));
-        dict_set(&sys, "newline",      value_string("\n"));
+        system_dict_set(&sys, "区切り文字",       "/");
+        system_dict_set(&sys, "path_separator", "/");
+        system_dict_set(&sys, "改行",            "\n");
+        system_dict_set(&sys, "newline",      "\n");
 #endif
         env_define(eval->global, "システム", sys, true);
         env_define(eval->global, "system", value_copy(sys), true);
@@ -1608,12 +2264,42 @@ void evaluator_clear_error(Evaluator *eval) {
     eval->error_message[0] = '\0';
 }
 
+void evaluator_set_output(FILE *out) {
+    g_evaluator_output = out;
+}
+
+FILE *evaluator_output(void) {
+    return g_evaluator_output != NULL ? g_evaluator_output : stdout;
+}
+
+void evaluator_retain_program(Evaluator *eval, char *source, ASTNode *program) {
+    if (eval->imported_count >= eval->imported_capacity) {
+        eval->imported_capacity = eval->imported_capacity == 0 ? 4 : eval->imported_capacity * 2;
+        eval->imported_modules = realloc(eval->imported_modules,
+                                         eval->imported_capacity * sizeof(ImportedModule));
+    }
+    eval->imported_modules[eval->imported_count].source = source;
+    eval->imported_modules[eval->imported_count].ast    = program;
+    eval->imported_count++;
+}
+
 void evaluator_set_debug_mode(Evaluator *eval, bool enabled) {
     eval->debug_mode = enabled;
     eval->step_mode = enabled;  // デバッグモードではステップモードも有効
 }
 
 // デバッグ: 行トレース
+#ifdef HAJIMU_MEM_PROFILE
+// メモリプロファイルの呼び出し位置に表示する名前
+static const char *call_site_name(const ASTNode *node) {
+    const ASTNode *callee = node->call.callee;
+    if (callee == NULL) return NULL;
+    if (callee->type == NODE_IDENTIFIER) return callee->string_value;
+    if (callee->type == NODE_MEMBER) return callee->member.member_name;
+    return NULL;
+}
+#endif
+
 static void debug_trace(Evaluator *eval, ASTNode *node) {
     if (!eval->debug_mode) return;
     if (node == NULL) return;
@@ -1658,6 +2344,7 @@ Value evaluator_run(Evaluator *eval, ASTNode *program) {
     
     // トップレベルの宣言を処理
     for (int i = 0; i < program->block.count; i++) {
+        value_free(&result);
         result = evaluate(eval, program->block.statements[i]);
         if (eval->had_error) break;
     }
@@ -1671,9 +2358,14 @@ Value evaluator_run(Evaluator *eval, ASTNode *program) {
         eval->current = local;
         
         // メイン関数の本体を実行
+        FunctionProfileFrame profile_frame;
+        function_profile_enter(eval, main_func->function.definition, "メイン", &profile_frame);
+        value_free(&result);
         result = evaluate(eval, main_func->function.definition->function.body);
+        function_profile_leave(eval, &profile_frame);
         
         if (eval->returning) {
+            value_free(&result);
             result = eval->return_value;
             eval->returning = false;
         }
@@ -1685,6 +2377,12 @@ Value evaluator_run(Evaluator *eval, ASTNode *program) {
     return result;
 }
 
+// 文や関数本体を評価して結果を捨てる（文の結果も呼び出し側が所有しているので解放する）
+static void evaluate_discard(Evaluator *eval, ASTNode *node) {
+    Value result = evaluate(eval, node);
+    value_free(&result);
+}
+
 Value evaluate(Evaluator *eval, ASTNode *node) {
     if (node == NULL) return value_null();
     if (eval->had_error) return value_null();
@@ -1695,8 +2393,13 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
     }
 
     double profile_start_ms = 0.0;
+    double profile_saved_child_ms = 0.0;
+    int profile_entry = -1;
     bool profile_this_node = eval->ast_profile_enabled;
     if (profile_this_node) {
+        profile_entry = begin_ast_profile(eval, node);
+        profile_saved_child_ms = eval->ast_profile_child_ms;
+        eval->ast_profile_child_ms = 0.0;
         profile_start_ms = evaluator_now_ms();
     }
     
@@ -1706,6 +2409,7 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
         node->type == NODE_FOR || node->type == NODE_RETURN ||
         node->type == NODE_EXPR_STMT || node->type == NODE_TRY ||
         node->type == NODE_THROW || node->type == NODE_FUNCTION_DEF) {
+        eval->current_line = node->location.line;
         debug_trace(eval, node);
     }
     
@@ -1784,9 +2488,12 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
             result = evaluate_unary(eval, node);
             break;
             
-        case NODE_CALL:
+        case NODE_CALL: {
+            MEM_PROFILE_ENTER_SITE(node, call_site_name(node), node->location.line, node->location.column);
             result = evaluate_call(eval, node);
+            MEM_PROFILE_LEAVE_SITE();
             break;
+        }
             
         case NODE_INDEX:
             result = evaluate_index(eval, node);
@@ -1818,7 +2525,11 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
             
         case NODE_RETURN:
             if (node->return_stmt.value != NULL) {
-                eval->return_value = value_copy(evaluate(eval, node->return_stmt.value));
+                Value returned = evaluate(eval, node->return_stmt.value);
+                bool moved = (returned.type == VALUE_FILE || returned.type == VALUE_ARRAY ||
+                              returned.type == VALUE_DICT) &&
+                             is_fresh_numeric_temporary(eval, node->return_stmt.value, returned);
+                eval->return_value = moved ? returned : value_copy(returned);
             } else {
                 eval->return_value = value_null();
             }
@@ -1845,9 +2556,12 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
             }
             break;
         
-        case NODE_IMPORT:
+        case NODE_IMPORT: {
+            TRACE_BEGIN(import_start_us);
             result = evaluate_import(eval, node);
+            TRACE_END(import_start_us, node->import_stmt.module_path, "import", eval->current_file);
             break;
+        }
         
         case NODE_CLASS_DEF:
             result = evaluate_class_def(eval, node);
@@ -1902,6 +2616,8 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
         case NODE_BLOCK:
         case NODE_PROGRAM:
             for (int i = 0; i < node->block.count; i++) {
+                // 前の文の結果は使わないので解放する（最後の文の結果だけをブロックの値として返す）
+                value_free(&result);
                 result = evaluate(eval, node->block.statements[i]);
                 if (eval->had_error || eval->returning || 
                     eval->breaking || eval->continuing || eval->throwing) {
@@ -1918,7 +2634,9 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
     
     eval->recursion_depth--;
     if (profile_this_node) {
-        record_ast_profile(eval, node, evaluator_now_ms() - profile_start_ms);
+        double elapsed_ms = evaluator_now_ms() - profile_start_ms;
+        record_ast_profile(eval, profile_entry, elapsed_ms, elapsed_ms - eval->ast_profile_child_ms);
+        eval->ast_profile_child_ms = profile_saved_child_ms + elapsed_ms;
     }
     return result;
 }
@@ -1927,6 +2645,265 @@ Value evaluate(Evaluator *eval, ASTNode *node) {
 // 各種評価関数
 // =============================================================================
 
+// =============================================================================
+// 数値ベクトル・行列の演算子
+// =============================================================================
+
+typedef double (*NumericCompareFn)(double a, double b);
+
+static double numeric_compare_eq(double a, double b) { return a == b ? 1.0 : 0.0; }
+static double numeric_compare_ne(double a, double b) { return a != b ? 1.0 : 0.0; }
+static double numeric_compare_lt(double a, double b) { return a < b ? 1.0 : 0.0; }
+static double numeric_compare_le(double a, double b) { return a <= b ? 1.0 : 0.0; }
+static double numeric_compare_gt(double a, double b) { return a > b ? 1.0 : 0.0; }
+static double numeric_compare_ge(double a, double b) { return a >= b ? 1.0 : 0.0; }
+
+// 算術演算子トークンを dtype ネイティブカーネルの演算へ対応付ける
+static bool numeric_arithmetic_for(TokenType op, NumericBinaryOp *out) {
+    switch (op) {
+        case TOKEN_PLUS:    *out = NUMERIC_OP_ADD; return true;
+        case TOKEN_MINUS:   *out = NUMERIC_OP_SUB; return true;
+        case TOKEN_STAR:    *out = NUMERIC_OP_MUL; return true;
+        case TOKEN_SLASH:   *out = NUMERIC_OP_DIV; return true;
+        case TOKEN_PERCENT: *out = NUMERIC_OP_MOD; return true;
+        case TOKEN_POWER:   *out = NUMERIC_OP_POW; return true;
+        default:            return false;
+    }
+}
+
+// == / != は値全体の等価比較なので、要素ごとのマスクは 等しいマスク / 等しくないマスク で作る
+static NumericCompareFn numeric_comparison_for(TokenType op) {
+    switch (op) {
+        case TOKEN_LT: return numeric_compare_lt;
+        case TOKEN_LE: return numeric_compare_le;
+        case TOKEN_GT: return numeric_compare_gt;
+        case TOKEN_GE: return numeric_compare_ge;
+        default:       return NULL;
+    }
+}
+
+static bool is_numeric_operator_token(TokenType op) {
+    NumericBinaryOp arithmetic;
+    return numeric_arithmetic_for(op, &arithmetic) || numeric_comparison_for(op) != NULL;
+}
+
+// 要素ごとの演算子ノードか（評価結果の数値ベクトル・行列は新しく作られた一時値になる）
+static bool is_numeric_operator_node(ASTNode *node) {
+    if (node->type == NODE_UNARY) return node->unary.operator == TOKEN_MINUS;
+    return node->type == NODE_BINARY && is_numeric_operator_token(node->binary.operator);
+}
+
+static bool is_builtin_call_node(Evaluator *eval, ASTNode *node) {
+    if (node->type == NODE_CALL && node->call.callee->type == NODE_IDENTIFIER) {
+        Value *callee = env_get(eval->current, node->call.callee->string_value);
+        return callee != NULL && callee->type == VALUE_BUILTIN;
+    }
+    return false;
+}
+
+// 演算子や組み込み関数が新しく作った数値ベクトル・行列か（変数へコピーせずに移してよい）。
+// 組み込み関数の戻り値は呼び出し側が所有する。引数として返された値も、評価時に
+// 取った参照が解放されずに残るので、そのまま移しても参照数は合う。
+// 添字の結果（マスク選択・行 view・配列の要素）も評価時に取った参照を持つので移す。
+// ファイルハンドルは呼び出し結果も変数参照も評価時に参照を1つ取るので、同様に移す
+// （コピーすると一時値の参照が残り、スコープを抜けても閉じられない）。
+// 配列・辞書もリテラル・変数参照・ユーザー関数の戻り値は評価結果を所有しているので移す
+// （コピーすると元の一時値ごと中のファイルハンドルの参照が残る）。
+static bool is_fresh_numeric_temporary(Evaluator *eval, ASTNode *node, Value value) {
+    if (value.type == VALUE_FILE) return node->type == NODE_CALL || node->type == NODE_IDENTIFIER;
+    if (value.type == VALUE_ARRAY || value.type == VALUE_DICT) {
+        return node->type == NODE_ARRAY || node->type == NODE_DICT || node->type == NODE_IDENTIFIER ||
+               (node->type == NODE_CALL && !is_builtin_call_node(eval, node));
+    }
+    if (value.type == VALUE_BYTES || value.type == VALUE_REGEX) return is_builtin_call_node(eval, node);
+    if (value.type != VALUE_NUMERIC_ARRAY && value.type != VALUE_MATRIX) return false;
+    if (is_numeric_operator_node(node) || node->type == NODE_INDEX) return true;
+    return is_builtin_call_node(eval, node);
+}
+
+static bool is_numeric_operand(Value v) {
+    return v.type == VALUE_NUMBER || v.type == VALUE_NUMERIC_ARRAY || v.type == VALUE_MATRIX;
+}
+
+static NumericDType numeric_operand_dtype(Value *v) {
+    return v->type == VALUE_MATRIX ? v->matrix.dtype : v->numeric_array.dtype;
+}
+
+// 演算子の片側を row-major の平坦な数値ベクトルとして読む。
+// 行列は同じバッファを指す借用 view にし、転置 view など行が連続していない行列だけ一時コピーを作る。
+static bool numeric_operand_flatten(Value *operand, Value *flat, Value *temporary) {
+    *temporary = value_null();
+    if (operand->type == VALUE_NUMERIC_ARRAY) {
+        *flat = *operand;
+        return true;
+    }
+
+    Value *source = operand;
+    if (operand->matrix.col_stride != 1 || operand->matrix.row_stride != operand->matrix.cols) {
+        *temporary = value_copy(*operand);
+        if (!matrix_make_unique(temporary)) return false;
+        source = temporary;
+    }
+
+    flat->type = VALUE_NUMERIC_ARRAY;
+    flat->is_const = false;
+    flat->is_integer = false;
+    flat->ref_count = 1;
+    flat->numeric_array.dtype = source->matrix.dtype;
+    flat->numeric_array.data = source->matrix.data;
+    flat->numeric_array.length = source->matrix.rows * source->matrix.cols;
+    flat->numeric_array.capacity = flat->numeric_array.length;
+    flat->numeric_array.offset = source->matrix.offset;
+    flat->numeric_array.stride = 1;
+    flat->numeric_array.ref_count = NULL;
+    return true;
+}
+
+static const void *numeric_flat_base(Value *flat) {
+    return (const char *)flat->numeric_array.data +
+           (size_t)flat->numeric_array.offset * (size_t)numeric_dtype_size(flat->numeric_array.dtype);
+}
+
+// 数値ベクトル・行列の二項演算子。スカラーはどちらの辺でも全要素へ broadcast する。
+// 算術は numeric_binary_result_dtype() の dtype のまま計算し、比較は NUMERIC_DTYPE_BOOL のマスクを返す。
+// reusable には式の途中結果など、他から参照されない一時値を渡すと、その
+// バッファへ結果を書き込んで中間配列の確保を省く（a * b + c などの連鎖）。
+static Value numeric_operator_apply(Evaluator *eval, ASTNode *node, TokenType op,
+                                    Value *left, Value *right, Value *reusable) {
+    NumericBinaryOp arithmetic = NUMERIC_OP_ADD;
+    bool is_arithmetic = numeric_arithmetic_for(op, &arithmetic);
+    NumericCompareFn compare = numeric_comparison_for(op);
+    if (!is_arithmetic && compare == NULL) {
+        runtime_error(eval, node->location.line, node->location.column,
+                     "不正な演算: %s %s %s", value_type_name(left->type),
+                     token_type_name(op), value_type_name(right->type));
+        return value_null();
+    }
+
+    bool is_matrix = left->type == VALUE_MATRIX || right->type == VALUE_MATRIX;
+    int rows = 0;
+    int cols = 0;
+    int n = 0;
+    if (is_matrix) {
+        if (left->type == VALUE_NUMERIC_ARRAY || right->type == VALUE_NUMERIC_ARRAY) {
+            runtime_error(eval, node->location.line, node->location.column,
+                         "数値ベクトルと数値行列は %s で演算できません。行取得 や 行列 で形をそろえてください",
+                         token_type_name(op));
+            return value_null();
+        }
+        Value *shape = left->type == VALUE_MATRIX ? left : right;
+        rows = shape->matrix.rows;
+        cols = shape->matrix.cols;
+        if (left->type == VALUE_MATRIX && right->type == VALUE_MATRIX &&
+            (right->matrix.rows != rows || right->matrix.cols != cols)) {
+            runtime_error(eval, node->location.line, node->location.column,
+                         "%s の行列サイズが一致しません（左: %d x %d, 右: %d x %d）",
+                         token_type_name(op), rows, cols, right->matrix.rows, right->matrix.cols);
+            return value_null();
+        }
+        n = rows * cols;
+    } else {
+        n = left->type == VALUE_NUMERIC_ARRAY ? left->numeric_array.length : right->numeric_array.length;
+        if (left->type == VALUE_NUMERIC_ARRAY && right->type == VALUE_NUMERIC_ARRAY &&
+            right->numeric_array.length != n) {
+            runtime_error(eval, node->location.line, node->location.column,
+                         "%s の左右のベクトル長が一致しません（左: %d, 右: %d）",
+                         token_type_name(op), n, right->numeric_array.length);
+            return value_null();
+        }
+    }
+
+    bool left_scalar = left->type == VALUE_NUMBER;
+    bool right_scalar = right->type == VALUE_NUMBER;
+    NumericDType left_dtype = left_scalar
+        ? numeric_scalar_dtype(left->number, numeric_operand_dtype(right)) : numeric_operand_dtype(left);
+    NumericDType right_dtype = right_scalar
+        ? numeric_scalar_dtype(right->number, numeric_operand_dtype(left)) : numeric_operand_dtype(right);
+    NumericDType out_dtype = is_arithmetic
+        ? numeric_binary_result_dtype(left_dtype, right_dtype, arithmetic) : NUMERIC_DTYPE_BOOL;
+
+    // 使い捨ての途中結果が同じ dtype ならそのバッファへ書く
+    bool reused = reusable != NULL && is_arithmetic &&
+                  reusable->type == (is_matrix ? VALUE_MATRIX : VALUE_NUMERIC_ARRAY) &&
+                  numeric_operand_dtype(reusable) == out_dtype &&
+                  (is_matrix ? matrix_make_unique(reusable) : numeric_array_make_unique(reusable));
+    Value result;
+    if (reused) {
+        result = *reusable;
+    } else if (is_matrix) {
+        result = value_matrix_with_dtype(rows, cols, out_dtype);
+    } else {
+        result = value_numeric_array_with_dtype(n, out_dtype);
+        if (result.type == VALUE_NUMERIC_ARRAY) result.numeric_array.length = n;
+    }
+
+    Value left_flat, right_flat, out_flat;
+    Value left_temp = value_null(), right_temp = value_null(), out_temp = value_null();
+    bool ok = result.type != VALUE_NULL &&
+              (left_scalar || numeric_operand_flatten(left, &left_flat, &left_temp)) &&
+              (right_scalar || numeric_operand_flatten(right, &right_flat, &right_temp));
+
+    // 結果と dtype が違う入力は一括変換してから dtype ネイティブカーネルへ渡す
+    if (ok && is_arithmetic && !left_scalar && left_flat.numeric_array.dtype != out_dtype) {
+        Value converted = numeric_array_astype(&left_flat, out_dtype);
+        value_free(&left_temp);
+        left_temp = converted;
+        left_flat = converted;
+        ok = converted.type == VALUE_NUMERIC_ARRAY;
+    }
+    if (ok && is_arithmetic && !right_scalar && right_flat.numeric_array.dtype != out_dtype) {
+        Value converted = numeric_array_astype(&right_flat, out_dtype);
+        value_free(&right_temp);
+        right_temp = converted;
+        right_flat = converted;
+        ok = converted.type == VALUE_NUMERIC_ARRAY;
+    }
+    if (!ok) {
+        value_free(&left_temp);
+        value_free(&right_temp);
+        if (!reused) value_free(&result);
+        runtime_error(eval, node->location.line, node->location.column,
+                     "%s の計算用バッファを確保できませんでした", token_type_name(op));
+        return value_null();
+    }
+    numeric_operand_flatten(&result, &out_flat, &out_temp);
+
+    int failed_at = -1;
+    if (is_arithmetic) {
+        failed_at = numeric_binary_kernel(
+            arithmetic, out_dtype, (void *)numeric_flat_base(&out_flat),
+            left_scalar ? NULL : numeric_flat_base(&left_flat),
+            left_scalar ? 0 : left_flat.numeric_array.stride,
+            left_scalar ? left->number : 0.0,
+            right_scalar ? NULL : numeric_flat_base(&right_flat),
+            right_scalar ? 0 : right_flat.numeric_array.stride,
+            right_scalar ? right->number : 0.0, n);
+    } else {
+        for (int i = 0; i < n; i++) {
+            double x = left_scalar ? left->number : numeric_array_get(&left_flat, i);
+            double y = right_scalar ? right->number : numeric_array_get(&right_flat, i);
+            numeric_array_set(&out_flat, i, compare(x, y));
+        }
+    }
+
+    value_free(&left_temp);
+    value_free(&right_temp);
+    if (failed_at >= 0) {
+        if (!reused) value_free(&result);
+        runtime_error(eval, node->location.line, node->location.column,
+                     "ゼロ除算（%d番目の要素）", failed_at);
+        return value_null();
+    }
+    return result;
+}
+
+// 演算子の両辺として評価した値の参照を手放す。変数から読んだコピーも式の途中結果も
+// 評価側が参照を1つ持っているので、結果へ引き継いだ辺（途中結果のバッファ再利用）以外は解放する
+static void release_numeric_operands(Value left, Value right, Value result) {
+    Value operands[2] = { left, right };
+    release_builtin_arguments(operands, 2, result);
+}
+
 static Value evaluate_binary(Evaluator *eval, ASTNode *node) {
     // 短絡評価
     if (node->binary.operator == TOKEN_AND) {
@@ -1989,7 +2966,37 @@ static Value evaluate_binary(Evaluator *eval, ASTNode *node) {
             default: break;
         }
     }
-    
+
+    // 数値ベクトル・行列の == / != は全要素の等価比較（真偽値）。
+    // マスクを返すと条件式では常に真になってしまうため、要素ごとの結果は
+    // 等しいマスク / 等しくないマスク で取り出す
+    if ((node->binary.operator == TOKEN_EQ || node->binary.operator == TOKEN_NE) &&
+        left.type != VALUE_INSTANCE &&
+        (left.type == VALUE_NUMERIC_ARRAY || left.type == VALUE_MATRIX ||
+         right.type == VALUE_NUMERIC_ARRAY || right.type == VALUE_MATRIX)) {
+        bool equal = value_equals(left, right);
+        release_numeric_operands(left, right, value_null());
+        return value_bool(node->binary.operator == TOKEN_EQ ? equal : !equal);
+    }
+
+    // 数値ベクトル・行列の要素ごとの演算（スカラーは broadcast、比較はマスク）
+    if (is_numeric_operand(left) && is_numeric_operand(right) &&
+        (left.type != VALUE_NUMBER || right.type != VALUE_NUMBER)) {
+        if (is_numeric_operator_token(node->binary.operator)) {
+            // 入れ子の演算子の途中結果は他から参照されないので、出力先として再利用する
+            Value *reusable = NULL;
+            if (is_numeric_operator_node(node->binary.left) && left.type != VALUE_NUMBER) {
+                reusable = &left;
+            } else if (is_numeric_operator_node(node->binary.right) && right.type != VALUE_NUMBER) {
+                reusable = &right;
+            }
+            Value result = numeric_operator_apply(eval, node, node->binary.operator,
+                                                  &left, &right, reusable);
+            release_numeric_operands(left, right, result);
+            return result;
+        }
+    }
+
     // 文字列結合
     if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
         if (node->binary.operator == TOKEN_PLUS) {
@@ -2045,6 +3052,11 @@ static Value evaluate_binary(Evaluator *eval, ASTNode *node) {
             eval->had_error = false;
             Value result = call_instance_operator(&left, method, &right);
             if (!eval->had_error) {
+                // 数値ベクトル・行列を返す演算子メソッドでも、フィールドのバッファを
+                // 外側の演算の出力先として書き換えないよう共有数を持たせる
+                if (result.type == VALUE_NUMERIC_ARRAY || result.type == VALUE_MATRIX) {
+                    result = value_copy(result);
+                }
                 return result;
             }
             eval->had_error = prev_error;
@@ -2076,6 +3088,13 @@ static Value evaluate_unary(Evaluator *eval, ASTNode *node) {
             if (operand.type == VALUE_NUMBER) {
                 return value_number(-operand.number);
             }
+            if (operand.type == VALUE_NUMERIC_ARRAY || operand.type == VALUE_MATRIX) {
+                Value minus_one = value_number(-1);
+                Value *reusable = is_numeric_operator_node(node->unary.operand) ? &operand : NULL;
+                Value result = numeric_operator_apply(eval, node, TOKEN_STAR, &operand, &minus_one, reusable);
+                release_numeric_operands(operand, minus_one, result);
+                return result;
+            }
             runtime_error(eval, node->location.line, node->location.column,
                          "数値以外に単項マイナスは使えません");
             return value_null();
@@ -2090,26 +3109,211 @@ static Value evaluate_unary(Evaluator *eval, ASTNode *node) {
     }
 }
 
-static Value evaluate_call(Evaluator *eval, ASTNode *node) {
-    // メソッド呼び出しの場合、インスタンスを保存
-    Value instance = value_null();
-    bool is_method_call = false;
-    bool is_super_call = false;
-    
-    if (node->call.callee->type == NODE_MEMBER) {
-        // 親クラスのメソッド呼び出しかチェック
-        if (node->call.callee->member.object->type == NODE_IDENTIFIER &&
-            strcmp(node->call.callee->member.object->string_value, "親") == 0) {
-            is_super_call = true;
-            // superの場合、instanceは現在のインスタンス
-            if (eval->current_instance != NULL) {
-                instance = value_copy(*eval->current_instance);
-                is_method_call = true;
-            }
-        } else {
-            instance = evaluate(eval, node->call.callee->member.object);
-            if (eval->had_error) return value_null();
-            if (instance.type == VALUE_INSTANCE) {
+// 第1引数の数値ベクトル・行列へ結果を書き込む組み込み関数か
+static bool builtin_writes_numeric_destination(BuiltinFn fn) {
+    return fn == builtin_vector_add_into || fn == builtin_vector_sub_into ||
+           fn == builtin_vector_mul_into || fn == builtin_vector_div_into ||
+           fn == builtin_vector_scale_inplace ||
+           fn == builtin_matrix_add_into || fn == builtin_matrix_sub_into ||
+           fn == builtin_matrix_hadamard_into || fn == builtin_matrix_div_into ||
+           fn == builtin_matrix_scale_inplace;
+}
+
+// 読み取るだけの変数引数はコピーせずに借用する。
+// value_copy すると数値バッファの共有数が増え、出力先への書き込みが毎回複製になるため。
+static Value evaluate_borrowed_argument(Evaluator *eval, ASTNode *node) {
+    if (node->type == NODE_IDENTIFIER) {
+        Value *ptr = env_get(eval->current, node->string_value);
+        if (ptr != NULL) return *ptr;
+    }
+    return evaluate(eval, node);
+}
+
+// 式の引数として評価した一時値を解放する（変数から借用した引数は解放しない）
+static void release_numeric_temporaries(ASTNode **arg_nodes, Value *args, int first, int count) {
+    for (int i = first; i < count; i++) {
+        if (arg_nodes[i]->type != NODE_IDENTIFIER) value_free(&args[i]);
+    }
+}
+
+// ベクトル加算格納(出力先, a, b) などを、出力先の変数のバッファへ直接書き込んで評価する。
+// 追加 と同じく変数そのものを更新し、null を返す（*_into は出力先によらず常に null）。
+static Value evaluate_numeric_destination_call(Evaluator *eval, ASTNode *node, Value callee) {
+    const char *dst_name = node->call.arguments[0]->string_value;
+    int argc = node->call.arg_count;
+    Value args[3];
+
+    // 式の引数を先に評価し、変数の借用は出力先へ書き込む直前に行う
+    for (int i = 1; i < argc; i++) {
+        if (node->call.arguments[i]->type != NODE_IDENTIFIER) {
+            args[i] = evaluate(eval, node->call.arguments[i]);
+            if (eval->had_error) {
+                for (int j = 1; j < i; j++) {
+                    if (node->call.arguments[j]->type != NODE_IDENTIFIER) value_free(&args[j]);
+                }
+                return value_null();
+            }
+        } else {
+            args[i] = value_null();
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        if (node->call.arguments[i]->type == NODE_IDENTIFIER) {
+            args[i] = evaluate_borrowed_argument(eval, node->call.arguments[i]);
+            if (eval->had_error) {
+                release_numeric_temporaries(node->call.arguments, args, 1, argc);
+                return value_null();
+            }
+        }
+    }
+
+    Value *dst = env_get(eval->current, dst_name);
+    if (dst == NULL) {
+        release_numeric_temporaries(node->call.arguments, args, 1, argc);
+        undefined_variable_error(eval, node->call.arguments[0], dst_name);
+        return value_null();
+    }
+    if (env_is_const(eval->current, dst_name)) {
+        release_numeric_temporaries(node->call.arguments, args, 1, argc);
+        runtime_error(eval, node->location.line, node->location.column,
+                     "定数 %s には書き込めません", dst_name);
+        return value_null();
+    }
+
+    args[0] = *dst;
+    callee.builtin.fn(argc, args);
+    // 共有中のバッファは書き込み時に複製されるので、更新後の値を変数へ戻す
+    *dst = args[0];
+    release_numeric_temporaries(node->call.arguments, args, 1, argc);
+    return value_null();
+}
+
+// 数値ベクトル・行列への複合代入（v += w など）。
+// ベクトル加算格納 などと同じ経路で変数のバッファへ直接書き込み、新しい配列を作らない。
+static Value evaluate_numeric_compound_assign(Evaluator *eval, ASTNode *node) {
+    const char *name = node->assign.target->string_value;
+    bool value_is_temporary = node->assign.value->type != NODE_IDENTIFIER;
+    Value args[3];
+    args[2] = evaluate_borrowed_argument(eval, node->assign.value);
+    if (eval->had_error) return value_null();
+
+    Value *target = env_get(eval->current, name);
+    if (target == NULL) {
+        if (value_is_temporary) value_free(&args[2]);
+        undefined_variable_error(eval, node->assign.target, name);
+        return value_null();
+    }
+    if (env_is_const(eval->current, name)) {
+        if (value_is_temporary) value_free(&args[2]);
+        runtime_error(eval, node->location.line, node->location.column,
+                     "定数 %s には代入できません", name);
+        return value_null();
+    }
+
+    bool is_matrix = target->type == VALUE_MATRIX;
+    BuiltinFn fn = NULL;
+    switch (node->assign.operator) {
+        case TOKEN_PLUS_ASSIGN:
+            fn = is_matrix ? builtin_matrix_add_into : builtin_vector_add_into;
+            break;
+        case TOKEN_MINUS_ASSIGN:
+            fn = is_matrix ? builtin_matrix_sub_into : builtin_vector_sub_into;
+            break;
+        case TOKEN_STAR_ASSIGN:
+            fn = is_matrix ? builtin_matrix_hadamard_into : builtin_vector_mul_into;
+            break;
+        case TOKEN_SLASH_ASSIGN:
+            fn = is_matrix ? builtin_matrix_div_into : builtin_vector_div_into;
+            break;
+        default:
+            if (value_is_temporary) value_free(&args[2]);
+            runtime_error(eval, node->location.line, node->location.column,
+                         "数値ベクトル・行列の複合代入は +=, -=, *=, /= のみ使用できます");
+            return value_null();
+    }
+
+    args[0] = *target;
+    args[1] = *target;
+    fn(3, args);
+    *target = args[0];
+    if (value_is_temporary) value_free(&args[2]);
+    return value_null();
+}
+
+// 組み込み関数に渡した数値ベクトル・行列の参照を返す。
+// 引数をそのまま戻り値にした組み込み関数（*_into など）は、その参照を戻り値へ引き継ぐ。
+static bool same_numeric_value(Value a, Value b) {
+    if (a.type != b.type) return false;
+    if (a.type == VALUE_NUMERIC_ARRAY) {
+        return a.numeric_array.data == b.numeric_array.data &&
+               a.numeric_array.ref_count == b.numeric_array.ref_count &&
+               a.numeric_array.offset == b.numeric_array.offset &&
+               a.numeric_array.length == b.numeric_array.length &&
+               a.numeric_array.stride == b.numeric_array.stride;
+    }
+    return a.matrix.data == b.matrix.data &&
+           a.matrix.ref_count == b.matrix.ref_count &&
+           a.matrix.offset == b.matrix.offset &&
+           a.matrix.rows == b.matrix.rows &&
+           a.matrix.cols == b.matrix.cols &&
+           a.matrix.row_stride == b.matrix.row_stride &&
+           a.matrix.col_stride == b.matrix.col_stride;
+}
+
+// ファイルハンドルも同様に返し、参照がなくなったハンドルが閉じられるようにする。
+// 文字列引数の一時コピーも解放する（行ごとのループで引数の文字列が溜まらないように）。
+static void release_builtin_arguments(Value *args, int count, Value result) {
+    for (int i = 0; i < count; i++) {
+        if (args[i].type == VALUE_FILE) {
+            if (result.type == VALUE_FILE && result.file.handle == args[i].file.handle) continue;
+            value_free(&args[i]);
+            continue;
+        }
+        if (args[i].type == VALUE_STRING) {
+            if (result.type == VALUE_STRING && result.string.data == args[i].string.data) continue;
+            value_free(&args[i]);
+            continue;
+        }
+        if (args[i].type == VALUE_BYTES) {
+            // スライスは同じバッファを共有しても自分の参照を持つので、同じ view のときだけ引き継ぐ
+            if (result.type == VALUE_BYTES && result.bytes.data == args[i].bytes.data &&
+                result.bytes.ref_count == args[i].bytes.ref_count &&
+                result.bytes.offset == args[i].bytes.offset &&
+                result.bytes.length == args[i].bytes.length) continue;
+            value_free(&args[i]);
+            continue;
+        }
+        if (args[i].type == VALUE_REGEX) {
+            if (result.type == VALUE_REGEX && result.regex.handle == args[i].regex.handle) continue;
+            value_free(&args[i]);
+            continue;
+        }
+        if (args[i].type != VALUE_NUMERIC_ARRAY && args[i].type != VALUE_MATRIX) continue;
+        if (same_numeric_value(args[i], result)) continue;
+        value_free(&args[i]);
+    }
+}
+
+static Value evaluate_call(Evaluator *eval, ASTNode *node) {
+    // メソッド呼び出しの場合、インスタンスを保存
+    Value instance = value_null();
+    bool is_method_call = false;
+    bool is_super_call = false;
+    
+    if (node->call.callee->type == NODE_MEMBER) {
+        // 親クラスのメソッド呼び出しかチェック
+        if (node->call.callee->member.object->type == NODE_IDENTIFIER &&
+            strcmp(node->call.callee->member.object->string_value, "親") == 0) {
+            is_super_call = true;
+            // superの場合、instanceは現在のインスタンス
+            if (eval->current_instance != NULL) {
+                instance = value_copy(*eval->current_instance);
+                is_method_call = true;
+            }
+        } else {
+            instance = evaluate(eval, node->call.callee->member.object);
+            if (eval->had_error) return value_null();
+            if (instance.type == VALUE_INSTANCE) {
                 is_method_call = true;
             }
         }
@@ -2117,7 +3321,25 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
     
     Value callee = evaluate(eval, node->call.callee);
     if (eval->had_error) return value_null();
-    
+
+    // 出力先指定のベクトル・行列演算は第1引数の変数へ直接書き込む
+    if (callee.type == VALUE_BUILTIN &&
+        builtin_writes_numeric_destination(callee.builtin.fn) &&
+        node->call.arg_count >= callee.builtin.min_args &&
+        node->call.arg_count <= callee.builtin.max_args &&
+        node->call.arguments[0]->type == NODE_IDENTIFIER) {
+        bool has_spread = false;
+        for (int i = 0; i < node->call.arg_count; i++) {
+            ASTNode *arg_node = node->call.arguments[i];
+            if (arg_node->type == NODE_UNARY && arg_node->unary.operator == TOKEN_SPREAD) {
+                has_spread = true;
+            }
+        }
+        if (!has_spread) {
+            return evaluate_numeric_destination_call(eval, node, callee);
+        }
+    }
+
     // 組み込み関数で配列を変更するもの（追加、削除）は特別に処理
     if (callee.type == VALUE_BUILTIN && 
         (strcmp(callee.builtin.name, "追加") == 0 || 
@@ -2170,6 +3392,7 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                 Value element = evaluate(eval, node->call.arguments[1]);
                 if (eval->had_error) return value_null();
                 array_push(array_ptr, element);
+                value_free(&element);  // array_push がコピーを持つ
                 return value_null();
             }
             else if ((strcmp(callee.builtin.name, "削除") == 0 ||
@@ -2266,6 +3489,7 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                          callee.builtin.name, max);
         } else {
             result = callee.builtin.fn(effective_arg_count, args);
+            release_builtin_arguments(args, effective_arg_count, result);
         }
     }
     // ユーザー定義関数
@@ -2328,12 +3552,16 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                     // 可変長引数: 残りの引数を配列に収集
                     Value rest = value_array();
                     for (int j = i; j < effective_arg_count; j++) {
-                        array_push(&rest, value_copy(args[j]));
+                        array_push(&rest, args[j]);
+                        value_free(&args[j]);
                     }
                     env_define(local, params[i].name, rest, false);
                 } else if (i < effective_arg_count) {
-                    // 渡された引数を使用
-                    env_define(local, params[i].name, value_copy(args[i]), false);
+                    // 渡された引数を使用（ファイルハンドルと配列・辞書は評価時に作った値をそのまま移す）
+                    bool move = args[i].type == VALUE_FILE || args[i].type == VALUE_ARRAY ||
+                                args[i].type == VALUE_DICT;
+                    Value arg = move ? args[i] : value_copy(args[i]);
+                    env_define(local, params[i].name, arg, false);
                 } else if (params[i].default_value != NULL) {
                     // デフォルト値を評価して使用
                     Value def_val = evaluate(eval, params[i].default_value);
@@ -2351,6 +3579,8 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                 eval->call_stack[eval->call_stack_depth].line = node->location.line;
                 eval->call_stack_depth++;
             }
+            FunctionProfileFrame profile_frame;
+            function_profile_enter(eval, def, func_name, &profile_frame);
             
             // メソッド呼び出しの場合、current_instanceを設定
             Value *prev_instance = eval->current_instance;
@@ -2380,7 +3610,7 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                 eval->in_generator = true;
                 eval->generator_target = &gen;
                 
-                evaluate(eval, body);
+                evaluate_discard(eval, body);
                 
                 eval->in_generator = prev_in_generator;
                 eval->generator_target = prev_gen_target;
@@ -2390,9 +3620,11 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
                 
                 result = gen;
             } else {
-                evaluate(eval, body);
+                evaluate_discard(eval, body);
             }
             
+            function_profile_leave(eval, &profile_frame);
+
             // コールスタックからポップ
             if (eval->call_stack_depth > 0) {
                 eval->call_stack_depth--;
@@ -2416,6 +3648,7 @@ static Value evaluate_call(Evaluator *eval, ASTNode *node) {
             }
             
             if (eval->returning) {
+                value_free(&result);
                 result = eval->return_value;
                 eval->returning = false;
             }
@@ -2447,6 +3680,8 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
     
     if (array.type == VALUE_ARRAY) {
         if (!require_integer_index(eval, node, index, "配列")) {
+            value_free(&array);
+            value_free(&index);
             return value_null();
         }
         
@@ -2457,14 +3692,31 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
             runtime_error(eval, node->location.line, node->location.column,
                          "インデックスが範囲外です: %d（長さ: %d）",
                          (int)index.number, array.array.length);
+            value_free(&array);
             return value_null();
         }
         
-        return array.array.elements[idx];
+        // 評価時のコピーから要素を抜き出し、残りは解放する（要素内のファイルハンドルなどの参照を残さない）
+        Value element = array.array.elements[idx];
+        array.array.elements[idx] = value_null();
+        value_free(&array);
+        return element;
+    }
+
+    // 比較演算子のマスクで添字を取ると、真の要素・行だけを選ぶ
+    if ((array.type == VALUE_NUMERIC_ARRAY || array.type == VALUE_MATRIX) &&
+        (index.type == VALUE_NUMERIC_ARRAY || index.type == VALUE_MATRIX)) {
+        // 選んだ要素は新しいバッファへコピーされるので、添字の両辺はここで手放す
+        Value args[2] = { array, index };
+        Value result = builtin_masked_select(2, args);
+        value_free(&array);
+        value_free(&index);
+        return result;
     }
 
     if (array.type == VALUE_NUMERIC_ARRAY) {
         if (!require_integer_index(eval, node, index, "数値ベクトル")) {
+            value_free(&array);
             return value_null();
         }
 
@@ -2474,14 +3726,18 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
             runtime_error(eval, node->location.line, node->location.column,
                          "インデックスが範囲外です: %d（長さ: %d）",
                          (int)index.number, array.numeric_array.length);
+            value_free(&array);
             return value_null();
         }
 
-        return value_number(numeric_array_get(&array, idx));
+        double element = numeric_array_get(&array, idx);
+        value_free(&array);
+        return value_number(element);
     }
 
     if (array.type == VALUE_MATRIX) {
         if (!require_integer_index(eval, node, index, "数値行列")) {
+            value_free(&array);
             return value_null();
         }
 
@@ -2491,14 +3747,14 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
             runtime_error(eval, node->location.line, node->location.column,
                          "行インデックスが範囲外です: %d（行数: %d）",
                          (int)index.number, array.matrix.rows);
+            value_free(&array);
             return value_null();
         }
 
-        Value result = value_numeric_array_with_capacity(array.matrix.cols);
-        for (int c = 0; c < array.matrix.cols; c++) {
-            numeric_array_push(&result, matrix_get(&array, row, c));
-        }
-        return result;
+        // 行 view はバッファの参照を自分で持つので、評価時に取った参照は手放す
+        Value view = matrix_row_view(&array, row);
+        value_free(&array);
+        return view;
     }
     
     if (array.type == VALUE_STRING) {
@@ -2518,7 +3774,28 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
             return value_null();
         }
         
-        return string_substring(&array, idx, idx + 1);
+        Value ch = string_substring(&array, idx, idx + 1);
+        value_free(&array);
+        return ch;
+    }
+    
+    if (array.type == VALUE_BYTES) {
+        if (!require_integer_index(eval, node, index, "バイト列")) {
+            return value_null();
+        }
+
+        int idx = (int)index.number;
+        if (idx < 0) idx += array.bytes.length;
+        if (idx < 0 || idx >= array.bytes.length) {
+            runtime_error(eval, node->location.line, node->location.column,
+                         "インデックスが範囲外です: %d（長さ: %d）",
+                         (int)index.number, array.bytes.length);
+            return value_null();
+        }
+
+        double byte = bytes_data(&array)[idx];
+        value_free(&array);
+        return value_number(byte);
     }
     
     if (array.type == VALUE_DICT) {
@@ -2528,11 +3805,14 @@ static Value evaluate_index(Evaluator *eval, ASTNode *node) {
             return value_null();
         }
         
-        return dict_get(&array, index.string.data);
+        Value element = value_copy(dict_get(&array, index.string.data));
+        value_free(&array);
+        value_free(&index);
+        return element;
     }
     
     runtime_error(eval, node->location.line, node->location.column,
-                 "インデックスアクセスは配列、文字列、辞書、数値ベクトル、数値行列にのみ使用できます");
+                 "インデックスアクセスは配列、文字列、辞書、数値ベクトル、数値行列、バイト列にのみ使用できます");
     return value_null();
 }
 
@@ -2555,8 +3835,9 @@ static Value evaluate_var_decl(Evaluator *eval, ASTNode *node) {
     Value value = evaluate(eval, node->var_decl.initializer);
     if (eval->had_error) return value_null();
     
-    // 環境に保存するときはコピーを作成
-    Value copy = value_copy(value);
+    // 環境に保存するときはコピーを作成（演算子・組み込み関数が作った一時ベクトル・行列はそのまま移す）
+    bool moved = is_fresh_numeric_temporary(eval, node->var_decl.initializer, value);
+    Value copy = moved ? value : value_copy(value);
     if (!env_define(eval->current, node->var_decl.name, copy, node->var_decl.is_const)) {
         if (env_is_const(eval->current, node->var_decl.name)) {
             if (is_protected_runtime_name(node->var_decl.name)) {
@@ -2567,12 +3848,21 @@ static Value evaluate_var_decl(Evaluator *eval, ASTNode *node) {
             }
         }
         value_free(&copy);  // 失敗した場合はコピーを解放
+        return value_null();
     }
     
-    return value;
+    return moved ? value_null() : value;
 }
 
 static Value evaluate_assign(Evaluator *eval, ASTNode *node) {
+    if (node->assign.operator != TOKEN_ASSIGN && node->assign.target->type == NODE_IDENTIFIER) {
+        Value *target = env_get(eval->current, node->assign.target->string_value);
+        if (target != NULL &&
+            (target->type == VALUE_NUMERIC_ARRAY || target->type == VALUE_MATRIX)) {
+            return evaluate_numeric_compound_assign(eval, node);
+        }
+    }
+
     Value value = evaluate(eval, node->assign.value);
     if (eval->had_error) return value_null();
     
@@ -2647,12 +3937,14 @@ static Value evaluate_assign(Evaluator *eval, ASTNode *node) {
             return value_null();
         }
         
-        // 環境に保存するときはコピーを作成
-        Value copy = value_copy(value);
+        // 環境に保存するときはコピーを作成（演算子・組み込み関数が作った一時ベクトル・行列はそのまま移す）
+        bool moved = is_fresh_numeric_temporary(eval, node->assign.value, value);
+        Value copy = moved ? value : value_copy(value);
         if (!env_set(eval->current, name, copy)) {
             // 変数が存在しない場合は新規定義
             env_define(eval->current, name, copy, false);
         }
+        if (moved) return value_null();
     }
     else if (node->assign.target->type == NODE_INDEX) {
         /* ネストしたインデックス代入に対応: a["x"]["y"]["z"] = val */
@@ -2785,12 +4077,14 @@ static Value evaluate_assign(Evaluator *eval, ASTNode *node) {
             // 元の変数を更新する必要がある
             if (member_node->member.object->type == NODE_IDENTIFIER) {
                 const char *var_name = member_node->member.object->string_value;
-                env_set(eval->current, var_name, object);
-            } else if (member_node->member.object->type == NODE_SELF) {
-                // 自分の場合、current_instanceを更新
-                if (eval->current_instance != NULL) {
+                if (!env_set(eval->current, var_name, object)) value_free(&object);
+            } else {
+                if (member_node->member.object->type == NODE_SELF && eval->current_instance != NULL) {
+                    // 自分の場合、current_instanceを更新
                     instance_set_field(eval->current_instance, member_node->member.member_name, value);
                 }
+                // 変数へ書き戻さなかった評価結果のコピーは捨てる
+                value_free(&object);
             }
         } else {
             runtime_error(eval, node->location.line, node->location.column, "メンバー代入はインスタンスにのみ使用できます");
@@ -2827,6 +4121,8 @@ static Value evaluate_while(Evaluator *eval, ASTNode *node) {
         
         if (!value_is_truthy(condition)) break;
         
+        value_free(&result);  // 前の反復の結果
+        
         result = evaluate(eval, node->while_stmt.body);
         
         if (eval->returning) break;
@@ -2887,6 +4183,8 @@ static Value evaluate_for(Evaluator *eval, ASTNode *node) {
         
         env_set(eval->current, node->for_stmt.var_name, value_number(i));
         
+        value_free(&result);  // 前の反復の結果
+        
         result = evaluate(eval, node->for_stmt.body);
         
         if (eval->returning) break;
@@ -3088,34 +4386,35 @@ static bool resolve_source_import_path(Evaluator *eval, const char *module_path,
 static Value evaluate_source_as_module(Evaluator *eval, ASTNode *node,
                                        const char *source, const char *source_path,
                                        const char *alias) {
-    /* ソースを strdup してモジュールとして保存（AST / ソースの寿命を evaluator に渡す）*/
-    char *src_copy = strdup(source);
-    if (!src_copy) return value_null();
-
-    Parser parser;
-    parser_init(&parser, src_copy, source_path ? source_path : "<module>");
-    ASTNode *program = parse_program(&parser);
-
-    if (parser.had_error) {
-        node_free(program);
-        free(src_copy);
+    /* ディスクのコンパイルキャッシュが有効なら字句解析・構文解析を省く */
+    size_t source_len = strlen(source);
+    ASTNode *program = module_cache_load(source_path, source, source_len);
+    char *src_copy = NULL;
+
+    if (program == NULL) {
+        /* ソースを strdup してモジュールとして保存（AST / ソースの寿命を evaluator に渡す）*/
+        src_copy = strdup(source);
+        if (!src_copy) return value_null();
+
+        Parser parser;
+        parser_init(&parser, src_copy, source_path ? source_path : "<module>");
+        program = parse_program(&parser);
+
+        if (parser.had_error) {
+            node_free(program);
+            free(src_copy);
+            parser_free(&parser);
+            runtime_error(eval, node->location.line, node->location.column,
+                         "モジュール '%s' のパースに失敗しました",
+                         source_path ? source_path : "<module>");
+            return value_null();
+        }
         parser_free(&parser);
-        runtime_error(eval, node->location.line, node->location.column,
-                     "モジュール '%s' のパースに失敗しました",
-                     source_path ? source_path : "<module>");
-        return value_null();
+        module_cache_store(source_path, source, source_len, program);
     }
-    parser_free(&parser);
 
     /* import 済みモジュールリストに追加 (AST と source の寿命を evaluator に委譲) */
-    if (eval->imported_count >= eval->imported_capacity) {
-        eval->imported_capacity = eval->imported_capacity == 0 ? 4 : eval->imported_capacity * 2;
-        eval->imported_modules = realloc(eval->imported_modules,
-                                         eval->imported_capacity * sizeof(ImportedModule));
-    }
-    eval->imported_modules[eval->imported_count].source = src_copy;
-    eval->imported_modules[eval->imported_count].ast    = program;
-    eval->imported_count++;
+    evaluator_retain_program(eval, src_copy, program);
 
     /* current_file を一時的に切り替え（ネストしたインポートの相対パス解決用）*/
     const char *prev_file = eval->current_file;
@@ -3128,7 +4427,7 @@ static Value evaluate_source_as_module(Evaluator *eval, ASTNode *node,
         eval->current = module_env;
 
         for (int i = 0; i < program->block.count; i++) {
-            evaluate(eval, program->block.statements[i]);
+            evaluate_discard(eval, program->block.statements[i]);
             if (eval->had_error) {
                 eval->current = prev;
                 eval->current_file = prev_file;
@@ -3153,7 +4452,7 @@ static Value evaluate_source_as_module(Evaluator *eval, ASTNode *node,
     } else {
         /* 直接インポート: 現在の環境で実行 */
         for (int i = 0; i < program->block.count; i++) {
-            evaluate(eval, program->block.statements[i]);
+            evaluate_discard(eval, program->block.statements[i]);
             if (eval->had_error) break;
         }
     }
@@ -3389,7 +4688,8 @@ static Value evaluate_class_def(Evaluator *eval, ASTNode *node) {
     // グローバル環境に登録
     env_define(eval->current, node->class_def.name, class_val, true);
     
-    return class_val;
+    // クラス値は環境が持つので、関数定義と同じく文の結果は null
+    return value_null();
 }
 
 static Value evaluate_new(Evaluator *eval, ASTNode *node) {
@@ -3447,7 +4747,7 @@ static Value evaluate_new(Evaluator *eval, ASTNode *node) {
         eval->current_instance = instance_ptr;
         
         // 初期化メソッドを実行
-        evaluate(eval, init->method.body);
+        evaluate_discard(eval, init->method.body);
         
         // インスタンスを取り戻す
         instance = *eval->current_instance;
@@ -3557,7 +4857,10 @@ static Value evaluate_member(Evaluator *eval, ASTNode *node) {
         
         Value *field = instance_get_field(&object, member_name);
         if (field != NULL) {
-            return value_copy(*field);
+            // 評価で得たインスタンスのコピーはフィールドを取り出したら不要
+            Value result = value_copy(*field);
+            value_free(&object);
+            return result;
         }
         
         // メソッドを探す（親クラスも含む）
@@ -3568,6 +4871,7 @@ static Value evaluate_member(Evaluator *eval, ASTNode *node) {
                 ASTNode *method = class_def->class_def.methods[i];
                 if (strcmp(method->method.name, member_name) == 0) {
                     // バインドされたメソッドを返す（関数として）
+                    value_free(&object);
                     return value_function(method, eval->current);
                 }
             }
@@ -3602,7 +4906,9 @@ static Value evaluate_member(Evaluator *eval, ASTNode *node) {
     if (object.type == VALUE_DICT) {
         Value val = dict_get(&object, member_name);
         if (val.type != VALUE_NULL) {
-            return value_copy(val);
+            Value result = value_copy(val);
+            value_free(&object);
+            return result;
         }
         const char *similar = find_similar_dict_key(&object, member_name);
         if (similar != NULL) {
@@ -3669,7 +4975,7 @@ static Value evaluate_try(Evaluator *eval, ASTNode *node) {
     Value result = value_null();
     
     // 試行ブロックを実行
-    evaluate(eval, node->try_stmt.try_block);
+    evaluate_discard(eval, node->try_stmt.try_block);
     
     bool caught_runtime_error = false;
     if (eval->had_error && node->try_stmt.catch_block != NULL) {
@@ -3686,7 +4992,7 @@ static Value evaluate_try(Evaluator *eval, ASTNode *node) {
 
         Environment *prev = eval->current;
         eval->current = catch_scope;
-        evaluate(eval, node->try_stmt.catch_block);
+        evaluate_discard(eval, node->try_stmt.catch_block);
         eval->current = prev;
         env_release(catch_scope);
     }
@@ -3707,7 +5013,7 @@ static Value evaluate_try(Evaluator *eval, ASTNode *node) {
         Environment *prev = eval->current;
         eval->current = catch_scope;
         
-        evaluate(eval, node->try_stmt.catch_block);
+        evaluate_discard(eval, node->try_stmt.catch_block);
         
         eval->current = prev;
         env_release(catch_scope);
@@ -3725,7 +5031,7 @@ static Value evaluate_try(Evaluator *eval, ASTNode *node) {
         eval->throwing = false;
         eval->returning = false;
         
-        evaluate(eval, node->try_stmt.finally_block);
+        evaluate_discard(eval, node->try_stmt.finally_block);
         
         // finally中に新しい例外や戻り値がなければ元に戻す
         if (!eval->throwing && was_throwing) {
@@ -3922,6 +5228,8 @@ static Value evaluate_foreach(Evaluator *eval, ASTNode *node) {
             env_define(eval->current, node->foreach_stmt.var_name,
                       value_copy(iterable.array.elements[i]), false);
             
+            value_free(&result);  // 前の反復の結果
+            
             result = evaluate(eval, node->foreach_stmt.body);
             
             if (eval->returning) break;
@@ -3941,6 +5249,8 @@ static Value evaluate_foreach(Evaluator *eval, ASTNode *node) {
             Value ch = string_substring(&iterable, i, i + 1);
             env_define(eval->current, node->foreach_stmt.var_name, ch, false);
             
+            value_free(&result);  // 前の反復の結果
+            
             result = evaluate(eval, node->foreach_stmt.body);
             
             if (eval->returning) break;
@@ -3966,6 +5276,44 @@ static Value evaluate_foreach(Evaluator *eval, ASTNode *node) {
                               value_copy(iterable.dict.values[i]), false);
                 }
                 
+                value_free(&result);  // 前の反復の結果
+                
+                result = evaluate(eval, node->foreach_stmt.body);
+                
+                if (eval->returning) break;
+                if (eval->breaking) {
+                    eval->breaking = false;
+                    break;
+                }
+                if (eval->continuing) {
+                    eval->continuing = false;
+                    continue;
+                }
+            }
+        }
+    } else if (iterable.type == VALUE_FILE) {
+        // ファイルの各行を遅延読み込み。行バッファとループ変数の文字列バッファを使い回し、
+        // 本体が値を保持する場合は代入・追加の時点でコピーされる
+        FileHandle *handle = iterable.file.handle;
+        if (handle == NULL || handle->fp == NULL || !handle->readable) {
+            runtime_error(eval, node->location.line, node->location.column,
+                         "反復できるのは読み取り用に開いたファイルのみです");
+        } else {
+            char *line = NULL;
+            size_t capacity = 0;
+            size_t length = 0;
+            while (handle->fp != NULL &&
+                   file_handle_read_line_into(handle, &line, &capacity, &length)) {
+                Value *slot = env_exists_local(eval->current, node->foreach_stmt.var_name)
+                    ? env_get(eval->current, node->foreach_stmt.var_name) : NULL;
+                if (slot == NULL || slot->type != VALUE_STRING ||
+                    !string_assign_n(slot, line, (int)length)) {
+                    env_define(eval->current, node->foreach_stmt.var_name,
+                              value_string_n(line, (int)length), false);
+                }
+                
+                value_free(&result);  // 前の反復の結果
+                
                 result = evaluate(eval, node->foreach_stmt.body);
                 
                 if (eval->returning) break;
@@ -3978,10 +5326,13 @@ static Value evaluate_foreach(Evaluator *eval, ASTNode *node) {
                     continue;
                 }
             }
+            free(line);
         }
+        // 評価時に取ったハンドルの参照を返す（ファイル行() の一時ハンドルはここで閉じる）
+        value_free(&iterable);
     } else {
         runtime_error(eval, node->location.line, node->location.column,
-                     "反復できるのは配列、文字列、辞書のみです");
+                     "反復できるのは配列、文字列、辞書、ファイルのみです");
     }
     
     eval->current = prev;
@@ -4114,22 +5465,23 @@ cleanup:
 // =============================================================================
 
 static Value builtin_print(int argc, Value *argv) {
+    FILE *out = evaluator_output();
     for (int i = 0; i < argc; i++) {
-        if (i > 0) printf(" ");
+        if (i > 0) fputc(' ', out);
         // toStringプロトコル
         if (argv[i].type == VALUE_INSTANCE) {
             Value str_val = call_instance_to_string(&argv[i]);
             char *str = value_to_string(str_val);
-            printf("%s", str);
+            fputs(str, out);
             free(str);
             value_free(&str_val);
         } else {
             char *str = value_to_string(argv[i]);
-            printf("%s", str);
+            fputs(str, out);
             free(str);
         }
     }
-    printf("\n");
+    fputc('\n', out);
     return value_null();
 }
 
@@ -4165,6 +5517,9 @@ static Value builtin_length(int argc, Value *argv) {
     if (argv[0].type == VALUE_STRING) {
         return value_number(string_length(&argv[0]));
     }
+    if (argv[0].type == VALUE_BYTES) {
+        return value_number(argv[0].bytes.length);
+    }
     
     return value_number(0);
 }
@@ -4292,20 +5647,10 @@ static Value builtin_astype(int argc, Value *argv) {
     }
 
     if (argv[0].type == VALUE_NUMERIC_ARRAY) {
-        Value result = value_numeric_array_with_dtype(argv[0].numeric_array.length, dtype);
-        for (int i = 0; i < argv[0].numeric_array.length; i++) {
-            numeric_array_push(&result, numeric_array_get(&argv[0], i));
-        }
-        return result;
+        return numeric_array_astype(&argv[0], dtype);
     }
     if (argv[0].type == VALUE_MATRIX) {
-        Value result = value_matrix_with_dtype(argv[0].matrix.rows, argv[0].matrix.cols, dtype);
-        for (int r = 0; r < argv[0].matrix.rows; r++) {
-            for (int c = 0; c < argv[0].matrix.cols; c++) {
-                matrix_set(&result, r, c, matrix_get(&argv[0], r, c));
-            }
-        }
-        return result;
+        return matrix_astype(&argv[0], dtype);
     }
 
     builtin_runtime_error("astype の第1引数は数値ベクトルまたは行列でなければなりません（実際: %s）",
@@ -4756,6 +6101,15 @@ static uint32_t unique_hash_value(Value value) {
             return unique_mix_hash(hash, (uint32_t)(uintptr_t)value.instance.class_ref);
         case VALUE_GENERATOR:
             return unique_mix_hash(hash, (uint32_t)(uintptr_t)value.generator.state);
+        case VALUE_FILE:
+            return unique_mix_hash(hash, (uint32_t)(uintptr_t)value.file.handle);
+        case VALUE_BYTES:
+            return unique_mix_hash(hash, unique_hash_bytes((const char *)bytes_data(&value),
+                                                           value.bytes.length));
+        case VALUE_REGEX: {
+            const char *pattern = value.regex.handle != NULL ? value.regex.handle->pattern : "";
+            return unique_mix_hash(hash, unique_hash_bytes(pattern, (int)strlen(pattern)));
+        }
     }
 
     return hash;
@@ -5003,6 +6357,236 @@ static Value builtin_dir_create(int argc, Value *argv) {
     return value_bool(ret == 0 || errno == EEXIST);
 }
 
+// =============================================================================
+// ファイルハンドル
+// =============================================================================
+
+// 既定の stdio バッファサイズ（行単位の大量追記を想定して BUFSIZ より大きめ）
+#define FILE_HANDLE_DEFAULT_BUFFER (64 * 1024)
+#define FILE_HANDLE_MAX_BUFFER (64 * 1024 * 1024)
+
+// fopen のモード文字列を検証し、読み書きの可否を返す
+static bool file_open_mode_parse(const char *mode, bool *readable, bool *writable) {
+    static const char *modes[] = {"r", "w", "a", "r+", "w+", "a+"};
+    char base[3] = {0};
+    size_t n = 0;
+    for (const char *p = mode; *p != '\0'; p++) {
+        if (*p == 'b') continue;
+        if (n >= 2) return false;
+        base[n++] = *p;
+    }
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(base, modes[i]) == 0) {
+            bool plus = base[1] == '+';
+            *readable = base[0] == 'r' || plus;
+            *writable = base[0] != 'r' || plus;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ハンドル引数を検証する（閉じ済み・用途違いは実行時エラー）
+static FileHandle *file_handle_arg(Value v, const char *fn_name, bool need_read, bool need_write) {
+    if (v.type != VALUE_FILE || v.file.handle == NULL) {
+        builtin_runtime_error("%s にはファイルハンドルを渡してください（実際: %s）",
+                              fn_name, value_runtime_type_name(v));
+        return NULL;
+    }
+    FileHandle *handle = v.file.handle;
+    if (handle->fp == NULL) {
+        builtin_runtime_error("%s: ファイルは既に閉じられています: %s", fn_name, handle->path);
+        return NULL;
+    }
+    if (need_read && !handle->readable) {
+        builtin_runtime_error("%s: 読み取りモードで開かれていません: %s", fn_name, handle->path);
+        return NULL;
+    }
+    if (need_write && !handle->writable) {
+        builtin_runtime_error("%s: 書き込みモードで開かれていません: %s", fn_name, handle->path);
+        return NULL;
+    }
+    return handle;
+}
+
+// ファイル開く: バッファ付きファイルハンドルを返す（失敗時は無）
+static Value builtin_file_open(int argc, Value *argv) {
+    if (argv[0].type != VALUE_STRING) return value_null();
+
+    const char *mode = "r";
+    if (argc >= 2 && argv[1].type == VALUE_STRING) {
+        mode = argv[1].string.data;
+    }
+    bool readable = false;
+    bool writable = false;
+    if (!file_open_mode_parse(mode, &readable, &writable)) {
+        builtin_runtime_error("未知のファイルモードです: %s（利用可能: r, w, a, r+, w+, a+）", mode);
+        return value_null();
+    }
+
+    size_t buffer_size = FILE_HANDLE_DEFAULT_BUFFER;
+    if (argc >= 3 && argv[2].type == VALUE_NUMBER) {
+        if (argv[2].number < 0 || argv[2].number > FILE_HANDLE_MAX_BUFFER) {
+            builtin_runtime_error("バッファサイズは 0〜%d バイトで指定してください", FILE_HANDLE_MAX_BUFFER);
+            return value_null();
+        }
+        // 0 は stdio の既定バッファ
+        buffer_size = (size_t)argv[2].number;
+    }
+
+    FILE *fp = fopen(argv[0].string.data, mode);
+    if (fp == NULL) return value_null();
+    return value_file(fp, argv[0].string.data, buffer_size, readable, writable);
+}
+
+// 次の1行を改行を除いて *line へ読み込む（バッファは呼び出し側が使い回す）。
+// EOF で何も読めなければ false を返す。
+static bool file_handle_read_line_into(FileHandle *handle, char **line, size_t *capacity, size_t *length) {
+    if (*line == NULL) {
+        *capacity = 256;
+        *line = malloc(*capacity);
+        if (*line == NULL) return false;
+    }
+
+    size_t used = 0;
+    bool read_any = false;
+    while (fgets(*line + used, (int)(*capacity - used), handle->fp) != NULL) {
+        read_any = true;
+        used += strlen(*line + used);
+        if (used > 0 && (*line)[used - 1] == '\n') break;
+        if (*capacity - used > 1) continue;
+        char *grown = realloc(*line, *capacity * 2);
+        if (grown == NULL) break;
+        *line = grown;
+        *capacity *= 2;
+    }
+    if (!read_any) return false;
+
+    if (used > 0 && (*line)[used - 1] == '\n') used--;
+    if (used > 0 && (*line)[used - 1] == '\r') used--;
+    *length = used;
+    return true;
+}
+
+// 行読込: 改行を除いた1行を返す（EOF なら無）
+static Value builtin_file_read_line(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "行読込", true, false);
+    if (handle == NULL) return value_null();
+
+    char *line = NULL;
+    size_t capacity = 0;
+    size_t length = 0;
+    Value result = value_null();
+    if (file_handle_read_line_into(handle, &line, &capacity, &length)) {
+        result = value_string_n(line, (int)length);
+    }
+    free(line);
+    return result;
+}
+
+// ファイル行: 各行を遅延読み込みする反復用ハンドル（各 ... の中 で使う）
+static Value builtin_file_lines(int argc, Value *argv) {
+    if (argv[0].type != VALUE_STRING) return value_null();
+
+    size_t buffer_size = FILE_HANDLE_DEFAULT_BUFFER;
+    if (argc >= 2 && argv[1].type == VALUE_NUMBER) {
+        if (argv[1].number < 0 || argv[1].number > FILE_HANDLE_MAX_BUFFER) {
+            builtin_runtime_error("バッファサイズは 0〜%d バイトで指定してください", FILE_HANDLE_MAX_BUFFER);
+            return value_null();
+        }
+        buffer_size = (size_t)argv[1].number;
+    }
+
+    FILE *fp = fopen(argv[0].string.data, "r");
+    if (fp == NULL) {
+        builtin_runtime_error("ファイルを開けません: %s", argv[0].string.data);
+        return value_null();
+    }
+    return value_file(fp, argv[0].string.data, buffer_size, true, false);
+}
+
+// チャンク読込: 最大 n バイトを読み込む（EOF なら無）
+static Value builtin_file_read_chunk(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "チャンク読込", true, false);
+    if (handle == NULL) return value_null();
+    if (argv[1].type != VALUE_NUMBER || argv[1].number < 1 || argv[1].number > INT_MAX) {
+        builtin_runtime_error("チャンク読込 のサイズは 1 以上の数値で指定してください");
+        return value_null();
+    }
+
+    size_t want = (size_t)argv[1].number;
+    char *chunk = malloc(want);
+    if (chunk == NULL) {
+        builtin_runtime_error("チャンク読込 の作業メモリを確保できませんでした");
+        return value_null();
+    }
+    size_t got = fread(chunk, 1, want, handle->fp);
+    if (got == 0) {
+        free(chunk);
+        return value_null();
+    }
+    Value result = value_string_n(chunk, (int)got);
+    free(chunk);
+    return result;
+}
+
+static bool file_handle_write_value(FileHandle *handle, Value v, bool newline) {
+    bool ok;
+    if (v.type == VALUE_BYTES) {
+        size_t length = (size_t)v.bytes.length;
+        ok = length == 0 || fwrite(bytes_data(&v), 1, length, handle->fp) == length;
+    } else if (v.type == VALUE_STRING) {
+        size_t length = (size_t)v.string.byte_length;
+        ok = fwrite(v.string.data, 1, length, handle->fp) == length;
+    } else {
+        char *text = value_to_string(v);
+        size_t length = strlen(text);
+        ok = fwrite(text, 1, length, handle->fp) == length;
+        free(text);
+    }
+    if (ok && newline) {
+        ok = fputc('\n', handle->fp) != EOF;
+    }
+    return ok;
+}
+
+// 書出: ハンドルのバッファへ書き込む
+static Value builtin_file_handle_write(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "書出", false, true);
+    if (handle == NULL) return value_bool(false);
+    return value_bool(file_handle_write_value(handle, argv[1], false));
+}
+
+// 行書出: 改行付きで書き込む
+static Value builtin_file_handle_write_line(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "行書出", false, true);
+    if (handle == NULL) return value_bool(false);
+    return value_bool(file_handle_write_value(handle, argv[1], true));
+}
+
+// フラッシュ: バッファの内容を OS へ書き出す
+static Value builtin_file_flush(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "フラッシュ", false, false);
+    if (handle == NULL) return value_bool(false);
+    return value_bool(fflush(handle->fp) == 0);
+}
+
+// ファイル閉じる: 明示的に閉じる（閉じ済みなら何もしない）
+static Value builtin_file_close(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_FILE || argv[0].file.handle == NULL) {
+        builtin_runtime_error("ファイル閉じる にはファイルハンドルを渡してください（実際: %s）",
+                              value_runtime_type_name(argv[0]));
+        return value_bool(false);
+    }
+    return value_bool(file_handle_close(argv[0].file.handle));
+}
+
 // =============================================================================
 // ユーティリティ関数
 // =============================================================================
@@ -5049,6 +6633,9 @@ static Value builtin_typeof_check(int argc, Value *argv) {
     if (strcmp(type_name, "関数") == 0) return value_bool(argv[0].type == VALUE_FUNCTION);
     if (strcmp(type_name, "無") == 0) return value_bool(argv[0].type == VALUE_NULL);
     if (strcmp(type_name, "ジェネレータ") == 0) return value_bool(argv[0].type == VALUE_GENERATOR);
+    if (strcmp(type_name, "ファイル") == 0) return value_bool(argv[0].type == VALUE_FILE);
+    if (strcmp(type_name, "バイト列") == 0) return value_bool(argv[0].type == VALUE_BYTES);
+    if (strcmp(type_name, "正規表現") == 0) return value_bool(argv[0].type == VALUE_REGEX);
     
     // クラスインスタンスの場合、クラス名と比較
     if (argv[0].type == VALUE_INSTANCE && argv[0].instance.class_ref != NULL) {
@@ -5106,6 +6693,7 @@ static Value call_instance_operator(Value *instance, const char *method_name, Va
                 Value ret = evaluate(g_eval, func_body);
                 
                 if (g_eval->returning) {
+                    value_free(&ret);
                     ret = g_eval->return_value;
                     g_eval->returning = false;
                 }
@@ -5159,6 +6747,7 @@ static Value call_instance_to_string(Value *instance) {
                 Value ret = evaluate(g_eval, method->method.body);
                 
                 if (g_eval->returning) {
+                    value_free(&ret);
                     ret = g_eval->return_value;
                     g_eval->returning = false;
                 }
@@ -5246,14 +6835,8 @@ static Value builtin_max(int argc, Value *argv) {
     if (argc == 0) return value_null();
 
     if (argc == 1 && argv[0].type == VALUE_NUMERIC_ARRAY) {
-        if (argv[0].numeric_array.length == 0) return value_null();
-        double max = numeric_array_get(&argv[0], 0);
-        for (int i = 1; i < argv[0].numeric_array.length; i++) {
-            double item = numeric_array_get(&argv[0], i);
-            if (item > max) {
-                max = item;
-            }
-        }
+        double min, max;
+        if (!numeric_array_min_max(&argv[0], &min, &max)) return value_null();
         return value_number(max);
     }
     
@@ -5273,14 +6856,8 @@ static Value builtin_min(int argc, Value *argv) {
     if (argc == 0) return value_null();
 
     if (argc == 1 && argv[0].type == VALUE_NUMERIC_ARRAY) {
-        if (argv[0].numeric_array.length == 0) return value_null();
-        double min = numeric_array_get(&argv[0], 0);
-        for (int i = 1; i < argv[0].numeric_array.length; i++) {
-            double item = numeric_array_get(&argv[0], i);
-            if (item < min) {
-                min = item;
-            }
-        }
+        double min, max;
+        if (!numeric_array_min_max(&argv[0], &min, &max)) return value_null();
         return value_number(min);
     }
     
@@ -5400,11 +6977,7 @@ static Value builtin_vector_sum(int argc, Value *argv) {
     (void)argc;
     if (argv[0].type != VALUE_NUMERIC_ARRAY) return value_null();
 
-    double total = 0.0;
-    for (int i = 0; i < argv[0].numeric_array.length; i++) {
-        total += numeric_array_get(&argv[0], i);
-    }
-    return value_number(total);
+    return value_number(numeric_array_sum(&argv[0]));
 }
 
 static Value builtin_mean(int argc, Value *argv) {
@@ -5412,9 +6985,7 @@ static Value builtin_mean(int argc, Value *argv) {
     if (argv[0].type == VALUE_NUMERIC_ARRAY) {
         int n = argv[0].numeric_array.length;
         if (n == 0) return value_null();
-        double total = 0.0;
-        for (int i = 0; i < n; i++) total += numeric_array_get(&argv[0], i);
-        return value_number(total / n);
+        return value_number(numeric_array_sum(&argv[0]) / n);
     }
 
     if (argv[0].type == VALUE_ARRAY) {
@@ -5438,17 +7009,9 @@ static Value builtin_variance(int argc, Value *argv) {
     int n = argv[0].numeric_array.length;
     if (n == 0) return value_null();
 
-    double mean = 0.0;
-    for (int i = 0; i < n; i++) mean += numeric_array_get(&argv[0], i);
-    mean /= n;
-
-    double total = 0.0;
-    for (int i = 0; i < n; i++) {
-        double delta = numeric_array_get(&argv[0], i) - mean;
-        total += delta * delta;
-    }
-
-    return value_number(total / n);
+    // 整数 dtype の合計は折り返すので、平均は double で累積して求める
+    double mean = numeric_array_mean(&argv[0]);
+    return value_number(numeric_array_squared_deviation_sum(&argv[0], mean) / n);
 }
 
 static Value builtin_std(int argc, Value *argv) {
@@ -5516,6 +7079,172 @@ static bool copy_numeric_values(Value input, const char *name, double **out, int
     return false;
 }
 
+static bool reject_nan_values(const double *data, int n, const char *name) {
+    for (int i = 0; i < n; i++) {
+        if (isnan(data[i])) {
+            builtin_runtime_error("%s は NaN を含むデータを扱えません（%d番目の要素）。欠損削除 または 欠損補完 で前処理してください",
+                                  name, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void swap_doubles(double *data, int a, int b) {
+    double tmp = data[a];
+    data[a] = data[b];
+    data[b] = tmp;
+}
+
+// Floyd-Rivest 選択。data[k] に k 番目に小さい値を置き、左側は以下・右側は以上になる。
+// 分割が偏り続けた場合は残りの区間をソートして打ち切る（introselect と同じ保険）。
+static void select_kth_range(double *data, int left, int right, int k, int depth) {
+    while (right > left) {
+        if (depth-- <= 0) {
+            qsort(data + left, (size_t)(right - left + 1), sizeof(double), compare_double_values);
+            return;
+        }
+        if (right - left > 600) {
+            double n = right - left + 1;
+            double i = k - left + 1;
+            double z = log(n);
+            double s = 0.5 * exp(2.0 * z / 3.0);
+            double sd = 0.5 * sqrt(z * s * (n - s) / n) * (i - n / 2.0 < 0 ? -1.0 : 1.0);
+            int new_left = (int)fmax(left, floor(k - i * s / n + sd));
+            int new_right = (int)fmin(right, floor(k + (n - i) * s / n + sd));
+            select_kth_range(data, new_left, new_right, k, depth);
+        }
+
+        double pivot = data[k];
+        int i = left;
+        int j = right;
+        swap_doubles(data, left, k);
+        if (data[right] > pivot) swap_doubles(data, right, left);
+        while (i < j) {
+            swap_doubles(data, i, j);
+            i++;
+            j--;
+            while (data[i] < pivot) i++;
+            while (data[j] > pivot) j--;
+        }
+        if (data[left] == pivot) {
+            swap_doubles(data, left, j);
+        } else {
+            j++;
+            swap_doubles(data, j, right);
+        }
+        if (j <= k) left = j + 1;
+        if (k <= j) right = j - 1;
+    }
+}
+
+static int select_depth_limit(int n) {
+    int depth = 8;
+    while (n > 1) {
+        depth += 2;
+        n >>= 1;
+    }
+    return depth;
+}
+
+// 昇順に並んだ重複のない順位 ks をすべて確定させる。中央の順位で分割し、
+// 左右の区間には該当する順位だけを渡すので、分位点の数が増えても全体ソートにはならない。
+static void select_kth_many(double *data, int left, int right, const int *ks, int count) {
+    while (count > 0 && left < right) {
+        int mid = count / 2;
+        int k = ks[mid];
+        select_kth_range(data, left, right, k, select_depth_limit(right - left + 1));
+        select_kth_many(data, left, k - 1, ks, mid);
+        left = k + 1;
+        ks += mid + 1;
+        count -= mid + 1;
+    }
+}
+
+static bool quantile_point_value(Value point, const char *name, double *out) {
+    if (point.type != VALUE_NUMBER || isnan(point.number) || point.number < 0.0 || point.number > 1.0) {
+        if (point.type == VALUE_NUMBER) {
+            builtin_runtime_error("%s の分位点は 0 から 1 の範囲で指定してください（実際: %g）", name, point.number);
+        } else {
+            builtin_runtime_error("%s の分位点は 0 から 1 の数値でなければなりません（実際: %s）",
+                                  name, value_type_name(point.type));
+        }
+        return false;
+    }
+    *out = point.number;
+    return true;
+}
+
+static bool copy_quantile_points(Value input, const char *name, double **out, int *length) {
+    *out = NULL;
+    *length = 0;
+    int n = 0;
+    if (input.type == VALUE_ARRAY) {
+        n = input.array.length;
+    } else if (input.type == VALUE_NUMERIC_ARRAY) {
+        n = input.numeric_array.length;
+    } else {
+        builtin_runtime_error("%s の第2引数は分位点の配列でなければなりません（実際: %s）",
+                              name, value_type_name(input.type));
+        return false;
+    }
+    double *points = malloc(sizeof(double) * (size_t)(n > 0 ? n : 1));
+    if (points == NULL) {
+        builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        Value point = input.type == VALUE_ARRAY
+            ? input.array.elements[i]
+            : value_number(numeric_array_get(&input, i));
+        if (!quantile_point_value(point, name, &points[i])) {
+            free(points);
+            return false;
+        }
+    }
+    *out = points;
+    *length = n;
+    return true;
+}
+
+static int compare_int_values(const void *a, const void *b) {
+    int ia = *(const int *)a;
+    int ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// data を部分的に並べ替え、points の各分位点を線形補間で results に書く。
+static bool exact_quantiles(double *data, int n, const double *points, int count,
+                            double *results, const char *name) {
+    int *ranks = malloc(sizeof(int) * (size_t)(count * 2 > 0 ? count * 2 : 1));
+    if (ranks == NULL) {
+        builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+        return false;
+    }
+    int rank_count = 0;
+    for (int i = 0; i < count; i++) {
+        double pos = points[i] * (double)(n - 1);
+        ranks[rank_count++] = (int)floor(pos);
+        ranks[rank_count++] = (int)ceil(pos);
+    }
+    qsort(ranks, (size_t)rank_count, sizeof(int), compare_int_values);
+    int unique = 0;
+    for (int i = 0; i < rank_count; i++) {
+        if (unique == 0 || ranks[unique - 1] != ranks[i]) ranks[unique++] = ranks[i];
+    }
+    select_kth_many(data, 0, n - 1, ranks, unique);
+    free(ranks);
+
+    for (int i = 0; i < count; i++) {
+        double pos = points[i] * (double)(n - 1);
+        int lower = (int)floor(pos);
+        int upper = (int)ceil(pos);
+        double frac = pos - lower;
+        results[i] = data[lower] * (1.0 - frac) + data[upper] * frac;
+    }
+    return true;
+}
+
 static Value builtin_quantile(int argc, Value *argv) {
     (void)argc;
     if (argv[1].type != VALUE_NUMBER) {
@@ -5533,15 +7262,15 @@ static Value builtin_quantile(int argc, Value *argv) {
     double *data = NULL;
     int n = 0;
     if (!copy_numeric_values(argv[0], "quantile", &data, &n)) return value_null();
+    if (!reject_nan_values(data, n, "quantile")) {
+        free(data);
+        return value_null();
+    }
 
-    qsort(data, (size_t)n, sizeof(double), compare_double_values);
-    double pos = q * (double)(n - 1);
-    int lower = (int)floor(pos);
-    int upper = (int)ceil(pos);
-    double frac = pos - lower;
-    double value = data[lower] * (1.0 - frac) + data[upper] * frac;
+    double value = 0.0;
+    bool ok = exact_quantiles(data, n, &q, 1, &value, "quantile");
     free(data);
-    return value_number(value);
+    return ok ? value_number(value) : value_null();
 }
 
 static Value builtin_median(int argc, Value *argv) {
@@ -5551,6 +7280,340 @@ static Value builtin_median(int argc, Value *argv) {
     return builtin_quantile(2, args);
 }
 
+// ---- 近似分位点スケッチ（merging t-digest） ----
+// メモリに載らない大量データ向け。値をバッファへ溜め、満杯になったら重心列へまとめる。
+// 重心の大きさは k1 スケール関数で制限するため、裾（p99 など）ほど細かく保たれる。
+
+typedef struct {
+    double mean;
+    double weight;
+} QuantileCentroid;
+
+typedef struct {
+    QuantileCentroid *items;
+    int count;
+    int capacity;
+    double compression;
+    double total;
+    double min;
+    double max;
+} QuantileDigest;
+
+#define QUANTILE_SKETCH_KIND "quantile_sketch"
+#define QUANTILE_SKETCH_DEFAULT_COMPRESSION 100.0
+
+static int compare_centroids(const void *a, const void *b) {
+    double ma = ((const QuantileCentroid *)a)->mean;
+    double mb = ((const QuantileCentroid *)b)->mean;
+    return (ma > mb) - (ma < mb);
+}
+
+static bool quantile_digest_init(QuantileDigest *digest, double compression) {
+    digest->compression = compression;
+    digest->count = 0;
+    digest->total = 0.0;
+    digest->min = INFINITY;
+    digest->max = -INFINITY;
+    digest->capacity = (int)(compression * 6) + 16;
+    digest->items = malloc(sizeof(QuantileCentroid) * (size_t)digest->capacity);
+    return digest->items != NULL;
+}
+
+static double quantile_digest_scale(double q, double compression) {
+    return compression / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+static double quantile_digest_scale_inverse(double k, double compression) {
+    return (sin(k * 2.0 * M_PI / compression) + 1.0) / 2.0;
+}
+
+static void quantile_digest_compress(QuantileDigest *digest) {
+    if (digest->count <= 1) return;
+    qsort(digest->items, (size_t)digest->count, sizeof(QuantileCentroid), compare_centroids);
+
+    double total = 0.0;
+    for (int i = 0; i < digest->count; i++) total += digest->items[i].weight;
+
+    int out = 0;
+    double seen = 0.0;
+    double limit = total * quantile_digest_scale_inverse(
+        quantile_digest_scale(0.0, digest->compression) + 1.0, digest->compression);
+    QuantileCentroid current = digest->items[0];
+    for (int i = 1; i < digest->count; i++) {
+        QuantileCentroid next = digest->items[i];
+        if (seen + current.weight + next.weight <= limit) {
+            double weight = current.weight + next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / weight;
+            current.weight = weight;
+        } else {
+            seen += current.weight;
+            digest->items[out++] = current;
+            double q = seen / total;
+            limit = total * quantile_digest_scale_inverse(
+                quantile_digest_scale(q, digest->compression) + 1.0, digest->compression);
+            current = next;
+        }
+    }
+    digest->items[out++] = current;
+    digest->count = out;
+    digest->total = total;
+}
+
+static bool quantile_digest_add(QuantileDigest *digest, double value, double weight) {
+    if (digest->count >= digest->capacity) {
+        quantile_digest_compress(digest);
+        if (digest->count >= digest->capacity / 2) {
+            int capacity = digest->capacity * 2;
+            QuantileCentroid *items = realloc(digest->items, sizeof(QuantileCentroid) * (size_t)capacity);
+            if (items == NULL) return false;
+            digest->items = items;
+            digest->capacity = capacity;
+        }
+    }
+    digest->items[digest->count].mean = value;
+    digest->items[digest->count].weight = weight;
+    digest->count++;
+    digest->total += weight;
+    if (value < digest->min) digest->min = value;
+    if (value > digest->max) digest->max = value;
+    return true;
+}
+
+static double quantile_digest_value(const QuantileDigest *digest, double q) {
+    if (digest->count == 1 || q <= 0.0) return q <= 0.0 ? digest->min : digest->items[0].mean;
+    if (q >= 1.0) return digest->max;
+
+    double target = q * digest->total;
+    const QuantileCentroid *items = digest->items;
+    double first_center = items[0].weight / 2.0;
+    if (target <= first_center) {
+        return digest->min + (items[0].mean - digest->min) * (target / first_center);
+    }
+
+    double cumulative = 0.0;
+    for (int i = 0; i + 1 < digest->count; i++) {
+        double left_center = cumulative + items[i].weight / 2.0;
+        double right_center = cumulative + items[i].weight + items[i + 1].weight / 2.0;
+        if (target <= right_center) {
+            double frac = (target - left_center) / (right_center - left_center);
+            return items[i].mean + (items[i + 1].mean - items[i].mean) * frac;
+        }
+        cumulative += items[i].weight;
+    }
+
+    const QuantileCentroid *last = &items[digest->count - 1];
+    double last_center = digest->total - last->weight / 2.0;
+    double frac = (target - last_center) / (digest->total - last_center);
+    return last->mean + (digest->max - last->mean) * frac;
+}
+
+static bool is_quantile_sketch(Value value) {
+    if (value.type != VALUE_DICT) return false;
+    Value kind = dict_get(&value, "kind");
+    return kind.type == VALUE_STRING && strcmp(kind.string.data, QUANTILE_SKETCH_KIND) == 0;
+}
+
+static bool quantile_digest_from_sketch(Value sketch, QuantileDigest *digest, const char *name) {
+    Value compression = dict_get(&sketch, "compression");
+    Value means = dict_get(&sketch, "means");
+    Value weights = dict_get(&sketch, "weights");
+    Value min = dict_get(&sketch, "min");
+    Value max = dict_get(&sketch, "max");
+    if (compression.type != VALUE_NUMBER || means.type != VALUE_NUMERIC_ARRAY ||
+        weights.type != VALUE_NUMERIC_ARRAY ||
+        means.numeric_array.length != weights.numeric_array.length) {
+        builtin_runtime_error("%s に渡された分位点スケッチが壊れています", name);
+        return false;
+    }
+    if (!quantile_digest_init(digest, compression.number)) {
+        builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+        return false;
+    }
+    for (int i = 0; i < means.numeric_array.length; i++) {
+        if (!quantile_digest_add(digest, numeric_array_get(&means, i), numeric_array_get(&weights, i))) {
+            free(digest->items);
+            builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+            return false;
+        }
+    }
+    if (min.type == VALUE_NUMBER && min.number < digest->min) digest->min = min.number;
+    if (max.type == VALUE_NUMBER && max.number > digest->max) digest->max = max.number;
+    return true;
+}
+
+static Value quantile_digest_to_sketch(QuantileDigest *digest) {
+    quantile_digest_compress(digest);
+    Value means = value_numeric_array_with_dtype(digest->count, NUMERIC_DTYPE_F64);
+    Value weights = value_numeric_array_with_dtype(digest->count, NUMERIC_DTYPE_F64);
+    for (int i = 0; i < digest->count; i++) {
+        numeric_array_push(&means, digest->items[i].mean);
+        numeric_array_push(&weights, digest->items[i].weight);
+    }
+
+    Value result = value_dict();
+    dict_set(&result, "kind", value_string(QUANTILE_SKETCH_KIND));
+    dict_set(&result, "compression", value_number(digest->compression));
+    dict_set(&result, "count", value_number(digest->total));
+    dict_set(&result, "件数", value_number(digest->total));
+    dict_set(&result, "min", digest->total > 0 ? value_number(digest->min) : value_null());
+    dict_set(&result, "最小", digest->total > 0 ? value_number(digest->min) : value_null());
+    dict_set(&result, "max", digest->total > 0 ? value_number(digest->max) : value_null());
+    dict_set(&result, "最大", digest->total > 0 ? value_number(digest->max) : value_null());
+    dict_set(&result, "means", means);
+    dict_set(&result, "weights", weights);
+    value_free(&means);
+    value_free(&weights);
+    return result;
+}
+
+static bool quantile_digest_add_values(QuantileDigest *digest, Value input, const char *name) {
+    if (input.type == VALUE_NUMBER) {
+        if (isnan(input.number)) {
+            builtin_runtime_error("%s は NaN を追加できません", name);
+            return false;
+        }
+        if (!quantile_digest_add(digest, input.number, 1.0)) {
+            builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+            return false;
+        }
+        return true;
+    }
+
+    int n = 0;
+    if (input.type == VALUE_NUMERIC_ARRAY) {
+        n = input.numeric_array.length;
+    } else if (input.type == VALUE_ARRAY) {
+        n = input.array.length;
+    } else {
+        builtin_runtime_error("%s に追加できるのは数値・数値ベクトル・数値配列です（実際: %s）",
+                              name, value_type_name(input.type));
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        double value;
+        if (input.type == VALUE_NUMERIC_ARRAY) {
+            value = numeric_array_get(&input, i);
+        } else if (input.array.elements[i].type == VALUE_NUMBER) {
+            value = input.array.elements[i].number;
+        } else {
+            builtin_runtime_error("%s の配列要素はすべて数値でなければなりません（%d番目: %s）",
+                                  name, i, value_type_name(input.array.elements[i].type));
+            return false;
+        }
+        if (isnan(value)) {
+            builtin_runtime_error("%s は NaN を追加できません（%d番目の要素）", name, i);
+            return false;
+        }
+        if (!quantile_digest_add(digest, value, 1.0)) {
+            builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+static Value builtin_quantile_sketch(int argc, Value *argv) {
+    double compression = QUANTILE_SKETCH_DEFAULT_COMPRESSION;
+    if (argc >= 1) {
+        if (argv[0].type != VALUE_NUMBER || isnan(argv[0].number) ||
+            argv[0].number < 10.0 || argv[0].number > 10000.0) {
+            builtin_runtime_error("quantile_sketch の圧縮度は 10 から 10000 の数値で指定してください");
+            return value_null();
+        }
+        compression = argv[0].number;
+    }
+    QuantileDigest digest;
+    if (!quantile_digest_init(&digest, compression)) {
+        builtin_runtime_error("quantile_sketch の作業メモリを確保できませんでした");
+        return value_null();
+    }
+    Value result = quantile_digest_to_sketch(&digest);
+    free(digest.items);
+    return result;
+}
+
+static Value builtin_quantile_sketch_add(int argc, Value *argv) {
+    (void)argc;
+    if (!is_quantile_sketch(argv[0])) {
+        builtin_runtime_error("quantile_sketch_add の第1引数は 分位点スケッチ() で作ったスケッチでなければなりません");
+        return value_null();
+    }
+    QuantileDigest digest;
+    if (!quantile_digest_from_sketch(argv[0], &digest, "quantile_sketch_add")) return value_null();
+    if (!quantile_digest_add_values(&digest, argv[1], "quantile_sketch_add")) {
+        free(digest.items);
+        return value_null();
+    }
+    Value result = quantile_digest_to_sketch(&digest);
+    free(digest.items);
+    return result;
+}
+
+static Value builtin_quantiles(int argc, Value *argv) {
+    bool approximate = false;
+    if (argc >= 3) {
+        if (argv[2].type != VALUE_STRING ||
+            (strcmp(argv[2].string.data, "exact") != 0 && strcmp(argv[2].string.data, "approx") != 0)) {
+            builtin_runtime_error("quantiles の mode は \"exact\" または \"approx\" で指定してください");
+            return value_null();
+        }
+        approximate = strcmp(argv[2].string.data, "approx") == 0;
+    }
+
+    double *points = NULL;
+    int count = 0;
+    if (!copy_quantile_points(argv[1], "quantiles", &points, &count)) return value_null();
+    double *results = malloc(sizeof(double) * (size_t)(count > 0 ? count : 1));
+    if (results == NULL) {
+        free(points);
+        builtin_runtime_error("quantiles の作業メモリを確保できませんでした");
+        return value_null();
+    }
+
+    bool ok = false;
+    if (is_quantile_sketch(argv[0]) || approximate) {
+        QuantileDigest digest;
+        if (is_quantile_sketch(argv[0])) {
+            ok = quantile_digest_from_sketch(argv[0], &digest, "quantiles");
+        } else {
+            ok = quantile_digest_init(&digest, QUANTILE_SKETCH_DEFAULT_COMPRESSION);
+            if (!ok) builtin_runtime_error("quantiles の作業メモリを確保できませんでした");
+            if (ok && !quantile_digest_add_values(&digest, argv[0], "quantiles")) {
+                free(digest.items);
+                ok = false;
+            }
+        }
+        if (ok) {
+            quantile_digest_compress(&digest);
+            if (digest.total <= 0.0) {
+                builtin_runtime_error("quantiles は空のスケッチを扱えません");
+                ok = false;
+            }
+            for (int i = 0; ok && i < count; i++) {
+                results[i] = quantile_digest_value(&digest, points[i]);
+            }
+            free(digest.items);
+        }
+    } else {
+        double *data = NULL;
+        int n = 0;
+        if (copy_numeric_values(argv[0], "quantiles", &data, &n)) {
+            ok = reject_nan_values(data, n, "quantiles") &&
+                 exact_quantiles(data, n, points, count, results, "quantiles");
+            free(data);
+        }
+    }
+
+    Value result = value_null();
+    if (ok) {
+        result = value_numeric_array_with_dtype(count, NUMERIC_DTYPE_F64);
+        for (int i = 0; i < count; i++) numeric_array_push(&result, results[i]);
+    }
+    free(points);
+    free(results);
+    return result;
+}
+
 static Value builtin_normalize(int argc, Value *argv) {
     (void)argc;
     double *data = NULL;
@@ -5813,25 +7876,15 @@ static Value builtin_histogram(int argc, Value *argv) {
     return result;
 }
 
+// シャッフルしない分割は元バッファを共有する view で返す
 static Value split_numeric_array(Value input, int start, int length) {
-    if (length <= 0) return value_numeric_array();
-    Value result = value_numeric_array_with_dtype(length, input.numeric_array.dtype);
-    for (int i = 0; i < length; i++) {
-        numeric_array_push(&result, numeric_array_get(&input, start + i));
-    }
-    return result;
+    if (length <= 0) return value_numeric_array_with_dtype(0, input.numeric_array.dtype);
+    return numeric_array_view(&input, start, length, 1);
 }
 
 static Value split_matrix_rows(Value input, int start, int rows) {
-    if (rows <= 0) return value_matrix(0, input.matrix.cols);
-    int cols = input.matrix.cols;
-    Value result = value_matrix_with_dtype(rows, cols, input.matrix.dtype);
-    for (int r = 0; r < rows; r++) {
-        for (int c = 0; c < cols; c++) {
-            matrix_set(&result, r, c, matrix_get(&input, start + r, c));
-        }
-    }
-    return result;
+    if (rows <= 0) return value_matrix_with_dtype(0, input.matrix.cols, input.matrix.dtype);
+    return matrix_rows_view(&input, start, rows);
 }
 
 static unsigned int split_next_random(unsigned int *state) {
@@ -5952,6 +8005,44 @@ static Value builtin_train_test_split(int argc, Value *argv) {
     return result;
 }
 
+static Value builtin_sliding_window(int argc, Value *argv) {
+    if (argv[0].type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("sliding_window の第1引数は数値ベクトルでなければなりません（実際: %s）",
+                              value_type_name(argv[0].type));
+        return value_null();
+    }
+    if (argv[1].type != VALUE_NUMBER || !argv[1].is_integer || argv[1].number <= 0) {
+        builtin_runtime_error("sliding_window の窓幅は正の整数でなければなりません");
+        return value_null();
+    }
+    int step = 1;
+    if (argc >= 3) {
+        if (argv[2].type != VALUE_NUMBER || !argv[2].is_integer || argv[2].number <= 0) {
+            builtin_runtime_error("sliding_window のステップは正の整数でなければなりません");
+            return value_null();
+        }
+        step = (int)argv[2].number;
+    }
+
+    int length = argv[0].numeric_array.length;
+    int size = argv[1].number > length ? length + 1 : (int)argv[1].number;
+    int count = size <= length ? (length - size) / step + 1 : 0;
+
+    // 各窓は元バッファを共有する view なので、長い系列でも窓ごとのコピーは発生しない
+    Value result = value_array_with_capacity(count);
+    for (int i = 0; i < count; i++) {
+        Value window = numeric_array_view(&argv[0], i * step, size, 1);
+        array_push(&result, window);
+        value_free(&window);
+    }
+    return result;
+}
+
+static Value builtin_shares_memory(int argc, Value *argv) {
+    (void)argc;
+    return value_bool(numeric_shares_memory(&argv[0], &argv[1]));
+}
+
 static Value builtin_is_nan(int argc, Value *argv) {
     (void)argc;
     return value_bool(argv[0].type == VALUE_NUMBER && isnan(argv[0].number));
@@ -6175,81 +8266,353 @@ static double vector_op_sub(double a, double b) { return a - b; }
 static double vector_op_mul(double a, double b) { return a * b; }
 static double vector_op_div(double a, double b) { return b == 0.0 ? NAN : a / b; }
 
-static Value vector_binary(const char *name, Value left, Value right, VectorBinaryOp op) {
+// 結果は常に f64。f64 以外の入力は一括変換してから f64 のネイティブカーネルで計算する
+static Value vector_binary(const char *name, Value left, Value right, NumericBinaryOp op) {
     if (left.type != VALUE_NUMERIC_ARRAY) {
         builtin_runtime_error("%s の第1引数は数値ベクトルでなければなりません（実際: %s）",
                               name, value_type_name(left.type));
         return value_null();
     }
+    if (right.type != VALUE_NUMBER && right.type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("%s の第2引数は数値または数値ベクトルでなければなりません（実際: %s）",
+                              name, value_type_name(right.type));
+        return value_null();
+    }
 
     int n = left.numeric_array.length;
-    Value result = value_numeric_array_with_capacity(n);
-
-    if (right.type == VALUE_NUMBER) {
-        for (int i = 0; i < n; i++) {
-            double value = op(numeric_array_get(&left, i), right.number);
-            if (isnan(value)) {
-                value_free(&result);
-                builtin_runtime_error("%s の計算結果が不正です（%d番目の要素）。0除算や定義域外の値を確認してください",
-                                      name, i);
-                return value_null();
-            }
-            numeric_array_push(&result, value);
-        }
-        return result;
+    if (right.type == VALUE_NUMERIC_ARRAY && n != right.numeric_array.length) {
+        builtin_runtime_error("%s の左右のベクトル長が一致しません（左: %d, 右: %d）",
+                              name, n, right.numeric_array.length);
+        return value_null();
     }
 
-    if (right.type == VALUE_NUMERIC_ARRAY) {
-        if (n != right.numeric_array.length) {
-            value_free(&result);
-            builtin_runtime_error("%s の左右のベクトル長が一致しません（左: %d, 右: %d）",
-                                  name, n, right.numeric_array.length);
-            return value_null();
-        }
-        for (int i = 0; i < n; i++) {
-            double value = op(numeric_array_get(&left, i), numeric_array_get(&right, i));
-            if (isnan(value)) {
-                value_free(&result);
-                builtin_runtime_error("%s の計算結果が不正です（%d番目の要素）。0除算や定義域外の値を確認してください",
-                                      name, i);
-                return value_null();
-            }
-            numeric_array_push(&result, value);
-        }
-        return result;
+    Value left_temp = value_null();
+    Value right_temp = value_null();
+    if (left.numeric_array.dtype != NUMERIC_DTYPE_F64) {
+        left_temp = numeric_array_astype(&left, NUMERIC_DTYPE_F64);
+        left = left_temp;
     }
-
-    value_free(&result);
-    builtin_runtime_error("%s の第2引数は数値または数値ベクトルでなければなりません（実際: %s）",
-                          name, value_type_name(right.type));
-    return value_null();
+    if (right.type == VALUE_NUMERIC_ARRAY && right.numeric_array.dtype != NUMERIC_DTYPE_F64) {
+        right_temp = numeric_array_astype(&right, NUMERIC_DTYPE_F64);
+        right = right_temp;
+    }
+    Value result = value_numeric_array_with_dtype(n, NUMERIC_DTYPE_F64);
+    if (left.type != VALUE_NUMERIC_ARRAY || right.type == VALUE_NULL || result.type != VALUE_NUMERIC_ARRAY) {
+        value_free(&left_temp);
+        value_free(&right_temp);
+        value_free(&result);
+        builtin_runtime_error("%s の計算用バッファを確保できませんでした", name);
+        return value_null();
+    }
+    result.numeric_array.length = n;
+
+    double *out = (double *)result.numeric_array.data;
+    bool right_scalar = right.type == VALUE_NUMBER;
+    int failed_at = numeric_binary_kernel(
+        op, NUMERIC_DTYPE_F64, out,
+        numeric_flat_base(&left), left.numeric_array.stride, 0.0,
+        right_scalar ? NULL : numeric_flat_base(&right),
+        right_scalar ? 0 : right.numeric_array.stride,
+        right_scalar ? right.number : 0.0, n);
+    for (int i = 0; failed_at < 0 && i < n; i++) {
+        if (isnan(out[i])) failed_at = i;
+    }
+    value_free(&left_temp);
+    value_free(&right_temp);
+    if (failed_at >= 0) {
+        value_free(&result);
+        builtin_runtime_error("%s の計算結果が不正です（%d番目の要素）。0除算や定義域外の値を確認してください",
+                              name, failed_at);
+        return value_null();
+    }
+    return result;
 }
 
 static Value builtin_vector_add(int argc, Value *argv) {
     (void)argc;
-    return vector_binary("vector_add", argv[0], argv[1], vector_op_add);
+    return vector_binary("vector_add", argv[0], argv[1], NUMERIC_OP_ADD);
 }
 
 static Value builtin_vector_sub(int argc, Value *argv) {
     (void)argc;
-    return vector_binary("vector_sub", argv[0], argv[1], vector_op_sub);
+    return vector_binary("vector_sub", argv[0], argv[1], NUMERIC_OP_SUB);
 }
 
 static Value builtin_vector_mul(int argc, Value *argv) {
     (void)argc;
-    return vector_binary("vector_mul", argv[0], argv[1], vector_op_mul);
+    return vector_binary("vector_mul", argv[0], argv[1], NUMERIC_OP_MUL);
 }
 
 static Value builtin_vector_div(int argc, Value *argv) {
     (void)argc;
-    return vector_binary("vector_div", argv[0], argv[1], vector_op_div);
+    return vector_binary("vector_div", argv[0], argv[1], NUMERIC_OP_DIV);
 }
 
-typedef double (*VectorUnaryOp)(double x);
-
-static Value vector_unary(const char *name, Value input, VectorUnaryOp op) {
-    if (input.type != VALUE_NUMERIC_ARRAY) {
-        builtin_runtime_error("%s の引数は数値ベクトルでなければなりません（実際: %s）",
+// 出力先 dst の既存バッファへ left (op) right を書き込む。
+// dst が他の値とバッファを共有している場合は書き込む前に複製されるため、
+// 入力と出力先が同じ変数でも結果は新しい配列を作る場合と変わらない。
+static bool vector_binary_into(const char *name, Value *dst, Value left, Value right, VectorBinaryOp op) {
+    if (dst->type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("%s の出力先は数値ベクトルでなければなりません（実際: %s）",
+                              name, value_type_name(dst->type));
+        return false;
+    }
+    if (left.type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("%s の入力は数値ベクトルでなければなりません（実際: %s）",
+                              name, value_type_name(left.type));
+        return false;
+    }
+    if (right.type != VALUE_NUMBER && right.type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("%s の第2入力は数値または数値ベクトルでなければなりません（実際: %s）",
+                              name, value_type_name(right.type));
+        return false;
+    }
+
+    int n = dst->numeric_array.length;
+    int right_length = right.type == VALUE_NUMERIC_ARRAY ? right.numeric_array.length : n;
+    if (left.numeric_array.length != n || right_length != n) {
+        builtin_runtime_error("%s の出力先と入力のベクトル長が一致しません（出力先: %d, 入力: %d, %d）",
+                              name, n, left.numeric_array.length, right_length);
+        return false;
+    }
+
+    // 入力が出力先そのもの（v += 1 の左辺など）を参照なしで借用していると、書き込み時の複製で
+    // 元のバッファ（NPY読込 の mmap など）が解放されて入力が宙に浮く。
+    // 先に出力先を単独所有にし、そうした入力は複製後のバッファへ付け替える
+    bool left_is_dst = same_numeric_value(left, *dst);
+    bool right_is_dst = right.type == VALUE_NUMERIC_ARRAY && same_numeric_value(right, *dst);
+    if (!numeric_array_make_unique(dst)) {
+        builtin_runtime_error("%s の出力先を複製できませんでした", name);
+        return false;
+    }
+    if (left_is_dst) left = *dst;
+    if (right_is_dst) right = *dst;
+
+    bool all_f64 = dst->numeric_array.dtype == NUMERIC_DTYPE_F64 &&
+                   left.numeric_array.dtype == NUMERIC_DTYPE_F64 &&
+                   (right.type == VALUE_NUMBER || right.numeric_array.dtype == NUMERIC_DTYPE_F64);
+    for (int i = 0; i < n; i++) {
+        double rhs = right.type == VALUE_NUMBER ? right.number : numeric_array_get(&right, i);
+        double value = op(numeric_array_get(&left, i), rhs);
+        if (isnan(value)) {
+            builtin_runtime_error("%s の計算結果が不正です（%d番目の要素）。0除算や定義域外の値を確認してください",
+                                  name, i);
+            return false;
+        }
+        if (!numeric_array_set(dst, i, value)) {
+            builtin_runtime_error("%s の出力先へ書き込めませんでした（%d番目の要素）", name, i);
+            return false;
+        }
+        if (all_f64) {
+            // dst は単独所有になっているので、残りは stride 付きで直接書き込む
+            double *out = (double *)dst->numeric_array.data + dst->numeric_array.offset;
+            const double *a = (const double *)left.numeric_array.data + left.numeric_array.offset;
+            const double *b = right.type == VALUE_NUMERIC_ARRAY
+                ? (const double *)right.numeric_array.data + right.numeric_array.offset : NULL;
+            int out_stride = dst->numeric_array.stride;
+            int a_stride = left.numeric_array.stride;
+            int b_stride = b != NULL ? right.numeric_array.stride : 0;
+            for (int j = i + 1; j < n; j++) {
+                double r = b != NULL ? b[(ptrdiff_t)j * b_stride] : right.number;
+                double v = op(a[(ptrdiff_t)j * a_stride], r);
+                if (isnan(v)) {
+                    builtin_runtime_error("%s の計算結果が不正です（%d番目の要素）。0除算や定義域外の値を確認してください",
+                                          name, j);
+                    return false;
+                }
+                out[(ptrdiff_t)j * out_stride] = v;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+// *_into は出力先のバッファを書き換え、出力先によらず常に null を返す
+static Value builtin_vector_add_into(int argc, Value *argv) {
+    (void)argc;
+    vector_binary_into("vector_add_into", &argv[0], argv[1], argv[2], vector_op_add);
+    return value_null();
+}
+
+static Value builtin_vector_sub_into(int argc, Value *argv) {
+    (void)argc;
+    vector_binary_into("vector_sub_into", &argv[0], argv[1], argv[2], vector_op_sub);
+    return value_null();
+}
+
+static Value builtin_vector_mul_into(int argc, Value *argv) {
+    (void)argc;
+    vector_binary_into("vector_mul_into", &argv[0], argv[1], argv[2], vector_op_mul);
+    return value_null();
+}
+
+static Value builtin_vector_div_into(int argc, Value *argv) {
+    (void)argc;
+    vector_binary_into("vector_div_into", &argv[0], argv[1], argv[2], vector_op_div);
+    return value_null();
+}
+
+static Value builtin_vector_scale_inplace(int argc, Value *argv) {
+    (void)argc;
+    if (argv[1].type != VALUE_NUMBER) {
+        builtin_runtime_error("vector_scale_inplace は (数値ベクトル, 数値) の形で呼び出してください（第2引数: %s）",
+                              value_type_name(argv[1].type));
+        return value_null();
+    }
+    vector_binary_into("vector_scale_inplace", &argv[0], argv[0], argv[1], vector_op_mul);
+    return value_null();
+}
+
+static bool is_bool_mask(Value mask) {
+    return (mask.type == VALUE_NUMERIC_ARRAY && mask.numeric_array.dtype == NUMERIC_DTYPE_BOOL) ||
+           (mask.type == VALUE_MATRIX && mask.matrix.dtype == NUMERIC_DTYPE_BOOL);
+}
+
+// 比較演算子で作った bool マスクが真の要素だけを取り出す。
+// ベクトル + 同じ長さのマスク → ベクトル、行列 + 行数と同じ長さのマスク → 行を選んだ行列、
+// 行列 + 同じ形のマスク行列 → 選ばれた要素を row-major に並べたベクトル。
+static Value builtin_masked_select(int argc, Value *argv) {
+    (void)argc;
+    Value values = argv[0];
+    Value mask = argv[1];
+    if (!is_bool_mask(mask)) {
+        builtin_runtime_error("masked_select のマスクは比較演算子で作った bool の数値ベクトルまたは行列でなければなりません（実際: %s）",
+                              mask.type == VALUE_NUMERIC_ARRAY || mask.type == VALUE_MATRIX
+                                  ? "bool 以外の dtype" : value_type_name(mask.type));
+        return value_null();
+    }
+
+    if (values.type == VALUE_NUMERIC_ARRAY && mask.type == VALUE_NUMERIC_ARRAY) {
+        int n = values.numeric_array.length;
+        if (mask.numeric_array.length != n) {
+            builtin_runtime_error("masked_select のベクトル長とマスク長が一致しません（値: %d, マスク: %d）",
+                                  n, mask.numeric_array.length);
+            return value_null();
+        }
+        Value result = value_numeric_array_with_dtype(n, values.numeric_array.dtype);
+        for (int i = 0; i < n; i++) {
+            if (numeric_array_get(&mask, i) != 0.0) {
+                numeric_array_push(&result, numeric_array_get(&values, i));
+            }
+        }
+        return result;
+    }
+
+    if (values.type == VALUE_MATRIX && mask.type == VALUE_NUMERIC_ARRAY) {
+        int rows = values.matrix.rows;
+        int cols = values.matrix.cols;
+        if (mask.numeric_array.length != rows) {
+            builtin_runtime_error("masked_select の行数とマスク長が一致しません（行数: %d, マスク: %d）",
+                                  rows, mask.numeric_array.length);
+            return value_null();
+        }
+        int selected = 0;
+        for (int r = 0; r < rows; r++) {
+            if (numeric_array_get(&mask, r) != 0.0) selected++;
+        }
+        Value result = value_matrix_with_dtype(selected, cols, values.matrix.dtype);
+        if (result.type != VALUE_MATRIX) return value_null();
+        int out_row = 0;
+        for (int r = 0; r < rows; r++) {
+            if (numeric_array_get(&mask, r) == 0.0) continue;
+            for (int c = 0; c < cols; c++) {
+                matrix_set(&result, out_row, c, matrix_get(&values, r, c));
+            }
+            out_row++;
+        }
+        return result;
+    }
+
+    if (values.type == VALUE_MATRIX && mask.type == VALUE_MATRIX) {
+        if (mask.matrix.rows != values.matrix.rows || mask.matrix.cols != values.matrix.cols) {
+            builtin_runtime_error("masked_select の行列とマスクの形が一致しません（値: %d x %d, マスク: %d x %d）",
+                                  values.matrix.rows, values.matrix.cols, mask.matrix.rows, mask.matrix.cols);
+            return value_null();
+        }
+        Value result = value_numeric_array_with_dtype(values.matrix.rows * values.matrix.cols,
+                                                      values.matrix.dtype);
+        for (int r = 0; r < values.matrix.rows; r++) {
+            for (int c = 0; c < values.matrix.cols; c++) {
+                if (matrix_get(&mask, r, c) != 0.0) {
+                    numeric_array_push(&result, matrix_get(&values, r, c));
+                }
+            }
+        }
+        return result;
+    }
+
+    builtin_runtime_error("masked_select は (数値ベクトル, マスク) または (行列, マスク) の形で呼び出してください（第1引数: %s）",
+                          value_type_name(values.type));
+    return value_null();
+}
+
+// 要素ごとの等価比較で bool マスクを作る（== / != は値全体の比較で真偽値を返すため）。
+// 数値はどちらの辺でも全要素へ broadcast する。
+static Value numeric_equality_mask(const char *name, Value left, Value right, NumericCompareFn compare) {
+    if (!is_numeric_operand(left) || !is_numeric_operand(right) ||
+        (left.type == VALUE_NUMBER && right.type == VALUE_NUMBER) ||
+        (left.type == VALUE_NUMERIC_ARRAY && right.type == VALUE_MATRIX) ||
+        (left.type == VALUE_MATRIX && right.type == VALUE_NUMERIC_ARRAY)) {
+        builtin_runtime_error("%s は (数値ベクトル, 数値ベクトルまたは数値) か (行列, 行列または数値) の形で呼び出してください（実際: %s, %s）",
+                              name, value_type_name(left.type), value_type_name(right.type));
+        return value_null();
+    }
+
+    if (left.type == VALUE_MATRIX || right.type == VALUE_MATRIX) {
+        Value *shape = left.type == VALUE_MATRIX ? &left : &right;
+        int rows = shape->matrix.rows;
+        int cols = shape->matrix.cols;
+        if (left.type == VALUE_MATRIX && right.type == VALUE_MATRIX &&
+            (right.matrix.rows != rows || right.matrix.cols != cols)) {
+            builtin_runtime_error("%s の行列サイズが一致しません（左: %d x %d, 右: %d x %d）",
+                                  name, rows, cols, right.matrix.rows, right.matrix.cols);
+            return value_null();
+        }
+        Value result = value_matrix_with_dtype(rows, cols, NUMERIC_DTYPE_BOOL);
+        if (result.type != VALUE_MATRIX) return result;
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < cols; c++) {
+                double x = left.type == VALUE_NUMBER ? left.number : matrix_get(&left, r, c);
+                double y = right.type == VALUE_NUMBER ? right.number : matrix_get(&right, r, c);
+                matrix_set(&result, r, c, compare(x, y));
+            }
+        }
+        return result;
+    }
+
+    int n = left.type == VALUE_NUMERIC_ARRAY ? left.numeric_array.length : right.numeric_array.length;
+    if (left.type == VALUE_NUMERIC_ARRAY && right.type == VALUE_NUMERIC_ARRAY &&
+        right.numeric_array.length != n) {
+        builtin_runtime_error("%s の左右のベクトル長が一致しません（左: %d, 右: %d）",
+                              name, n, right.numeric_array.length);
+        return value_null();
+    }
+    Value result = value_numeric_array_with_dtype(n, NUMERIC_DTYPE_BOOL);
+    if (result.type != VALUE_NUMERIC_ARRAY) return result;
+    for (int i = 0; i < n; i++) {
+        double x = left.type == VALUE_NUMBER ? left.number : numeric_array_get(&left, i);
+        double y = right.type == VALUE_NUMBER ? right.number : numeric_array_get(&right, i);
+        numeric_array_push(&result, compare(x, y));
+    }
+    return result;
+}
+
+static Value builtin_equal_mask(int argc, Value *argv) {
+    (void)argc;
+    return numeric_equality_mask("equal_mask", argv[0], argv[1], numeric_compare_eq);
+}
+
+static Value builtin_not_equal_mask(int argc, Value *argv) {
+    (void)argc;
+    return numeric_equality_mask("not_equal_mask", argv[0], argv[1], numeric_compare_ne);
+}
+
+typedef double (*VectorUnaryOp)(double x);
+
+static Value vector_unary(const char *name, Value input, VectorUnaryOp op) {
+    if (input.type != VALUE_NUMERIC_ARRAY) {
+        builtin_runtime_error("%s の引数は数値ベクトルでなければなりません（実際: %s）",
                               name, value_type_name(input.type));
         return value_null();
     }
@@ -6309,11 +8672,7 @@ static Value builtin_dot(int argc, Value *argv) {
         return value_null();
     }
 
-    double total = 0.0;
-    for (int i = 0; i < n; i++) {
-        total += numeric_array_get(&argv[0], i) * numeric_array_get(&argv[1], i);
-    }
-    return value_number(total);
+    return value_number(numeric_array_dot(&argv[0], &argv[1]));
 }
 
 static Value builtin_matrix(int argc, Value *argv) {
@@ -6477,11 +8836,7 @@ static Value builtin_matrix_row(int argc, Value *argv) {
         return value_null();
     }
 
-    Value result = value_numeric_array_with_dtype(argv[0].matrix.cols, argv[0].matrix.dtype);
-    for (int c = 0; c < argv[0].matrix.cols; c++) {
-        numeric_array_push(&result, matrix_get(&argv[0], row, c));
-    }
-    return result;
+    return matrix_row_view(&argv[0], row);
 }
 
 static Value builtin_matrix_column(int argc, Value *argv) {
@@ -6498,43 +8853,13 @@ static Value builtin_matrix_column(int argc, Value *argv) {
         return value_null();
     }
 
-    Value result = value_numeric_array_with_dtype(argv[0].matrix.rows, argv[0].matrix.dtype);
-    for (int r = 0; r < argv[0].matrix.rows; r++) {
-        numeric_array_push(&result, matrix_get(&argv[0], r, col));
-    }
-    return result;
+    return matrix_column_view(&argv[0], col);
 }
 
 static Value builtin_transpose(int argc, Value *argv) {
     (void)argc;
     if (argv[0].type != VALUE_MATRIX) return value_null();
-
-    if (argv[0].matrix.ref_count != NULL) {
-        Value result;
-        result.type = VALUE_MATRIX;
-        result.is_const = false;
-        result.is_integer = false;
-        result.ref_count = 1;
-        result.matrix.dtype = argv[0].matrix.dtype;
-        result.matrix.data = argv[0].matrix.data;
-        result.matrix.rows = argv[0].matrix.cols;
-        result.matrix.cols = argv[0].matrix.rows;
-        result.matrix.row_stride = argv[0].matrix.col_stride;
-        result.matrix.col_stride = argv[0].matrix.row_stride;
-        result.matrix.offset = argv[0].matrix.offset;
-        result.matrix.ref_count = argv[0].matrix.ref_count;
-        (*result.matrix.ref_count)++;
-        return result;
-    }
-
-    Value result = value_matrix_with_dtype(argv[0].matrix.cols, argv[0].matrix.rows, argv[0].matrix.dtype);
-    if (result.type != VALUE_MATRIX) return value_null();
-    for (int r = 0; r < argv[0].matrix.rows; r++) {
-        for (int c = 0; c < argv[0].matrix.cols; c++) {
-            matrix_set(&result, c, r, matrix_get(&argv[0], r, c));
-        }
-    }
-    return result;
+    return matrix_transpose_view(&argv[0]);
 }
 
 static Value builtin_matmul(int argc, Value *argv) {
@@ -6578,6 +8903,8 @@ static Value builtin_matmul(int argc, Value *argv) {
     }
 #endif
 
+    if (matrix_matmul_f64(&argv[0], &argv[1], &result)) return result;
+
     for (int r = 0; r < rows; r++) {
         for (int c = 0; c < cols; c++) {
             double total = 0.0;
@@ -6651,6 +8978,94 @@ static Value builtin_matrix_scale(int argc, Value *argv) {
     return result;
 }
 
+static double matrix_op_div(double a, double b) { return b == 0.0 ? NAN : a / b; }
+
+// 出力先行列 dst の既存バッファへ left (op) right を書き込む（right は行列または数値）。
+// 共有中のバッファは書き込む前に複製されるので、他の値には影響しない。
+static bool matrix_binary_into(const char *name, Value *dst, Value left, Value right, MatrixBinaryOp op) {
+    if (dst->type != VALUE_MATRIX || left.type != VALUE_MATRIX) {
+        builtin_runtime_error("%s の出力先と入力は行列でなければなりません（出力先: %s, 入力: %s）",
+                              name, value_type_name(dst->type), value_type_name(left.type));
+        return false;
+    }
+    if (right.type != VALUE_MATRIX && right.type != VALUE_NUMBER) {
+        builtin_runtime_error("%s の第2入力は行列または数値でなければなりません（実際: %s）",
+                              name, value_type_name(right.type));
+        return false;
+    }
+
+    int rows = dst->matrix.rows;
+    int cols = dst->matrix.cols;
+    if (left.matrix.rows != rows || left.matrix.cols != cols ||
+        (right.type == VALUE_MATRIX && (right.matrix.rows != rows || right.matrix.cols != cols))) {
+        builtin_runtime_error("%s の出力先と入力の行列サイズが一致しません（出力先: %d x %d, 入力: %d x %d）",
+                              name, rows, cols, left.matrix.rows, left.matrix.cols);
+        return false;
+    }
+
+    // 出力先を借用した入力は vector_binary_into と同じく複製後のバッファへ付け替える
+    bool left_is_dst = same_numeric_value(left, *dst);
+    bool right_is_dst = right.type == VALUE_MATRIX && same_numeric_value(right, *dst);
+    if (!matrix_make_unique(dst)) {
+        builtin_runtime_error("%s の出力先を複製できませんでした", name);
+        return false;
+    }
+    if (left_is_dst) left = *dst;
+    if (right_is_dst) right = *dst;
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            double rhs = right.type == VALUE_NUMBER ? right.number : matrix_get(&right, r, c);
+            double value = op(matrix_get(&left, r, c), rhs);
+            if (isnan(value)) {
+                builtin_runtime_error("%s の計算結果が不正です（(%d, %d) 要素）。0除算を確認してください",
+                                      name, r, c);
+                return false;
+            }
+            if (!matrix_set(dst, r, c, value)) {
+                builtin_runtime_error("%s の出力先へ書き込めませんでした（(%d, %d) 要素）", name, r, c);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static Value builtin_matrix_add_into(int argc, Value *argv) {
+    (void)argc;
+    matrix_binary_into("matrix_add_into", &argv[0], argv[1], argv[2], matrix_op_add);
+    return value_null();
+}
+
+static Value builtin_matrix_sub_into(int argc, Value *argv) {
+    (void)argc;
+    matrix_binary_into("matrix_sub_into", &argv[0], argv[1], argv[2], matrix_op_sub);
+    return value_null();
+}
+
+static Value builtin_matrix_hadamard_into(int argc, Value *argv) {
+    (void)argc;
+    matrix_binary_into("matrix_hadamard_into", &argv[0], argv[1], argv[2], matrix_op_mul);
+    return value_null();
+}
+
+static Value builtin_matrix_div_into(int argc, Value *argv) {
+    (void)argc;
+    matrix_binary_into("matrix_div_into", &argv[0], argv[1], argv[2], matrix_op_div);
+    return value_null();
+}
+
+static Value builtin_matrix_scale_inplace(int argc, Value *argv) {
+    (void)argc;
+    if (argv[1].type != VALUE_NUMBER) {
+        builtin_runtime_error("matrix_scale_inplace は (行列, 数値) の形で呼び出してください（第2引数: %s）",
+                              value_type_name(argv[1].type));
+        return value_null();
+    }
+    matrix_binary_into("matrix_scale_inplace", &argv[0], argv[0], argv[1], matrix_op_mul);
+    return value_null();
+}
+
 static bool require_square_matrix(Value matrix, const char *name) {
     if (matrix.type != VALUE_MATRIX) {
         builtin_runtime_error("%s の引数は行列でなければなりません（実際: %s）",
@@ -7444,176 +9859,628 @@ static Value builtin_predict_logistic_class(int argc, Value *argv) {
 static bool parse_text_delimited_fields(const char *line, char delimiter, Value *out_fields,
                                         const char *name, int line_no);
 
-static Value read_delimited_numeric(int argc, Value *argv, char delimiter, const char *name, const char *label) {
-    if (argv[0].type != VALUE_STRING) {
-        builtin_runtime_error("%s の第1引数はファイルパス文字列でなければなりません（実際: %s）",
-                              name, value_type_name(argv[0].type));
-        return value_null();
-    }
+// ---- 数値 CSV / TSV の並列ローダー ----
+// ファイルを mmap し、改行位置で区切ったチャンクを 2 段階で並列処理する。
+// 1 段目で各チャンクの行数を数えて書き込み位置を決め、2 段目で各行を
+// 確保済みの行列バッファへ直接書き込む。行の長さや列数に上限はない。
 
-    bool has_header = false;
-    if (argc >= 2) {
-        if (argv[1].type != VALUE_BOOL) {
-            builtin_runtime_error("%s の第2引数はヘッダー有無を表す真偽値でなければなりません（実際: %s）",
-                                  name, value_type_name(argv[1].type));
-            return value_null();
-        }
-        has_header = argv[1].boolean;
-    }
+#define NUMERIC_TEXT_MIN_CHUNK_BYTES (1024 * 1024)
+#define NUMERIC_TEXT_MAX_CHUNKS 4096
+#define NUMERIC_TEXT_TOKEN_PREVIEW 64
 
-    const char *missing_mode = "error";
-    if (argc >= 3) {
-        if (argv[2].type != VALUE_STRING) {
-            builtin_runtime_error("%s の第3引数は missing mode 文字列でなければなりません（実際: %s）",
-                                  name, value_type_name(argv[2].type));
-            return value_null();
-        }
-        missing_mode = argv[2].string.data;
-        if (strcmp(missing_mode, "error") != 0 &&
-            strcmp(missing_mode, "nan") != 0 &&
-            strcmp(missing_mode, "zero") != 0) {
-            builtin_runtime_error("%s の missing mode は \"error\" / \"nan\" / \"zero\" のいずれかです（実際: %s）",
-                                  name, missing_mode);
-            return value_null();
-        }
+typedef struct {
+    const char *data;
+    size_t size;
+    void *mapping;     // munmap / free する領域
+    size_t mapping_size;
+} MappedTextFile;
+
+static bool mapped_text_open(const char *path, MappedTextFile *file) {
+    memset(file, 0, sizeof(*file));
+#ifdef _WIN32
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return false;
     }
-
-    FILE *f = fopen(argv[0].string.data, "r");
-    if (f == NULL) {
-        builtin_runtime_error("%sファイルを読み込めません: %s", label, argv[0].string.data);
-        return value_null();
+    char *buffer = malloc((size_t)size + 1);
+    if (buffer == NULL || fread(buffer, 1, (size_t)size, f) != (size_t)size) {
+        free(buffer);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    file->data = buffer;
+    file->size = (size_t)size;
+    file->mapping = buffer;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    file->size = (size_t)st.st_size;
+    if (file->size == 0) {
+        close(fd);
+        file->data = "";
+        return true;
     }
+    void *mapping = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+    madvise(mapping, file->size, MADV_SEQUENTIAL);
+#endif
+    file->data = mapping;
+    file->mapping = mapping;
+    file->mapping_size = file->size;
+    return true;
+#endif
+}
 
-    double *data = NULL;
-    int data_count = 0;
-    int data_capacity = 0;
-    int rows = 0;
-    int cols = -1;
-    char line[8192];
-    int line_no = 0;
-    bool skipped_header = false;
+static void mapped_text_close(MappedTextFile *file) {
+    if (file->mapping == NULL) return;
+#ifdef _WIN32
+    free(file->mapping);
+#else
+    munmap(file->mapping, file->mapping_size);
+#endif
+    file->mapping = NULL;
+}
 
-    while (fgets(line, sizeof(line), f) != NULL) {
-        line_no++;
-        if (has_header && !skipped_header) {
-            skipped_header = true;
-            continue;
-        }
+typedef enum {
+    NUMERIC_TEXT_OK,
+    NUMERIC_TEXT_UNCLOSED_QUOTE,
+    NUMERIC_TEXT_MISSING,
+    NUMERIC_TEXT_NOT_NUMBER,
+    NUMERIC_TEXT_COLUMN_COUNT,
+    NUMERIC_TEXT_NO_MEMORY
+} NumericTextStatus;
 
-        size_t line_len = strlen(line);
-        if (line_len == sizeof(line) - 1 && line[line_len - 1] != '\n') {
-            free(data);
-            fclose(f);
-            builtin_runtime_error("%sの%d行目が長すぎます。1行は8191バイト以内にしてください", label, line_no);
-            return value_null();
-        }
+typedef enum {
+    NUMERIC_MISSING_ERROR,
+    NUMERIC_MISSING_NAN,
+    NUMERIC_MISSING_ZERO
+} NumericMissingMode;
 
-        char *p = line;
-        while (*p == ' ' || *p == '\t') p++;
-        if (*p == '\0' || *p == '\n' || *p == '\r') continue;
+typedef struct {
+    const char *begin;
+    const char *end;
+    int lines;
+    int rows;
+    int first_line;     // チャンク先頭の行番号（1 始まり）
+    int first_row;      // 行列内の書き込み開始行
+    NumericTextStatus status;
+    int error_line;
+    int error_col;
+    char error_token[NUMERIC_TEXT_TOKEN_PREVIEW];
+} NumericTextChunk;
 
-        Value fields = value_null();
-        if (!parse_text_delimited_fields(line, delimiter, &fields, label, line_no)) {
-            free(data);
-            fclose(f);
-            return value_null();
-        }
+typedef struct {
+    char delimiter;
+    NumericMissingMode missing;
+    int cols;               // ファイル上の列数
+    const int *column_map;  // ファイル列 → 出力列（-1 は読み飛ばし）。NULL なら全列
+    int out_cols;
+    double *out;
+    NumericTextChunk *chunks;
+} NumericTextLoad;
+
+static const double numeric_text_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-        double row_values[1024];
-        int row_cols = fields.array.length;
-        if (row_cols > (int)(sizeof(row_values) / sizeof(row_values[0]))) {
-            value_free(&fields);
-            free(data);
-            fclose(f);
-            builtin_runtime_error("%sの%d行目の列数が多すぎます。現在は1行1024列まで対応しています", label, line_no);
-            return value_null();
+// 10 進表記の高速パス。仮数が 2^53 以下で指数が ±22 以内なら 1 回の乗除算で
+// 正しく丸められる（Clinger の高速パス）。それ以外は false を返し strtod に任せる。
+static bool parse_decimal_fast(const char *p, const char *end, double *out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (mantissa != 0 || *p != '0') significant++;
+        mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        any_digit = true;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (mantissa != 0 || *p != '0') significant++;
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            exponent--;
+            any_digit = true;
+            p++;
         }
+    }
+    if (!any_digit || significant > 19) return false;
 
-        for (int i = 0; i < row_cols; i++) {
-            Value *field = &fields.array.elements[i];
-            if (field->type != VALUE_STRING) {
-                value_free(&fields);
-                free(data);
-                fclose(f);
-                builtin_runtime_error("%sの%d行%d列目を文字列セルとして扱えません", label, line_no, i + 1);
-                return value_null();
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exp_negative = *p == '-';
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') return false;
+        int exp_value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (exp_value < 10000) exp_value = exp_value * 10 + (*p - '0');
+            p++;
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+    if (p != end) return false;
+
+    double value;
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+        value = (double)mantissa;
+        value = exponent < 0 ? value / numeric_text_pow10[-exponent] : value * numeric_text_pow10[exponent];
+    } else {
+        return false;
+    }
+    *out = negative ? -value : value;
+    return true;
+}
+
+static void numeric_text_record_error(NumericTextChunk *chunk, NumericTextStatus status, int line,
+                                      int col, const char *token, size_t token_len) {
+    chunk->status = status;
+    chunk->error_line = line;
+    chunk->error_col = col;
+    if (token_len >= sizeof(chunk->error_token)) token_len = sizeof(chunk->error_token) - 1;
+    if (token != NULL) memcpy(chunk->error_token, token, token_len);
+    chunk->error_token[token != NULL ? token_len : 0] = '\0';
+}
+
+// 1 セルを数値へ変換する。token は引用符を外したセル内容（末尾 NUL なし）。
+static NumericTextStatus numeric_text_cell_value(const char *token, size_t len, NumericMissingMode missing,
+                                                 double *out) {
+    while (len > 0 && (*token == ' ' || *token == '\t')) {
+        token++;
+        len--;
+    }
+    while (len > 0 && (token[len - 1] == ' ' || token[len - 1] == '\t' ||
+           token[len - 1] == '\r' || token[len - 1] == '\n')) {
+        len--;
+    }
+
+    if (len > 0 && parse_decimal_fast(token, token + len, out)) return NUMERIC_TEXT_OK;
+
+    bool is_missing = len == 0 ||
+        (len == 2 && strncmp(token, "NA", 2) == 0) ||
+        (len == 4 && strncmp(token, "null", 4) == 0);
+    if (!is_missing) {
+        char small[128];
+        char *buffer = len < sizeof(small) ? small : malloc(len + 1);
+        if (buffer == NULL) return NUMERIC_TEXT_NO_MEMORY;
+        memcpy(buffer, token, len);
+        buffer[len] = '\0';
+        char *endptr = NULL;
+        errno = 0;
+        double value = strtod(buffer, &endptr);
+        bool ok = errno == 0 && endptr == buffer + len;
+        if (buffer != small) free(buffer);
+        if (ok) {
+            *out = value;
+            return NUMERIC_TEXT_OK;
+        }
+        return NUMERIC_TEXT_NOT_NUMBER;
+    }
+
+    if (missing == NUMERIC_MISSING_NAN) {
+        *out = NAN;
+    } else if (missing == NUMERIC_MISSING_ZERO) {
+        *out = 0.0;
+    } else {
+        return NUMERIC_TEXT_MISSING;
+    }
+    return NUMERIC_TEXT_OK;
+}
+
+// 1 行を解析する。row が NULL なら列数だけ数える。
+// 引用符は parse_text_delimited_fields と同じく、セル先頭にあるときだけ特別扱いする。
+static NumericTextStatus numeric_text_parse_line(const NumericTextLoad *load, const char *line,
+                                                 const char *line_end, double *row, int line_no,
+                                                 int *field_count, NumericTextChunk *chunk) {
+    const char *p = line;
+    int col = 0;
+    char *scratch = NULL;
+    size_t scratch_capacity = 0;
+    NumericTextStatus status = NUMERIC_TEXT_OK;
+
+    while (1) {
+        const char *token = p;
+        size_t token_len = 0;
+
+        if (p < line_end && *p == '"') {
+            size_t needed = (size_t)(line_end - p) + 1;
+            if (needed > scratch_capacity) {
+                char *grown = realloc(scratch, needed);
+                if (grown == NULL) {
+                    status = NUMERIC_TEXT_NO_MEMORY;
+                    break;
+                }
+                scratch = grown;
+                scratch_capacity = needed;
             }
-            char *token = field->string.data;
-            while (*token == ' ' || *token == '\t') token++;
-            char *endptr = NULL;
-            errno = 0;
-            double value = strtod(token, &endptr);
-            while (endptr != NULL && (*endptr == ' ' || *endptr == '\t' || *endptr == '\r' || *endptr == '\n')) {
-                endptr++;
-            }
-            char *token_end = token + strlen(token);
-            while (token_end > token && (token_end[-1] == ' ' || token_end[-1] == '\t' ||
-                   token_end[-1] == '\r' || token_end[-1] == '\n')) {
-                token_end--;
-            }
-            int token_len = (int)(token_end - token);
-            bool missing = token_len == 0 || (endptr == token &&
-                ((token_len == 2 && strncmp(token, "NA", 2) == 0) ||
-                 (token_len == 3 && strncmp(token, "NaN", 3) == 0) ||
-                 (token_len == 3 && strncmp(token, "nan", 3) == 0) ||
-                 (token_len == 4 && strncmp(token, "null", 4) == 0)));
-            if (missing) {
-                if (strcmp(missing_mode, "nan") == 0) {
-                    value = NAN;
-                } else if (strcmp(missing_mode, "zero") == 0) {
-                    value = 0.0;
-                } else {
-                    value_free(&fields);
-                    free(data);
-                    fclose(f);
-                    builtin_runtime_error("%sの%d行%d列目に欠損値があります。第3引数に \"nan\" または \"zero\" を指定すると読み込めます",
-                                          label, line_no, i + 1);
-                    return value_null();
+            p++;
+            bool closed = false;
+            while (p < line_end) {
+                if (*p == '"') {
+                    if (p + 1 < line_end && p[1] == '"') {
+                        scratch[token_len++] = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    closed = true;
+                    break;
                 }
-            } else if (errno != 0 || endptr == token || (endptr != NULL && *endptr != '\0')) {
-                value_free(&fields);
-                free(data);
-                fclose(f);
-                builtin_runtime_error("%sの%d行%d列目を数値として読めません: %s",
-                                      label, line_no, i + 1, token);
-                return value_null();
+                scratch[token_len++] = *p++;
             }
-            row_values[i] = value;
+            if (!closed) {
+                status = NUMERIC_TEXT_UNCLOSED_QUOTE;
+                if (chunk != NULL) numeric_text_record_error(chunk, status, line_no, col + 1, NULL, 0);
+                break;
+            }
+            while (p < line_end && *p != load->delimiter && *p != '\r') {
+                scratch[token_len++] = *p++;
+            }
+            token = scratch;
+        } else {
+            while (p < line_end && *p != load->delimiter && *p != '\r') p++;
+            token_len = (size_t)(p - token);
         }
 
-        if (row_cols == 0) continue;
-        if (cols < 0) cols = row_cols;
-        if (row_cols != cols) {
-            value_free(&fields);
-            free(data);
-            fclose(f);
-            builtin_runtime_error("%sの列数が一致しません（期待: %d列, %d行目: %d列）",
-                                  label, cols, line_no, row_cols);
-            return value_null();
+        if (row != NULL && col < load->cols) {
+            int out_col = load->column_map != NULL ? load->column_map[col] : col;
+            if (out_col >= 0) {
+                status = numeric_text_cell_value(token, token_len, load->missing, &row[out_col]);
+                if (status != NUMERIC_TEXT_OK) {
+                    if (chunk != NULL) {
+                        numeric_text_record_error(chunk, status, line_no, col + 1, token, token_len);
+                    }
+                    break;
+                }
+            }
         }
+        col++;
 
-        for (int c = 0; c < cols; c++) {
-            if (data_count >= data_capacity) {
-                ARRAY_GROW(data, data_count, data_capacity, double,
-                           value_free(&fields); free(data); fclose(f);
-                           builtin_runtime_error("CSVデータのメモリ確保に失敗しました");
-                           return value_null());
+        if (p < line_end && *p == load->delimiter) {
+            p++;
+            continue;
+        }
+        break;
+    }
+
+    free(scratch);
+    *field_count = col;
+    if (status == NUMERIC_TEXT_OK && row != NULL && col != load->cols) {
+        status = NUMERIC_TEXT_COLUMN_COUNT;
+        if (chunk != NULL) numeric_text_record_error(chunk, status, line_no, col, NULL, 0);
+    }
+    return status;
+}
+
+static bool numeric_text_is_blank(const char *line, const char *line_end) {
+    while (line < line_end && (*line == ' ' || *line == '\t')) line++;
+    return line == line_end || *line == '\r';
+}
+
+static const char *numeric_text_line_end(const char *p, const char *end) {
+    const char *newline = memchr(p, '\n', (size_t)(end - p));
+    return newline != NULL ? newline : end;
+}
+
+static void numeric_text_count_chunk(int index, void *arg) {
+    NumericTextLoad *load = arg;
+    NumericTextChunk *chunk = &load->chunks[index];
+    const char *p = chunk->begin;
+    while (p < chunk->end) {
+        const char *line_end = numeric_text_line_end(p, chunk->end);
+        chunk->lines++;
+        if (!numeric_text_is_blank(p, line_end)) chunk->rows++;
+        p = line_end < chunk->end ? line_end + 1 : line_end;
+    }
+}
+
+static void numeric_text_parse_chunk(int index, void *arg) {
+    NumericTextLoad *load = arg;
+    NumericTextChunk *chunk = &load->chunks[index];
+    const char *p = chunk->begin;
+    int line_no = chunk->first_line;
+    int row = chunk->first_row;
+    while (p < chunk->end) {
+        const char *line_end = numeric_text_line_end(p, chunk->end);
+        if (!numeric_text_is_blank(p, line_end)) {
+            int fields = 0;
+            double *out = load->out + (size_t)row * (size_t)load->out_cols;
+            if (numeric_text_parse_line(load, p, line_end, out, line_no, &fields, chunk) != NUMERIC_TEXT_OK) {
+                return;
             }
-            data[data_count++] = row_values[c];
+            row++;
         }
-        value_free(&fields);
-        rows++;
+        line_no++;
+        p = line_end < chunk->end ? line_end + 1 : line_end;
     }
+}
 
-    fclose(f);
+// 列指定（列番号または見出し名の配列）を column_map へ変換する。
+static int *resolve_numeric_columns(Value selection, const char *header, const char *header_end,
+                                    int cols, char delimiter, const char *name, const char *label,
+                                    int *out_cols) {
+    if (selection.type != VALUE_ARRAY || selection.array.length == 0) {
+        builtin_runtime_error("%s の第4引数は読み込む列番号または見出し名の配列でなければなりません", name);
+        return NULL;
+    }
 
-    if (cols < 0) {
-        free(data);
+    Value header_fields = value_null();
+    int *map = malloc(sizeof(int) * (size_t)cols);
+    if (map == NULL) {
+        builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+        return NULL;
+    }
+    for (int c = 0; c < cols; c++) map[c] = -1;
+
+    for (int i = 0; i < selection.array.length; i++) {
+        Value item = selection.array.elements[i];
+        int source = -1;
+        if (item.type == VALUE_NUMBER) {
+            source = (int)item.number;
+            if (source < 0) source += cols;
+            if (source < 0 || source >= cols) {
+                builtin_runtime_error("%s の列番号が範囲外です（指定: %d, 列数: %d）", name, (int)item.number, cols);
+                break;
+            }
+        } else if (item.type == VALUE_STRING) {
+            if (header == NULL) {
+                builtin_runtime_error("%s で見出し名を指定するには第2引数を 真 にしてください", name);
+                break;
+            }
+            if (header_fields.type == VALUE_NULL) {
+                char *line = malloc((size_t)(header_end - header) + 1);
+                if (line == NULL) {
+                    builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+                    break;
+                }
+                memcpy(line, header, (size_t)(header_end - header));
+                line[header_end - header] = '\0';
+                bool parsed = parse_text_delimited_fields(line, delimiter, &header_fields, label, 1);
+                free(line);
+                if (!parsed) break;
+            }
+            for (int c = 0; c < header_fields.array.length; c++) {
+                Value field = header_fields.array.elements[c];
+                if (field.type == VALUE_STRING && strcmp(field.string.data, item.string.data) == 0) {
+                    source = c;
+                    break;
+                }
+            }
+            if (source < 0 || source >= cols) {
+                builtin_runtime_error("%sの見出しに列 \"%s\" がありません", label, item.string.data);
+                source = -1;
+                break;
+            }
+        } else {
+            builtin_runtime_error("%s の列指定は数値または文字列でなければなりません（%d番目: %s）",
+                                  name, i, value_type_name(item.type));
+            break;
+        }
+        if (map[source] >= 0) {
+            builtin_runtime_error("%s の列指定が重複しています（%d列目）", name, source);
+            source = -1;
+            break;
+        }
+        map[source] = i;
+        if (i == selection.array.length - 1) {
+            value_free(&header_fields);
+            *out_cols = selection.array.length;
+            return map;
+        }
+    }
+
+    value_free(&header_fields);
+    free(map);
+    return NULL;
+}
+
+static Value read_delimited_numeric(int argc, Value *argv, char delimiter, const char *name, const char *label) {
+    if (argv[0].type != VALUE_STRING) {
+        builtin_runtime_error("%s の第1引数はファイルパス文字列でなければなりません（実際: %s）",
+                              name, value_type_name(argv[0].type));
+        return value_null();
+    }
+
+    bool has_header = false;
+    if (argc >= 2) {
+        if (argv[1].type != VALUE_BOOL) {
+            builtin_runtime_error("%s の第2引数はヘッダー有無を表す真偽値でなければなりません（実際: %s）",
+                                  name, value_type_name(argv[1].type));
+            return value_null();
+        }
+        has_header = argv[1].boolean;
+    }
+
+    NumericMissingMode missing = NUMERIC_MISSING_ERROR;
+    if (argc >= 3) {
+        if (argv[2].type != VALUE_STRING) {
+            builtin_runtime_error("%s の第3引数は missing mode 文字列でなければなりません（実際: %s）",
+                                  name, value_type_name(argv[2].type));
+            return value_null();
+        }
+        const char *missing_mode = argv[2].string.data;
+        if (strcmp(missing_mode, "nan") == 0) {
+            missing = NUMERIC_MISSING_NAN;
+        } else if (strcmp(missing_mode, "zero") == 0) {
+            missing = NUMERIC_MISSING_ZERO;
+        } else if (strcmp(missing_mode, "error") != 0) {
+            builtin_runtime_error("%s の missing mode は \"error\" / \"nan\" / \"zero\" のいずれかです（実際: %s）",
+                                  name, missing_mode);
+            return value_null();
+        }
+    }
+
+    MappedTextFile file;
+    if (!mapped_text_open(argv[0].string.data, &file)) {
+        builtin_runtime_error("%sファイルを読み込めません: %s", label, argv[0].string.data);
+        return value_null();
+    }
+
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    const char *header = NULL;
+    const char *header_end = NULL;
+    int first_line = 1;
+    if (has_header && p < end) {
+        header = p;
+        header_end = numeric_text_line_end(p, end);
+        p = header_end < end ? header_end + 1 : header_end;
+        first_line = 2;
+    }
+
+    // 最初のデータ行で列数を決める
+    NumericTextLoad load = { .delimiter = delimiter, .missing = missing };
+    const char *scan = p;
+    while (scan < end) {
+        const char *line_end = numeric_text_line_end(scan, end);
+        if (!numeric_text_is_blank(scan, line_end)) {
+            NumericTextChunk probe = {0};
+            if (numeric_text_parse_line(&load, scan, line_end, NULL, 0, &load.cols, &probe) != NUMERIC_TEXT_OK) {
+                int line_no = first_line;
+                for (const char *q = p; q < scan; q++) {
+                    if (*q == '\n') line_no++;
+                }
+                mapped_text_close(&file);
+                builtin_runtime_error("%s の%d行目に閉じていない引用符があります", label, line_no);
+                return value_null();
+            }
+            break;
+        }
+        scan = line_end < end ? line_end + 1 : line_end;
+    }
+    if (load.cols == 0) {
+        mapped_text_close(&file);
         return value_matrix(0, 0);
     }
 
-    Value result = value_matrix_from_data(data, rows, cols);
-    free(data);
+    int *column_map = NULL;
+    load.out_cols = load.cols;
+    if (argc >= 4) {
+        column_map = resolve_numeric_columns(argv[3], header, header_end, load.cols, delimiter, name, label,
+                                             &load.out_cols);
+        if (column_map == NULL) {
+            mapped_text_close(&file);
+            return value_null();
+        }
+        load.column_map = column_map;
+    }
+
+    size_t data_size = (size_t)(end - p);
+    size_t chunk_bytes = data_size / NUMERIC_TEXT_MAX_CHUNKS + 1;
+    if (chunk_bytes < NUMERIC_TEXT_MIN_CHUNK_BYTES) chunk_bytes = NUMERIC_TEXT_MIN_CHUNK_BYTES;
+    int chunk_count = (int)((data_size + chunk_bytes - 1) / chunk_bytes);
+    if (chunk_count < 1) chunk_count = 1;
+    load.chunks = calloc((size_t)chunk_count, sizeof(NumericTextChunk));
+    if (load.chunks == NULL) {
+        free(column_map);
+        mapped_text_close(&file);
+        builtin_runtime_error("%s の作業メモリを確保できませんでした", name);
+        return value_null();
+    }
+    const char *chunk_begin = p;
+    for (int i = 0; i < chunk_count; i++) {
+        const char *chunk_end = end;
+        if (i + 1 < chunk_count) {
+            const char *target = p + (size_t)(i + 1) * chunk_bytes;
+            if (target < chunk_begin) target = chunk_begin;
+            chunk_end = numeric_text_line_end(target, end);
+            if (chunk_end < end) chunk_end++;
+        }
+        load.chunks[i].begin = chunk_begin;
+        load.chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    async_parallel_for(chunk_count, numeric_text_count_chunk, &load);
+
+    long long total_rows = 0;
+    int line_no = first_line;
+    for (int i = 0; i < chunk_count; i++) {
+        load.chunks[i].first_line = line_no;
+        load.chunks[i].first_row = (int)total_rows;
+        line_no += load.chunks[i].lines;
+        total_rows += load.chunks[i].rows;
+    }
+    if (total_rows * load.out_cols > INT_MAX) {
+        free(load.chunks);
+        free(column_map);
+        mapped_text_close(&file);
+        builtin_runtime_error("%sが大きすぎます（%lld行 × %d列）。列指定で読み込む列を減らしてください",
+                              label, total_rows, load.out_cols);
+        return value_null();
+    }
+
+    Value result = value_matrix((int)total_rows, load.out_cols);
+    if (result.type != VALUE_MATRIX) {
+        free(load.chunks);
+        free(column_map);
+        mapped_text_close(&file);
+        builtin_runtime_error("%sデータのメモリ確保に失敗しました", label);
+        return value_null();
+    }
+    load.out = matrix_raw_data(&result);
+
+    async_parallel_for(chunk_count, numeric_text_parse_chunk, &load);
+
+    NumericTextChunk *failed = NULL;
+    for (int i = 0; i < chunk_count && failed == NULL; i++) {
+        if (load.chunks[i].status != NUMERIC_TEXT_OK) failed = &load.chunks[i];
+    }
+    if (failed != NULL) {
+        switch (failed->status) {
+            case NUMERIC_TEXT_UNCLOSED_QUOTE:
+                builtin_runtime_error("%s の%d行目に閉じていない引用符があります", label, failed->error_line);
+                break;
+            case NUMERIC_TEXT_MISSING:
+                builtin_runtime_error("%sの%d行%d列目に欠損値があります。第3引数に \"nan\" または \"zero\" を指定すると読み込めます",
+                                      label, failed->error_line, failed->error_col);
+                break;
+            case NUMERIC_TEXT_NOT_NUMBER:
+                builtin_runtime_error("%sの%d行%d列目を数値として読めません: %s",
+                                      label, failed->error_line, failed->error_col, failed->error_token);
+                break;
+            case NUMERIC_TEXT_COLUMN_COUNT:
+                builtin_runtime_error("%sの列数が一致しません（期待: %d列, %d行目: %d列）",
+                                      label, load.cols, failed->error_line, failed->error_col);
+                break;
+            default:
+                builtin_runtime_error("%sデータのメモリ確保に失敗しました", label);
+                break;
+        }
+        value_free(&result);
+        result = value_null();
+    }
+
+    free(load.chunks);
+    free(column_map);
+    mapped_text_close(&file);
     return result;
 }
 
@@ -7625,6 +10492,340 @@ static Value builtin_read_tsv_numeric(int argc, Value *argv) {
     return read_delimited_numeric(argc, argv, '\t', "read_tsv_numeric", "TSV");
 }
 
+// ---- .npy 形式 ----
+// NumPy の .npy（version 1.0 / 2.0 / 3.0）を読み書きする。保存はヘッダーと
+// 本体を 1 回の連続書き込みで書き、読込はファイルを mmap して本体を複製も
+// 解析もせずに参照する読み取り専用の数値ベクトル・行列を返す。
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_MAGIC_LENGTH 6
+#define NPY_HEADER_ALIGN 64
+#define NPY_WRITE_CHUNK_BYTES (64 * 1024)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#  define NPY_NATIVE_ORDER '>'
+#else
+#  define NPY_NATIVE_ORDER '<'
+#endif
+
+// dtype に対応する descr の型コード（'<f8' の "f8" 部分）
+static const char *npy_type_code(NumericDType dtype) {
+    switch (dtype) {
+        case NUMERIC_DTYPE_F32:  return "f4";
+        case NUMERIC_DTYPE_I64:  return "i8";
+        case NUMERIC_DTYPE_I32:  return "i4";
+        case NUMERIC_DTYPE_BOOL: return "b1";
+        case NUMERIC_DTYPE_F64:
+        default:                 return "f8";
+    }
+}
+
+static bool npy_dtype_from_descr(const char *descr, NumericDType *dtype) {
+    static const NumericDType dtypes[] = {
+        NUMERIC_DTYPE_F64, NUMERIC_DTYPE_F32, NUMERIC_DTYPE_I64, NUMERIC_DTYPE_I32, NUMERIC_DTYPE_BOOL
+    };
+    char order = descr[0];
+    if (order != NPY_NATIVE_ORDER && order != '|' && order != '=') return false;
+    for (size_t i = 0; i < sizeof(dtypes) / sizeof(dtypes[0]); i++) {
+        const char *code = npy_type_code(dtypes[i]);
+        if (strcmp(descr + 1, code) != 0) continue;
+        // 1 バイト型以外はバイト順の指定が必須
+        if (order == '|' && dtypes[i] != NUMERIC_DTYPE_BOOL) return false;
+        *dtype = dtypes[i];
+        return true;
+    }
+    return false;
+}
+
+// ヘッダー辞書から 'key': の直後（空白を除く）を返す
+static const char *npy_header_value(const char *header, const char *key) {
+    char quoted[32];
+    snprintf(quoted, sizeof(quoted), "'%s'", key);
+    const char *p = strstr(header, quoted);
+    if (p == NULL) return NULL;
+    p += strlen(quoted);
+    while (*p == ' ') p++;
+    if (*p != ':') return NULL;
+    p++;
+    while (*p == ' ') p++;
+    return p;
+}
+
+typedef struct {
+    NumericDType dtype;
+    bool fortran_order;
+    int ndim;
+    long long shape[2];
+} NpyHeader;
+
+static bool npy_parse_header(const char *header, NpyHeader *out, const char **error) {
+    const char *descr = npy_header_value(header, "descr");
+    char descr_text[16];
+    if (descr == NULL || *descr != '\'') {
+        *error = "descr がありません";
+        return false;
+    }
+    const char *descr_end = strchr(descr + 1, '\'');
+    if (descr_end == NULL || descr_end - descr - 1 >= (long)sizeof(descr_text)) {
+        *error = "descr を読めません";
+        return false;
+    }
+    memcpy(descr_text, descr + 1, (size_t)(descr_end - descr - 1));
+    descr_text[descr_end - descr - 1] = '\0';
+    if (!npy_dtype_from_descr(descr_text, &out->dtype)) {
+        *error = "未対応の dtype です。f8 / f4 / i8 / i4 / b1 に対応しています";
+        return false;
+    }
+
+    const char *fortran = npy_header_value(header, "fortran_order");
+    if (fortran != NULL && strncmp(fortran, "True", 4) == 0) {
+        out->fortran_order = true;
+    } else if (fortran != NULL && strncmp(fortran, "False", 5) == 0) {
+        out->fortran_order = false;
+    } else {
+        *error = "fortran_order を読めません";
+        return false;
+    }
+
+    const char *shape = npy_header_value(header, "shape");
+    if (shape == NULL || *shape != '(') {
+        *error = "shape を読めません";
+        return false;
+    }
+    shape++;
+    out->ndim = 0;
+    while (1) {
+        while (*shape == ' ') shape++;
+        if (*shape == ')') break;
+        if (*shape < '0' || *shape > '9') {
+            *error = "shape を読めません";
+            return false;
+        }
+        if (out->ndim >= 2) {
+            *error = "3 次元以上の配列には対応していません";
+            return false;
+        }
+        char *end;
+        out->shape[out->ndim++] = strtoll(shape, &end, 10);
+        shape = end;
+        while (*shape == ' ') shape++;
+        if (*shape == ',') shape++;
+    }
+    if (out->ndim == 0) {
+        *error = "0 次元の配列には対応していません";
+        return false;
+    }
+    return true;
+}
+
+static Value builtin_npy_load(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING) {
+        builtin_runtime_error("npy_load の第1引数はファイルパス文字列でなければなりません（実際: %s）",
+                              value_type_name(argv[0].type));
+        return value_null();
+    }
+    const char *path = argv[0].string.data;
+
+    MappedTextFile file;
+    if (!mapped_text_open(path, &file)) {
+        builtin_runtime_error("npy ファイルを読み込めません: %s", path);
+        return value_null();
+    }
+
+    const unsigned char *bytes = (const unsigned char *)file.data;
+    size_t header_offset = 0;
+    size_t header_length = 0;
+    if (file.size >= NPY_MAGIC_LENGTH + 4 && memcmp(bytes, NPY_MAGIC, NPY_MAGIC_LENGTH) == 0) {
+        unsigned char major = bytes[NPY_MAGIC_LENGTH];
+        if (major == 1) {
+            header_offset = NPY_MAGIC_LENGTH + 4;
+            header_length = (size_t)bytes[8] | ((size_t)bytes[9] << 8);
+        } else if ((major == 2 || major == 3) && file.size >= NPY_MAGIC_LENGTH + 6) {
+            header_offset = NPY_MAGIC_LENGTH + 6;
+            header_length = (size_t)bytes[8] | ((size_t)bytes[9] << 8) |
+                            ((size_t)bytes[10] << 16) | ((size_t)bytes[11] << 24);
+        }
+    }
+    if (header_offset == 0 || header_length > file.size - header_offset) {
+        mapped_text_close(&file);
+        builtin_runtime_error("npy 形式ではありません: %s", path);
+        return value_null();
+    }
+
+    char *header = malloc(header_length + 1);
+    if (header == NULL) {
+        mapped_text_close(&file);
+        builtin_runtime_error("npy ヘッダーのメモリ確保に失敗しました");
+        return value_null();
+    }
+    memcpy(header, file.data + header_offset, header_length);
+    header[header_length] = '\0';
+
+    NpyHeader npy;
+    const char *error = NULL;
+    bool parsed = npy_parse_header(header, &npy, &error);
+    free(header);
+    if (!parsed) {
+        mapped_text_close(&file);
+        builtin_runtime_error("npy ヘッダーが不正です（%s）: %s", error, path);
+        return value_null();
+    }
+
+    long long rows = npy.shape[0];
+    long long cols = npy.ndim == 2 ? npy.shape[1] : 1;
+    if (rows > INT_MAX || cols > INT_MAX || (cols > 0 && rows > INT_MAX / cols)) {
+        mapped_text_close(&file);
+        builtin_runtime_error("npy 配列が大きすぎます（%lld x %lld）: %s", rows, cols, path);
+        return value_null();
+    }
+
+    size_t data_offset = header_offset + header_length;
+    size_t elem_size = (size_t)numeric_dtype_size(npy.dtype);
+    size_t count = (size_t)rows * (size_t)cols;
+    if (file.size - data_offset < count * elem_size) {
+        mapped_text_close(&file);
+        builtin_runtime_error("npy ファイルの本体が足りません（%zu 要素が必要）: %s", count, path);
+        return value_null();
+    }
+
+    // 本体が要素境界に揃っていれば mmap 領域をそのまま参照する。
+    // 揃っていない古い形式のファイルだけ、単独所有のバッファへ複製する。
+    if (file.mapping != NULL && data_offset % elem_size == 0) {
+        void *mapping = file.mapping;
+        size_t mapping_size = file.mapping_size;
+        if (npy.ndim == 1) {
+            return value_numeric_array_mapped(mapping, mapping_size, data_offset, npy.dtype, (int)rows);
+        }
+        return value_matrix_mapped(mapping, mapping_size, data_offset, npy.dtype,
+                                   (int)rows, (int)cols, npy.fortran_order);
+    }
+
+    Value result;
+    const char *src = file.data + data_offset;
+    if (npy.ndim == 1) {
+        result = value_numeric_array_with_dtype((int)rows, npy.dtype);
+        if (result.type == VALUE_NUMERIC_ARRAY) {
+            memcpy(result.numeric_array.data, src, count * elem_size);
+            result.numeric_array.length = (int)rows;
+        }
+    } else {
+        result = value_matrix_with_dtype((int)rows, (int)cols, npy.dtype);
+        if (result.type == VALUE_MATRIX && count > 0) {
+            memcpy(result.matrix.data, src, count * elem_size);
+            if (npy.fortran_order) {
+                result.matrix.row_stride = 1;
+                result.matrix.col_stride = (int)rows;
+            }
+        }
+    }
+    mapped_text_close(&file);
+    if (result.type == VALUE_NULL) {
+        builtin_runtime_error("npy データのメモリ確保に失敗しました");
+    }
+    return result;
+}
+
+static Value builtin_npy_save(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING) {
+        builtin_runtime_error("npy_save の第1引数はファイルパス文字列でなければなりません（実際: %s）",
+                              value_type_name(argv[0].type));
+        return value_bool(false);
+    }
+    Value *value = &argv[1];
+    if (value->type != VALUE_NUMERIC_ARRAY && value->type != VALUE_MATRIX) {
+        builtin_runtime_error("npy_save の第2引数は数値ベクトルまたは数値行列でなければなりません（実際: %s）",
+                              value_type_name(value->type));
+        return value_bool(false);
+    }
+
+    // 連続した行優先・列優先の並びはそのまま 1 回で書く。
+    // それ以外の view は行優先の順に固定長バッファへ集めて書く。
+    NumericDType dtype;
+    char shape[64];
+    const char *data = NULL;
+    bool fortran_order = false;
+    int rows, cols;
+    if (value->type == VALUE_NUMERIC_ARRAY) {
+        dtype = value->numeric_array.dtype;
+        rows = value->numeric_array.length;
+        cols = 1;
+        snprintf(shape, sizeof(shape), "(%d,)", rows);
+        if (numeric_array_is_contiguous(value)) data = numeric_array_raw_data(value);
+    } else {
+        dtype = value->matrix.dtype;
+        rows = value->matrix.rows;
+        cols = value->matrix.cols;
+        snprintf(shape, sizeof(shape), "(%d, %d)", rows, cols);
+        if (value->matrix.offset == 0 && value->matrix.row_stride == cols && value->matrix.col_stride == 1) {
+            data = value->matrix.data;
+        } else if (value->matrix.offset == 0 && value->matrix.row_stride == 1 &&
+                   value->matrix.col_stride == rows) {
+            data = value->matrix.data;
+            fortran_order = true;
+        }
+    }
+
+    char header[256];
+    int header_length = snprintf(header, sizeof(header),
+                                 "{'descr': '%c%s', 'fortran_order': %s, 'shape': %s, }",
+                                 dtype == NUMERIC_DTYPE_BOOL ? '|' : NPY_NATIVE_ORDER, npy_type_code(dtype),
+                                 fortran_order ? "True" : "False", shape);
+    int preamble = NPY_MAGIC_LENGTH + 4;
+    int padded = ((preamble + header_length + 1 + NPY_HEADER_ALIGN - 1) / NPY_HEADER_ALIGN) * NPY_HEADER_ALIGN;
+    while (preamble + header_length < padded - 1) header[header_length++] = ' ';
+    header[header_length++] = '\n';
+
+    unsigned char prefix[NPY_MAGIC_LENGTH + 4];
+    memcpy(prefix, NPY_MAGIC, NPY_MAGIC_LENGTH);
+    prefix[6] = 1;
+    prefix[7] = 0;
+    prefix[8] = (unsigned char)(header_length & 0xFF);
+    prefix[9] = (unsigned char)((header_length >> 8) & 0xFF);
+
+    FILE *out = fopen(argv[0].string.data, "wb");
+    if (out == NULL) {
+        builtin_runtime_error("npy ファイルを書き込めません: %s", argv[0].string.data);
+        return value_bool(false);
+    }
+
+    size_t elem_size = (size_t)numeric_dtype_size(dtype);
+    size_t count = (size_t)rows * (size_t)cols;
+    bool ok = fwrite(prefix, 1, sizeof(prefix), out) == sizeof(prefix) &&
+              fwrite(header, 1, (size_t)header_length, out) == (size_t)header_length;
+    if (ok && data != NULL) {
+        ok = count == 0 || fwrite(data, elem_size, count, out) == count;
+    } else if (ok) {
+        char *chunk = malloc(NPY_WRITE_CHUNK_BYTES);
+        size_t per_chunk = NPY_WRITE_CHUNK_BYTES / elem_size;
+        size_t filled = 0;
+        ok = chunk != NULL;
+        for (size_t i = 0; ok && i < count; i++) {
+            const char *base = value->type == VALUE_NUMERIC_ARRAY ? value->numeric_array.data : value->matrix.data;
+            int slot;
+            if (value->type == VALUE_NUMERIC_ARRAY) {
+                slot = value->numeric_array.offset + (int)i * value->numeric_array.stride;
+            } else {
+                int r = (int)(i / (size_t)cols);
+                int c = (int)(i % (size_t)cols);
+                slot = value->matrix.offset + r * value->matrix.row_stride + c * value->matrix.col_stride;
+            }
+            memcpy(chunk + filled * elem_size, base + (size_t)slot * elem_size, elem_size);
+            if (++filled == per_chunk || i + 1 == count) {
+                ok = fwrite(chunk, elem_size, filled, out) == filled;
+                filled = 0;
+            }
+        }
+        free(chunk);
+    }
+    if (fclose(out) != 0) ok = false;
+    if (!ok) {
+        builtin_runtime_error("npy ファイルの書き込みに失敗しました: %s", argv[0].string.data);
+    }
+    return value_bool(ok);
+}
+
 static bool parse_text_delimited_fields(const char *line, char delimiter, Value *out_fields,
                                         const char *name, int line_no) {
     size_t line_len = strlen(line);
@@ -7702,6 +10903,90 @@ static bool is_blank_csv_line(const char *line) {
     return true;
 }
 
+// ---- 行単位のテキストリーダー ----
+// 固定長の読み込みバッファと、行の長さに合わせて伸びる行バッファを再利用する。
+// 1 行の長さに上限はなく、ファイル全体を保持しないので巨大なファイルも一定メモリで読める。
+
+#define TEXT_LINE_READER_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t buffer_len;
+    size_t buffer_pos;
+    char *line;            // 末尾の '\n' を除いた NUL 終端の行
+    size_t line_len;
+    size_t line_capacity;
+    int line_no;
+} TextLineReader;
+
+static bool text_line_reader_open(TextLineReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) return false;
+    reader->buffer = malloc(TEXT_LINE_READER_BUFFER_SIZE);
+    reader->line_capacity = 256;
+    reader->line = malloc(reader->line_capacity);
+    if (reader->buffer == NULL || reader->line == NULL) {
+        fclose(reader->file);
+        free(reader->buffer);
+        free(reader->line);
+        memset(reader, 0, sizeof(*reader));
+        return false;
+    }
+    return true;
+}
+
+static void text_line_reader_close(TextLineReader *reader) {
+    if (reader->file != NULL) fclose(reader->file);
+    free(reader->buffer);
+    free(reader->line);
+    memset(reader, 0, sizeof(*reader));
+}
+
+static bool text_line_reader_append(TextLineReader *reader, const char *data, size_t len) {
+    if (reader->line_len + len + 1 > reader->line_capacity) {
+        size_t capacity = reader->line_capacity;
+        while (reader->line_len + len + 1 > capacity) capacity *= 2;
+        char *line = realloc(reader->line, capacity);
+        if (line == NULL) return false;
+        reader->line = line;
+        reader->line_capacity = capacity;
+    }
+    memcpy(reader->line + reader->line_len, data, len);
+    reader->line_len += len;
+    return true;
+}
+
+// 次の行を reader->line に読む。1: 読めた / 0: 終端 / -1: メモリ不足
+static int text_line_reader_next(TextLineReader *reader) {
+    if (reader->file == NULL) return 0;
+    reader->line_len = 0;
+    bool any = false;
+    while (1) {
+        if (reader->buffer_pos >= reader->buffer_len) {
+            reader->buffer_len = fread(reader->buffer, 1, TEXT_LINE_READER_BUFFER_SIZE, reader->file);
+            reader->buffer_pos = 0;
+            if (reader->buffer_len == 0) break;
+        }
+        const char *start = reader->buffer + reader->buffer_pos;
+        size_t available = reader->buffer_len - reader->buffer_pos;
+        const char *newline = memchr(start, '\n', available);
+        size_t take = newline != NULL ? (size_t)(newline - start) : available;
+        if (!text_line_reader_append(reader, start, take)) return -1;
+        any = true;
+        reader->buffer_pos += take;
+        if (newline != NULL) {
+            reader->buffer_pos++;
+            break;
+        }
+    }
+    if (!any) return 0;
+    reader->line[reader->line_len] = '\0';
+    reader->line_no++;
+    return 1;
+}
+
 static Value builtin_read_csv(int argc, Value *argv) {
     if (argv[0].type != VALUE_STRING) {
         builtin_runtime_error("read_csv の第1引数はファイルパス文字列でなければなりません（実際: %s）",
@@ -7719,8 +11004,8 @@ static Value builtin_read_csv(int argc, Value *argv) {
         has_header = argv[1].boolean;
     }
 
-    FILE *f = fopen(argv[0].string.data, "r");
-    if (f == NULL) {
+    TextLineReader reader;
+    if (!text_line_reader_open(&reader, argv[0].string.data)) {
         builtin_runtime_error("CSVファイルを読み込めません: %s", argv[0].string.data);
         return value_null();
     }
@@ -7728,27 +11013,19 @@ static Value builtin_read_csv(int argc, Value *argv) {
     Value rows = value_array();
     Value headers = value_null();
     int expected_cols = -1;
-    int line_no = 0;
     bool header_seen = false;
-    char line[8192];
+    int status;
 
-    while (fgets(line, sizeof(line), f) != NULL) {
-        line_no++;
-        size_t line_len = strlen(line);
-        if (line_len == sizeof(line) - 1 && line[line_len - 1] != '\n') {
-            value_free(&rows);
-            value_free(&headers);
-            fclose(f);
-            builtin_runtime_error("CSVの%d行目が長すぎます。1行は8191バイト以内にしてください", line_no);
-            return value_null();
-        }
+    while ((status = text_line_reader_next(&reader)) > 0) {
+        const char *line = reader.line;
+        int line_no = reader.line_no;
         if (is_blank_csv_line(line)) continue;
 
         Value fields = value_null();
         if (!parse_text_delimited_fields(line, ',', &fields, "CSV", line_no)) {
             value_free(&rows);
             value_free(&headers);
-            fclose(f);
+            text_line_reader_close(&reader);
             return value_null();
         }
 
@@ -7759,7 +11036,7 @@ static Value builtin_read_csv(int argc, Value *argv) {
             value_free(&fields);
             value_free(&rows);
             value_free(&headers);
-            fclose(f);
+            text_line_reader_close(&reader);
             builtin_runtime_error("CSVの列数が一致しません（期待: %d列, %d行目: %d列）",
                                   expected_cols, line_no, actual_cols);
             return value_null();
@@ -7787,8 +11064,13 @@ static Value builtin_read_csv(int argc, Value *argv) {
         }
     }
 
-    fclose(f);
+    text_line_reader_close(&reader);
     value_free(&headers);
+    if (status < 0) {
+        value_free(&rows);
+        builtin_runtime_error("CSVの行バッファを確保できませんでした");
+        return value_null();
+    }
     return rows;
 }
 
@@ -7801,102 +11083,482 @@ static Value builtin_csv_column(int argc, Value *argv) {
         return value_null();
     }
 
-    Value result = value_array_with_capacity(argv[0].array.length);
-    for (int r = 0; r < argv[0].array.length; r++) {
-        Value row = argv[0].array.elements[r];
-        if (row.type == VALUE_DICT && argv[1].type == VALUE_STRING) {
-            Value cell = dict_get(&row, argv[1].string.data);
-            array_push(&result, cell);
-            continue;
+    Value result = value_array_with_capacity(argv[0].array.length);
+    for (int r = 0; r < argv[0].array.length; r++) {
+        Value row = argv[0].array.elements[r];
+        if (row.type == VALUE_DICT && argv[1].type == VALUE_STRING) {
+            Value cell = dict_get(&row, argv[1].string.data);
+            array_push(&result, cell);
+            continue;
+        }
+
+        if (row.type == VALUE_ARRAY && argv[1].type == VALUE_NUMBER && floor(argv[1].number) == argv[1].number) {
+            int index = (int)argv[1].number;
+            if (index < 0) index += row.array.length;
+            if (index < 0 || index >= row.array.length) {
+                value_free(&result);
+                builtin_runtime_error("csv_column の列番号が範囲外です（指定: %d, %d行目の列数: %d）",
+                                      (int)argv[1].number, r + 1, row.array.length);
+                return value_null();
+            }
+            array_push(&result, row.array.elements[index]);
+            continue;
+        }
+
+        value_free(&result);
+        builtin_runtime_error("csv_column は、辞書行には列名文字列、配列行には列番号整数を指定してください（%d行目: %s, 指定: %s）",
+                              r + 1, value_type_name(row.type), value_type_name(argv[1].type));
+        return value_null();
+    }
+
+    return result;
+}
+
+static Value builtin_read_json_lines(int argc, Value *argv) {
+    if (argv[0].type != VALUE_STRING) {
+        builtin_runtime_error("read_json_lines の第1引数はファイルパス文字列でなければなりません（実際: %s）",
+                              value_type_name(argv[0].type));
+        return value_null();
+    }
+
+    int max_lines = 100000;
+    if (argc >= 2) {
+        if (argv[1].type != VALUE_NUMBER || floor(argv[1].number) != argv[1].number) {
+            builtin_runtime_error("read_json_lines の第2引数は最大行数を表す整数でなければなりません（実際: %s）",
+                                  value_type_name(argv[1].type));
+            return value_null();
+        }
+        max_lines = (int)argv[1].number;
+        if (max_lines < 0) {
+            builtin_runtime_error("read_json_lines の最大行数は0以上でなければなりません（実際: %d）", max_lines);
+            return value_null();
+        }
+    }
+
+    TextLineReader reader;
+    if (!text_line_reader_open(&reader, argv[0].string.data)) {
+        builtin_runtime_error("JSON Linesファイルを読み込めません: %s", argv[0].string.data);
+        return value_null();
+    }
+
+    Value rows = value_array();
+    int parsed_lines = 0;
+    int status;
+
+    while ((status = text_line_reader_next(&reader)) > 0) {
+        const char *line = reader.line;
+        size_t line_len = reader.line_len;
+        int line_no = reader.line_no;
+        if (is_blank_csv_line(line)) continue;
+
+        if (parsed_lines >= max_lines) {
+            value_free(&rows);
+            text_line_reader_close(&reader);
+            builtin_runtime_error("JSON Linesの読み込み行数が上限を超えました（上限: %d行）。第2引数で上限を調整できます",
+                                  max_lines);
+            return value_null();
+        }
+
+        Value item = value_null();
+        if (!json_decode_checked(line, (int)line_len, &item)) {
+            value_free(&rows);
+            text_line_reader_close(&reader);
+            builtin_runtime_error("JSON Linesの%d行目をJSONとして解析できません", line_no);
+            return value_null();
+        }
+        array_push(&rows, item);
+        value_free(&item);
+        parsed_lines++;
+    }
+
+    text_line_reader_close(&reader);
+    if (status < 0) {
+        value_free(&rows);
+        builtin_runtime_error("JSON Linesの行バッファを確保できませんでした");
+        return value_null();
+    }
+    return rows;
+}
+
+// ---- バッチ読み込みリーダー ----
+// CSV / TSV / JSON Lines を呼び出しごとに N 行ずつ返す。リーダーは ID で参照し、
+// 行バッファと数値ブロック用バッファを使い回すので、ファイルの大きさによらずメモリは一定。
+
+#define MAX_DATA_READERS 64
+
+typedef enum {
+    DATA_READER_DELIMITED,
+    DATA_READER_JSON_LINES
+} DataReaderKind;
+
+typedef struct {
+    int id;
+    bool used;
+    bool closing;           // リーダー閉じる 済み。最後の利用者が抜けたら解放する
+    int pins;               // 読み込み中の呼び出し数（g_data_reader_mutex で保護）
+    pthread_mutex_t lock;   // 読み込み状態（行バッファ・ヘッダ・数値バッファ）を保護
+    DataReaderKind kind;
+    char delimiter;
+    const char *label;
+    TextLineReader lines;
+    bool has_header;
+    bool header_seen;
+    Value headers;
+    int expected_cols;
+    double *numeric_buffer;
+    size_t numeric_capacity;
+} DataReader;
+
+static DataReader g_data_readers[MAX_DATA_READERS];
+static int g_next_data_reader_id = 1;
+static pthread_mutex_t g_data_reader_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// g_data_reader_mutex を保持し、誰も使っていないときに呼ぶ
+static void data_reader_release(DataReader *reader) {
+    text_line_reader_close(&reader->lines);
+    value_free(&reader->headers);
+    free(reader->numeric_buffer);
+    pthread_mutex_destroy(&reader->lock);
+    memset(reader, 0, sizeof(*reader));
+}
+
+static void data_readers_close_all(void) {
+    pthread_mutex_lock(&g_data_reader_mutex);
+    for (int i = 0; i < MAX_DATA_READERS; i++) {
+        DataReader *reader = &g_data_readers[i];
+        if (!reader->used) continue;
+        // 読み込み中のスレッドがあれば、そのスレッドが抜けるときに解放される
+        reader->closing = true;
+        if (reader->pins == 0) data_reader_release(reader);
+    }
+    pthread_mutex_unlock(&g_data_reader_mutex);
+}
+
+static Value data_reader_open(Value path, DataReaderKind kind, char delimiter, bool has_header,
+                              const char *name, const char *label) {
+    if (path.type != VALUE_STRING) {
+        builtin_runtime_error("%s の第1引数はファイルパス文字列でなければなりません（実際: %s）",
+                              name, value_type_name(path.type));
+        return value_null();
+    }
+
+    pthread_mutex_lock(&g_data_reader_mutex);
+    DataReader *reader = NULL;
+    for (int i = 0; i < MAX_DATA_READERS; i++) {
+        if (!g_data_readers[i].used) {
+            reader = &g_data_readers[i];
+            break;
+        }
+    }
+    if (reader == NULL) {
+        pthread_mutex_unlock(&g_data_reader_mutex);
+        builtin_runtime_error("%s で同時に開けるリーダーは%d個までです。使い終わったリーダーは リーダー閉じる で閉じてください",
+                              name, MAX_DATA_READERS);
+        return value_null();
+    }
+    if (!text_line_reader_open(&reader->lines, path.string.data)) {
+        pthread_mutex_unlock(&g_data_reader_mutex);
+        builtin_runtime_error("%sファイルを読み込めません: %s", label, path.string.data);
+        return value_null();
+    }
+    pthread_mutex_init(&reader->lock, NULL);
+    reader->id = g_next_data_reader_id++;
+    reader->used = true;
+    reader->closing = false;
+    reader->pins = 0;
+    reader->kind = kind;
+    reader->delimiter = delimiter;
+    reader->label = label;
+    reader->has_header = has_header;
+    reader->headers = value_null();
+    reader->expected_cols = -1;
+    int id = reader->id;
+    pthread_mutex_unlock(&g_data_reader_mutex);
+    return value_number(id);
+}
+
+// 全体のロックは検索と参照数の更新だけに使い、読み込みはリーダーごとのロックで行う。
+// 見つかったリーダーは固定（pins を加算）し、自身のロックを取って返す。
+// 呼び出し側は data_reader_unpin で返す。固定中のスロットは閉じられても再利用されない
+static DataReader *data_reader_find(Value handle, const char *name) {
+    if (handle.type == VALUE_NUMBER) {
+        int id = (int)handle.number;
+        DataReader *reader = NULL;
+        pthread_mutex_lock(&g_data_reader_mutex);
+        for (int i = 0; i < MAX_DATA_READERS; i++) {
+            if (g_data_readers[i].used && !g_data_readers[i].closing && g_data_readers[i].id == id) {
+                reader = &g_data_readers[i];
+                reader->pins++;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_data_reader_mutex);
+        if (reader != NULL) {
+            pthread_mutex_lock(&reader->lock);
+            return reader;
+        }
+    }
+    builtin_runtime_error("%s の第1引数は開いているリーダーでなければなりません", name);
+    return NULL;
+}
+
+static void data_reader_unpin(DataReader *reader) {
+    pthread_mutex_unlock(&reader->lock);
+    pthread_mutex_lock(&g_data_reader_mutex);
+    if (--reader->pins == 0 && reader->closing) data_reader_release(reader);
+    pthread_mutex_unlock(&g_data_reader_mutex);
+}
+
+static bool data_reader_count_arg(Value count, const char *name, int *out) {
+    if (count.type != VALUE_NUMBER || floor(count.number) != count.number ||
+        count.number < 1 || count.number > INT_MAX) {
+        builtin_runtime_error("%s の第2引数は 1 以上の整数の行数でなければなりません", name);
+        return false;
+    }
+    *out = (int)count.number;
+    return true;
+}
+
+// 空行を飛ばして次の行を読む。1: 読めた / 0: 終端 / -1: エラー（報告済み）
+static int data_reader_next_line(DataReader *reader) {
+    while (1) {
+        int status = text_line_reader_next(&reader->lines);
+        if (status < 0) {
+            builtin_runtime_error("%sの行バッファを確保できませんでした", reader->label);
+            return -1;
         }
+        if (status == 0) return 0;
+        if (!is_blank_csv_line(reader->lines.line)) return 1;
+    }
+}
 
-        if (row.type == VALUE_ARRAY && argv[1].type == VALUE_NUMBER && floor(argv[1].number) == argv[1].number) {
-            int index = (int)argv[1].number;
-            if (index < 0) index += row.array.length;
-            if (index < 0 || index >= row.array.length) {
-                value_free(&result);
-                builtin_runtime_error("csv_column の列番号が範囲外です（指定: %d, %d行目の列数: %d）",
-                                      (int)argv[1].number, r + 1, row.array.length);
-                return value_null();
-            }
-            array_push(&result, row.array.elements[index]);
+// 区切りテキストの次のセル配列を読む。見出し行はここで取り込む。
+static int data_reader_next_fields(DataReader *reader, Value *fields) {
+    while (1) {
+        int status = data_reader_next_line(reader);
+        if (status <= 0) return status;
+        if (!parse_text_delimited_fields(reader->lines.line, reader->delimiter, fields,
+                                         reader->label, reader->lines.line_no)) {
+            return -1;
+        }
+        if (reader->expected_cols < 0) {
+            reader->expected_cols = fields->array.length;
+        } else if (fields->array.length != reader->expected_cols) {
+            int actual_cols = fields->array.length;
+            value_free(fields);
+            builtin_runtime_error("%sの列数が一致しません（期待: %d列, %d行目: %d列）",
+                                  reader->label, reader->expected_cols, reader->lines.line_no, actual_cols);
+            return -1;
+        }
+        if (reader->has_header && !reader->header_seen) {
+            reader->headers = *fields;
+            reader->header_seen = true;
             continue;
         }
-
-        value_free(&result);
-        builtin_runtime_error("csv_column は、辞書行には列名文字列、配列行には列番号整数を指定してください（%d行目: %s, 指定: %s）",
-                              r + 1, value_type_name(row.type), value_type_name(argv[1].type));
-        return value_null();
+        return 1;
     }
-
-    return result;
 }
 
-static Value builtin_read_json_lines(int argc, Value *argv) {
-    if (argv[0].type != VALUE_STRING) {
-        builtin_runtime_error("read_json_lines の第1引数はファイルパス文字列でなければなりません（実際: %s）",
-                              value_type_name(argv[0].type));
-        return value_null();
+static Value builtin_csv_reader(int argc, Value *argv) {
+    bool has_header = true;
+    if (argc >= 2) {
+        if (argv[1].type != VALUE_BOOL) {
+            builtin_runtime_error("csv_reader の第2引数はヘッダー有無を表す真偽値でなければなりません（実際: %s）",
+                                  value_type_name(argv[1].type));
+            return value_null();
+        }
+        has_header = argv[1].boolean;
     }
+    return data_reader_open(argv[0], DATA_READER_DELIMITED, ',', has_header, "csv_reader", "CSV");
+}
 
-    int max_lines = 100000;
+static Value builtin_tsv_reader(int argc, Value *argv) {
+    bool has_header = true;
     if (argc >= 2) {
-        if (argv[1].type != VALUE_NUMBER || floor(argv[1].number) != argv[1].number) {
-            builtin_runtime_error("read_json_lines の第2引数は最大行数を表す整数でなければなりません（実際: %s）",
+        if (argv[1].type != VALUE_BOOL) {
+            builtin_runtime_error("tsv_reader の第2引数はヘッダー有無を表す真偽値でなければなりません（実際: %s）",
                                   value_type_name(argv[1].type));
             return value_null();
         }
-        max_lines = (int)argv[1].number;
-        if (max_lines < 0) {
-            builtin_runtime_error("read_json_lines の最大行数は0以上でなければなりません（実際: %d）", max_lines);
+        has_header = argv[1].boolean;
+    }
+    return data_reader_open(argv[0], DATA_READER_DELIMITED, '\t', has_header, "tsv_reader", "TSV");
+}
+
+static Value builtin_json_lines_reader(int argc, Value *argv) {
+    (void)argc;
+    return data_reader_open(argv[0], DATA_READER_JSON_LINES, 0, false, "json_lines_reader", "JSON Lines");
+}
+
+static Value data_reader_read_batch(DataReader *reader, Value count_arg) {
+    int count = 0;
+    if (!data_reader_count_arg(count_arg, "read_batch", &count)) return value_null();
+
+    Value rows = value_array_with_capacity(count < 1024 ? count : 1024);
+    while (rows.array.length < count) {
+        Value item = value_null();
+        int status;
+        if (reader->kind == DATA_READER_JSON_LINES) {
+            status = data_reader_next_line(reader);
+            if (status > 0 && !json_decode_checked(reader->lines.line, (int)reader->lines.line_len, &item)) {
+                builtin_runtime_error("JSON Linesの%d行目をJSONとして解析できません", reader->lines.line_no);
+                status = -1;
+            }
+        } else {
+            Value fields = value_null();
+            status = data_reader_next_fields(reader, &fields);
+            if (status > 0 && reader->has_header) {
+                item = value_dict();
+                for (int i = 0; i < fields.array.length; i++) {
+                    Value *key = &reader->headers.array.elements[i];
+                    if (key->type != VALUE_STRING) continue;
+                    dict_set(&item, key->string.data, fields.array.elements[i]);
+                }
+                value_free(&fields);
+            } else if (status > 0) {
+                item = fields;
+            }
+        }
+        if (status < 0) {
+            value_free(&rows);
             return value_null();
         }
+        if (status == 0) break;
+        array_push(&rows, item);
+        value_free(&item);
     }
+    return rows;
+}
 
-    FILE *f = fopen(argv[0].string.data, "r");
-    if (f == NULL) {
-        builtin_runtime_error("JSON Linesファイルを読み込めません: %s", argv[0].string.data);
+static Value builtin_read_batch(int argc, Value *argv) {
+    (void)argc;
+    DataReader *reader = data_reader_find(argv[0], "read_batch");
+    if (reader == NULL) return value_null();
+    Value rows = data_reader_read_batch(reader, argv[1]);
+    data_reader_unpin(reader);
+    return rows;
+}
+
+static Value data_reader_read_numeric_block(DataReader *reader, int argc, Value *argv) {
+    int count = 0;
+    if (!data_reader_count_arg(argv[1], "read_numeric_block", &count)) return value_null();
+    if (reader->kind != DATA_READER_DELIMITED) {
+        builtin_runtime_error("read_numeric_block は CSVリーダー または TSVリーダー で開いたリーダーにだけ使えます");
         return value_null();
     }
 
-    Value rows = value_array();
-    char line[8192];
-    int line_no = 0;
-    int parsed_lines = 0;
-
-    while (fgets(line, sizeof(line), f) != NULL) {
-        line_no++;
-        size_t line_len = strlen(line);
-        if (line_len == sizeof(line) - 1 && line[line_len - 1] != '\n') {
-            value_free(&rows);
-            fclose(f);
-            builtin_runtime_error("JSON Linesの%d行目が長すぎます。1行は8191バイト以内にしてください", line_no);
+    NumericTextLoad load = { .delimiter = reader->delimiter, .missing = NUMERIC_MISSING_ERROR };
+    if (argc >= 3) {
+        if (argv[2].type != VALUE_STRING) {
+            builtin_runtime_error("read_numeric_block の第3引数は missing mode 文字列でなければなりません（実際: %s）",
+                                  value_type_name(argv[2].type));
             return value_null();
         }
-        if (is_blank_csv_line(line)) continue;
-
-        if (parsed_lines >= max_lines) {
-            value_free(&rows);
-            fclose(f);
-            builtin_runtime_error("JSON Linesの読み込み行数が上限を超えました（上限: %d行）。第2引数で上限を調整できます",
-                                  max_lines);
+        if (strcmp(argv[2].string.data, "nan") == 0) {
+            load.missing = NUMERIC_MISSING_NAN;
+        } else if (strcmp(argv[2].string.data, "zero") == 0) {
+            load.missing = NUMERIC_MISSING_ZERO;
+        } else if (strcmp(argv[2].string.data, "error") != 0) {
+            builtin_runtime_error("read_numeric_block の missing mode は \"error\" / \"nan\" / \"zero\" のいずれかです（実際: %s）",
+                                  argv[2].string.data);
             return value_null();
         }
+    }
 
-        Value item = value_null();
-        if (!json_decode_checked(line, (int)line_len, &item)) {
-            value_free(&rows);
-            fclose(f);
-            builtin_runtime_error("JSON Linesの%d行目をJSONとして解析できません", line_no);
+    int rows = 0;
+    while (rows < count) {
+        int status = data_reader_next_line(reader);
+        if (status < 0) return value_null();
+        if (status == 0) break;
+
+        const char *line = reader->lines.line;
+        const char *line_end = line + reader->lines.line_len;
+        int line_no = reader->lines.line_no;
+        if (reader->has_header && !reader->header_seen) {
+            Value headers = value_null();
+            if (!parse_text_delimited_fields(line, reader->delimiter, &headers, reader->label, line_no)) {
+                return value_null();
+            }
+            reader->headers = headers;
+            reader->header_seen = true;
+            reader->expected_cols = headers.array.length;
+            continue;
+        }
+        if (reader->expected_cols < 0) {
+            NumericTextChunk probe = {0};
+            if (numeric_text_parse_line(&load, line, line_end, NULL, line_no, &reader->expected_cols, &probe) !=
+                NUMERIC_TEXT_OK) {
+                builtin_runtime_error("%s の%d行目に閉じていない引用符があります", reader->label, line_no);
+                return value_null();
+            }
+        }
+        load.cols = reader->expected_cols;
+        load.out_cols = reader->expected_cols;
+
+        size_t needed = (size_t)(rows + 1) * (size_t)load.cols;
+        if (needed > reader->numeric_capacity) {
+            size_t capacity = reader->numeric_capacity > 0 ? reader->numeric_capacity : (size_t)load.cols * 64;
+            while (capacity < needed) capacity *= 2;
+            double *buffer = realloc(reader->numeric_buffer, sizeof(double) * capacity);
+            if (buffer == NULL) {
+                builtin_runtime_error("%s の数値ブロックを確保できませんでした", reader->label);
+                return value_null();
+            }
+            reader->numeric_buffer = buffer;
+            reader->numeric_capacity = capacity;
+        }
+
+        NumericTextChunk chunk = {0};
+        int fields = 0;
+        double *row = reader->numeric_buffer + (size_t)rows * (size_t)load.cols;
+        if (numeric_text_parse_line(&load, line, line_end, row, line_no, &fields, &chunk) != NUMERIC_TEXT_OK) {
+            switch (chunk.status) {
+                case NUMERIC_TEXT_UNCLOSED_QUOTE:
+                    builtin_runtime_error("%s の%d行目に閉じていない引用符があります", reader->label, line_no);
+                    break;
+                case NUMERIC_TEXT_MISSING:
+                    builtin_runtime_error("%sの%d行%d列目に欠損値があります。第3引数に \"nan\" または \"zero\" を指定すると読み込めます",
+                                          reader->label, line_no, chunk.error_col);
+                    break;
+                case NUMERIC_TEXT_NOT_NUMBER:
+                    builtin_runtime_error("%sの%d行%d列目を数値として読めません: %s",
+                                          reader->label, line_no, chunk.error_col, chunk.error_token);
+                    break;
+                case NUMERIC_TEXT_COLUMN_COUNT:
+                    builtin_runtime_error("%sの列数が一致しません（期待: %d列, %d行目: %d列）",
+                                          reader->label, load.cols, line_no, fields);
+                    break;
+                default:
+                    builtin_runtime_error("%sデータのメモリ確保に失敗しました", reader->label);
+                    break;
+            }
             return value_null();
         }
-        array_push(&rows, item);
-        value_free(&item);
-        parsed_lines++;
+        rows++;
     }
 
-    fclose(f);
-    return rows;
+    if (rows == 0) return value_matrix(0, reader->expected_cols > 0 ? reader->expected_cols : 0);
+    return value_matrix_from_data(reader->numeric_buffer, rows, reader->expected_cols);
+}
+
+static Value builtin_read_numeric_block(int argc, Value *argv) {
+    DataReader *reader = data_reader_find(argv[0], "read_numeric_block");
+    if (reader == NULL) return value_null();
+    Value block = data_reader_read_numeric_block(reader, argc, argv);
+    data_reader_unpin(reader);
+    return block;
+}
+
+static Value builtin_reader_close(int argc, Value *argv) {
+    (void)argc;
+    DataReader *reader = data_reader_find(argv[0], "reader_close");
+    if (reader == NULL) return value_bool(false);
+    // 以後の検索からは外し、読み込み中の他スレッドが抜けた時点で解放する
+    pthread_mutex_lock(&g_data_reader_mutex);
+    reader->closing = true;
+    pthread_mutex_unlock(&g_data_reader_mutex);
+    data_reader_unpin(reader);
+    return value_bool(true);
 }
 
 static Value describe_numeric_buffer(const double *data, int length) {
@@ -8236,6 +11898,28 @@ static Value builtin_reverse(int argc, Value *argv) {
 }
 
 static Value builtin_slice(int argc, Value *argv) {
+    if (argv[0].type == VALUE_BYTES && argv[1].type == VALUE_NUMBER) {
+        // バイト列も複製せず同じバッファの view を返す
+        int end = argv[0].bytes.length;
+        if (argc >= 3 && argv[2].type == VALUE_NUMBER) {
+            end = (int)argv[2].number;
+        }
+        return bytes_slice(&argv[0], (int)argv[1].number, end);
+    }
+    if (argv[0].type == VALUE_NUMERIC_ARRAY && argv[1].type == VALUE_NUMBER) {
+        // 数値ベクトルはコピーせず共有バッファの view を返す
+        int length = argv[0].numeric_array.length;
+        int start = (int)argv[1].number;
+        int end = length;
+        if (argc >= 3 && argv[2].type == VALUE_NUMBER) {
+            end = (int)argv[2].number;
+        }
+        if (start < 0) start = 0;
+        if (end > length) end = length;
+        if (start >= end) return value_numeric_array_with_dtype(0, argv[0].numeric_array.dtype);
+        return numeric_array_view(&argv[0], start, end - start, 1);
+    }
+
     if (argv[0].type != VALUE_ARRAY || argv[1].type != VALUE_NUMBER) {
         return value_array();
     }
@@ -8410,9 +12094,14 @@ static Value call_function_value(Value *func, Value *args, int argc) {
     Environment *prev = g_eval->current;
     g_eval->current = local;
     
+    FunctionProfileFrame profile_frame;
+    function_profile_enter(g_eval, def, def->type == NODE_LAMBDA ? "無名関数" : def->function.name,
+                           &profile_frame);
     Value result = evaluate(g_eval, body);
+    function_profile_leave(g_eval, &profile_frame);
     
     if (g_eval->returning) {
+        value_free(&result);
         result = g_eval->return_value;
         g_eval->returning = false;
     }
@@ -8502,19 +12191,176 @@ static Value builtin_foreach(int argc, Value *argv) {
 // 正規表現関数
 // =============================================================================
 
+// 文字列パターンはコンパイル済みの regex_t を LRU キャッシュに残し、
+// 同じパターンを繰り返し使うループで regcomp を呼び直さないようにする。
+// キャッシュはスレッド間で共有し、取り出したハンドルは参照を取ってから使う
+// （使用中に追い出されても呼び出し側の参照で生き続ける）。
+#define REGEX_CACHE_SIZE 64
+#define REGEX_MAX_GROUPS 10
+
+typedef struct {
+    RegexHandle *handle;
+    uint32_t hash;
+    int cflags;
+    uint64_t last_used;
+} RegexCacheEntry;
+
+static RegexCacheEntry g_regex_cache[REGEX_CACHE_SIZE];
+static uint64_t g_regex_cache_clock = 0;
+static pthread_mutex_t g_regex_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void regex_compiled_destroy(void *compiled) {
+    if (compiled == NULL) return;
+    regfree((regex_t *)compiled);
+    free(compiled);
+}
+
+// フラグ文字列を regcomp のフラグへ変換する（i: 大文字小文字を無視、m: 複数行）
+static bool regex_parse_flags(const char *text, int *cflags) {
+    *cflags = REG_EXTENDED;
+    for (const char *p = text; *p; p++) {
+        switch (*p) {
+            case 'i': *cflags |= REG_ICASE; break;
+            case 'm': *cflags |= REG_NEWLINE; break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+// パターンをコンパイルして参照 1 の共有状態を返す。失敗時は NULL で error に理由を書く
+static RegexHandle *regex_handle_compile(const char *pattern, const char *flags, int cflags,
+                                         char *error, size_t error_size) {
+    regex_t *compiled = malloc(sizeof(regex_t));
+    RegexHandle *handle = calloc(1, sizeof(RegexHandle));
+    char *pattern_copy = strdup(pattern);
+    if (compiled == NULL || handle == NULL || pattern_copy == NULL) {
+        free(compiled);
+        free(handle);
+        free(pattern_copy);
+        if (error != NULL) snprintf(error, error_size, "メモリ不足");
+        return NULL;
+    }
+    int ret = regcomp(compiled, pattern, cflags);
+    if (ret != 0) {
+        if (error != NULL) regerror(ret, compiled, error, error_size);
+        free(compiled);
+        free(handle);
+        free(pattern_copy);
+        return NULL;
+    }
+    handle->compiled = compiled;
+    handle->pattern = pattern_copy;
+    snprintf(handle->flags, sizeof(handle->flags), "%s", flags);
+    handle->ref_count = 1;
+    handle->destroy = regex_compiled_destroy;
+    return handle;
+}
+
+// キャッシュから取り出す（なければコンパイルして登録）。呼び出し側が参照を 1 つ持つ
+static RegexHandle *regex_cache_acquire(const char *pattern, int length) {
+    uint32_t hash = unique_hash_bytes(pattern, length);
+    int cflags = REG_EXTENDED;
+
+    pthread_mutex_lock(&g_regex_cache_mutex);
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        RegexCacheEntry *entry = &g_regex_cache[i];
+        if (entry->handle != NULL && entry->hash == hash && entry->cflags == cflags &&
+            strcmp(entry->handle->pattern, pattern) == 0) {
+            entry->last_used = ++g_regex_cache_clock;
+            regex_handle_retain(entry->handle);
+            RegexHandle *handle = entry->handle;
+            pthread_mutex_unlock(&g_regex_cache_mutex);
+            return handle;
+        }
+    }
+    pthread_mutex_unlock(&g_regex_cache_mutex);
+
+    // regcomp はロックの外で行う（同じパターンを同時にコンパイルしても害はない）
+    RegexHandle *handle = regex_handle_compile(pattern, "", cflags, NULL, 0);
+    if (handle == NULL) return NULL;
+
+    pthread_mutex_lock(&g_regex_cache_mutex);
+    RegexCacheEntry *victim = &g_regex_cache[0];
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        RegexCacheEntry *entry = &g_regex_cache[i];
+        if (entry->handle == NULL) {
+            victim = entry;
+            break;
+        }
+        if (entry->last_used < victim->last_used) victim = entry;
+    }
+    RegexHandle *evicted = victim->handle;
+    victim->handle = handle;
+    victim->hash = hash;
+    victim->cflags = cflags;
+    victim->last_used = ++g_regex_cache_clock;
+    regex_handle_retain(handle);
+    pthread_mutex_unlock(&g_regex_cache_mutex);
+
+    regex_handle_release(evicted);
+    return handle;
+}
+
+// パターン引数（文字列または正規表現値）から使用する正規表現を得る
+static RegexHandle *regex_arg_acquire(Value *arg) {
+    if (arg->type == VALUE_REGEX) {
+        regex_handle_retain(arg->regex.handle);
+        return arg->regex.handle;
+    }
+    if (arg->type == VALUE_STRING) {
+        return regex_cache_acquire(arg->string.data, arg->string.byte_length);
+    }
+    return NULL;
+}
+
+static bool is_regex_pattern_arg(Value v) {
+    return v.type == VALUE_STRING || v.type == VALUE_REGEX;
+}
+
+// 正規表現: パターンを一度だけコンパイルした正規表現値を返す
+static Value builtin_regex_compile(int argc, Value *argv) {
+    if (argv[0].type != VALUE_STRING) {
+        builtin_runtime_error("正規表現のパターンには文字列を指定してください");
+        return value_null();
+    }
+    const char *flags = "";
+    if (argc >= 2) {
+        if (argv[1].type != VALUE_STRING) {
+            builtin_runtime_error("正規表現のフラグには文字列を指定してください（\"i\" / \"m\"）");
+            return value_null();
+        }
+        flags = argv[1].string.data;
+    }
+    int cflags;
+    if (!regex_parse_flags(flags, &cflags) || strlen(flags) >= sizeof(((RegexHandle *)0)->flags)) {
+        builtin_runtime_error("正規表現のフラグが不正です: %s（\"i\" / \"m\" を指定できます）", flags);
+        return value_null();
+    }
+
+    char error[256];
+    RegexHandle *handle = regex_handle_compile(argv[0].string.data, flags, cflags, error, sizeof(error));
+    if (handle == NULL) {
+        builtin_runtime_error("正規表現をコンパイルできません: %s（%s）", argv[0].string.data, error);
+        return value_null();
+    }
+    Value result = value_regex(handle);
+    regex_handle_release(handle);
+    return result;
+}
+
 // 正規一致: 文字列が正規表現パターンに完全一致するか
 static Value builtin_regex_match(int argc, Value *argv) {
     (void)argc;
-    if (argv[0].type != VALUE_STRING || argv[1].type != VALUE_STRING) {
+    if (argv[0].type != VALUE_STRING || !is_regex_pattern_arg(argv[1])) {
         return value_bool(false);
     }
     
-    regex_t regex;
-    int ret = regcomp(&regex, argv[1].string.data, REG_EXTENDED | REG_NOSUB);
-    if (ret != 0) return value_bool(false);
+    RegexHandle *regex = regex_arg_acquire(&argv[1]);
+    if (regex == NULL) return value_bool(false);
     
-    ret = regexec(&regex, argv[0].string.data, 0, NULL, 0);
-    regfree(&regex);
+    int ret = regexec(regex->compiled, argv[0].string.data, 0, NULL, 0);
+    regex_handle_release(regex);
     
     return value_bool(ret == 0);
 }
@@ -8522,53 +12368,74 @@ static Value builtin_regex_match(int argc, Value *argv) {
 // 正規検索: 文字列から正規表現にマッチする部分を検索
 static Value builtin_regex_search(int argc, Value *argv) {
     (void)argc;
-    if (argv[0].type != VALUE_STRING || argv[1].type != VALUE_STRING) {
+    if (argv[0].type != VALUE_STRING || !is_regex_pattern_arg(argv[1])) {
         return value_null();
     }
     
-    regex_t regex;
-    int ret = regcomp(&regex, argv[1].string.data, REG_EXTENDED);
-    if (ret != 0) return value_null();
+    RegexHandle *regex = regex_arg_acquire(&argv[1]);
+    if (regex == NULL) return value_null();
     
-    regmatch_t matches[10];
-    ret = regexec(&regex, argv[0].string.data, 10, matches, 0);
+    regmatch_t matches[REGEX_MAX_GROUPS];
+    int ret = regexec(regex->compiled, argv[0].string.data, REGEX_MAX_GROUPS, matches, 0);
+    regex_handle_release(regex);
     
     if (ret != 0) {
-        regfree(&regex);
         return value_null();
     }
     
     // マッチした部分文字列の配列を返す
     Value result = value_array();
     
-    for (int i = 0; i < 10 && matches[i].rm_so != -1; i++) {
+    for (int i = 0; i < REGEX_MAX_GROUPS && matches[i].rm_so != -1; i++) {
         int start = matches[i].rm_so;
-        int end = matches[i].rm_eo;
-        int len = end - start;
-        
-        char *match_str = malloc(len + 1);
-        memcpy(match_str, argv[0].string.data + start, len);
-        match_str[len] = '\0';
-        
-        array_push(&result, value_string(match_str));
-        free(match_str);
+        int len = matches[i].rm_eo - start;
+        array_push(&result, value_string_n(argv[0].string.data + start, len));
+    }
+    
+    return result;
+}
+
+// 正規全検索: 重ならないすべてのマッチ部分を 1 回の走査で配列にして返す
+static Value builtin_regex_find_all(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING || !is_regex_pattern_arg(argv[1])) {
+        return value_null();
+    }
+    
+    RegexHandle *regex = regex_arg_acquire(&argv[1]);
+    if (regex == NULL) return value_null();
+    
+    Value result = value_array();
+    const char *text = argv[0].string.data;
+    const char *end = text + argv[0].string.byte_length;
+    const char *p = text;
+    regmatch_t match;
+    
+    while (p <= end && regexec(regex->compiled, p, 1, &match, p == text ? 0 : REG_NOTBOL) == 0) {
+        array_push(&result, value_string_n(p + match.rm_so, (int)(match.rm_eo - match.rm_so)));
+        if (match.rm_eo > match.rm_so) {
+            p += match.rm_eo;
+        } else {
+            // 空マッチは 1 文字（UTF-8 の 1 コードポイント）進めて無限ループを避ける
+            if (p + match.rm_eo >= end) break;
+            p += match.rm_eo + utf8_char_length((unsigned char)p[match.rm_eo]);
+        }
     }
     
-    regfree(&regex);
+    regex_handle_release(regex);
     return result;
 }
 
 // 正規置換: 正規表現パターンにマッチする部分を置換
 static Value builtin_regex_replace(int argc, Value *argv) {
     (void)argc;
-    if (argv[0].type != VALUE_STRING || argv[1].type != VALUE_STRING ||
+    if (argv[0].type != VALUE_STRING || !is_regex_pattern_arg(argv[1]) ||
         argv[2].type != VALUE_STRING) {
         return value_null();
     }
     
-    regex_t regex;
-    int ret = regcomp(&regex, argv[1].string.data, REG_EXTENDED);
-    if (ret != 0) return value_copy(argv[0]);
+    RegexHandle *regex = regex_arg_acquire(&argv[1]);
+    if (regex == NULL) return value_copy(argv[0]);
     
     const char *src = argv[0].string.data;
     const char *replacement = argv[2].string.data;
@@ -8581,11 +12448,11 @@ static Value builtin_regex_replace(int argc, Value *argv) {
     
     regmatch_t match;
     
-    while (*src && regexec(&regex, src, 1, &match, 0) == 0) {
+    while (*src && regexec(regex->compiled, src, 1, &match, 0) == 0) {
         // マッチ前の部分をコピー
         int prefix_len = match.rm_so;
         while (buf_len + prefix_len + rep_len + 1 >= buf_capacity) {
-            ARRAY_GROW(buf, buf_len + prefix_len + rep_len + 1, buf_capacity, char, free(buf); regfree(&regex); return value_string(""));
+            ARRAY_GROW(buf, buf_len + prefix_len + rep_len + 1, buf_capacity, char, free(buf); regex_handle_release(regex); return value_string(""));
         }
         memcpy(buf + buf_len, src, prefix_len);
         buf_len += prefix_len;
@@ -8608,15 +12475,15 @@ static Value builtin_regex_replace(int argc, Value *argv) {
     // 残りの部分をコピー
     int remaining = strlen(src);
     while (buf_len + remaining + 1 >= buf_capacity) {
-        ARRAY_GROW(buf, buf_len + remaining + 1, buf_capacity, char, free(buf); regfree(&regex); return value_string(""));
+        ARRAY_GROW(buf, buf_len + remaining + 1, buf_capacity, char, free(buf); regex_handle_release(regex); return value_string(""));
     }
     memcpy(buf + buf_len, src, remaining);
     buf_len += remaining;
     buf[buf_len] = '\0';
     
-    Value result = value_string(buf);
+    Value result = value_string_n(buf, buf_len);
     free(buf);
-    regfree(&regex);
+    regex_handle_release(regex);
     
     return result;
 }
@@ -8819,6 +12686,124 @@ static Value builtin_extension(int argc, Value *argv) {
     return value_string("");
 }
 
+// =============================================================================
+// バイト列関数
+// =============================================================================
+
+// バイト列: 文字列・0〜255 の整数配列・長さ（ゼロ埋め）からバイト列を作る
+static Value builtin_bytes(int argc, Value *argv) {
+    (void)argc;
+    switch (argv[0].type) {
+        case VALUE_BYTES:
+            return value_copy(argv[0]);
+        case VALUE_STRING:
+            return value_bytes(argv[0].string.data, argv[0].string.byte_length);
+        case VALUE_NUMBER: {
+            if (!argv[0].is_integer || argv[0].number < 0 || argv[0].number > INT_MAX) {
+                builtin_runtime_error("バイト列 の長さは 0 以上の整数で指定してください");
+                return value_null();
+            }
+            uint8_t *out = NULL;
+            Value result = value_bytes_alloc((int)argv[0].number, &out);
+            if (out != NULL) memset(out, 0, (size_t)argv[0].number);
+            return result;
+        }
+        case VALUE_ARRAY: {
+            uint8_t *out = NULL;
+            Value result = value_bytes_alloc(argv[0].array.length, &out);
+            if (result.type != VALUE_BYTES) return result;
+            for (int i = 0; i < argv[0].array.length; i++) {
+                Value item = argv[0].array.elements[i];
+                if (item.type != VALUE_NUMBER || !item.is_integer || item.number < 0 || item.number > 255) {
+                    value_free(&result);
+                    builtin_runtime_error("バイト列 の配列要素は 0〜255 の整数で指定してください（%d 番目）", i);
+                    return value_null();
+                }
+                out[i] = (uint8_t)item.number;
+            }
+            return result;
+        }
+        default:
+            builtin_runtime_error("バイト列 には文字列・整数配列・長さを渡してください（実際: %s）",
+                                  value_runtime_type_name(argv[0]));
+            return value_null();
+    }
+}
+
+// バイト文字列化: UTF-8 として正しければ文字列に変換（不正なら無）
+static Value builtin_bytes_to_string(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_BYTES) return value_null();
+    return bytes_to_string(&argv[0]);
+}
+
+// バイトファイル読込: ファイル全体をバイト列として返す（mmap して複製しない）
+static Value builtin_read_file_bytes(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING) return value_null();
+
+    MappedTextFile file;
+    if (!mapped_text_open(argv[0].string.data, &file)) return value_null();
+    if (file.size > INT_MAX) {
+        mapped_text_close(&file);
+        builtin_runtime_error("ファイルが大きすぎます（%zu バイト）: %s", file.size, argv[0].string.data);
+        return value_null();
+    }
+    if (file.mapping == NULL) {
+        return value_bytes(NULL, 0);
+    }
+    return value_bytes_mapped(file.mapping, file.mapping_size, 0, (int)file.size);
+}
+
+// バイトファイル書込: バイト列（または文字列）をそのまま書き出す
+static Value builtin_write_file_bytes(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING) return value_bool(false);
+
+    const void *data;
+    size_t length;
+    if (argv[1].type == VALUE_BYTES) {
+        data = bytes_data(&argv[1]);
+        length = (size_t)argv[1].bytes.length;
+    } else if (argv[1].type == VALUE_STRING) {
+        data = argv[1].string.data;
+        length = (size_t)argv[1].string.byte_length;
+    } else {
+        return value_bool(false);
+    }
+
+    FILE *fp = fopen(argv[0].string.data, "wb");
+    if (fp == NULL) return value_bool(false);
+    bool ok = length == 0 || fwrite(data, 1, length, fp) == length;
+    ok = fclose(fp) == 0 && ok;
+    return value_bool(ok);
+}
+
+// バイト読込: ハンドルから最大 n バイトをバイト列へ直接読み込む（EOF なら無）
+static Value builtin_read_bytes(int argc, Value *argv) {
+    (void)argc;
+    FileHandle *handle = file_handle_arg(argv[0], "バイト読込", true, false);
+    if (handle == NULL) return value_null();
+    if (argv[1].type != VALUE_NUMBER || argv[1].number < 1 || argv[1].number > INT_MAX) {
+        builtin_runtime_error("バイト読込 のサイズは 1 以上の数値で指定してください");
+        return value_null();
+    }
+
+    uint8_t *out = NULL;
+    Value result = value_bytes_alloc((int)argv[1].number, &out);
+    if (result.type != VALUE_BYTES) {
+        builtin_runtime_error("バイト読込 の作業メモリを確保できませんでした");
+        return value_null();
+    }
+    size_t got = fread(out, 1, (size_t)argv[1].number, handle->fp);
+    if (got == 0) {
+        value_free(&result);
+        return value_null();
+    }
+    result.bytes.length = (int)got;
+    return result;
+}
+
 // =============================================================================
 // Base64関数
 // =============================================================================
@@ -8827,10 +12812,17 @@ static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqr
 
 static Value builtin_base64_encode(int argc, Value *argv) {
     (void)argc;
-    if (argv[0].type != VALUE_STRING) return value_null();
-    
-    const unsigned char *input = (const unsigned char *)argv[0].string.data;
-    size_t input_len = strlen((const char *)input);
+    const unsigned char *input;
+    size_t input_len;
+    if (argv[0].type == VALUE_BYTES) {
+        input = bytes_data(&argv[0]);
+        input_len = (size_t)argv[0].bytes.length;
+    } else if (argv[0].type == VALUE_STRING) {
+        input = (const unsigned char *)argv[0].string.data;
+        input_len = (size_t)argv[0].string.byte_length;
+    } else {
+        return value_null();
+    }
     size_t output_len = 4 * ((input_len + 2) / 3);
     char *output = malloc(output_len + 1);
     
@@ -8849,7 +12841,7 @@ static Value builtin_base64_encode(int argc, Value *argv) {
     }
     output[j] = '\0';
     
-    Value result = value_string(output);
+    Value result = value_string_n(output, (int)j);
     free(output);
     return result;
 }
@@ -8863,19 +12855,32 @@ static int base64_decode_char(char c) {
     return -1;
 }
 
+// 文字列を渡すと、結果が UTF-8 として正しければ文字列、そうでなければバイト列を返す。
+// バイト列を渡すと常にバイト列を返す。
 static Value builtin_base64_decode(int argc, Value *argv) {
     (void)argc;
-    if (argv[0].type != VALUE_STRING) return value_null();
-    
-    const char *input = argv[0].string.data;
-    size_t input_len = strlen(input);
-    if (input_len % 4 != 0) return value_string("");
+    const char *input;
+    size_t input_len;
+    bool want_bytes = argv[0].type == VALUE_BYTES;
+    if (want_bytes) {
+        input = (const char *)bytes_data(&argv[0]);
+        input_len = (size_t)argv[0].bytes.length;
+    } else if (argv[0].type == VALUE_STRING) {
+        input = argv[0].string.data;
+        input_len = (size_t)argv[0].string.byte_length;
+    } else {
+        return value_null();
+    }
+    if (input_len % 4 != 0) return want_bytes ? value_bytes(NULL, 0) : value_string("");
     
     size_t output_len = input_len / 4 * 3;
     if (input_len > 0 && input[input_len - 1] == '=') output_len--;
     if (input_len > 1 && input[input_len - 2] == '=') output_len--;
+    if (output_len > INT_MAX) return value_null();
     
-    char *output = malloc(output_len + 1);
+    uint8_t *output = NULL;
+    Value result = value_bytes_alloc((int)output_len, &output);
+    if (result.type != VALUE_BYTES) return value_null();
     size_t j = 0;
     
     for (size_t i = 0; i < input_len; i += 4) {
@@ -8892,10 +12897,11 @@ static Value builtin_base64_decode(int argc, Value *argv) {
         if (j < output_len) output[j++] = (triple >> 8) & 0xFF;
         if (j < output_len) output[j++] = triple & 0xFF;
     }
-    output[j] = '\0';
+    result.bytes.length = (int)j;
     
-    Value result = value_string(output);
-    free(output);
+    if (want_bytes) return result;
+    Value text = bytes_to_string(&result);
+    if (text.type == VALUE_STRING) return text;
     return result;
 }
 
@@ -9069,7 +13075,7 @@ static Value builtin_expect_error(int argc, Value *argv) {
         Environment *saved = g_eval->current;
         g_eval->current = call_env;
         
-        evaluate(g_eval, argv[0].function.definition->function.body);
+        evaluate_discard(g_eval, argv[0].function.definition->function.body);
         
         g_eval->current = saved;
         env_release(call_env);
@@ -9099,8 +13105,9 @@ static Value builtin_test_run(int argc, Value *argv) {
     
     int passed = 0;
     int failed = 0;
+    FILE *out = evaluator_output();
     
-    printf("\n=== テスト実行 ===\n");
+    fprintf(out, "\n=== テスト実行 ===\n");
     
     for (int i = 0; i < g_test_count; i++) {
         // テスト前にリセット
@@ -9115,7 +13122,7 @@ static Value builtin_test_run(int argc, Value *argv) {
             Environment *saved = g_eval->current;
             g_eval->current = test_env;
             
-            evaluate(g_eval, g_tests[i].func.function.definition->function.body);
+            evaluate_discard(g_eval, g_tests[i].func.function.definition->function.body);
             
             if (g_eval->returning) {
                 g_eval->returning = false;
@@ -9134,12 +13141,12 @@ static Value builtin_test_run(int argc, Value *argv) {
         }
         
         if (g_expect_failures == 0 && !test_error) {
-            printf("  ✓ %s\n", g_tests[i].name);
+            fprintf(out, "  ✓ %s\n", g_tests[i].name);
             passed++;
         } else {
-            printf("  ✗ %s\n", g_tests[i].name);
+            fprintf(out, "  ✗ %s\n", g_tests[i].name);
             if (g_expect_msg_len > 0) {
-                printf("%s", g_expect_messages);
+                fprintf(out, "%s", g_expect_messages);
             }
             failed++;
         }
@@ -9149,11 +13156,11 @@ static Value builtin_test_run(int argc, Value *argv) {
         value_free(&g_tests[i].func);
     }
     
-    printf("\nテスト結果: %d/%d 成功", passed, passed + failed);
+    fprintf(out, "\nテスト結果: %d/%d 成功", passed, passed + failed);
     if (failed > 0) {
-        printf(" (%d 失敗)", failed);
+        fprintf(out, " (%d 失敗)", failed);
     }
-    printf("\n");
+    fprintf(out, "\n");
     
     g_test_count = 0;
     
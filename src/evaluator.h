@@ -12,6 +12,7 @@
 #include "environment.h"
 #include "plugin.h"
 #include <stdbool.h>
+#include <stdio.h>
 
 // =============================================================================
 // 定数
@@ -19,6 +20,11 @@
 
 #define MAX_RECURSION_DEPTH 1000
 
+// 処理系のバージョン（--version・はじむバージョン・モジュールキャッシュの互換判定で使う）
+#ifndef HAJIMU_VERSION
+#define HAJIMU_VERSION "1.5.0"
+#endif
+
 // =============================================================================
 // インポートされたモジュール
 // =============================================================================
@@ -39,10 +45,34 @@ typedef struct {
     int line;
     int column;
     long count;
-    double total_ms;
+    int active;         // 評価中の数（再帰時の包括時間の二重計上を防ぐ）
+    double total_ms;    // 包括時間（子ノードを含む）
+    double self_ms;     // 自己時間（子ノードを除く）
     double max_ms;
 } AstProfileEntry;
 
+typedef struct {
+    const ASTNode *definition;
+    const char *name;
+    int line;
+    long calls;
+    int active;         // 実行中の呼び出し数（再帰時の包括時間の二重計上を防ぐ）
+    double total_ms;
+    double self_ms;
+} FunctionProfileEntry;
+
+// プロファイル用索引（ノードポインタ → エントリ番号、開番地法）
+typedef struct {
+    const ASTNode *node;
+    int entry;
+} ProfileIndexSlot;
+
+typedef struct {
+    ProfileIndexSlot *slots;
+    int capacity;
+    int count;
+} ProfileIndex;
+
 // =============================================================================
 // 評価器構造体
 // =============================================================================
@@ -88,12 +118,20 @@ typedef struct {
         int line;
     } call_stack[128];
     int call_stack_depth;
+    int current_line;           // 実行中の文の行（サンプリングプロファイル用）
 
     // AST評価プロファイル
     bool ast_profile_enabled;
     AstProfileEntry *ast_profile_entries;
     int ast_profile_count;
     int ast_profile_capacity;
+    ProfileIndex ast_profile_index;
+    double ast_profile_child_ms;        // 評価中ノードの子に費やした時間
+    FunctionProfileEntry *function_profile_entries;
+    int function_profile_count;
+    int function_profile_capacity;
+    ProfileIndex function_profile_index;
+    double function_profile_child_ms;   // 実行中の関数から呼んだ関数に費やした時間
     
     // インポートされたモジュール
     ImportedModule *imported_modules;
@@ -212,6 +250,26 @@ const char *evaluator_error_message(Evaluator *eval);
  */
 void evaluator_clear_error(Evaluator *eval);
 
+/**
+ * 表示・テスト結果などスクリプトの出力先を切り替える（NULL で stdout に戻す）
+ * @param out 出力先ストリーム
+ */
+void evaluator_set_output(FILE *out);
+
+/**
+ * 現在のスクリプト出力先（未設定なら stdout）
+ */
+FILE *evaluator_output(void);
+
+/**
+ * プログラムの AST とソースの寿命を評価器に預ける（evaluator_free で解放）。
+ * 定義した関数・クラスは AST を参照し続けるため、評価後も残す必要がある
+ * @param eval 評価器
+ * @param source ソース（NULL 可）
+ * @param program プログラムAST
+ */
+void evaluator_retain_program(Evaluator *eval, char *source, ASTNode *program);
+
 /**
  * デバッグモードを設定
  * @param eval 評価器
@@ -229,6 +287,26 @@ void evaluator_set_ast_profile_enabled(Evaluator *eval, bool enabled);
  */
 void evaluator_print_ast_profile(Evaluator *eval, int limit);
 
+/**
+ * 関数単位の評価プロファイル（関数別時間）を出力する
+ */
+void evaluator_print_function_profile(Evaluator *eval, int limit);
+
+/**
+ * サンプリングプロファイルを開始する（hz 回/秒の SIGPROF で各評価器スレッドの
+ * コールスタックを集計し、停止時に path へ書き出す）。未対応の環境では false を返す。
+ * 停止せずに exit() した場合も atexit で書き出す
+ */
+bool evaluator_start_sample_profile(int hz, const char *path);
+
+/**
+ * サンプリングプロファイルを停止し、flamegraph.pl / speedscope 形式の
+ * collapsed stack を開始時の path に書き出す。書き出したサンプル数（失敗時と
+ * 停止済みの場合は -1）を返す。
+ * 関数名は AST を参照するため、評価器とASTを解放する前に呼ぶこと
+ */
+long evaluator_stop_sample_profile(void);
+
 /**
  * 実行時エラーを報告
  * @param eval 評価器
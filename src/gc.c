@@ -1,6 +1,7 @@
 #include "gc.h"
 #include "environment.h"
 #include "value.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -137,6 +138,7 @@ static void gc_subtract_internal_refs(GC *gc) {
 }
 
 static void gc_mark_env(GC *gc, Environment *env);
+static void gc_untrack_locked(GC *gc, Environment *env);
 
 static void gc_mark_closure(Environment *closure, void *ctx) {
     GC *gc = (GC *)ctx;
@@ -148,6 +150,8 @@ static void gc_mark_env(GC *gc, Environment *env) {
     if (env->gc_node.gc_marked) return;
 
     env->gc_node.gc_marked = true;
+    // 到達可能な子スコープの親も生きている
+    gc_mark_env(gc, env->parent);
     for (int i = 0; i < ENV_HASH_SIZE; i++) {
         EnvEntry *entry = env->table[i];
         while (entry != NULL) {
@@ -166,11 +170,20 @@ static void gc_mark_reachable(GC *gc) {
     }
 }
 
-static int gc_sweep(GC *gc) {
+// 到達不能な環境を解放する。生き残る親への参照は g_gc_mutex を持ったまま
+// env_release できないので *parents に集め、gc_collect がロックを外してから返す
+static int gc_sweep(GC *gc, Environment ***parents, int *parent_count) {
+    *parents = NULL;
+    *parent_count = 0;
     if (gc->tracked_count <= 0) return 0;
 
     Environment **unreachable = malloc(sizeof(Environment *) * (size_t)gc->tracked_count);
     if (unreachable == NULL) return 0;
+    Environment **released = malloc(sizeof(Environment *) * (size_t)gc->tracked_count);
+    if (released == NULL) {
+        free(unreachable);
+        return 0;
+    }
 
     int unreachable_count = 0;
     for (GCNode *node = gc->head.gc_next; node != &gc->head; node = node->gc_next) {
@@ -180,9 +193,18 @@ static int gc_sweep(GC *gc) {
         }
     }
 
+    // 親も回収されるならその親ごと解放するので参照は返さない
+    int released_count = 0;
+    for (int i = 0; i < unreachable_count; i++) {
+        Environment *parent = unreachable[i]->parent;
+        if (parent != NULL && (!gc_is_tracked(gc, parent) || parent->gc_node.gc_marked)) {
+            released[released_count++] = parent;
+        }
+    }
+
     for (int i = 0; i < unreachable_count; i++) {
         Environment *env = unreachable[i];
-        gc_untrack(gc, env);
+        gc_untrack_locked(gc, env);  // g_gc_mutex は gc_collect が持っている
 
         for (int j = 0; j < ENV_HASH_SIZE; j++) {
             EnvEntry *entry = env->table[j];
@@ -199,6 +221,8 @@ static int gc_sweep(GC *gc) {
     }
 
     free(unreachable);
+    *parents = released;
+    *parent_count = released_count;
     return unreachable_count;
 }
 
@@ -277,14 +301,9 @@ void gc_track(GC *gc, Environment *env) {
     pthread_mutex_unlock(&g_gc_mutex);
 }
 
-void gc_untrack(GC *gc, Environment *env) {
-    if (gc == NULL || env == NULL) return;
-
-    pthread_mutex_lock(&g_gc_mutex);
-    if (!gc_is_tracked(gc, env)) {
-        pthread_mutex_unlock(&g_gc_mutex);
-        return;
-    }
+// g_gc_mutex を持った状態でリストから外す（回収中の gc_sweep からも使う）
+static void gc_untrack_locked(GC *gc, Environment *env) {
+    if (!gc_is_tracked(gc, env)) return;
 
     GCNode *node = &env->gc_node;
     node->gc_prev->gc_next = node->gc_next;
@@ -297,26 +316,46 @@ void gc_untrack(GC *gc, Environment *env) {
     if (gc->tracked_count > 0) {
         gc->tracked_count--;
     }
+}
+
+void gc_untrack(GC *gc, Environment *env) {
+    if (gc == NULL || env == NULL) return;
+
+    pthread_mutex_lock(&g_gc_mutex);
+    gc_untrack_locked(gc, env);
     pthread_mutex_unlock(&g_gc_mutex);
 }
 
 int gc_collect(GC *gc) {
     if (gc == NULL) return 0;
 
+    TRACE_BEGIN(trace_start_us);
     pthread_mutex_lock(&g_gc_mutex);
     if (gc->tracked_count <= 0) {
         pthread_mutex_unlock(&g_gc_mutex);
         return 0;
     }
 
+    int tracked = gc->tracked_count;
     gc_update_refs(gc);
     gc_subtract_internal_refs(gc);
     gc_mark_reachable(gc);
 
-    int collected = gc_sweep(gc);
+    Environment **parents = NULL;
+    int parent_count = 0;
+    int collected = gc_sweep(gc, &parents, &parent_count);
     gc->collections++;
     gc->collected += collected;
     pthread_mutex_unlock(&g_gc_mutex);
+    for (int i = 0; i < parent_count; i++) {
+        env_release(parents[i]);
+    }
+    free(parents);
+    if (trace_enabled()) {
+        char detail[64];
+        snprintf(detail, sizeof(detail), "追跡 %d / 回収 %d", tracked, collected);
+        trace_complete("GC", "gc", trace_start_us, detail);
+    }
     return collected;
 }
 
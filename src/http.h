@@ -8,6 +8,7 @@
 #define HTTP_H
 
 #include "value.h"
+#include <stdio.h>
 
 // =============================================================================
 // JSON関数
@@ -18,6 +19,27 @@
  */
 Value json_encode(Value v);
 
+/**
+ * ValueをJSON文字列に変換（indent が NULL 以外なら整形して出力）
+ */
+Value json_encode_indent(Value v, const char *indent);
+
+/**
+ * ValueをJSONとしてファイルへ直接書き出す。
+ * 固定長バッファ経由で書くため、文書全体をメモリに持たない。
+ */
+bool json_encode_to_file(FILE *file, Value v, const char *indent);
+
+/**
+ * ValueをJSONとしてファイル記述子（ソケット等）へ直接書き出す。
+ */
+bool json_encode_to_fd(int fd, Value v, const char *indent);
+
+/**
+ * ValueをJSONとしてファイル記述子へ HTTP chunked 形式で書き出し、終端チャンクまで送る。
+ */
+bool json_encode_chunked_to_fd(int fd, Value v);
+
 /**
  * JSON文字列をValueに変換
  */
@@ -34,12 +56,14 @@ bool json_decode_checked(const char *json, int length, Value *out);
 
 Value builtin_json_encode(int argc, Value *argv);
 Value builtin_json_decode(int argc, Value *argv);
+Value builtin_json_write_file(int argc, Value *argv);
 
 // =============================================================================
 // 組み込み関数（HTTPクライアント）
 // =============================================================================
 
 Value builtin_http_get(int argc, Value *argv);
+Value builtin_http_get_bytes(int argc, Value *argv);
 Value builtin_http_post(int argc, Value *argv);
 Value builtin_http_put(int argc, Value *argv);
 Value builtin_http_delete(int argc, Value *argv);
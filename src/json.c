@@ -0,0 +1,1091 @@
+/**
+ * 日本語プログラミング言語 - JSONモジュール実装
+ *
+ * JSONパーサーとエンコーダー。ネイティブ版と WASM 版で共通に使う
+ */
+
+#include "http.h"
+#include "array_grow.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#  include "win_compat.h"
+#else
+#  include <unistd.h>
+#endif
+
+#define JSON_STRING_INITIAL_CAPACITY 64
+
+// =============================================================================
+// JSON パーサー
+// =============================================================================
+//
+// 1 バイトずつ peek/advance する代わりに、文字列本体と空白の走査は 8 バイト
+// 単位（SWAR）で進めます。配列・オブジェクトの要素はいったん共有の作業
+// スタックへ積み、閉じ括弧の時点で要素数ちょうどの容量を確保して移します。
+// 同じキー列のオブジェクトが続く場合は、覚えておいた形と照合して重複キー
+// 検査を省きます。受理する文法と結果は従来の再帰下降パーサーと同じです。
+
+#define JSON_SHAPE_CACHE_SIZE 8
+#define JSON_SHAPE_MAX_KEYS 32
+#define JSON_STACK_INITIAL_CAPACITY 64
+#define JSON_NUMBER_BUFFER_SIZE 64
+
+#define JSON_SWAR_ONES  0x0101010101010101ULL
+#define JSON_SWAR_HIGHS 0x8080808080808080ULL
+
+// 配列要素（key == NULL）またはオブジェクトのメンバー
+typedef struct {
+    char *key;
+    bool key_plain;    // エスケープを含まないキーか
+    Value value;
+} JsonSlot;
+
+// 直近に解析したオブジェクトのキー列
+typedef struct {
+    char *keys[JSON_SHAPE_MAX_KEYS];
+    int lengths[JSON_SHAPE_MAX_KEYS];
+    int count;
+} JsonShape;
+
+// JSON パーサーの状態
+typedef struct {
+    const char *input;
+    int pos;
+    int length;
+    bool error;
+    JsonSlot *stack;
+    int stack_length;
+    int stack_capacity;
+    JsonShape shapes[JSON_SHAPE_CACHE_SIZE];
+    int shape_count;
+    int shape_next;
+} JsonParser;
+
+static uint64_t json_load_word(const char *p) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// word 内に byte と等しいバイトがあれば非 0
+static uint64_t json_swar_has_byte(uint64_t word, unsigned char byte) {
+    uint64_t x = word ^ (JSON_SWAR_ONES * byte);
+    return (x - JSON_SWAR_ONES) & ~x & JSON_SWAR_HIGHS;
+}
+
+// word 内に limit 未満のバイトがあれば非 0（limit <= 128）
+static uint64_t json_swar_has_less(uint64_t word, unsigned char limit) {
+    return (word - JSON_SWAR_ONES * limit) & ~word & JSON_SWAR_HIGHS;
+}
+
+static void json_skip_whitespace(JsonParser *p) {
+    const char *s = p->input;
+    int pos = p->pos;
+    while (pos < p->length) {
+        char c = s[pos];
+        if (c == ' ') {
+            // 整形済み JSON の字下げは 8 バイトずつ読み飛ばす
+            while (pos + 8 <= p->length && json_load_word(s + pos) == JSON_SWAR_ONES * ' ') {
+                pos += 8;
+            }
+            if (pos < p->length && s[pos] == ' ') pos++;
+        } else if (c == '\t' || c == '\n' || c == '\r') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    p->pos = pos;
+}
+
+static char json_peek(JsonParser *p) {
+    if (p->pos >= p->length) return '\0';
+    return p->input[p->pos];
+}
+
+static bool json_match(JsonParser *p, char expected) {
+    json_skip_whitespace(p);
+    if (p->pos < p->length && p->input[p->pos] == expected) {
+        p->pos++;
+        return true;
+    }
+    return false;
+}
+
+// '"'・'\\'・制御文字のいずれかが最初に現れる位置（無ければ length）
+static int json_scan_string(JsonParser *p, int pos) {
+    const char *s = p->input;
+    while (pos + 8 <= p->length) {
+        uint64_t word = json_load_word(s + pos);
+        if (json_swar_has_byte(word, '"') | json_swar_has_byte(word, '\\') |
+            json_swar_has_less(word, 0x20)) {
+            break;
+        }
+        pos += 8;
+    }
+    while (pos < p->length) {
+        unsigned char c = (unsigned char)s[pos];
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        pos++;
+    }
+    return pos;
+}
+
+static bool json_buffer_reserve(char **buffer, int *capacity, int needed) {
+    if (needed <= *capacity) return true;
+    int new_capacity = *capacity > 0 ? *capacity : JSON_STRING_INITIAL_CAPACITY;
+    while (new_capacity < needed) {
+        if (new_capacity > INT_MAX / 2) return false;
+        new_capacity *= 2;
+    }
+    char *grown = realloc(*buffer, (size_t)new_capacity);
+    if (grown == NULL) return false;
+    *buffer = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static int json_hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// エスケープを含む文字列を復号します。p->pos は開始引用符の直後、
+// special は最初の '\\' または制御文字の位置です。
+static char *json_unescape_string(JsonParser *p, int special, int *out_length) {
+    int capacity = 0;
+    int length = 0;
+    char *buffer = NULL;
+    int pos = p->pos;
+
+    while (1) {
+        int run = special - pos;
+        if (!json_buffer_reserve(&buffer, &capacity, length + run + 4)) goto fail;
+        memcpy(buffer + length, p->input + pos, (size_t)run);
+        length += run;
+        pos = special;
+        if (pos >= p->length) goto fail;
+
+        char c = p->input[pos++];
+        if (c == '"') {
+            buffer[length] = '\0';
+            p->pos = pos;
+            *out_length = length;
+            return buffer;
+        }
+        if (c != '\\') goto fail;   // 生の制御文字
+
+        c = pos < p->length ? p->input[pos++] : '\0';
+        switch (c) {
+            case '"':  buffer[length++] = '"';  break;
+            case '\\': buffer[length++] = '\\'; break;
+            case '/':  buffer[length++] = '/';  break;
+            case 'b':  buffer[length++] = '\b'; break;
+            case 'f':  buffer[length++] = '\f'; break;
+            case 'n':  buffer[length++] = '\n'; break;
+            case 'r':  buffer[length++] = '\r'; break;
+            case 't':  buffer[length++] = '\t'; break;
+            case 'u': {
+                // Unicode escape: \uXXXX
+                unsigned int codepoint = 0;
+                for (int i = 0; i < 4; i++) {
+                    int digit = pos < p->length ? json_hex_value(p->input[pos]) : -1;
+                    if (digit < 0) goto fail;
+                    codepoint = (codepoint << 4) | (unsigned int)digit;
+                    pos++;
+                }
+
+                // UTF-8にエンコード
+                if (codepoint < 0x80) {
+                    buffer[length++] = (char)codepoint;
+                } else if (codepoint < 0x800) {
+                    buffer[length++] = (char)(0xC0 | (codepoint >> 6));
+                    buffer[length++] = (char)(0x80 | (codepoint & 0x3F));
+                } else {
+                    buffer[length++] = (char)(0xE0 | (codepoint >> 12));
+                    buffer[length++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+                    buffer[length++] = (char)(0x80 | (codepoint & 0x3F));
+                }
+                break;
+            }
+            default:
+                goto fail;
+        }
+        special = json_scan_string(p, pos);
+    }
+
+fail:
+    free(buffer);
+    p->error = true;
+    return NULL;
+}
+
+// 文字列を読み、入力内の範囲（*owned == NULL）または復号済みバッファを返す
+static bool json_read_string(JsonParser *p, const char **data, int *length, char **owned) {
+    *owned = NULL;
+    if (p->pos >= p->length || p->input[p->pos] != '"') {
+        p->error = true;
+        return false;
+    }
+    p->pos++;
+
+    int stop = json_scan_string(p, p->pos);
+    if (stop < p->length && p->input[stop] == '"') {
+        *data = p->input + p->pos;
+        *length = stop - p->pos;
+        p->pos = stop + 1;
+        return true;
+    }
+
+    *owned = json_unescape_string(p, stop, length);
+    if (*owned == NULL) return false;
+    *data = *owned;
+    return true;
+}
+
+// 前方宣言
+static Value json_parse_value(JsonParser *p);
+
+static Value json_parse_string(JsonParser *p) {
+    const char *data;
+    int length;
+    char *owned;
+    if (!json_read_string(p, &data, &length, &owned)) return value_null();
+    Value result = value_string_n(data, length);
+    free(owned);
+    return result;
+}
+
+static const double json_exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static Value json_parse_number(JsonParser *p) {
+    const char *s = p->input;
+    int start = p->pos;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool exact = true;
+
+    if (p->pos < p->length && s[p->pos] == '-') {
+        negative = true;
+        p->pos++;
+    }
+
+    int digit_start = p->pos;
+    while (p->pos < p->length && isdigit((unsigned char)s[p->pos])) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(s[p->pos] - '0');
+            if (mantissa != 0) significant++;
+        } else {
+            exact = false;
+        }
+        p->pos++;
+    }
+    if (p->pos == digit_start) {
+        p->error = true;
+        return value_null();
+    }
+    
+    if (p->pos < p->length && s[p->pos] == '.') {
+        p->pos++;
+        int frac_start = p->pos;
+        while (p->pos < p->length && isdigit((unsigned char)s[p->pos])) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(s[p->pos] - '0');
+                if (mantissa != 0) significant++;
+                exponent--;
+            } else {
+                exact = false;
+            }
+            p->pos++;
+        }
+        if (p->pos == frac_start) {
+            p->error = true;
+            return value_null();
+        }
+    }
+    
+    // 指数部
+    if (p->pos < p->length && (s[p->pos] == 'e' || s[p->pos] == 'E')) {
+        p->pos++;
+        bool exp_negative = false;
+        if (p->pos < p->length && (s[p->pos] == '+' || s[p->pos] == '-')) {
+            exp_negative = s[p->pos] == '-';
+            p->pos++;
+        }
+        int exp_start = p->pos;
+        int exp_value = 0;
+        while (p->pos < p->length && isdigit((unsigned char)s[p->pos])) {
+            if (exp_value < 100000) exp_value = exp_value * 10 + (s[p->pos] - '0');
+            p->pos++;
+        }
+        if (p->pos == exp_start) {
+            p->error = true;
+            return value_null();
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    // Clinger の高速経路: 仮数が 2^53 以下で 10 の冪が正確に表せるなら
+    // 1 回の乗除算で正しく丸められた値になる
+    if (exact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        if (exponent >= 0) {
+            value *= json_exact_powers_of_ten[exponent];
+        } else {
+            value /= json_exact_powers_of_ten[-exponent];
+        }
+        return value_number(negative ? -value : value);
+    }
+    if (exact && mantissa == 0) {
+        return value_number(negative ? -0.0 : 0.0);
+    }
+
+    int length = p->pos - start;
+    char stack_buffer[JSON_NUMBER_BUFFER_SIZE];
+    char *numstr = length < JSON_NUMBER_BUFFER_SIZE ? stack_buffer : malloc((size_t)length + 1);
+    if (numstr == NULL) {
+        p->error = true;
+        return value_null();
+    }
+    memcpy(numstr, s + start, (size_t)length);
+    numstr[length] = '\0';
+    double value = strtod(numstr, NULL);
+    if (numstr != stack_buffer) free(numstr);
+    
+    return value_number(value);
+}
+
+static bool json_stack_push(JsonParser *p, char *key, bool key_plain, Value value) {
+    if (p->stack_length >= p->stack_capacity) {
+        int new_capacity = p->stack_capacity > 0 ? p->stack_capacity * 2 : JSON_STACK_INITIAL_CAPACITY;
+        JsonSlot *grown = new_capacity > p->stack_capacity
+            ? realloc(p->stack, sizeof(JsonSlot) * (size_t)new_capacity)
+            : NULL;
+        if (grown == NULL) {
+            free(key);
+            value_free(&value);
+            p->error = true;
+            return false;
+        }
+        p->stack = grown;
+        p->stack_capacity = new_capacity;
+    }
+    JsonSlot *slot = &p->stack[p->stack_length++];
+    slot->key = key;
+    slot->key_plain = key_plain;
+    slot->value = value;
+    return true;
+}
+
+static Value json_parse_array(JsonParser *p) {
+    p->pos++; // '['
+    json_skip_whitespace(p);
+    
+    if (json_peek(p) == ']') {
+        p->pos++;
+        return value_array();
+    }
+    
+    int base = p->stack_length;
+    while (1) {
+        json_skip_whitespace(p);
+        Value elem = json_parse_value(p);
+        if (p->error) return value_null();
+        if (!json_stack_push(p, NULL, true, elem)) return value_null();
+        
+        json_skip_whitespace(p);
+        if (json_peek(p) == ',') {
+            p->pos++;
+        } else {
+            break;
+        }
+    }
+    
+    if (!json_match(p, ']')) {
+        p->error = true;
+        return value_null();
+    }
+    
+    // 要素数ちょうどの配列へ作業スタックから移す
+    int count = p->stack_length - base;
+    Value array = value_array_with_capacity(count);
+    if (array.array.elements == NULL) {
+        p->error = true;
+        return value_null();
+    }
+    for (int i = 0; i < count; i++) {
+        array.array.elements[i] = p->stack[base + i].value;
+    }
+    array.array.length = count;
+    p->stack_length = base;
+    return array;
+}
+
+// 形 shape の先頭 index 個のキーが other と一致するか
+static bool json_shape_prefix_equal(const JsonShape *shape, const JsonShape *other, int index) {
+    if (other->count <= index) return false;
+    for (int i = 0; i < index; i++) {
+        if (shape->lengths[i] != other->lengths[i] ||
+            memcmp(shape->keys[i], other->keys[i], (size_t)shape->lengths[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool json_shape_key_equal(const JsonShape *shape, int index, const char *key, int length) {
+    return index < shape->count && shape->lengths[index] == length &&
+           memcmp(shape->keys[index], key, (size_t)length) == 0;
+}
+
+// index 番目のキーまで一致する形を探す（current は先頭 index 個が一致済み）
+static JsonShape *json_shape_follow(JsonParser *p, JsonShape *current, int index,
+                                    const char *key, int length) {
+    if (current != NULL && json_shape_key_equal(current, index, key, length)) return current;
+    for (int i = 0; i < p->shape_count; i++) {
+        JsonShape *shape = &p->shapes[i];
+        if (shape == current) continue;
+        if (index > 0 && (current == NULL || !json_shape_prefix_equal(current, shape, index))) continue;
+        if (json_shape_key_equal(shape, index, key, length)) return shape;
+    }
+    return NULL;
+}
+
+// 重複の無いことを確認したキー列を覚える
+static void json_shape_remember(JsonParser *p, char **keys, int count) {
+    if (count <= 0 || count > JSON_SHAPE_MAX_KEYS) return;
+
+    JsonShape *shape;
+    if (p->shape_count < JSON_SHAPE_CACHE_SIZE) {
+        shape = &p->shapes[p->shape_count++];
+    } else {
+        shape = &p->shapes[p->shape_next];
+        p->shape_next = (p->shape_next + 1) % JSON_SHAPE_CACHE_SIZE;
+        for (int i = 0; i < shape->count; i++) free(shape->keys[i]);
+    }
+    shape->count = 0;
+    for (int i = 0; i < count; i++) {
+        char *key = strdup(keys[i]);
+        if (key == NULL) break;
+        shape->keys[i] = key;
+        shape->lengths[i] = (int)strlen(key);
+        shape->count++;
+    }
+}
+
+static void json_shapes_free(JsonParser *p) {
+    for (int i = 0; i < p->shape_count; i++) {
+        for (int j = 0; j < p->shapes[i].count; j++) free(p->shapes[i].keys[j]);
+    }
+    p->shape_count = 0;
+}
+
+static Value json_parse_object(JsonParser *p) {
+    p->pos++; // '{'
+    json_skip_whitespace(p);
+    
+    if (json_peek(p) == '}') {
+        p->pos++;
+        return value_dict();
+    }
+    
+    int base = p->stack_length;
+    JsonShape *shape = NULL;
+    bool shape_matches = p->shape_count > 0;
+    while (1) {
+        json_skip_whitespace(p);
+        
+        // キー（文字列）
+        const char *key_data;
+        int key_length;
+        char *key;
+        if (!json_read_string(p, &key_data, &key_length, &key)) return value_null();
+        bool key_plain = key == NULL;
+        if (key_plain) {
+            key = malloc((size_t)key_length + 1);
+            if (key == NULL) {
+                p->error = true;
+                return value_null();
+            }
+            memcpy(key, key_data, (size_t)key_length);
+            key[key_length] = '\0';
+        }
+        if (shape_matches) {
+            int index = p->stack_length - base;
+            shape = key_plain ? json_shape_follow(p, shape, index, key, key_length) : NULL;
+            shape_matches = shape != NULL;
+        }
+
+        if (!json_match(p, ':')) {
+            free(key);
+            p->error = true;
+            return value_null();
+        }
+        json_skip_whitespace(p);
+
+        // 値
+        Value val = json_parse_value(p);
+        if (p->error) {
+            free(key);
+            return value_null();
+        }
+        if (!json_stack_push(p, key, key_plain, val)) return value_null();
+
+        json_skip_whitespace(p);
+        if (json_peek(p) == ',') {
+            p->pos++;
+        } else {
+            break;
+        }
+    }
+    
+    if (!json_match(p, '}')) {
+        p->error = true;
+        return value_null();
+    }
+    
+    // 既知の形と完全に一致すればキーは重複しないので、検索せず追加する。
+    // それ以外は後勝ちの dict_set と同じ規則で挿入する。
+    int count = p->stack_length - base;
+    JsonSlot *slots = &p->stack[base];
+    bool known_shape = shape_matches && shape != NULL && shape->count == count;
+    bool all_plain = true;
+    for (int i = 0; i < count; i++) {
+        if (!slots[i].key_plain) all_plain = false;
+    }
+    Value dict = value_dict_with_capacity(count);
+    if (dict.dict.keys == NULL) {
+        p->error = true;
+        return value_null();
+    }
+    for (int i = 0; i < count; i++) {
+        if (known_shape) {
+            dict_append_owned(&dict, slots[i].key, slots[i].value);
+        } else {
+            dict_set_owned(&dict, slots[i].key, slots[i].value);
+        }
+    }
+    p->stack_length = base;
+    if (!known_shape && all_plain && dict.dict.length == count) {
+        json_shape_remember(p, dict.dict.keys, count);
+    }
+    return dict;
+}
+
+static Value json_parse_value(JsonParser *p) {
+    json_skip_whitespace(p);
+    
+    char c = json_peek(p);
+    
+    if (c == '"') {
+        return json_parse_string(p);
+    } else if (c == '{') {
+        return json_parse_object(p);
+    } else if (c == '[') {
+        return json_parse_array(p);
+    } else if (c == 't') {
+        // true
+        if (p->pos + 4 <= p->length && strncmp(p->input + p->pos, "true", 4) == 0) {
+            p->pos += 4;
+            return value_bool(true);
+        }
+    } else if (c == 'f') {
+        // false
+        if (p->pos + 5 <= p->length && strncmp(p->input + p->pos, "false", 5) == 0) {
+            p->pos += 5;
+            return value_bool(false);
+        }
+    } else if (c == 'n') {
+        // null
+        if (p->pos + 4 <= p->length && strncmp(p->input + p->pos, "null", 4) == 0) {
+            p->pos += 4;
+            return value_null();
+        }
+    } else if (c == '-' || isdigit((unsigned char)c)) {
+        return json_parse_number(p);
+    }
+    
+    p->error = true;
+    return value_null();
+}
+
+// =============================================================================
+// JSON エンコーダー
+// =============================================================================
+//
+// 出力はすべて JsonWriter を通します。メモリへ書く場合は必要に応じて
+// バッファを伸ばし、FILE* やファイル記述子へ書く場合は固定長バッファが
+// 埋まるたびに書き出すので、文書全体をメモリに持ちません。
+
+#define JSON_WRITER_BUFFER_SIZE 65536
+#define JSON_INDENT_MAX 32
+
+typedef struct {
+    char *data;
+    int length;
+    int capacity;
+    FILE *file;          // 書き出し先（NULL ならメモリ）
+    int fd;              // 書き出し先のファイル記述子（-1 なら未使用）
+    bool chunked;        // fd へ HTTP chunked 形式で書く
+    bool failed;
+    const char *indent;  // 整形時の字下げ（NULL なら 1 行で出力）
+    int indent_length;
+    int depth;
+} JsonWriter;
+
+static bool jw_init(JsonWriter *w, FILE *file, int fd, const char *indent) {
+    memset(w, 0, sizeof(*w));
+    w->file = file;
+    w->fd = fd;
+    w->capacity = (file != NULL || fd >= 0) ? JSON_WRITER_BUFFER_SIZE : 128;
+    w->data = malloc((size_t)w->capacity);
+    if (w->data == NULL) {
+        w->capacity = 0;
+        w->failed = true;
+        return false;
+    }
+    w->data[0] = '\0';
+    if (indent != NULL && indent[0] != '\0') {
+        w->indent = indent;
+        w->indent_length = (int)strlen(indent);
+    }
+    return true;
+}
+
+static bool jw_write_fd(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+static void jw_write_out(JsonWriter *w, const char *data, int length) {
+    if (w->failed || length <= 0) return;
+    if (w->file != NULL) {
+        if (fwrite(data, 1, (size_t)length, w->file) != (size_t)length) w->failed = true;
+        return;
+    }
+    if (w->chunked) {
+        char size_line[16];
+        int size_length = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned int)length);
+        if (!jw_write_fd(w->fd, size_line, (size_t)size_length) ||
+            !jw_write_fd(w->fd, data, (size_t)length) ||
+            !jw_write_fd(w->fd, "\r\n", 2)) {
+            w->failed = true;
+        }
+        return;
+    }
+    if (!jw_write_fd(w->fd, data, (size_t)length)) w->failed = true;
+}
+
+static void jw_flush(JsonWriter *w) {
+    if (w->file == NULL && w->fd < 0) return;
+    jw_write_out(w, w->data, w->length);
+    w->length = 0;
+}
+
+static void jw_append(JsonWriter *w, const char *str, int len) {
+    if (w->failed) return;
+    if (w->file == NULL && w->fd < 0) {
+        if (w->length > INT_MAX - len - 1) {
+            w->failed = true;
+            return;
+        }
+        while (w->length + len + 1 >= w->capacity) {
+            ARRAY_GROW(w->data, w->length + len + 1, w->capacity, char, w->failed = true; return);
+        }
+        memcpy(w->data + w->length, str, (size_t)len);
+        w->length += len;
+        w->data[w->length] = '\0';
+        return;
+    }
+
+    if (w->length + len > w->capacity) {
+        jw_flush(w);
+        if (len >= w->capacity) {
+            jw_write_out(w, str, len);
+            return;
+        }
+    }
+    memcpy(w->data + w->length, str, (size_t)len);
+    w->length += len;
+}
+
+static void jw_append_str(JsonWriter *w, const char *str) {
+    jw_append(w, str, (int)strlen(str));
+}
+
+static void jw_append_char(JsonWriter *w, char c) {
+    if (w->length + 2 < w->capacity) {
+        w->data[w->length++] = c;
+        if (w->file == NULL && w->fd < 0) w->data[w->length] = '\0';
+        return;
+    }
+    jw_append(w, &c, 1);
+}
+
+// 整形時は改行と depth 段の字下げを書く
+static void jw_newline(JsonWriter *w) {
+    if (w->indent == NULL) return;
+    jw_append_char(w, '\n');
+    for (int i = 0; i < w->depth; i++) {
+        jw_append(w, w->indent, w->indent_length);
+    }
+}
+
+static const double json_format_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+};
+
+static int json_format_uint(char *out, uint64_t value) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < count; i++) out[i] = digits[count - 1 - i];
+    return count;
+}
+
+// 読み戻すと同じ double になる最短の 10 進表記を書き、長さを返す。
+// 整数と「整数 / 10^k」で正確に表せる値は桁を直接組み立て、それ以外は
+// 有効桁数 15→16→17 の順に strtod で往復を確かめる。非正規化数は有効桁数が
+// 15 桁より少なく、%.15g では余分な桁が付くので 1 桁から探す。
+static int json_format_number(char *out, double value) {
+    if (!isfinite(value)) {
+        memcpy(out, "null", 5);
+        return 4;
+    }
+
+    const double exact_limit = 9007199254740992.0; // 2^53
+    int length = 0;
+    double magnitude = value;
+    if (signbit(value)) {
+        out[length++] = '-';
+        magnitude = -value;
+    }
+
+    if (magnitude < exact_limit && floor(magnitude) == magnitude) {
+        length += json_format_uint(out + length, (uint64_t)magnitude);
+        out[length] = '\0';
+        return length;
+    }
+
+    if (magnitude < exact_limit && magnitude >= 1e-6) {
+        for (int k = 1; k <= 17; k++) {
+            double scaled = nearbyint(magnitude * json_format_powers_of_ten[k]);
+            if (scaled >= exact_limit) break;
+            if (scaled / json_format_powers_of_ten[k] != magnitude) continue;
+
+            char digits[24];
+            int count = json_format_uint(digits, (uint64_t)scaled);
+            if (count <= k) {
+                out[length++] = '0';
+                out[length++] = '.';
+                for (int i = count; i < k; i++) out[length++] = '0';
+                memcpy(out + length, digits, (size_t)count);
+                length += count;
+            } else {
+                memcpy(out + length, digits, (size_t)(count - k));
+                length += count - k;
+                out[length++] = '.';
+                memcpy(out + length, digits + count - k, (size_t)k);
+                length += k;
+            }
+            out[length] = '\0';
+            return length;
+        }
+    }
+
+    for (int precision = magnitude < DBL_MIN ? 1 : 15; precision <= 17; precision++) {
+        length = snprintf(out, 32, "%.*g", precision, value);
+        if (precision == 17 || strtod(out, NULL) == value) break;
+    }
+    return length;
+}
+
+static void json_encode_number(JsonWriter *w, double value) {
+    char buf[32];
+    int length = json_format_number(buf, value);
+    jw_append(w, buf, length);
+}
+
+static void json_encode_value(JsonWriter *w, Value v);
+
+static void json_encode_string(JsonWriter *w, const char *s, int len) {
+    jw_append_char(w, '"');
+
+    // エスケープ不要な連続部分はまとめて書く
+    int run_start = 0;
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        jw_append(w, s + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c) {
+            case '"':  jw_append(w, "\\\"", 2); break;
+            case '\\': jw_append(w, "\\\\", 2); break;
+            case '\b': jw_append(w, "\\b", 2);  break;
+            case '\f': jw_append(w, "\\f", 2);  break;
+            case '\n': jw_append(w, "\\n", 2);  break;
+            case '\r': jw_append(w, "\\r", 2);  break;
+            case '\t': jw_append(w, "\\t", 2);  break;
+            default: {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                jw_append(w, buf, 6);
+                break;
+            }
+        }
+    }
+    jw_append(w, s + run_start, len - run_start);
+
+    jw_append_char(w, '"');
+}
+
+// 配列・辞書の i 番目の要素の前に区切りと改行を書く
+static void json_encode_separator(JsonWriter *w, int index) {
+    if (index > 0) jw_append_char(w, ',');
+    jw_newline(w);
+}
+
+static void json_encode_open(JsonWriter *w, char bracket) {
+    jw_append_char(w, bracket);
+    w->depth++;
+}
+
+static void json_encode_close(JsonWriter *w, char bracket, int count) {
+    w->depth--;
+    if (count > 0) jw_newline(w);
+    jw_append_char(w, bracket);
+}
+
+static void json_encode_value(JsonWriter *w, Value v) {
+    if (w->failed) return;
+    switch (v.type) {
+        case VALUE_NULL:
+            jw_append(w, "null", 4);
+            break;
+            
+        case VALUE_BOOL:
+            jw_append_str(w, v.boolean ? "true" : "false");
+            break;
+            
+        case VALUE_NUMBER:
+            json_encode_number(w, v.number);
+            break;
+        
+        case VALUE_STRING:
+            json_encode_string(w, v.string.data, v.string.byte_length);
+            break;
+            
+        case VALUE_ARRAY:
+            json_encode_open(w, '[');
+            for (int i = 0; i < v.array.length && !w->failed; i++) {
+                json_encode_separator(w, i);
+                json_encode_value(w, v.array.elements[i]);
+            }
+            json_encode_close(w, ']', v.array.length);
+            break;
+
+        case VALUE_NUMERIC_ARRAY:
+            json_encode_open(w, '[');
+            for (int i = 0; i < v.numeric_array.length && !w->failed; i++) {
+                json_encode_separator(w, i);
+                json_encode_number(w, numeric_array_get(&v, i));
+            }
+            json_encode_close(w, ']', v.numeric_array.length);
+            break;
+
+        case VALUE_MATRIX:
+            json_encode_open(w, '[');
+            for (int r = 0; r < v.matrix.rows && !w->failed; r++) {
+                json_encode_separator(w, r);
+                json_encode_open(w, '[');
+                for (int c = 0; c < v.matrix.cols; c++) {
+                    json_encode_separator(w, c);
+                    json_encode_number(w, matrix_get(&v, r, c));
+                }
+                json_encode_close(w, ']', v.matrix.cols);
+            }
+            json_encode_close(w, ']', v.matrix.rows);
+            break;
+            
+        case VALUE_DICT:
+            json_encode_open(w, '{');
+            for (int i = 0; i < v.dict.length && !w->failed; i++) {
+                json_encode_separator(w, i);
+                json_encode_string(w, v.dict.keys[i], (int)strlen(v.dict.keys[i]));
+                if (w->indent != NULL) {
+                    jw_append(w, ": ", 2);
+                } else {
+                    jw_append_char(w, ':');
+                }
+                json_encode_value(w, v.dict.values[i]);
+            }
+            json_encode_close(w, '}', v.dict.length);
+            break;
+            
+        default:
+            jw_append(w, "null", 4);
+            break;
+    }
+}
+
+// 字下げ指定（数値ならその数の空白、文字列ならそのまま）を解釈する。
+// 無・0・空文字列は 1 行で出力する。
+static const char *json_indent_from_value(Value indent, char *spaces) {
+    if (indent.type == VALUE_NUMBER && indent.number >= 1) {
+        int count = indent.number > JSON_INDENT_MAX ? JSON_INDENT_MAX : (int)indent.number;
+        memset(spaces, ' ', (size_t)count);
+        spaces[count] = '\0';
+        return spaces;
+    }
+    if (indent.type == VALUE_STRING && indent.string.byte_length > 0) {
+        return indent.string.data;
+    }
+    return NULL;
+}
+
+// =============================================================================
+// JSON 公開API
+// =============================================================================
+
+Value json_encode_indent(Value v, const char *indent) {
+    JsonWriter w;
+    if (!jw_init(&w, NULL, -1, indent)) return value_null();
+    json_encode_value(&w, v);
+    Value result = w.failed ? value_null() : value_string_n(w.data, w.length);
+    free(w.data);
+    return result;
+}
+
+Value json_encode(Value v) {
+    return json_encode_indent(v, NULL);
+}
+
+bool json_encode_to_file(FILE *file, Value v, const char *indent) {
+    JsonWriter w;
+    if (file == NULL || !jw_init(&w, file, -1, indent)) return false;
+    json_encode_value(&w, v);
+    jw_flush(&w);
+    free(w.data);
+    return !w.failed;
+}
+
+bool json_encode_to_fd(int fd, Value v, const char *indent) {
+    JsonWriter w;
+    if (fd < 0 || !jw_init(&w, NULL, fd, indent)) return false;
+    json_encode_value(&w, v);
+    jw_flush(&w);
+    free(w.data);
+    return !w.failed;
+}
+
+bool json_encode_chunked_to_fd(int fd, Value v) {
+    JsonWriter w;
+    if (fd < 0 || !jw_init(&w, NULL, fd, NULL)) return false;
+    w.chunked = true;
+    json_encode_value(&w, v);
+    jw_flush(&w);
+    free(w.data);
+    return !w.failed && jw_write_fd(fd, "0\r\n\r\n", 5);
+}
+
+bool json_decode_checked(const char *json, int length, Value *out) {
+    JsonParser parser;
+    parser.input = json;
+    parser.pos = 0;
+    parser.length = length;
+    parser.error = false;
+    parser.stack = NULL;
+    parser.stack_length = 0;
+    parser.stack_capacity = 0;
+    parser.shape_count = 0;
+    parser.shape_next = 0;
+    Value result = json_parse_value(&parser);
+    json_skip_whitespace(&parser);
+
+    // エラーで中断した場合は作業スタックに要素が残っている
+    for (int i = 0; i < parser.stack_length; i++) {
+        free(parser.stack[i].key);
+        value_free(&parser.stack[i].value);
+    }
+    free(parser.stack);
+    json_shapes_free(&parser);
+
+    if (parser.error || parser.pos != parser.length) {
+        value_free(&result);
+        if (out != NULL) *out = value_null();
+        return false;
+    }
+    if (out != NULL) {
+        *out = result;
+    } else {
+        value_free(&result);
+    }
+    return true;
+}
+
+Value json_decode(const char *json, int length) {
+    Value result = value_null();
+    if (!json_decode_checked(json, length, &result)) {
+        return value_null();
+    }
+    return result;
+}
+
+// =============================================================================
+// JSON 組み込み関数
+// =============================================================================
+
+Value builtin_json_encode(int argc, Value *argv) {
+    char spaces[JSON_INDENT_MAX + 1];
+    const char *indent = argc >= 2 ? json_indent_from_value(argv[1], spaces) : NULL;
+    return json_encode_indent(argv[0], indent);
+}
+
+// JSONファイル書込(パス, 値 [, 字下げ]) - 文書全体を文字列にせず書き出す
+Value builtin_json_write_file(int argc, Value *argv) {
+    if (argv[0].type != VALUE_STRING) return value_bool(false);
+
+    char spaces[JSON_INDENT_MAX + 1];
+    const char *indent = argc >= 3 ? json_indent_from_value(argv[2], spaces) : NULL;
+    FILE *file = fopen(argv[0].string.data, "wb");
+    if (file == NULL) return value_bool(false);
+
+    bool ok = json_encode_to_file(file, argv[1], indent);
+    if (fclose(file) != 0) ok = false;
+    return value_bool(ok);
+}
+
+Value builtin_json_decode(int argc, Value *argv) {
+    (void)argc;
+    if (argv[0].type != VALUE_STRING) return value_null();
+    return json_decode(argv[0].string.data, argv[0].string.byte_length);
+}
@@ -30,12 +30,16 @@
 #include "evaluator.h"
 #include "package.h"
 #include "bytecode.h"
+#include "mem_profile.h"
+#include "bench.h"
+#include "trace.h"
+#include "module_cache.h"
 
 // =============================================================================
 // バージョン情報
 // =============================================================================
 
-#define VERSION "1.5.0"
+#define VERSION HAJIMU_VERSION
 #define AUTHOR "Reo Shiozawa"
 
 // =============================================================================
@@ -101,7 +105,20 @@ static char *read_program_source(const char *path) {
 // ファイル実行
 // =============================================================================
 
-static int run_file(const char *path, bool debug_mode, bool profile_mode, bool profile_ast_mode, int script_argc, char **script_argv) {
+typedef struct {
+    bool debug_mode;
+    bool profile_mode;
+    bool profile_ast_mode;
+    int profile_sample_hz;              // 0 ならサンプリングしない
+    const char *profile_sample_path;    // collapsed stack の出力先
+    bool profile_mem_mode;
+    const char *trace_path;             // NULL ならトレースしない
+} RunOptions;
+
+static int run_file(const char *path, const RunOptions *options, int script_argc, char **script_argv) {
+    bool debug_mode = options->debug_mode;
+    bool profile_mode = options->profile_mode;
+    bool profile_ast_mode = options->profile_ast_mode;
     double total_start_ms = profile_now_ms();
     double read_start_ms = total_start_ms;
     char *source = read_program_source(path);
@@ -163,9 +180,32 @@ static int run_file(const char *path, bool debug_mode, bool profile_mode, bool p
     if (profile_ast_mode) {
         evaluator_set_ast_profile_enabled(eval, true);
     }
+    if (options->profile_mem_mode) {
+        if (mem_profile_available()) {
+            mem_profile_set_enabled(true);
+        } else {
+            fprintf(stderr, "警告: このビルドはメモリプロファイルに対応していません（make PROFILE_MEM=1 で再ビルドしてください）\n");
+        }
+    }
+    bool tracing = false;
+    if (options->trace_path != NULL) {
+        tracing = trace_start(options->trace_path);
+        if (!tracing) {
+            fprintf(stderr, "警告: トレースを開始できません: %s\n", options->trace_path);
+        }
+    }
+    bool sampling = false;
+    if (options->profile_sample_hz > 0) {
+        sampling = evaluator_start_sample_profile(options->profile_sample_hz, options->profile_sample_path);
+        if (!sampling) {
+            fprintf(stderr, "警告: この環境ではサンプリングプロファイルを開始できません\n");
+        }
+    }
     
     double eval_start_ms = profile_now_ms();
+    TRACE_BEGIN(run_start_us);
     Value result = evaluator_run(eval, program);
+    TRACE_END(run_start_us, "実行", "run", path);
     double eval_end_ms = profile_now_ms();
     (void)result;  // 結果は使用しない
     
@@ -173,6 +213,28 @@ static int run_file(const char *path, bool debug_mode, bool profile_mode, bool p
 
     if (profile_ast_mode) {
         evaluator_print_ast_profile(eval, 20);
+        evaluator_print_function_profile(eval, 20);
+    }
+    if (options->profile_mem_mode) {
+        mem_profile_print(stderr, 20);
+    }
+    if (sampling) {
+        long samples = evaluator_stop_sample_profile();
+        if (samples < 0) {
+            fprintf(stderr, "エラー: プロファイルを書き出せません: %s\n", options->profile_sample_path);
+        } else {
+            fprintf(stderr, "サンプリングプロファイル: %ld サンプルを %s に書き出しました\n",
+                    samples, options->profile_sample_path);
+        }
+    }
+    if (tracing) {
+        long events = trace_stop();
+        if (events < 0) {
+            fprintf(stderr, "エラー: トレースを書き出せません: %s\n", options->trace_path);
+        } else {
+            fprintf(stderr, "トレース: %ld 件の区間を %s に書き出しました\n",
+                    events, options->trace_path);
+        }
     }
     
     // クリーンアップ
@@ -187,6 +249,11 @@ static int run_file(const char *path, bool debug_mode, bool profile_mode, bool p
                 parse_end_ms - parse_start_ms,
                 eval_end_ms - eval_start_ms,
                 profile_now_ms() - total_start_ms);
+        ModuleCacheStats cache = module_cache_stats();
+        if (cache.hits + cache.misses > 0) {
+            fprintf(stderr, "モジュールキャッシュ: 命中 %ld, ミス %ld, 書込 %ld\n",
+                    cache.hits, cache.misses, cache.writes);
+        }
     }
     
     return exit_code;
@@ -466,10 +533,18 @@ static void print_usage(const char *program_name) {
     printf("  -v, --version  バージョン情報を表示\n");
     printf("  -d, --debug    デバッグモードで実行\n");
     printf("  -p, --profile  読み込み・パース・実行時間を表示\n");
-    printf("      --profile-ast  ASTノード単位の評価時間を表示\n");
+    printf("      --profile-ast  ASTノード単位・関数単位の評価時間を表示\n");
+    printf("      --profile-sample=<hz>  毎秒hz回コールスタックを採取し collapsed stack を書き出す\n");
+    printf("      --profile-sample-out=<file>  サンプリング結果の出力先（既定: hajimu.folded）\n");
+    printf("      --profile-mem  値の生成・コピー・解放数を型別・呼び出し位置別に表示（PROFILE_MEM=1 ビルド）\n");
+    printf("      --trace=<file>  非同期タスク・キュー待ち・GC・インポートを Chrome trace JSON に記録\n");
+    printf("      --no-module-cache  取り込んだモジュールのコンパイルキャッシュ（~/.cache/hajimu）を使わない\n");
     printf("  -t, --tokens   トークンを表示\n");
     printf("  -a, --ast      ASTを表示\n");
     printf("\n");
+    printf("ベンチマーク:\n");
+    printf("  %s ベンチ [オプション] [ファイル...]  benchmarks/*.jp を反復実行し統計を表示（bench --help で詳細）\n", program_name);
+    printf("\n");
     printf("バイトコード (.hjp) 操作:\n");
     printf("  %s 構築 <ソース> [出力.hjp]       .jp/.haj/.hajimu をクロスプラットフォーム .hjp にコンパイル\n", program_name);
     printf("  %s 情報 <ファイル.hjp>            .hjp の内容、メタデータを表示\n", program_name);
@@ -746,6 +821,11 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // ベンチマーク: nihongo bench [オプション] [ファイル...]
+    if (argc >= 2 && (strcmp(argv[1], "ベンチ") == 0 || strcmp(argv[1], "bench") == 0)) {
+        return bench_command(argc, argv);
+    }
+
     // 構築コマンド: nihongo 構築 <入力ソース> [出力.hjp]
     if (argc >= 3 && (strcmp(argv[1], "構築") == 0 || strcmp(argv[1], "build") == 0)) {
         const char *out = (argc >= 4) ? argv[3] : NULL;
@@ -771,8 +851,10 @@ int main(int argc, char *argv[]) {
     bool show_help = false;
     bool show_ver = false;
     bool debug_mode = false;
-    bool profile_mode = false;
-    bool profile_ast_mode = false;
+    RunOptions run_options = {
+        .profile_sample_hz = 0,
+        .profile_sample_path = "hajimu.folded",
+    };
     bool show_tok = false;
     bool show_tree = false;
     const char *filename = NULL;
@@ -787,9 +869,29 @@ int main(int argc, char *argv[]) {
         } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--debug") == 0) {
             debug_mode = true;
         } else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--profile") == 0) {
-            profile_mode = true;
+            run_options.profile_mode = true;
         } else if (strcmp(argv[i], "--profile-ast") == 0) {
-            profile_ast_mode = true;
+            run_options.profile_ast_mode = true;
+        } else if (strncmp(argv[i], "--profile-sample=", 17) == 0) {
+            char *end = NULL;
+            long hz = strtol(argv[i] + 17, &end, 10);
+            if (end == argv[i] + 17 || *end != '\0' || hz <= 0 || hz > 10000) {
+                fprintf(stderr, "エラー: --profile-sample には 1〜10000 の頻度(Hz)を指定してください\n");
+                return 1;
+            }
+            run_options.profile_sample_hz = (int)hz;
+        } else if (strncmp(argv[i], "--profile-sample-out=", 21) == 0) {
+            run_options.profile_sample_path = argv[i] + 21;
+        } else if (strcmp(argv[i], "--profile-mem") == 0) {
+            run_options.profile_mem_mode = true;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            if (argv[i][8] == '\0') {
+                fprintf(stderr, "エラー: --trace には出力ファイルを指定してください\n");
+                return 1;
+            }
+            run_options.trace_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--no-module-cache") == 0) {
+            module_cache_set_enabled(false);
         } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tokens") == 0) {
             show_tok = true;
         } else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--ast") == 0) {
@@ -851,7 +953,8 @@ int main(int argc, char *argv[]) {
             script_argc = argc - filename_index - 1;
             script_argv = &argv[filename_index + 1];
         }
-        return run_file(filename, debug_mode, profile_mode, profile_ast_mode, script_argc, script_argv);
+        run_options.debug_mode = debug_mode;
+        return run_file(filename, &run_options, script_argc, script_argv);
     }
     
     // REPLモード
@@ -0,0 +1,76 @@
+/**
+ * 日本語プログラミング言語 - メモリ割り当てプロファイル
+ *
+ * 値の生成・コピー・解放を ValueType 別と AST の呼び出し位置別に数える。
+ * HAJIMU_MEM_PROFILE を定義したビルド（make PROFILE_MEM=1）でのみ有効で、
+ * 定義しなければ各マクロは何も生成しない。
+ */
+
+#ifndef MEM_PROFILE_H
+#define MEM_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "value.h"
+
+#ifdef HAJIMU_MEM_PROFILE
+
+// 実行中の呼び出し位置（スレッドごと）
+typedef struct {
+    const void *key;        // 呼び出しノード
+    const char *name;       // 呼び出し先の名前（AST所有）
+    int line;
+    int column;
+} MemProfileSite;
+
+extern bool g_mem_profile_enabled;
+
+void mem_profile_record_alloc(ValueType type, size_t bytes);
+void mem_profile_record_copy(ValueType type, size_t bytes);
+void mem_profile_record_free(ValueType type, size_t bytes);
+void mem_profile_record_resize(ValueType type, size_t old_bytes, size_t new_bytes);
+MemProfileSite mem_profile_enter_site(const void *key, const char *name, int line, int column);
+void mem_profile_leave_site(MemProfileSite saved);
+
+#define MEM_PROFILE_ALLOC(type, bytes) \
+    do { if (g_mem_profile_enabled) mem_profile_record_alloc((type), (bytes)); } while (0)
+#define MEM_PROFILE_COPY(type, bytes) \
+    do { if (g_mem_profile_enabled) mem_profile_record_copy((type), (bytes)); } while (0)
+#define MEM_PROFILE_FREE(type, bytes) \
+    do { if (g_mem_profile_enabled) mem_profile_record_free((type), (bytes)); } while (0)
+#define MEM_PROFILE_RESIZE(type, old_bytes, new_bytes) \
+    do { if (g_mem_profile_enabled) mem_profile_record_resize((type), (old_bytes), (new_bytes)); } while (0)
+#define MEM_PROFILE_ENTER_SITE(key, name, line, column) \
+    MemProfileSite mem_profile_saved_site = mem_profile_enter_site((key), (name), (line), (column))
+#define MEM_PROFILE_LEAVE_SITE() mem_profile_leave_site(mem_profile_saved_site)
+
+/**
+ * 計測を有効にする（実行前に呼ぶ）
+ */
+void mem_profile_set_enabled(bool enabled);
+
+/**
+ * 型別・呼び出し位置別の集計とピーク使用量・ピークRSSを出力する。
+ * 呼び出し位置の名前は AST を参照するため、AST を解放する前に呼ぶこと
+ */
+void mem_profile_print(FILE *out, int limit);
+
+static inline bool mem_profile_available(void) { return true; }
+
+#else
+
+#define MEM_PROFILE_ALLOC(type, bytes) ((void)0)
+#define MEM_PROFILE_COPY(type, bytes) ((void)0)
+#define MEM_PROFILE_FREE(type, bytes) ((void)0)
+#define MEM_PROFILE_RESIZE(type, old_bytes, new_bytes) ((void)0)
+#define MEM_PROFILE_ENTER_SITE(key, name, line, column) ((void)0)
+#define MEM_PROFILE_LEAVE_SITE() ((void)0)
+
+static inline void mem_profile_set_enabled(bool enabled) { (void)enabled; }
+static inline void mem_profile_print(FILE *out, int limit) { (void)out; (void)limit; }
+static inline bool mem_profile_available(void) { return false; }
+
+#endif
+
+#endif // MEM_PROFILE_H
@@ -0,0 +1,861 @@
+/**
+ * 日本語プログラミング言語 - モジュールのコンパイルキャッシュ実装
+ *
+ * ファイル形式（ネイティブのバイト順。byte_order が一致しなければ使わない）:
+ *   ModuleCacheHeader（72 バイト）
+ *   正規化パス（path_len バイト、終端なし）
+ *   AST（前順走査でノードを並べたもの。payload_size バイト）
+ *
+ * ノードは「タグ(u8: 0 は NULL、それ以外は NodeType + 1)・行(i32)・列(i32)」に
+ * 種別ごとのフィールドが続く。文字列は長さ(u32、NULL は UINT32_MAX)と本体。
+ * 復元はすべて境界チェック付きで、途中で壊れていれば作りかけの AST を捨てて NULL を返す。
+ */
+
+#include "module_cache.h"
+#include "evaluator.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+#  define MODULE_CACHE_SUPPORTED 0    // mmap / 永続ディレクトリがない環境では使わない
+#else
+#  define MODULE_CACHE_SUPPORTED 1
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <limits.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#define MODULE_CACHE_MAGIC        "HJPC"
+#define MODULE_CACHE_FORMAT       2
+#define MODULE_CACHE_BYTE_ORDER   0x01020304u
+#define MODULE_CACHE_MAX_DEPTH    20000    // 復元時の再帰の深さの上限（スタック保護）
+#define MODULE_CACHE_NULL_STRING  UINT32_MAX
+
+// AST・トークン・値の種別が増減したら古いキャッシュは使えない
+#define MODULE_CACHE_LAYOUT \
+    ((uint32_t)NODE_TYPE_COUNT << 20 ^ (uint32_t)TOKEN_COUNT << 8 ^ (uint32_t)VALUE_REGEX)
+
+// ビルドの識別子。Makefile はソース一式のハッシュを渡す（それ以外のビルドではコンパイル日時）
+#ifndef HAJIMU_BUILD_ID
+#define HAJIMU_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    uint32_t abi;
+    uint32_t byte_order;
+    uint32_t path_len;
+    uint32_t reserved;
+    uint64_t file_size;         // ソースファイルの st_size
+    int64_t  file_mtime_ns;     // ソースファイルの mtime（ナノ秒）
+    uint64_t source_size;       // パースしたソースの長さ（.hjp では展開後）
+    uint64_t source_hash;       // パースしたソースの FNV-1a 64bit
+    uint64_t payload_size;
+    uint64_t payload_hash;      // AST 部分の FNV-1a 64bit（途中で切れたファイルの検出用）
+} ModuleCacheHeader;
+
+_Static_assert(sizeof(ModuleCacheHeader) == 72, "キャッシュヘッダーは 72 バイト");
+
+static int g_module_cache_enabled = -1;    // -1: 環境変数をまだ見ていない
+static ModuleCacheStats g_module_cache_stats = {0, 0, 0};
+
+// =============================================================================
+// 有効・無効と統計
+// =============================================================================
+
+void module_cache_set_enabled(bool enabled) {
+    g_module_cache_enabled = enabled ? 1 : 0;
+}
+
+bool module_cache_enabled(void) {
+    if (!MODULE_CACHE_SUPPORTED) return false;
+    if (g_module_cache_enabled < 0) {
+        const char *off = getenv("HAJIMU_NO_MODULE_CACHE");
+        g_module_cache_enabled = (off != NULL && off[0] != '\0' && strcmp(off, "0") != 0) ? 0 : 1;
+    }
+    return g_module_cache_enabled == 1;
+}
+
+ModuleCacheStats module_cache_stats(void) {
+    ModuleCacheStats stats;
+    stats.hits = __atomic_load_n(&g_module_cache_stats.hits, __ATOMIC_RELAXED);
+    stats.misses = __atomic_load_n(&g_module_cache_stats.misses, __ATOMIC_RELAXED);
+    stats.writes = __atomic_load_n(&g_module_cache_stats.writes, __ATOMIC_RELAXED);
+    return stats;
+}
+
+#if MODULE_CACHE_SUPPORTED
+
+static uint64_t module_cache_hash(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t hash = 1469598103934665603ULL;  // FNV-1a 64bit
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 種別の数が同じでもノードの並びやフィールドは変わりうるので、
+// 処理系のバージョンかビルドが違えばキャッシュは使わない
+static uint32_t module_cache_abi(void) {
+    static const char build[] = HAJIMU_VERSION "\n" HAJIMU_BUILD_ID;
+    uint64_t hash = module_cache_hash(build, sizeof(build) - 1);
+    return (uint32_t)(hash ^ hash >> 32) ^ MODULE_CACHE_LAYOUT;
+}
+
+// =============================================================================
+// 書き出し
+// =============================================================================
+
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} CacheWriter;
+
+static void cw_bytes(CacheWriter *w, const void *data, size_t len) {
+    if (w->failed) return;
+    if (w->length + len > w->capacity) {
+        size_t capacity = w->capacity > 0 ? w->capacity : 4096;
+        while (capacity < w->length + len) capacity *= 2;
+        uint8_t *grown = realloc(w->data, capacity);
+        if (grown == NULL) {
+            w->failed = true;
+            return;
+        }
+        w->data = grown;
+        w->capacity = capacity;
+    }
+    memcpy(w->data + w->length, data, len);
+    w->length += len;
+}
+
+static void cw_u8(CacheWriter *w, uint8_t v)   { cw_bytes(w, &v, sizeof(v)); }
+static void cw_u32(CacheWriter *w, uint32_t v) { cw_bytes(w, &v, sizeof(v)); }
+static void cw_i32(CacheWriter *w, int32_t v)  { cw_bytes(w, &v, sizeof(v)); }
+static void cw_f64(CacheWriter *w, double v)   { cw_bytes(w, &v, sizeof(v)); }
+
+static void cw_string(CacheWriter *w, const char *s) {
+    if (s == NULL) {
+        cw_u32(w, MODULE_CACHE_NULL_STRING);
+        return;
+    }
+    size_t len = strlen(s);
+    if (len >= MODULE_CACHE_NULL_STRING) {
+        w->failed = true;
+        return;
+    }
+    cw_u32(w, (uint32_t)len);
+    cw_bytes(w, s, len);
+}
+
+static void cw_node(CacheWriter *w, const ASTNode *node, int depth);
+
+static void cw_nodes(CacheWriter *w, ASTNode *const *nodes, int count, int depth) {
+    cw_u32(w, (uint32_t)count);
+    for (int i = 0; i < count; i++) {
+        cw_node(w, nodes[i], depth);
+    }
+}
+
+static void cw_params(CacheWriter *w, const Parameter *params, int count, int depth) {
+    cw_u32(w, (uint32_t)count);
+    for (int i = 0; i < count; i++) {
+        cw_string(w, params[i].name);
+        cw_i32(w, params[i].type);
+        cw_u8(w, params[i].has_type);
+        cw_u8(w, params[i].is_variadic);
+        cw_node(w, params[i].default_value, depth);
+    }
+}
+
+static void cw_node(CacheWriter *w, const ASTNode *node, int depth) {
+    if (w->failed) return;
+    if (node == NULL) {
+        cw_u8(w, 0);
+        return;
+    }
+    if (depth >= MODULE_CACHE_MAX_DEPTH || node->type < 0 || node->type >= NODE_TYPE_COUNT) {
+        w->failed = true;
+        return;
+    }
+    depth++;
+    cw_u8(w, (uint8_t)(node->type + 1));
+    cw_i32(w, node->location.line);
+    cw_i32(w, node->location.column);
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            cw_f64(w, node->number_value);
+            break;
+        case NODE_BOOL:
+            cw_u8(w, node->bool_value);
+            break;
+        case NODE_NULL:
+        case NODE_BREAK:
+        case NODE_CONTINUE:
+        case NODE_SELF:
+            break;
+        case NODE_STRING:
+        case NODE_IDENTIFIER:
+            cw_string(w, node->string_value);
+            break;
+        case NODE_BINARY:
+            cw_i32(w, node->binary.operator);
+            cw_node(w, node->binary.left, depth);
+            cw_node(w, node->binary.right, depth);
+            break;
+        case NODE_UNARY:
+            cw_i32(w, node->unary.operator);
+            cw_node(w, node->unary.operand, depth);
+            break;
+        case NODE_CALL:
+            cw_node(w, node->call.callee, depth);
+            cw_nodes(w, node->call.arguments, node->call.arg_count, depth);
+            break;
+        case NODE_INDEX:
+            cw_node(w, node->index.array, depth);
+            cw_node(w, node->index.index, depth);
+            break;
+        case NODE_MEMBER:
+            cw_node(w, node->member.object, depth);
+            cw_string(w, node->member.member_name);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+        case NODE_ARRAY:
+            cw_nodes(w, node->block.statements, node->block.count, depth);
+            break;
+        case NODE_DICT:
+            cw_u32(w, (uint32_t)node->dict.count);
+            for (int i = 0; i < node->dict.count; i++) {
+                cw_string(w, node->dict.keys[i]);
+                cw_node(w, node->dict.values[i], depth);
+            }
+            break;
+        case NODE_FUNCTION_DEF:
+            cw_string(w, node->function.name);
+            cw_params(w, node->function.params, node->function.param_count, depth);
+            cw_i32(w, node->function.return_type);
+            cw_u8(w, node->function.has_return_type);
+            cw_u8(w, node->function.is_generator);
+            cw_node(w, node->function.body, depth);
+            break;
+        case NODE_VAR_DECL:
+            cw_string(w, node->var_decl.name);
+            cw_node(w, node->var_decl.initializer, depth);
+            cw_u8(w, node->var_decl.is_const);
+            break;
+        case NODE_ASSIGN:
+            cw_node(w, node->assign.target, depth);
+            cw_i32(w, node->assign.operator);
+            cw_node(w, node->assign.value, depth);
+            break;
+        case NODE_IF:
+            cw_node(w, node->if_stmt.condition, depth);
+            cw_node(w, node->if_stmt.then_branch, depth);
+            cw_node(w, node->if_stmt.else_branch, depth);
+            break;
+        case NODE_WHILE:
+            cw_node(w, node->while_stmt.condition, depth);
+            cw_node(w, node->while_stmt.body, depth);
+            break;
+        case NODE_FOR:
+            cw_string(w, node->for_stmt.var_name);
+            cw_node(w, node->for_stmt.start, depth);
+            cw_node(w, node->for_stmt.end, depth);
+            cw_node(w, node->for_stmt.step, depth);
+            cw_node(w, node->for_stmt.body, depth);
+            break;
+        case NODE_RETURN:
+            cw_node(w, node->return_stmt.value, depth);
+            break;
+        case NODE_YIELD:
+            cw_node(w, node->yield_stmt.value, depth);
+            break;
+        case NODE_THROW:
+            cw_node(w, node->throw_stmt.expression, depth);
+            break;
+        case NODE_EXPR_STMT:
+            cw_node(w, node->expr_stmt.expression, depth);
+            break;
+        case NODE_IMPORT:
+            cw_string(w, node->import_stmt.module_path);
+            cw_string(w, node->import_stmt.alias);
+            break;
+        case NODE_CLASS_DEF:
+            cw_string(w, node->class_def.name);
+            cw_string(w, node->class_def.parent_name);
+            cw_nodes(w, node->class_def.methods, node->class_def.method_count, depth);
+            cw_nodes(w, node->class_def.static_methods, node->class_def.static_method_count, depth);
+            cw_node(w, node->class_def.init_method, depth);
+            break;
+        case NODE_METHOD_DEF:
+            cw_string(w, node->method.name);
+            cw_params(w, node->method.params, node->method.param_count, depth);
+            cw_i32(w, node->method.return_type);
+            cw_u8(w, node->method.has_return_type);
+            cw_node(w, node->method.body, depth);
+            break;
+        case NODE_NEW:
+            cw_string(w, node->new_expr.class_name);
+            cw_nodes(w, node->new_expr.arguments, node->new_expr.arg_count, depth);
+            break;
+        case NODE_TRY:
+            cw_node(w, node->try_stmt.try_block, depth);
+            cw_string(w, node->try_stmt.catch_var);
+            cw_node(w, node->try_stmt.catch_block, depth);
+            cw_node(w, node->try_stmt.finally_block, depth);
+            break;
+        case NODE_LAMBDA:
+            cw_params(w, node->lambda.params, node->lambda.param_count, depth);
+            cw_node(w, node->lambda.body, depth);
+            break;
+        case NODE_SWITCH:
+            cw_node(w, node->switch_stmt.target, depth);
+            cw_u32(w, (uint32_t)node->switch_stmt.case_count);
+            for (int i = 0; i < node->switch_stmt.case_count; i++) {
+                cw_node(w, node->switch_stmt.case_values[i], depth);
+                cw_node(w, node->switch_stmt.case_bodies[i], depth);
+            }
+            cw_node(w, node->switch_stmt.default_body, depth);
+            break;
+        case NODE_FOREACH:
+            cw_string(w, node->foreach_stmt.var_name);
+            cw_string(w, node->foreach_stmt.value_name);
+            cw_node(w, node->foreach_stmt.iterable, depth);
+            cw_node(w, node->foreach_stmt.body, depth);
+            break;
+        case NODE_LIST_COMPREHENSION:
+            cw_node(w, node->list_comp.expression, depth);
+            cw_string(w, node->list_comp.var_name);
+            cw_node(w, node->list_comp.iterable, depth);
+            cw_node(w, node->list_comp.condition, depth);
+            break;
+        default:
+            w->failed = true;
+            break;
+    }
+}
+
+// =============================================================================
+// 復元
+// =============================================================================
+
+typedef struct {
+    const uint8_t *cursor;
+    const uint8_t *end;
+    bool failed;
+} CacheReader;
+
+static bool cr_bytes(CacheReader *r, void *out, size_t len) {
+    if (r->failed || (size_t)(r->end - r->cursor) < len) {
+        r->failed = true;
+        memset(out, 0, len);
+        return false;
+    }
+    memcpy(out, r->cursor, len);
+    r->cursor += len;
+    return true;
+}
+
+static uint8_t cr_u8(CacheReader *r)   { uint8_t v;  cr_bytes(r, &v, sizeof(v)); return v; }
+static uint32_t cr_u32(CacheReader *r) { uint32_t v; cr_bytes(r, &v, sizeof(v)); return v; }
+static int32_t cr_i32(CacheReader *r)  { int32_t v;  cr_bytes(r, &v, sizeof(v)); return v; }
+static double cr_f64(CacheReader *r)   { double v;   cr_bytes(r, &v, sizeof(v)); return v; }
+
+/**
+ * 要素数を読む。残りバイト数より多い要素数は壊れたデータとみなす
+ */
+static int cr_count(CacheReader *r) {
+    uint32_t count = cr_u32(r);
+    if (r->failed || count > (uint32_t)(r->end - r->cursor) || count > INT32_MAX) {
+        r->failed = true;
+        return 0;
+    }
+    return (int)count;
+}
+
+static char *cr_string(CacheReader *r) {
+    uint32_t len = cr_u32(r);
+    if (r->failed || len == MODULE_CACHE_NULL_STRING) return NULL;
+    if (len > (uint32_t)(r->end - r->cursor)) {
+        r->failed = true;
+        return NULL;
+    }
+    char *s = malloc((size_t)len + 1);
+    if (s == NULL) {
+        r->failed = true;
+        return NULL;
+    }
+    memcpy(s, r->cursor, len);
+    s[len] = '\0';
+    r->cursor += len;
+    return s;
+}
+
+static ASTNode *cr_node(CacheReader *r, int depth);
+
+/**
+ * ノード配列を読む。*count は確保した要素数を指すので、
+ * 途中で失敗しても node_free がそのまま後始末できる
+ */
+static ASTNode **cr_nodes(CacheReader *r, int *count, int depth) {
+    int n = cr_count(r);
+    *count = 0;
+    if (n == 0) return NULL;
+    ASTNode **nodes = calloc((size_t)n, sizeof(ASTNode *));
+    if (nodes == NULL) {
+        r->failed = true;
+        return NULL;
+    }
+    *count = n;
+    for (int i = 0; i < n && !r->failed; i++) {
+        nodes[i] = cr_node(r, depth);
+    }
+    return nodes;
+}
+
+static Parameter *cr_params(CacheReader *r, int *count, int depth) {
+    int n = cr_count(r);
+    *count = 0;
+    if (n == 0) return NULL;
+    Parameter *params = calloc((size_t)n, sizeof(Parameter));
+    if (params == NULL) {
+        r->failed = true;
+        return NULL;
+    }
+    *count = n;
+    for (int i = 0; i < n && !r->failed; i++) {
+        params[i].name = cr_string(r);
+        params[i].type = (ValueType)cr_i32(r);
+        params[i].has_type = cr_u8(r) != 0;
+        params[i].is_variadic = cr_u8(r) != 0;
+        params[i].default_value = cr_node(r, depth);
+    }
+    return params;
+}
+
+static ASTNode *cr_node(CacheReader *r, int depth) {
+    uint8_t tag = cr_u8(r);
+    if (r->failed || tag == 0) return NULL;
+    if (tag > NODE_TYPE_COUNT || depth >= MODULE_CACHE_MAX_DEPTH) {
+        r->failed = true;
+        return NULL;
+    }
+    depth++;
+    int line = cr_i32(r);
+    int column = cr_i32(r);
+    ASTNode *node = node_new((NodeType)(tag - 1), line, column);
+    if (node == NULL) {
+        r->failed = true;
+        return NULL;
+    }
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            node->number_value = cr_f64(r);
+            break;
+        case NODE_BOOL:
+            node->bool_value = cr_u8(r) != 0;
+            break;
+        case NODE_NULL:
+        case NODE_BREAK:
+        case NODE_CONTINUE:
+        case NODE_SELF:
+            break;
+        case NODE_STRING:
+        case NODE_IDENTIFIER:
+            node->string_value = cr_string(r);
+            break;
+        case NODE_BINARY:
+            node->binary.operator = (TokenType)cr_i32(r);
+            node->binary.left = cr_node(r, depth);
+            node->binary.right = cr_node(r, depth);
+            break;
+        case NODE_UNARY:
+            node->unary.operator = (TokenType)cr_i32(r);
+            node->unary.operand = cr_node(r, depth);
+            break;
+        case NODE_CALL:
+            node->call.callee = cr_node(r, depth);
+            node->call.arguments = cr_nodes(r, &node->call.arg_count, depth);
+            break;
+        case NODE_INDEX:
+            node->index.array = cr_node(r, depth);
+            node->index.index = cr_node(r, depth);
+            break;
+        case NODE_MEMBER:
+            node->member.object = cr_node(r, depth);
+            node->member.member_name = cr_string(r);
+            break;
+        case NODE_PROGRAM:
+        case NODE_BLOCK:
+        case NODE_ARRAY:
+            node->block.statements = cr_nodes(r, &node->block.count, depth);
+            node->block.capacity = node->block.count;
+            break;
+        case NODE_DICT: {
+            int n = cr_count(r);
+            if (n == 0) break;
+            node->dict.keys = calloc((size_t)n, sizeof(char *));
+            node->dict.values = calloc((size_t)n, sizeof(ASTNode *));
+            if (node->dict.keys == NULL || node->dict.values == NULL) {
+                r->failed = true;
+                break;
+            }
+            node->dict.count = n;
+            for (int i = 0; i < n && !r->failed; i++) {
+                node->dict.keys[i] = cr_string(r);
+                node->dict.values[i] = cr_node(r, depth);
+            }
+            break;
+        }
+        case NODE_FUNCTION_DEF:
+            node->function.name = cr_string(r);
+            node->function.params = cr_params(r, &node->function.param_count, depth);
+            node->function.return_type = (ValueType)cr_i32(r);
+            node->function.has_return_type = cr_u8(r) != 0;
+            node->function.is_generator = cr_u8(r) != 0;
+            node->function.body = cr_node(r, depth);
+            break;
+        case NODE_VAR_DECL:
+            node->var_decl.name = cr_string(r);
+            node->var_decl.initializer = cr_node(r, depth);
+            node->var_decl.is_const = cr_u8(r) != 0;
+            break;
+        case NODE_ASSIGN:
+            node->assign.target = cr_node(r, depth);
+            node->assign.operator = (TokenType)cr_i32(r);
+            node->assign.value = cr_node(r, depth);
+            break;
+        case NODE_IF:
+            node->if_stmt.condition = cr_node(r, depth);
+            node->if_stmt.then_branch = cr_node(r, depth);
+            node->if_stmt.else_branch = cr_node(r, depth);
+            break;
+        case NODE_WHILE:
+            node->while_stmt.condition = cr_node(r, depth);
+            node->while_stmt.body = cr_node(r, depth);
+            break;
+        case NODE_FOR:
+            node->for_stmt.var_name = cr_string(r);
+            node->for_stmt.start = cr_node(r, depth);
+            node->for_stmt.end = cr_node(r, depth);
+            node->for_stmt.step = cr_node(r, depth);
+            node->for_stmt.body = cr_node(r, depth);
+            break;
+        case NODE_RETURN:
+            node->return_stmt.value = cr_node(r, depth);
+            break;
+        case NODE_YIELD:
+            node->yield_stmt.value = cr_node(r, depth);
+            break;
+        case NODE_THROW:
+            node->throw_stmt.expression = cr_node(r, depth);
+            break;
+        case NODE_EXPR_STMT:
+            node->expr_stmt.expression = cr_node(r, depth);
+            break;
+        case NODE_IMPORT:
+            node->import_stmt.module_path = cr_string(r);
+            node->import_stmt.alias = cr_string(r);
+            break;
+        case NODE_CLASS_DEF:
+            node->class_def.name = cr_string(r);
+            node->class_def.parent_name = cr_string(r);
+            node->class_def.methods = cr_nodes(r, &node->class_def.method_count, depth);
+            node->class_def.method_capacity = node->class_def.method_count;
+            node->class_def.static_methods =
+                cr_nodes(r, &node->class_def.static_method_count, depth);
+            node->class_def.static_method_capacity = node->class_def.static_method_count;
+            node->class_def.init_method = cr_node(r, depth);
+            break;
+        case NODE_METHOD_DEF:
+            node->method.name = cr_string(r);
+            node->method.params = cr_params(r, &node->method.param_count, depth);
+            node->method.param_capacity = node->method.param_count;
+            node->method.return_type = (ValueType)cr_i32(r);
+            node->method.has_return_type = cr_u8(r) != 0;
+            node->method.body = cr_node(r, depth);
+            break;
+        case NODE_NEW:
+            node->new_expr.class_name = cr_string(r);
+            node->new_expr.arguments = cr_nodes(r, &node->new_expr.arg_count, depth);
+            break;
+        case NODE_TRY:
+            node->try_stmt.try_block = cr_node(r, depth);
+            node->try_stmt.catch_var = cr_string(r);
+            node->try_stmt.catch_block = cr_node(r, depth);
+            node->try_stmt.finally_block = cr_node(r, depth);
+            break;
+        case NODE_LAMBDA:
+            node->lambda.params = cr_params(r, &node->lambda.param_count, depth);
+            node->lambda.body = cr_node(r, depth);
+            break;
+        case NODE_SWITCH: {
+            node->switch_stmt.target = cr_node(r, depth);
+            int n = cr_count(r);
+            if (n > 0) {
+                node->switch_stmt.case_values = calloc((size_t)n, sizeof(ASTNode *));
+                node->switch_stmt.case_bodies = calloc((size_t)n, sizeof(ASTNode *));
+                if (node->switch_stmt.case_values == NULL || node->switch_stmt.case_bodies == NULL) {
+                    r->failed = true;
+                    break;
+                }
+                node->switch_stmt.case_count = n;
+                node->switch_stmt.case_capacity = n;
+                for (int i = 0; i < n && !r->failed; i++) {
+                    node->switch_stmt.case_values[i] = cr_node(r, depth);
+                    node->switch_stmt.case_bodies[i] = cr_node(r, depth);
+                }
+            }
+            node->switch_stmt.default_body = cr_node(r, depth);
+            break;
+        }
+        case NODE_FOREACH:
+            node->foreach_stmt.var_name = cr_string(r);
+            node->foreach_stmt.value_name = cr_string(r);
+            node->foreach_stmt.iterable = cr_node(r, depth);
+            node->foreach_stmt.body = cr_node(r, depth);
+            break;
+        case NODE_LIST_COMPREHENSION:
+            node->list_comp.expression = cr_node(r, depth);
+            node->list_comp.var_name = cr_string(r);
+            node->list_comp.iterable = cr_node(r, depth);
+            node->list_comp.condition = cr_node(r, depth);
+            break;
+        default:
+            r->failed = true;
+            break;
+    }
+    return node;
+}
+
+// =============================================================================
+// キャッシュファイル
+// =============================================================================
+
+static bool module_cache_dir(char *out, size_t out_size) {
+    const char *dir = getenv("HAJIMU_CACHE_DIR");
+    if (dir != NULL && dir[0] != '\0') {
+        return snprintf(out, out_size, "%s", dir) < (int)out_size;
+    }
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg != NULL && xdg[0] == '/') {
+        return snprintf(out, out_size, "%s/hajimu", xdg) < (int)out_size;
+    }
+    const char *home = getenv("HOME");
+    if (home == NULL || home[0] == '\0') return false;
+    return snprintf(out, out_size, "%s/.cache/hajimu", home) < (int)out_size;
+}
+
+/**
+ * 正規化パスとキャッシュファイルのパスを求める
+ */
+static bool module_cache_paths(const char *path, char *canonical, size_t canonical_size,
+                               char *cache_path, size_t cache_path_size) {
+    char dir[PATH_MAX];
+    if (!module_cache_dir(dir, sizeof(dir))) return false;
+
+    char *resolved = realpath(path, NULL);
+    int n = snprintf(canonical, canonical_size, "%s", resolved != NULL ? resolved : path);
+    free(resolved);
+    if (n < 0 || (size_t)n >= canonical_size) return false;
+
+    uint64_t key = module_cache_hash(canonical, strlen(canonical));
+    n = snprintf(cache_path, cache_path_size, "%s/%016llx.hjpc", dir, (unsigned long long)key);
+    return n > 0 && (size_t)n < cache_path_size;
+}
+
+static int64_t module_cache_mtime_ns(const struct stat *st) {
+#ifdef __APPLE__
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000LL + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#endif
+}
+
+static bool module_cache_mkdirs(const char *dir) {
+    char buf[PATH_MAX];
+    if (snprintf(buf, sizeof(buf), "%s", dir) >= (int)sizeof(buf)) return false;
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buf, 0755) != 0 && errno != EEXIST) return false;
+        *p = '/';
+    }
+    return mkdir(buf, 0755) == 0 || errno == EEXIST;
+}
+
+static bool module_cache_write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t written = write(fd, p, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += written;
+        len -= (size_t)written;
+    }
+    return true;
+}
+
+ASTNode *module_cache_load(const char *path, const char *source, size_t source_len) {
+    if (path == NULL || !module_cache_enabled()) return NULL;
+
+    char canonical[PATH_MAX];
+    char cache_path[PATH_MAX];
+    struct stat source_st;
+    if (!module_cache_paths(path, canonical, sizeof(canonical), cache_path, sizeof(cache_path)) ||
+        stat(path, &source_st) != 0) {
+        return NULL;
+    }
+
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0) {
+        __atomic_fetch_add(&g_module_cache_stats.misses, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    struct stat cache_st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &cache_st) == 0 && cache_st.st_size >= (off_t)sizeof(ModuleCacheHeader)) {
+        map = mmap(NULL, (size_t)cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        __atomic_fetch_add(&g_module_cache_stats.misses, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    // 安いものから順に照合し、内容ハッシュは最後に計算する
+    const uint8_t *base = map;
+    size_t map_size = (size_t)cache_st.st_size;
+    ModuleCacheHeader header;
+    memcpy(&header, base, sizeof(header));
+    size_t canonical_len = strlen(canonical);
+    const uint8_t *stored_path = base + sizeof(header);
+    const uint8_t *payload = stored_path + canonical_len;
+    ASTNode *program = NULL;
+
+    bool valid =
+        memcmp(header.magic, MODULE_CACHE_MAGIC, 4) == 0 &&
+        header.format == MODULE_CACHE_FORMAT &&
+        header.abi == module_cache_abi() &&
+        header.byte_order == MODULE_CACHE_BYTE_ORDER &&
+        header.path_len == canonical_len &&
+        header.payload_size == map_size - sizeof(header) - canonical_len &&
+        header.file_size == (uint64_t)source_st.st_size &&
+        header.file_mtime_ns == module_cache_mtime_ns(&source_st) &&
+        header.source_size == source_len &&
+        memcmp(stored_path, canonical, canonical_len) == 0 &&
+        header.source_hash == module_cache_hash(source, source_len) &&
+        header.payload_hash == module_cache_hash(payload, (size_t)header.payload_size);
+
+    if (valid) {
+        CacheReader reader = {
+            .cursor = payload,
+            .end = payload + header.payload_size,
+            .failed = false,
+        };
+        program = cr_node(&reader, 0);
+        if (reader.failed || reader.cursor != reader.end ||
+            program == NULL || program->type != NODE_PROGRAM) {
+            node_free(program);
+            program = NULL;
+        }
+    }
+    munmap(map, map_size);
+
+    if (program != NULL) {
+        __atomic_fetch_add(&g_module_cache_stats.hits, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&g_module_cache_stats.misses, 1, __ATOMIC_RELAXED);
+    }
+    return program;
+}
+
+void module_cache_store(const char *path, const char *source, size_t source_len,
+                        const ASTNode *program) {
+    if (path == NULL || program == NULL || !module_cache_enabled()) return;
+
+    char canonical[PATH_MAX];
+    char cache_path[PATH_MAX];
+    struct stat source_st;
+    if (!module_cache_paths(path, canonical, sizeof(canonical), cache_path, sizeof(cache_path)) ||
+        stat(path, &source_st) != 0) {
+        return;
+    }
+
+    CacheWriter writer = {0};
+    cw_node(&writer, program, 0);
+    if (writer.failed) {
+        free(writer.data);
+        return;
+    }
+
+    ModuleCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODULE_CACHE_MAGIC, 4);
+    header.format = MODULE_CACHE_FORMAT;
+    header.abi = module_cache_abi();
+    header.byte_order = MODULE_CACHE_BYTE_ORDER;
+    header.path_len = (uint32_t)strlen(canonical);
+    header.file_size = (uint64_t)source_st.st_size;
+    header.file_mtime_ns = module_cache_mtime_ns(&source_st);
+    header.source_size = source_len;
+    header.source_hash = module_cache_hash(source, source_len);
+    header.payload_size = writer.length;
+    header.payload_hash = module_cache_hash(writer.data, writer.length);
+
+    // 一時ファイルに書いてから rename で置き換える（同時に書くプロセスがいても読み手は常に完全なファイルを見る）
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", cache_path);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL) *slash = '\0';
+
+    static int tmp_counter = 0;
+    char tmp_path[PATH_MAX + 64];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.%d.tmp", cache_path, (long)getpid(),
+             __atomic_fetch_add(&tmp_counter, 1, __ATOMIC_RELAXED));
+
+    int fd = -1;
+    if (slash != NULL && module_cache_mkdirs(dir)) {
+        fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd >= 0) {
+        bool ok = module_cache_write_all(fd, &header, sizeof(header)) &&
+                  module_cache_write_all(fd, canonical, header.path_len) &&
+                  module_cache_write_all(fd, writer.data, writer.length);
+        ok = close(fd) == 0 && ok;
+        if (ok && rename(tmp_path, cache_path) == 0) {
+            __atomic_fetch_add(&g_module_cache_stats.writes, 1, __ATOMIC_RELAXED);
+        } else {
+            unlink(tmp_path);
+        }
+    }
+    free(writer.data);
+}
+
+#else
+
+ASTNode *module_cache_load(const char *path, const char *source, size_t source_len) {
+    (void)path; (void)source; (void)source_len;
+    return NULL;
+}
+
+void module_cache_store(const char *path, const char *source, size_t source_len,
+                        const ASTNode *program) {
+    (void)path; (void)source; (void)source_len; (void)program;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * 日本語プログラミング言語 - モジュールのコンパイルキャッシュ
+ *
+ * 取り込んだ .jp のパース結果（AST）をバイナリ化してディスクに保存し、
+ * 次回以降の実行では字句解析・構文解析を省いて mmap したキャッシュから復元する。
+ *
+ * 保存先: $HAJIMU_CACHE_DIR、なければ $XDG_CACHE_HOME/hajimu、なければ ~/.cache/hajimu
+ * ファイル: <正規化パスのハッシュ>.hjpc
+ *
+ * キャッシュは処理系のバージョン・ビルド識別子と、正規化パス・ソースのサイズ・
+ * mtime・内容ハッシュがすべて一致したときだけ使う。書き込みは一時ファイルへ書いてから rename するので、
+ * 同じモジュールを複数プロセスが同時に書いても読み手が壊れたファイルを見ることはない。
+ * 読み込みに失敗したキャッシュは無視して通常どおりパースし、書き直す。
+ *
+ * HAJIMU_NO_MODULE_CACHE=1 または --no-module-cache で無効化できる。
+ */
+
+#ifndef MODULE_CACHE_H
+#define MODULE_CACHE_H
+
+#include "ast.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** キャッシュの利用状況（--profile で表示） */
+typedef struct {
+    long hits;      // キャッシュから復元した回数
+    long misses;    // キャッシュがない・古い・壊れていた回数
+    long writes;    // キャッシュを書き込んだ回数
+} ModuleCacheStats;
+
+/**
+ * キャッシュの有効・無効を切り替える（既定は有効。環境変数で無効化されていれば無効）
+ */
+void module_cache_set_enabled(bool enabled);
+
+/**
+ * キャッシュが使える状態か
+ */
+bool module_cache_enabled(void);
+
+/**
+ * path のソース source（長さ source_len）に対応するキャッシュを読み込む。
+ * 一致するキャッシュがなければ NULL。返した AST は通常の AST と同じく node_free で解放する
+ */
+ASTNode *module_cache_load(const char *path, const char *source, size_t source_len);
+
+/**
+ * パース済みの program をキャッシュに書き込む。失敗しても実行には影響しない
+ */
+void module_cache_store(const char *path, const char *source, size_t source_len,
+                        const ASTNode *program);
+
+/**
+ * このプロセスでのキャッシュ利用状況を取得する
+ */
+ModuleCacheStats module_cache_stats(void);
+
+#endif // MODULE_CACHE_H
@@ -602,6 +602,7 @@ static ASTNode *function_definition(Parser *parser, bool is_generator) {
 
     ASTNode *func_node = node_function_def(name, params, param_count, return_type, has_return_type,
                             body, line, column);
+    free(name);
     func_node->function.is_generator = is_generator;
     return func_node;
 }
@@ -766,7 +767,9 @@ static ASTNode *var_declaration(Parser *parser, bool is_const) {
         consume(parser, TOKEN_NEWLINE, "改行が必要です");
     }
 
-    return node_var_decl(name, initializer, is_const, line, column);
+    ASTNode *decl = node_var_decl(name, initializer, is_const, line, column);
+    free(name);  // ノードは名前を複製して持つ
+    return decl;
 }
 
 static ASTNode *if_statement(Parser *parser) {
@@ -856,7 +859,9 @@ static ASTNode *for_statement(Parser *parser) {
     // 終わり
     consume_end(parser);
 
-    return node_for(var_name, start, end, step, body, line, column);
+    ASTNode *node = node_for(var_name, start, end, step, body, line, column);
+    free(var_name);
+    return node;
 }
 
 static ASTNode *english_for_statement(Parser *parser) {
@@ -1271,7 +1276,9 @@ static ASTNode *enum_definition(Parser *parser) {
 
     // 辞書リテラルとして定数宣言に変換
     ASTNode *dict = node_dict(keys, values, count, line, column);
-    return node_var_decl(name, dict, true, line, column);
+    ASTNode *decl = node_var_decl(name, dict, true, line, column);
+    free(name);
+    return decl;
 }
 
 // 各 変数名 を 配列式 の中:
@@ -1768,6 +1775,7 @@ static ASTNode *call(Parser *parser) {
                 member_name = copy_token_string(&parser->previous);
             }
             expr = node_member(expr, member_name, line, column);
+            free(member_name);
         } else {
             break;
         }
@@ -1847,7 +1855,10 @@ static ASTNode *primary(Parser *parser) {
 
     // 識別子
     if (match(parser, TOKEN_IDENTIFIER)) {
-        return node_identifier(copy_token_string(&parser->previous), line, column);
+        char *name = copy_token_string(&parser->previous);
+        ASTNode *node = node_identifier(name, line, column);
+        free(name);
+        return node;
     }
 
     // グループ化 (...)
@@ -362,6 +362,22 @@ bool plugin_load(PluginManager *mgr, const char *path, HajimuPluginInfo **info_o
         return false;
     }
     
+    // ABI バージョンを確認（古いヘッダーでビルドされたプラグインは Value の扱いが異なる）
+    const int *abi_version = (const int *)platform_dlsym(handle, HAJIMU_PLUGIN_ABI_SYMBOL);
+    if (abi_version == NULL || *abi_version != HAJIMU_PLUGIN_ABI_VERSION) {
+        fprintf(stderr, "エラー: プラグインの ABI バージョンが一致しません: %s\n", path);
+        if (abi_version == NULL) {
+            fprintf(stderr, "  詳細: '%s' がありません（必要: %d）\n",
+                    HAJIMU_PLUGIN_ABI_SYMBOL, HAJIMU_PLUGIN_ABI_VERSION);
+        } else {
+            fprintf(stderr, "  詳細: プラグイン %d / インタプリタ %d\n",
+                    *abi_version, HAJIMU_PLUGIN_ABI_VERSION);
+        }
+        fprintf(stderr, "  ヒント: 現在の hajimu_plugin.h でプラグインを再ビルドしてください\n");
+        platform_dlclose(handle);
+        return false;
+    }
+
     // 初期化関数を検索
 #ifndef _WIN32
     dlerror(); // エラーをクリア（POSIX専用）
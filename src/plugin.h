@@ -74,6 +74,10 @@ typedef HajimuPluginInfo *(*HajimuPluginInitFn)(void);
 #define HAJIMU_PLUGIN_SET_RUNTIME_SYMBOL "hajimu_plugin_set_runtime"
 typedef void (*HajimuPluginSetRuntimeFn)(HajimuRuntime *);
 
+// プラグイン ABI バージョン（include/hajimu_plugin.h と一致させる）とそのシンボル名
+#define HAJIMU_PLUGIN_ABI_VERSION 2
+#define HAJIMU_PLUGIN_ABI_SYMBOL "hajimu_plugin_abi_version"
+
 // =============================================================================
 // プラグインマネージャ（内部用）
 // =============================================================================
@@ -0,0 +1,266 @@
+/**
+ * 日本語プログラミング言語 - 実行トレース実装
+ *
+ * 区間は固定上限の動的配列に貯め、書き出し時に trace-event JSON へ変換する。
+ *   - 同じスレッド内の区間は "X"（完了イベント）
+ *   - キュー待ちのようにスレッドをまたぐ区間は "b" / "e"（非同期イベント）
+ *   - スレッド名は "M"（メタデータ）
+ * tid はスレッドが最初に記録した順の連番で、メインスレッドが 1。
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(_MSC_VER)
+#  define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#  define TRACE_THREAD_LOCAL __thread
+#endif
+
+typedef enum {
+    TRACE_EVENT_COMPLETE,
+    TRACE_EVENT_ASYNC,
+    TRACE_EVENT_THREAD_NAME,
+} TraceEventKind;
+
+typedef struct {
+    TraceEventKind kind;
+    char *name;
+    const char *category;   // 呼び出し側の文字列リテラル
+    char *detail;
+    double start_us;
+    double end_us;
+    int tid;
+} TraceEvent;
+
+bool g_trace_enabled = false;
+
+static pthread_mutex_t g_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceEvent *g_trace_events = NULL;
+static int g_trace_count = 0;
+static int g_trace_capacity = 0;
+static long g_trace_dropped = 0;
+static double g_trace_origin_us = 0.0;
+static char *g_trace_path = NULL;
+static bool g_trace_atexit_registered = false;
+
+static int g_trace_next_tid = 1;
+static int g_trace_session = 0;
+static TRACE_THREAD_LOCAL int t_trace_tid = 0;
+static TRACE_THREAD_LOCAL const char *t_trace_thread_name = NULL;
+static TRACE_THREAD_LOCAL int t_trace_named_session = 0;
+
+double trace_now_us(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+}
+
+static int trace_current_tid(void) {
+    if (t_trace_tid == 0) {
+        t_trace_tid = __atomic_fetch_add(&g_trace_next_tid, 1, __ATOMIC_RELAXED);
+    }
+    return t_trace_tid;
+}
+
+static TraceEvent *trace_push_locked(void) {
+    if (g_trace_count >= TRACE_MAX_EVENTS) {
+        g_trace_dropped++;
+        return NULL;
+    }
+    if (g_trace_count == g_trace_capacity) {
+        int capacity = g_trace_capacity > 0 ? g_trace_capacity * 2 : 1024;
+        TraceEvent *events = realloc(g_trace_events, sizeof(TraceEvent) * capacity);
+        if (events == NULL) {
+            g_trace_dropped++;
+            return NULL;
+        }
+        g_trace_events = events;
+        g_trace_capacity = capacity;
+    }
+    return &g_trace_events[g_trace_count++];
+}
+
+static void trace_record(TraceEventKind kind, const char *name, const char *category,
+                         double start_us, double end_us, const char *detail) {
+    int tid = trace_current_tid();
+    pthread_mutex_lock(&g_trace_mutex);
+    if (!trace_enabled()) {
+        pthread_mutex_unlock(&g_trace_mutex);
+        return;
+    }
+    // スレッド名はそのスレッドの最初の区間と一緒に出す（プールはトレース開始前から動いている）
+    if (t_trace_named_session != g_trace_session) {
+        t_trace_named_session = g_trace_session;
+        TraceEvent *meta = t_trace_thread_name != NULL ? trace_push_locked() : NULL;
+        if (meta != NULL) {
+            memset(meta, 0, sizeof(*meta));
+            meta->kind = TRACE_EVENT_THREAD_NAME;
+            meta->name = strdup(t_trace_thread_name);
+            meta->category = "";
+            meta->tid = tid;
+        }
+    }
+    TraceEvent *event = trace_push_locked();
+    if (event != NULL) {
+        event->kind = kind;
+        event->name = name != NULL ? strdup(name) : NULL;
+        event->category = category;
+        event->detail = detail != NULL ? strdup(detail) : NULL;
+        event->start_us = start_us;
+        event->end_us = end_us;
+        event->tid = tid;
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+}
+
+void trace_thread_name(const char *name) {
+    t_trace_thread_name = name;
+}
+
+void trace_complete(const char *name, const char *category, double start_us,
+                    const char *detail) {
+    if (!trace_enabled()) return;
+    trace_record(TRACE_EVENT_COMPLETE, name, category, start_us, trace_now_us(), detail);
+}
+
+void trace_async_span(const char *name, const char *category, double start_us,
+                      double end_us, const char *detail) {
+    if (!trace_enabled()) return;
+    trace_record(TRACE_EVENT_ASYNC, name, category, start_us, end_us, detail);
+}
+
+static void trace_atexit(void) {
+    if (trace_enabled()) {
+        trace_stop();
+    }
+}
+
+bool trace_start(const char *path) {
+    if (path == NULL || path[0] == '\0') return false;
+
+    pthread_mutex_lock(&g_trace_mutex);
+    free(g_trace_path);
+    g_trace_path = strdup(path);
+    g_trace_count = 0;
+    g_trace_dropped = 0;
+    g_trace_origin_us = trace_now_us();
+    g_trace_session++;
+    bool enabled = g_trace_path != NULL;
+    __atomic_store_n(&g_trace_enabled, enabled, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_trace_mutex);
+    if (!enabled) return false;
+
+    if (!g_trace_atexit_registered) {
+        atexit(trace_atexit);
+        g_trace_atexit_registered = true;
+    }
+    trace_current_tid();
+    trace_thread_name("メイン");
+    return true;
+}
+
+static void trace_write_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(out, "\\u%04x", *p);
+                } else {
+                    fputc(*p, out);
+                }
+                break;
+        }
+    }
+    fputc('"', out);
+}
+
+static void trace_write_event_head(FILE *out, const TraceEvent *event, const char *phase,
+                                   double ts_us) {
+    fputs("{\"name\":", out);
+    trace_write_string(out, event->name != NULL ? event->name : "");
+    fputs(",\"cat\":", out);
+    trace_write_string(out, event->category);
+    fprintf(out, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", phase, ts_us, event->tid);
+}
+
+static void trace_write_args(FILE *out, const TraceEvent *event) {
+    if (event->detail == NULL) return;
+    fputs(",\"args\":{\"detail\":", out);
+    trace_write_string(out, event->detail);
+    fputc('}', out);
+}
+
+long trace_stop(void) {
+    pthread_mutex_lock(&g_trace_mutex);
+    if (g_trace_path == NULL) {
+        pthread_mutex_unlock(&g_trace_mutex);
+        return -1;
+    }
+    __atomic_store_n(&g_trace_enabled, false, __ATOMIC_RELEASE);
+
+    FILE *out = fopen(g_trace_path, "w");
+    long written = -1;
+    if (out != NULL) {
+        fputs("{\"traceEvents\":[\n", out);
+        long async_id = 0;
+        for (int i = 0; i < g_trace_count; i++) {
+            const TraceEvent *event = &g_trace_events[i];
+            double start = event->start_us - g_trace_origin_us;
+            if (i > 0) fputs(",\n", out);
+            switch (event->kind) {
+                case TRACE_EVENT_THREAD_NAME:
+                    fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1", out);
+                    fprintf(out, ",\"tid\":%d,\"args\":{\"name\":", event->tid);
+                    trace_write_string(out, event->name);
+                    fputs("}}", out);
+                    break;
+                case TRACE_EVENT_COMPLETE:
+                    trace_write_event_head(out, event, "X", start);
+                    fprintf(out, ",\"dur\":%.3f", event->end_us - event->start_us);
+                    trace_write_args(out, event);
+                    fputc('}', out);
+                    break;
+                case TRACE_EVENT_ASYNC:
+                    async_id++;
+                    trace_write_event_head(out, event, "b", start);
+                    fprintf(out, ",\"id\":%ld", async_id);
+                    trace_write_args(out, event);
+                    fputs("},\n", out);
+                    trace_write_event_head(out, event, "e", event->end_us - g_trace_origin_us);
+                    fprintf(out, ",\"id\":%ld}", async_id);
+                    break;
+            }
+        }
+        fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%ld}}\n",
+                g_trace_dropped);
+        written = fclose(out) == 0 ? g_trace_count : -1;
+    }
+
+    for (int i = 0; i < g_trace_count; i++) {
+        free(g_trace_events[i].name);
+        free(g_trace_events[i].detail);
+    }
+    free(g_trace_events);
+    g_trace_events = NULL;
+    g_trace_count = 0;
+    g_trace_capacity = 0;
+    free(g_trace_path);
+    g_trace_path = NULL;
+    pthread_mutex_unlock(&g_trace_mutex);
+    return written;
+}
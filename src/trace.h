@@ -0,0 +1,67 @@
+/**
+ * 日本語プログラミング言語 - 実行トレース（Chrome trace-event 形式）
+ *
+ * --trace=<ファイル> で有効にし、非同期タスクの実行・スレッドプールの
+ * キュー待ち・待機やチャネルのブロック・GC・モジュール読み込みを
+ * スレッドごとの区間として記録する。出力は Perfetto / chrome://tracing で開ける。
+ *
+ * 記録はメモリ上に貯め、trace_stop（または終了時）にまとめて書き出す。
+ * 無効時の呼び出し側コストは trace_enabled() の不可分読み取り 1 回だけ。
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+#define TRACE_MAX_EVENTS (1 << 20)  // これを超えた区間は捨てて件数だけ数える
+
+extern bool g_trace_enabled;
+
+/**
+ * トレースが有効か（プールのワーカーなど他スレッドからも読むので不可分に読む）
+ */
+static inline bool trace_enabled(void) {
+    return __atomic_load_n(&g_trace_enabled, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * トレースを開始する（呼び出したスレッドを「メイン」として登録）。
+ * 終了時に trace_stop されていなければ atexit で書き出す
+ */
+bool trace_start(const char *path);
+
+/**
+ * 記録を止めて JSON を書き出す。書き出した区間数を返し、失敗時は -1
+ */
+long trace_stop(void);
+
+/**
+ * トレース用の単調時刻（マイクロ秒）
+ */
+double trace_now_us(void);
+
+/**
+ * 呼び出したスレッドに表示名を付ける（文字列リテラルを渡す）。
+ * 名前はそのスレッドが最初に区間を記録したときに出力される
+ */
+void trace_thread_name(const char *name);
+
+/**
+ * start_us から現在までの区間を現在のスレッドに記録する。
+ * name / detail は複製するので呼び出し後に解放してよい（detail は NULL 可）
+ */
+void trace_complete(const char *name, const char *category, double start_us,
+                    const char *detail);
+
+/**
+ * スレッドをまたぐ区間（キュー待ちなど）を非同期トラックとして記録する
+ */
+void trace_async_span(const char *name, const char *category, double start_us,
+                      double end_us, const char *detail);
+
+#define TRACE_BEGIN(var) double var = trace_enabled() ? trace_now_us() : 0.0
+#define TRACE_END(var, name, category, detail) \
+    do { if (trace_enabled() && (var) > 0.0) trace_complete((name), (category), (var), (detail)); } while (0)
+
+#endif // TRACE_H
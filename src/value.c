@@ -5,6 +5,7 @@
 #include "value.h"
 #include "array_grow.h"
 #include "environment.h"
+#include "mem_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +13,17 @@
 #include <stdint.h>
 #include <limits.h>
 
+#if defined(__wasm_simd128__)
+#  include <wasm_simd128.h>
+#  define NUMERIC_WASM_SIMD 1
+#else
+#  define NUMERIC_WASM_SIMD 0
+#endif
+
+#ifndef _WIN32
+#  include <sys/mman.h>
+#endif
+
 #define VALUE_INITIAL_CAPACITY 8
 
 // =============================================================================
@@ -56,6 +68,41 @@ static void generator_state_release(GeneratorState **state_ref) {
     *state_ref = NULL;
 }
 
+bool file_handle_close(FileHandle *handle) {
+    if (handle == NULL || handle->fp == NULL) return true;
+
+    bool ok = fclose(handle->fp) == 0;
+    handle->fp = NULL;
+    free(handle->buffer);
+    handle->buffer = NULL;
+    return ok;
+}
+
+static void file_handle_release(FileHandle **handle_ref) {
+    if (handle_ref == NULL || *handle_ref == NULL) return;
+
+    FileHandle *handle = *handle_ref;
+    handle->ref_count--;
+    if (handle->ref_count <= 0) {
+        file_handle_close(handle);
+        free(handle->path);
+        free(handle);
+    }
+    *handle_ref = NULL;
+}
+
+void regex_handle_retain(RegexHandle *handle) {
+    if (handle != NULL) __atomic_add_fetch(&handle->ref_count, 1, __ATOMIC_RELAXED);
+}
+
+void regex_handle_release(RegexHandle *handle) {
+    if (handle == NULL) return;
+    if (__atomic_sub_fetch(&handle->ref_count, 1, __ATOMIC_ACQ_REL) > 0) return;
+    if (handle->destroy != NULL) handle->destroy(handle->compiled);
+    free(handle->pattern);
+    free(handle);
+}
+
 const char *numeric_dtype_name(NumericDType dtype) {
     switch (dtype) {
         case NUMERIC_DTYPE_F64: return "f64";
@@ -128,6 +175,52 @@ static size_t numeric_buffer_bytes(int capacity, NumericDType dtype) {
     return (size_t)capacity * (size_t)numeric_dtype_size(dtype);
 }
 
+// 数値ベクトル・行列の共有バッファ参照数は非同期ワーカー間でも増減するため、
+// atomic 命令で更新します。ref_count が NULL のバッファは単独所有です。
+static void numeric_shared_retain(int *ref_count) {
+    if (ref_count != NULL) {
+        __atomic_add_fetch(ref_count, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// mmap したファイル領域を共有バッファとして使う場合の管理情報。
+// ref_count は NUMERIC_MAPPED_BIAS だけ底上げしてあるため常に「共有中」と
+// 判定され、書き込みは必ず複製へ向かいます（領域は読み取り専用）。
+// 最後の参照が外れて BIAS まで戻った時点で領域を解放します。
+#define NUMERIC_MAPPED_BIAS (1 << 30)
+
+typedef struct {
+    int ref_count;     // 先頭に置き、int * として Value から参照する
+    void *base;
+    size_t length;
+} NumericMapping;
+
+static void numeric_mapping_unmap(void *base, size_t length) {
+    if (base == NULL) return;
+#ifdef _WIN32
+    (void)length;
+    free(base);
+#else
+    munmap(base, length);
+#endif
+}
+
+static bool numeric_shared_release(int *ref_count) {
+    if (ref_count == NULL) return true;
+    int remaining = __atomic_sub_fetch(ref_count, 1, __ATOMIC_ACQ_REL);
+    if (remaining == NUMERIC_MAPPED_BIAS) {
+        NumericMapping *mapping = (NumericMapping *)ref_count;
+        numeric_mapping_unmap(mapping->base, mapping->length);
+        free(mapping);
+        return false;
+    }
+    return remaining <= 0;
+}
+
+static bool numeric_shared_is_unique(int *ref_count) {
+    return ref_count == NULL || __atomic_load_n(ref_count, __ATOMIC_ACQUIRE) <= 1;
+}
+
 static double numeric_read_at(const void *data, NumericDType dtype, int index) {
     if (data == NULL || index < 0) return 0.0;
     switch (dtype) {
@@ -221,6 +314,7 @@ Value value_string_n(const char *s, int length) {
     if (v.string.data == NULL) {
         return value_null();
     }
+    MEM_PROFILE_ALLOC(VALUE_STRING, (size_t)v.string.capacity);
 
     if (s != NULL) {
         memcpy(v.string.data, s, length);
@@ -244,6 +338,7 @@ Value value_array_with_capacity(int capacity) {
     v.array.length = 0;
     v.array.capacity = capacity > 0 ? capacity : VALUE_INITIAL_CAPACITY;
     v.array.elements = malloc(sizeof(Value) * v.array.capacity);
+    MEM_PROFILE_ALLOC(VALUE_ARRAY, sizeof(Value) * (size_t)v.array.capacity);
     
     return v;
 }
@@ -266,7 +361,17 @@ Value value_numeric_array_with_dtype(int capacity, NumericDType dtype) {
     v.numeric_array.dtype = dtype;
     v.numeric_array.length = 0;
     v.numeric_array.capacity = capacity > 0 ? capacity : VALUE_INITIAL_CAPACITY;
+    v.numeric_array.offset = 0;
+    v.numeric_array.stride = 1;
     v.numeric_array.data = malloc(numeric_buffer_bytes(v.numeric_array.capacity, dtype));
+    v.numeric_array.ref_count = malloc(sizeof(int));
+    if (v.numeric_array.data == NULL || v.numeric_array.ref_count == NULL) {
+        free(v.numeric_array.data);
+        free(v.numeric_array.ref_count);
+        return value_null();
+    }
+    *v.numeric_array.ref_count = 1;
+    MEM_PROFILE_ALLOC(VALUE_NUMERIC_ARRAY, numeric_buffer_bytes(v.numeric_array.capacity, dtype));
 
     return v;
 }
@@ -279,7 +384,7 @@ Value value_numeric_array_from_data_with_dtype(const double *data, int length, N
     if (length < 0) return value_null();
 
     Value v = value_numeric_array_with_dtype(length > 0 ? length : VALUE_INITIAL_CAPACITY, dtype);
-    if (v.numeric_array.data == NULL) return value_null();
+    if (v.type != VALUE_NUMERIC_ARRAY) return value_null();
 
     v.numeric_array.length = length;
     if (data != NULL && length > 0) {
@@ -319,6 +424,7 @@ Value value_matrix_with_dtype(int rows, int cols, NumericDType dtype) {
         free(v.matrix.ref_count);
         return value_null();
     }
+    MEM_PROFILE_ALLOC(VALUE_MATRIX, count * (size_t)numeric_dtype_size(dtype));
 
     return v;
 }
@@ -341,6 +447,132 @@ Value value_matrix_from_data_with_dtype(const double *data, int rows, int cols,
     return v;
 }
 
+// mapping 全体の所有権を引き取り、参照数 0 の NumericMapping を作る
+static int *numeric_mapping_new(void *mapping, size_t mapping_size) {
+    NumericMapping *owner = malloc(sizeof(NumericMapping));
+    if (owner == NULL) {
+        numeric_mapping_unmap(mapping, mapping_size);
+        return NULL;
+    }
+    owner->ref_count = NUMERIC_MAPPED_BIAS;
+    owner->base = mapping;
+    owner->length = mapping_size;
+    return &owner->ref_count;
+}
+
+Value value_numeric_array_mapped(void *mapping, size_t mapping_size, size_t data_offset,
+                                 NumericDType dtype, int length) {
+    int *ref_count = numeric_mapping_new(mapping, mapping_size);
+    if (ref_count == NULL) return value_null();
+
+    Value v;
+    v.type = VALUE_NUMERIC_ARRAY;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    v.numeric_array.dtype = dtype;
+    v.numeric_array.data = (char *)mapping + data_offset;
+    v.numeric_array.length = length;
+    v.numeric_array.capacity = length;
+    v.numeric_array.offset = 0;
+    v.numeric_array.stride = 1;
+    v.numeric_array.ref_count = ref_count;
+    numeric_shared_retain(ref_count);
+    return v;
+}
+
+Value value_matrix_mapped(void *mapping, size_t mapping_size, size_t data_offset,
+                          NumericDType dtype, int rows, int cols, bool column_major) {
+    int *ref_count = numeric_mapping_new(mapping, mapping_size);
+    if (ref_count == NULL) return value_null();
+
+    Value v;
+    v.type = VALUE_MATRIX;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    v.matrix.dtype = dtype;
+    v.matrix.data = (char *)mapping + data_offset;
+    v.matrix.rows = rows;
+    v.matrix.cols = cols;
+    v.matrix.row_stride = column_major ? 1 : cols;
+    v.matrix.col_stride = column_major ? rows : 1;
+    v.matrix.offset = 0;
+    v.matrix.ref_count = ref_count;
+    numeric_shared_retain(ref_count);
+    return v;
+}
+
+// バイト列の単独所有バッファ。末尾に NUL 用の 1 バイトを余分に確保する
+Value value_bytes_alloc(int length, uint8_t **out) {
+    if (length < 0) return value_null();
+    uint8_t *data = malloc((size_t)length + 1);
+    if (data == NULL) return value_null();
+    data[length] = '\0';
+
+    Value v = value_bytes_take(data, length);
+    if (v.type == VALUE_BYTES && out != NULL) {
+        *out = data;
+    }
+    return v;
+}
+
+Value value_bytes(const void *data, int length) {
+    uint8_t *out = NULL;
+    Value v = value_bytes_alloc(length, &out);
+    if (v.type == VALUE_BYTES && length > 0) {
+        memcpy(out, data, (size_t)length);
+    }
+    return v;
+}
+
+// ヒープに確保したバイト列バッファの参照数。スライスは長さや位置が元と違うため、
+// 解放量を確保時と揃えられるよう確保サイズも持つ
+typedef struct {
+    int ref_count;     // 先頭に置き、int * として Value から参照する
+    size_t size;       // 確保したバイト数（NUL 用の 1 バイトを含む）
+} BytesBuffer;
+
+Value value_bytes_take(void *data, int length) {
+    BytesBuffer *buffer = malloc(sizeof(BytesBuffer));
+    if (buffer == NULL) {
+        free(data);
+        return value_null();
+    }
+    buffer->ref_count = 1;
+    buffer->size = (size_t)length + 1;
+    int *ref_count = &buffer->ref_count;
+
+    Value v;
+    v.type = VALUE_BYTES;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    v.bytes.data = data;
+    v.bytes.offset = 0;
+    v.bytes.length = length;
+    v.bytes.ref_count = ref_count;
+    MEM_PROFILE_ALLOC(VALUE_BYTES, buffer->size);
+    return v;
+}
+
+Value value_bytes_mapped(void *mapping, size_t mapping_size, size_t data_offset, int length) {
+    int *ref_count = numeric_mapping_new(mapping, mapping_size);
+    if (ref_count == NULL) return value_null();
+
+    Value v;
+    v.type = VALUE_BYTES;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    v.bytes.data = (uint8_t *)mapping + data_offset;
+    v.bytes.offset = 0;
+    v.bytes.length = length;
+    v.bytes.ref_count = ref_count;
+    numeric_shared_retain(ref_count);
+    return v;
+}
+
 Value value_function(struct ASTNode *definition, struct Environment *closure) {
     Value v;
     v.type = VALUE_FUNCTION;
@@ -417,6 +649,49 @@ Value value_generator(void) {
     return v;
 }
 
+Value value_file(FILE *fp, const char *path, size_t buffer_size, bool readable, bool writable) {
+    Value v;
+    v.type = VALUE_FILE;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+
+    FileHandle *handle = calloc(1, sizeof(FileHandle));
+    handle->fp = fp;
+    handle->path = strdup(path != NULL ? path : "");
+    handle->readable = readable;
+    handle->writable = writable;
+    handle->ref_count = 1;
+    if (buffer_size > 0) {
+        // setvbuf は最初の入出力より前に呼ぶ必要がある
+        handle->buffer = malloc(buffer_size);
+        if (handle->buffer != NULL &&
+            setvbuf(fp, handle->buffer, _IOFBF, buffer_size) == 0) {
+            handle->buffer_size = buffer_size;
+        } else {
+            free(handle->buffer);
+            handle->buffer = NULL;
+        }
+    }
+    if (handle->buffer_size == 0) {
+        handle->buffer_size = BUFSIZ;
+    }
+    v.file.handle = handle;
+
+    return v;
+}
+
+Value value_regex(RegexHandle *handle) {
+    Value v;
+    v.type = VALUE_REGEX;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    regex_handle_retain(handle);
+    v.regex.handle = handle;
+    return v;
+}
+
 void generator_add_value(Value *gen, Value val) {
     if (gen->type != VALUE_GENERATOR || gen->generator.state == NULL) return;
     GeneratorState *s = gen->generator.state;
@@ -575,6 +850,7 @@ Value value_dict_with_capacity(int capacity) {
         v.dict.values = NULL;
         v.dict.capacity = 0;
     }
+    MEM_PROFILE_ALLOC(VALUE_DICT, (sizeof(char *) + sizeof(Value)) * (size_t)v.dict.capacity);
     
     return v;
 }
@@ -588,6 +864,7 @@ Value value_copy(Value v) {
     
     switch (v.type) {
         case VALUE_STRING:
+            MEM_PROFILE_COPY(VALUE_STRING, (size_t)v.string.capacity);
             copy.string.data = malloc(v.string.capacity);
             if (copy.string.data == NULL) return value_null();
             memcpy(copy.string.data, v.string.data, v.string.byte_length + 1);
@@ -595,6 +872,7 @@ Value value_copy(Value v) {
             break;
 
         case VALUE_ARRAY:
+            MEM_PROFILE_COPY(VALUE_ARRAY, sizeof(Value) * (size_t)v.array.capacity);
             copy.array.elements = malloc(sizeof(Value) * v.array.capacity);
             if (copy.array.elements == NULL) return value_null();
             for (int i = 0; i < v.array.length; i++) {
@@ -604,8 +882,26 @@ Value value_copy(Value v) {
             break;
 
         case VALUE_NUMERIC_ARRAY:
-            copy.numeric_array.data = malloc(numeric_buffer_bytes(v.numeric_array.capacity, v.numeric_array.dtype));
-            if (copy.numeric_array.data == NULL) return value_null();
+            // 共有可能なバッファは参照数だけ増やし、書き込み時に複製する
+            if (v.numeric_array.ref_count != NULL) {
+                MEM_PROFILE_COPY(VALUE_NUMERIC_ARRAY, 0);
+                numeric_shared_retain(v.numeric_array.ref_count);
+                copy.ref_count = 1;
+                break;
+            }
+            copy.numeric_array.capacity = v.numeric_array.length > 0 ? v.numeric_array.length : VALUE_INITIAL_CAPACITY;
+            MEM_PROFILE_COPY(VALUE_NUMERIC_ARRAY,
+                             numeric_buffer_bytes(copy.numeric_array.capacity, v.numeric_array.dtype));
+            copy.numeric_array.offset = 0;
+            copy.numeric_array.stride = 1;
+            copy.numeric_array.data = malloc(numeric_buffer_bytes(copy.numeric_array.capacity, v.numeric_array.dtype));
+            copy.numeric_array.ref_count = malloc(sizeof(int));
+            if (copy.numeric_array.data == NULL || copy.numeric_array.ref_count == NULL) {
+                free(copy.numeric_array.data);
+                free(copy.numeric_array.ref_count);
+                return value_null();
+            }
+            *copy.numeric_array.ref_count = 1;
             if (v.numeric_array.length > 0) {
                 memcpy(copy.numeric_array.data, v.numeric_array.data,
                        numeric_buffer_bytes(v.numeric_array.length, v.numeric_array.dtype));
@@ -614,7 +910,14 @@ Value value_copy(Value v) {
             break;
 
         case VALUE_MATRIX: {
+            if (v.matrix.ref_count != NULL) {
+                MEM_PROFILE_COPY(VALUE_MATRIX, 0);
+                numeric_shared_retain(v.matrix.ref_count);
+                copy.ref_count = 1;
+                break;
+            }
             size_t count = (size_t)v.matrix.rows * (size_t)v.matrix.cols;
+            MEM_PROFILE_COPY(VALUE_MATRIX, count * (size_t)numeric_dtype_size(v.matrix.dtype));
             copy.matrix.data = count > 0 ? malloc(count * (size_t)numeric_dtype_size(v.matrix.dtype)) : NULL;
             if (count > 0 && copy.matrix.data == NULL) return value_null();
             copy.matrix.row_stride = v.matrix.cols;
@@ -638,6 +941,7 @@ Value value_copy(Value v) {
         }
             
         case VALUE_DICT:
+            MEM_PROFILE_COPY(VALUE_DICT, (sizeof(char *) + sizeof(Value)) * (size_t)v.dict.capacity);
             copy.dict.keys = malloc(sizeof(char *) * v.dict.capacity);
             copy.dict.values = malloc(sizeof(Value) * v.dict.capacity);
             copy.dict.hash_indices = NULL;
@@ -692,6 +996,8 @@ Value value_copy(Value v) {
 
         case VALUE_INSTANCE:
             // インスタンスはディープコピー
+            MEM_PROFILE_COPY(VALUE_INSTANCE,
+                             (sizeof(char *) + sizeof(Value)) * (size_t)v.instance.field_capacity);
             copy.instance.field_names = malloc(sizeof(char *) * v.instance.field_capacity);
             copy.instance.fields = malloc(sizeof(Value) * v.instance.field_capacity);
             if (copy.instance.field_names == NULL || copy.instance.fields == NULL) {
@@ -735,6 +1041,27 @@ Value value_copy(Value v) {
             }
             copy.ref_count = 1;
             break;
+        
+        case VALUE_BYTES:
+            // バイト列は不変なのでバッファを共有する
+            MEM_PROFILE_COPY(VALUE_BYTES, 0);
+            numeric_shared_retain(v.bytes.ref_count);
+            copy.ref_count = 1;
+            break;
+        
+        case VALUE_REGEX:
+            // コンパイル済みのパターンを共有する
+            regex_handle_retain(v.regex.handle);
+            copy.ref_count = 1;
+            break;
+        
+        case VALUE_FILE:
+            // ファイルハンドルも同じストリームを共有する
+            if (v.file.handle != NULL) {
+                v.file.handle->ref_count++;
+            }
+            copy.ref_count = 1;
+            break;
             
         default:
             break;
@@ -749,6 +1076,7 @@ void value_free(Value *v) {
     switch (v->type) {
         case VALUE_STRING:
             if (v->string.data != NULL) {
+                MEM_PROFILE_FREE(VALUE_STRING, (size_t)v->string.capacity);
                 free(v->string.data);
                 v->string.data = NULL;
             }
@@ -756,6 +1084,7 @@ void value_free(Value *v) {
             
         case VALUE_ARRAY:
             if (v->array.elements != NULL) {
+                MEM_PROFILE_FREE(VALUE_ARRAY, sizeof(Value) * (size_t)v->array.capacity);
                 for (int i = 0; i < v->array.length; i++) {
                     value_free(&v->array.elements[i]);
                 }
@@ -765,16 +1094,29 @@ void value_free(Value *v) {
             break;
 
         case VALUE_NUMERIC_ARRAY:
-            free(v->numeric_array.data);
+            if (v->numeric_array.ref_count != NULL) {
+                if (numeric_shared_release(v->numeric_array.ref_count)) {
+                    MEM_PROFILE_FREE(VALUE_NUMERIC_ARRAY,
+                                     numeric_buffer_bytes(v->numeric_array.capacity, v->numeric_array.dtype));
+                    free(v->numeric_array.data);
+                    free(v->numeric_array.ref_count);
+                }
+            } else {
+                free(v->numeric_array.data);
+            }
             v->numeric_array.data = NULL;
             v->numeric_array.length = 0;
             v->numeric_array.capacity = 0;
+            v->numeric_array.offset = 0;
+            v->numeric_array.stride = 1;
+            v->numeric_array.ref_count = NULL;
             break;
 
         case VALUE_MATRIX:
             if (v->matrix.ref_count != NULL) {
-                (*v->matrix.ref_count)--;
-                if (*v->matrix.ref_count <= 0) {
+                if (numeric_shared_release(v->matrix.ref_count)) {
+                    MEM_PROFILE_FREE(VALUE_MATRIX, (size_t)v->matrix.rows * (size_t)v->matrix.cols *
+                                                   (size_t)numeric_dtype_size(v->matrix.dtype));
                     free(v->matrix.data);
                     free(v->matrix.ref_count);
                 }
@@ -792,6 +1134,7 @@ void value_free(Value *v) {
             
         case VALUE_DICT:
             if (v->dict.keys != NULL) {
+                MEM_PROFILE_FREE(VALUE_DICT, (sizeof(char *) + sizeof(Value)) * (size_t)v->dict.capacity);
                 for (int i = 0; i < v->dict.length; i++) {
                     free(v->dict.keys[i]);
                     value_free(&v->dict.values[i]);
@@ -841,6 +1184,28 @@ void value_free(Value *v) {
             generator_state_release(&v->generator.state);
             break;
         
+        case VALUE_FILE:
+            file_handle_release(&v->file.handle);
+            break;
+        
+        case VALUE_REGEX:
+            regex_handle_release(v->regex.handle);
+            v->regex.handle = NULL;
+            break;
+        
+        case VALUE_BYTES:
+            // 最後の参照のときだけ、view ではなく確保したバッファ全体の大きさを数える
+            if (numeric_shared_release(v->bytes.ref_count)) {
+                MEM_PROFILE_FREE(VALUE_BYTES, ((BytesBuffer *)v->bytes.ref_count)->size);
+                free(v->bytes.data);
+                free(v->bytes.ref_count);
+            }
+            v->bytes.data = NULL;
+            v->bytes.offset = 0;
+            v->bytes.length = 0;
+            v->bytes.ref_count = NULL;
+            break;
+        
         case VALUE_FUNCTION:
             // クロージャ環境の参照カウントを減少
             if (v->function.closure != NULL) {
@@ -869,6 +1234,9 @@ void value_retain(Value *v) {
         case VALUE_INSTANCE:
         case VALUE_CLASS:
         case VALUE_GENERATOR:
+        case VALUE_FILE:
+        case VALUE_BYTES:
+        case VALUE_REGEX:
             v->ref_count++;
             break;
         default:
@@ -889,6 +1257,9 @@ void value_release(Value *v) {
         case VALUE_INSTANCE:
         case VALUE_CLASS:
         case VALUE_GENERATOR:
+        case VALUE_FILE:
+        case VALUE_BYTES:
+        case VALUE_REGEX:
             v->ref_count--;
             if (v->ref_count <= 0) {
                 value_free(v);
@@ -908,6 +1279,8 @@ void array_push(Value *array, Value element) {
     
     // 容量が足りなければ拡張
     if (array->array.length >= array->array.capacity) {
+        MEM_PROFILE_RESIZE(VALUE_ARRAY, sizeof(Value) * (size_t)array->array.capacity,
+                           sizeof(Value) * (size_t)(array->array.capacity ? array->array.capacity * 2 : 8));
         ARRAY_GROW(
             array->array.elements,
             array->array.length,
@@ -966,15 +1339,68 @@ int array_length(Value *array) {
 // 数値ベクトル操作
 // =============================================================================
 
+static int numeric_array_slot(const Value *array, int index) {
+    return array->numeric_array.offset + index * array->numeric_array.stride;
+}
+
+// view・共有バッファを単独所有の連続バッファへ複製する
+static bool numeric_array_detach(Value *array, int capacity) {
+    NumericDType dtype = array->numeric_array.dtype;
+    int length = array->numeric_array.length;
+    if (capacity < length) capacity = length;
+    if (capacity <= 0) capacity = VALUE_INITIAL_CAPACITY;
+
+    void *data = malloc(numeric_buffer_bytes(capacity, dtype));
+    int *ref_count = malloc(sizeof(int));
+    if (data == NULL || ref_count == NULL) {
+        free(data);
+        free(ref_count);
+        return false;
+    }
+    *ref_count = 1;
+
+    size_t elem_size = (size_t)numeric_dtype_size(dtype);
+    const char *src = (const char *)array->numeric_array.data;
+    if (length > 0 && array->numeric_array.stride == 1) {
+        memcpy(data, src + (size_t)array->numeric_array.offset * elem_size, (size_t)length * elem_size);
+    } else {
+        for (int i = 0; i < length; i++) {
+            memcpy((char *)data + (size_t)i * elem_size,
+                   src + (size_t)numeric_array_slot(array, i) * elem_size, elem_size);
+        }
+    }
+
+    MEM_PROFILE_COPY(VALUE_NUMERIC_ARRAY, numeric_buffer_bytes(capacity, dtype));
+    if (numeric_shared_release(array->numeric_array.ref_count)) {
+        MEM_PROFILE_FREE(VALUE_NUMERIC_ARRAY, numeric_buffer_bytes(array->numeric_array.capacity, dtype));
+        free(array->numeric_array.data);
+        free(array->numeric_array.ref_count);
+    }
+    array->numeric_array.data = data;
+    array->numeric_array.ref_count = ref_count;
+    array->numeric_array.capacity = capacity;
+    array->numeric_array.offset = 0;
+    array->numeric_array.stride = 1;
+    return true;
+}
+
 void numeric_array_push(Value *array, double element) {
     if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return;
 
+    if (!numeric_array_is_contiguous(array) || !numeric_shared_is_unique(array->numeric_array.ref_count)) {
+        int length = array->numeric_array.length;
+        if (!numeric_array_detach(array, length > 0 ? length * 2 : VALUE_INITIAL_CAPACITY)) abort();
+    }
+
     if (array->numeric_array.length >= array->numeric_array.capacity) {
         int old_capacity = array->numeric_array.capacity;
         int new_capacity = old_capacity > 0 ? old_capacity * 2 : VALUE_INITIAL_CAPACITY;
         void *new_data = realloc(array->numeric_array.data,
                                  numeric_buffer_bytes(new_capacity, array->numeric_array.dtype));
         if (new_data == NULL) abort();
+        MEM_PROFILE_RESIZE(VALUE_NUMERIC_ARRAY,
+                           numeric_buffer_bytes(old_capacity, array->numeric_array.dtype),
+                           numeric_buffer_bytes(new_capacity, array->numeric_array.dtype));
         array->numeric_array.data = new_data;
         array->numeric_array.capacity = new_capacity;
     }
@@ -986,19 +1412,26 @@ void numeric_array_push(Value *array, double element) {
 double numeric_array_get(Value *array, int index) {
     if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return 0.0;
     if (index < 0 || index >= array->numeric_array.length) return 0.0;
-    return numeric_read_at(array->numeric_array.data, array->numeric_array.dtype, index);
+    return numeric_read_at(array->numeric_array.data, array->numeric_array.dtype,
+                           numeric_array_slot(array, index));
 }
 
 bool numeric_array_set(Value *array, int index, double element) {
     if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return false;
     if (index < 0 || index >= array->numeric_array.length) return false;
-    numeric_write_at(array->numeric_array.data, array->numeric_array.dtype, index, element);
+    if (!numeric_shared_is_unique(array->numeric_array.ref_count) &&
+        !numeric_array_detach(array, array->numeric_array.length)) {
+        return false;
+    }
+    numeric_write_at(array->numeric_array.data, array->numeric_array.dtype,
+                     numeric_array_slot(array, index), element);
     return true;
 }
 
 void *numeric_array_raw_data(Value *array) {
-    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return NULL;
-    return array->numeric_array.data;
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY || array->numeric_array.data == NULL) return NULL;
+    return (char *)array->numeric_array.data +
+           (size_t)array->numeric_array.offset * (size_t)numeric_dtype_size(array->numeric_array.dtype);
 }
 
 int numeric_array_length(Value *array) {
@@ -1006,6 +1439,60 @@ int numeric_array_length(Value *array) {
     return array->numeric_array.length;
 }
 
+bool numeric_array_is_contiguous(Value *array) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return false;
+    return array->numeric_array.offset == 0 && array->numeric_array.stride == 1;
+}
+
+bool numeric_array_make_unique(Value *array) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return false;
+    if (numeric_array_is_contiguous(array) && numeric_shared_is_unique(array->numeric_array.ref_count)) {
+        return true;
+    }
+    return numeric_array_detach(array, array->numeric_array.length);
+}
+
+// 共有バッファ上の数値ベクトル view を作る（ref_count は呼び出し側で確認済み）
+static Value numeric_view_of(void *data, int *ref_count, NumericDType dtype,
+                             int offset, int length, int stride) {
+    Value v;
+    v.type = VALUE_NUMERIC_ARRAY;
+    v.is_const = false;
+    v.is_integer = false;
+    v.ref_count = 1;
+    v.numeric_array.dtype = dtype;
+    v.numeric_array.data = data;
+    v.numeric_array.length = length;
+    v.numeric_array.capacity = length;
+    v.numeric_array.offset = offset;
+    v.numeric_array.stride = stride;
+    v.numeric_array.ref_count = ref_count;
+    numeric_shared_retain(ref_count);
+    return v;
+}
+
+Value numeric_array_view(Value *array, int start, int length, int step) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY || step <= 0 || start < 0 || length < 0) {
+        return value_null();
+    }
+    if (length > 0 && start + (length - 1) * step >= array->numeric_array.length) {
+        return value_null();
+    }
+
+    if (array->numeric_array.ref_count == NULL) {
+        Value copy = value_numeric_array_with_dtype(length, array->numeric_array.dtype);
+        for (int i = 0; i < length; i++) {
+            numeric_array_push(&copy, numeric_array_get(array, start + i * step));
+        }
+        return copy;
+    }
+
+    return numeric_view_of(array->numeric_array.data, array->numeric_array.ref_count,
+                           array->numeric_array.dtype,
+                           numeric_array_slot(array, start), length,
+                           array->numeric_array.stride * step);
+}
+
 // =============================================================================
 // 数値行列操作
 // =============================================================================
@@ -1021,11 +1508,54 @@ double matrix_get(Value *matrix, int row, int col) {
     return numeric_read_at(matrix->matrix.data, matrix->matrix.dtype, index);
 }
 
+// 共有中の行列バッファを単独所有の row-major 連続バッファへ複製する
+static bool matrix_detach(Value *matrix) {
+    NumericDType dtype = matrix->matrix.dtype;
+    int rows = matrix->matrix.rows;
+    int cols = matrix->matrix.cols;
+    size_t count = (size_t)rows * (size_t)cols;
+    size_t elem_size = (size_t)numeric_dtype_size(dtype);
+
+    void *data = count > 0 ? malloc(count * elem_size) : NULL;
+    int *ref_count = malloc(sizeof(int));
+    if ((count > 0 && data == NULL) || ref_count == NULL) {
+        free(data);
+        free(ref_count);
+        return false;
+    }
+    *ref_count = 1;
+
+    const char *src = (const char *)matrix->matrix.data;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int index = matrix->matrix.offset + r * matrix->matrix.row_stride + c * matrix->matrix.col_stride;
+            memcpy((char *)data + ((size_t)r * (size_t)cols + (size_t)c) * elem_size,
+                   src + (size_t)index * elem_size, elem_size);
+        }
+    }
+
+    MEM_PROFILE_COPY(VALUE_MATRIX, count * elem_size);
+    if (numeric_shared_release(matrix->matrix.ref_count)) {
+        MEM_PROFILE_FREE(VALUE_MATRIX, count * elem_size);
+        free(matrix->matrix.data);
+        free(matrix->matrix.ref_count);
+    }
+    matrix->matrix.data = data;
+    matrix->matrix.ref_count = ref_count;
+    matrix->matrix.row_stride = cols;
+    matrix->matrix.col_stride = 1;
+    matrix->matrix.offset = 0;
+    return true;
+}
+
 bool matrix_set(Value *matrix, int row, int col, double element) {
     if (matrix == NULL || matrix->type != VALUE_MATRIX) return false;
     if (row < 0 || row >= matrix->matrix.rows || col < 0 || col >= matrix->matrix.cols) {
         return false;
     }
+    if (!numeric_shared_is_unique(matrix->matrix.ref_count) && !matrix_detach(matrix)) {
+        return false;
+    }
     int index = matrix->matrix.offset +
                 row * matrix->matrix.row_stride +
                 col * matrix->matrix.col_stride;
@@ -1045,6 +1575,814 @@ bool matrix_is_contiguous(Value *matrix) {
            matrix->matrix.col_stride == 1;
 }
 
+bool matrix_make_unique(Value *matrix) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX) return false;
+    if (matrix_is_contiguous(matrix) && numeric_shared_is_unique(matrix->matrix.ref_count)) {
+        return true;
+    }
+    return matrix_detach(matrix);
+}
+
+Value matrix_row_view(Value *matrix, int row) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX || row < 0 || row >= matrix->matrix.rows) {
+        return value_null();
+    }
+
+    if (matrix->matrix.ref_count == NULL) {
+        Value copy = value_numeric_array_with_dtype(matrix->matrix.cols, matrix->matrix.dtype);
+        for (int c = 0; c < matrix->matrix.cols; c++) {
+            numeric_array_push(&copy, matrix_get(matrix, row, c));
+        }
+        return copy;
+    }
+
+    return numeric_view_of(matrix->matrix.data, matrix->matrix.ref_count, matrix->matrix.dtype,
+                           matrix->matrix.offset + row * matrix->matrix.row_stride,
+                           matrix->matrix.cols, matrix->matrix.col_stride);
+}
+
+Value matrix_column_view(Value *matrix, int col) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX || col < 0 || col >= matrix->matrix.cols) {
+        return value_null();
+    }
+
+    if (matrix->matrix.ref_count == NULL) {
+        Value copy = value_numeric_array_with_dtype(matrix->matrix.rows, matrix->matrix.dtype);
+        for (int r = 0; r < matrix->matrix.rows; r++) {
+            numeric_array_push(&copy, matrix_get(matrix, r, col));
+        }
+        return copy;
+    }
+
+    return numeric_view_of(matrix->matrix.data, matrix->matrix.ref_count, matrix->matrix.dtype,
+                           matrix->matrix.offset + col * matrix->matrix.col_stride,
+                           matrix->matrix.rows, matrix->matrix.row_stride);
+}
+
+Value matrix_rows_view(Value *matrix, int start, int rows) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX || start < 0 || rows < 0 ||
+        start + rows > matrix->matrix.rows) {
+        return value_null();
+    }
+
+    if (matrix->matrix.ref_count == NULL) {
+        Value copy = value_matrix_with_dtype(rows, matrix->matrix.cols, matrix->matrix.dtype);
+        if (copy.type != VALUE_MATRIX) return copy;
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < matrix->matrix.cols; c++) {
+                matrix_set(&copy, r, c, matrix_get(matrix, start + r, c));
+            }
+        }
+        return copy;
+    }
+
+    Value view = *matrix;
+    view.ref_count = 1;
+    view.is_const = false;
+    view.matrix.rows = rows;
+    view.matrix.offset = matrix->matrix.offset + start * matrix->matrix.row_stride;
+    numeric_shared_retain(view.matrix.ref_count);
+    return view;
+}
+
+Value matrix_transpose_view(Value *matrix) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX) return value_null();
+
+    if (matrix->matrix.ref_count == NULL) {
+        Value copy = value_matrix_with_dtype(matrix->matrix.cols, matrix->matrix.rows, matrix->matrix.dtype);
+        if (copy.type != VALUE_MATRIX) return copy;
+        for (int r = 0; r < matrix->matrix.rows; r++) {
+            for (int c = 0; c < matrix->matrix.cols; c++) {
+                matrix_set(&copy, c, r, matrix_get(matrix, r, c));
+            }
+        }
+        return copy;
+    }
+
+    Value view = *matrix;
+    view.ref_count = 1;
+    view.is_const = false;
+    view.matrix.rows = matrix->matrix.cols;
+    view.matrix.cols = matrix->matrix.rows;
+    view.matrix.row_stride = matrix->matrix.col_stride;
+    view.matrix.col_stride = matrix->matrix.row_stride;
+    numeric_shared_retain(view.matrix.ref_count);
+    return view;
+}
+
+bool numeric_shares_memory(Value *a, Value *b) {
+    if (a == NULL || b == NULL) return false;
+    void *left = a->type == VALUE_NUMERIC_ARRAY ? a->numeric_array.data
+               : a->type == VALUE_MATRIX ? a->matrix.data : NULL;
+    void *right = b->type == VALUE_NUMERIC_ARRAY ? b->numeric_array.data
+                : b->type == VALUE_MATRIX ? b->matrix.data : NULL;
+    return left != NULL && left == right;
+}
+
+// =============================================================================
+// dtype ネイティブの数値カーネル
+// =============================================================================
+//
+// 要素を double へ変換せず、各 dtype の型のまま演算・集計します。
+// 型の広げ方は numeric_binary_result_dtype() にまとめています。
+
+static int64_t numeric_double_to_i64(double value) {
+    if (isnan(value)) return 0;
+    if (value >= 9223372036854775807.0) return INT64_MAX;
+    if (value <= -9223372036854775808.0) return INT64_MIN;
+    return (int64_t)value;
+}
+
+static int32_t numeric_double_to_i32(double value) {
+    if (isnan(value)) return 0;
+    if (value > (double)INT32_MAX) return INT32_MAX;
+    if (value < (double)INT32_MIN) return INT32_MIN;
+    return (int32_t)value;
+}
+
+static int32_t numeric_i64_to_i32(int64_t value) {
+    if (value > INT32_MAX) return INT32_MAX;
+    if (value < INT32_MIN) return INT32_MIN;
+    return (int32_t)value;
+}
+
+static bool numeric_dtype_is_integer(NumericDType dtype) {
+    return dtype == NUMERIC_DTYPE_I64 || dtype == NUMERIC_DTYPE_I32;
+}
+
+NumericDType numeric_binary_result_dtype(NumericDType left, NumericDType right, NumericBinaryOp op) {
+    // bool は算術では i64 として数える
+    if (left == NUMERIC_DTYPE_BOOL) left = NUMERIC_DTYPE_I64;
+    if (right == NUMERIC_DTYPE_BOOL) right = NUMERIC_DTYPE_I64;
+
+    NumericDType result;
+    if (left == right) {
+        result = left;
+    } else if (numeric_dtype_is_integer(left) && numeric_dtype_is_integer(right)) {
+        result = NUMERIC_DTYPE_I64;
+    } else {
+        // f32 と整数、または f64 を含む組み合わせは f64 へ広げる
+        result = NUMERIC_DTYPE_F64;
+    }
+
+    // 整数同士の除算・べき乗は小数になり得るので f64 で計算する
+    if ((op == NUMERIC_OP_DIV || op == NUMERIC_OP_POW) && numeric_dtype_is_integer(result)) {
+        result = NUMERIC_DTYPE_F64;
+    }
+    return result;
+}
+
+NumericDType numeric_scalar_dtype(double scalar, NumericDType other) {
+    if (other == NUMERIC_DTYPE_F64 || other == NUMERIC_DTYPE_F32) return other;
+
+    NumericDType integer_dtype = other == NUMERIC_DTYPE_BOOL ? NUMERIC_DTYPE_I64 : other;
+    double low = integer_dtype == NUMERIC_DTYPE_I32 ? (double)INT32_MIN : -9007199254740992.0;
+    double high = integer_dtype == NUMERIC_DTYPE_I32 ? (double)INT32_MAX : 9007199254740992.0;
+    if (scalar == floor(scalar) && scalar >= low && scalar <= high) {
+        return integer_dtype;
+    }
+    return NUMERIC_DTYPE_F64;
+}
+
+// 連続または stride 付きの入力を型 T のまま読み、o[i] = EXPR(x, y) を書く。
+// 片側がスカラーのときは stride 0 の代わりにループ外で 1 回だけ変換する。
+#define NUMERIC_BINARY_LOOP(T, SCALAR_CAST, EXPR)                                      \
+    do {                                                                               \
+        T *o = (T *)out;                                                               \
+        const T *pa = (const T *)left;                                                 \
+        const T *pb = (const T *)right;                                                \
+        T sa = pa == NULL ? SCALAR_CAST(left_scalar) : (T)0;                           \
+        T sb = pb == NULL ? SCALAR_CAST(right_scalar) : (T)0;                          \
+        if (pa != NULL && pb != NULL && left_stride == 1 && right_stride == 1) {       \
+            for (int i = 0; i < n; i++) { T x = pa[i]; T y = pb[i]; o[i] = (EXPR); }   \
+        } else if (pa != NULL && pb == NULL && left_stride == 1) {                     \
+            for (int i = 0; i < n; i++) { T x = pa[i]; T y = sb; o[i] = (EXPR); }     \
+        } else if (pa == NULL && pb != NULL && right_stride == 1) {                    \
+            for (int i = 0; i < n; i++) { T x = sa; T y = pb[i]; o[i] = (EXPR); }     \
+        } else {                                                                       \
+            for (int i = 0; i < n; i++) {                                              \
+                T x = pa != NULL ? pa[(ptrdiff_t)i * left_stride] : sa;                \
+                T y = pb != NULL ? pb[(ptrdiff_t)i * right_stride] : sb;               \
+                o[i] = (EXPR);                                                         \
+            }                                                                          \
+        }                                                                              \
+    } while (0)
+
+#define NUMERIC_CAST_F64(v) ((double)(v))
+#define NUMERIC_CAST_F32(v) ((float)(v))
+#define NUMERIC_CAST_I64(v) numeric_double_to_i64(v)
+#define NUMERIC_CAST_I32(v) numeric_double_to_i32(v)
+
+// 整数の加減乗算は符号なしで計算して 2 の補数で折り返す（符号付きオーバーフローを避ける）
+#define NUMERIC_INTEGER_KERNEL(T, U, SCALAR_CAST)                                      \
+    switch (op) {                                                                      \
+        case NUMERIC_OP_ADD: NUMERIC_BINARY_LOOP(T, SCALAR_CAST, (T)((U)x + (U)y)); break; \
+        case NUMERIC_OP_SUB: NUMERIC_BINARY_LOOP(T, SCALAR_CAST, (T)((U)x - (U)y)); break; \
+        case NUMERIC_OP_MUL: NUMERIC_BINARY_LOOP(T, SCALAR_CAST, (T)((U)x * (U)y)); break; \
+        case NUMERIC_OP_MOD: NUMERIC_BINARY_LOOP(T, SCALAR_CAST, (T)(y == -1 ? 0 : x % y)); break; \
+        default: return -2;                                                            \
+    }
+
+static int numeric_zero_divisor_index(NumericDType dtype, const void *right, int right_stride,
+                                      double right_scalar, int n) {
+    if (right == NULL) return right_scalar == 0.0 && n > 0 ? 0 : -1;
+    for (int i = 0; i < n; i++) {
+        ptrdiff_t slot = (ptrdiff_t)i * right_stride;
+        bool zero;
+        switch (dtype) {
+            case NUMERIC_DTYPE_F32: zero = ((const float *)right)[slot] == 0.0f; break;
+            case NUMERIC_DTYPE_I64: zero = ((const int64_t *)right)[slot] == 0; break;
+            case NUMERIC_DTYPE_I32: zero = ((const int32_t *)right)[slot] == 0; break;
+            case NUMERIC_DTYPE_F64:
+            default: zero = ((const double *)right)[slot] == 0.0; break;
+        }
+        if (zero) return i;
+    }
+    return -1;
+}
+
+int numeric_binary_kernel(NumericBinaryOp op, NumericDType dtype, void *out,
+                          const void *left, int left_stride, double left_scalar,
+                          const void *right, int right_stride, double right_scalar, int n) {
+    if (n <= 0) return -1;
+    if (op == NUMERIC_OP_DIV || op == NUMERIC_OP_MOD) {
+        int zero = numeric_zero_divisor_index(dtype, right, right_stride, right_scalar, n);
+        if (zero >= 0) return zero;
+    }
+
+    switch (dtype) {
+        case NUMERIC_DTYPE_F64:
+            switch (op) {
+                case NUMERIC_OP_ADD: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, x + y); break;
+                case NUMERIC_OP_SUB: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, x - y); break;
+                case NUMERIC_OP_MUL: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, x * y); break;
+                case NUMERIC_OP_DIV: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, x / y); break;
+                case NUMERIC_OP_MOD: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, fmod(x, y)); break;
+                case NUMERIC_OP_POW: NUMERIC_BINARY_LOOP(double, NUMERIC_CAST_F64, pow(x, y)); break;
+            }
+            return -1;
+        case NUMERIC_DTYPE_F32:
+            switch (op) {
+                case NUMERIC_OP_ADD: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, x + y); break;
+                case NUMERIC_OP_SUB: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, x - y); break;
+                case NUMERIC_OP_MUL: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, x * y); break;
+                case NUMERIC_OP_DIV: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, x / y); break;
+                case NUMERIC_OP_MOD: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, fmodf(x, y)); break;
+                case NUMERIC_OP_POW: NUMERIC_BINARY_LOOP(float, NUMERIC_CAST_F32, powf(x, y)); break;
+            }
+            return -1;
+        case NUMERIC_DTYPE_I64:
+            NUMERIC_INTEGER_KERNEL(int64_t, uint64_t, NUMERIC_CAST_I64);
+            return -1;
+        case NUMERIC_DTYPE_I32:
+            NUMERIC_INTEGER_KERNEL(int32_t, uint32_t, NUMERIC_CAST_I32);
+            return -1;
+        default:
+            return -2;
+    }
+}
+
+#undef NUMERIC_INTEGER_KERNEL
+#undef NUMERIC_BINARY_LOOP
+
+// stride 付きの src を連続した dst へ n 要素変換する
+#define NUMERIC_CONVERT_FROM(DST_T, CONVERT_F64, CONVERT_F32, CONVERT_I64, CONVERT_I32)   \
+    do {                                                                                \
+        DST_T *o = (DST_T *)dst;                                                        \
+        switch (src_dtype) {                                                            \
+            case NUMERIC_DTYPE_F64:                                                     \
+                for (int i = 0; i < n; i++) {                                           \
+                    double x = ((const double *)src)[(ptrdiff_t)i * src_stride];        \
+                    o[i] = CONVERT_F64(x);                                              \
+                }                                                                       \
+                break;                                                                  \
+            case NUMERIC_DTYPE_F32:                                                     \
+                for (int i = 0; i < n; i++) {                                           \
+                    float x = ((const float *)src)[(ptrdiff_t)i * src_stride];          \
+                    o[i] = CONVERT_F32(x);                                              \
+                }                                                                       \
+                break;                                                                  \
+            case NUMERIC_DTYPE_I64:                                                     \
+                for (int i = 0; i < n; i++) {                                           \
+                    int64_t x = ((const int64_t *)src)[(ptrdiff_t)i * src_stride];      \
+                    o[i] = CONVERT_I64(x);                                              \
+                }                                                                       \
+                break;                                                                  \
+            case NUMERIC_DTYPE_I32:                                                     \
+                for (int i = 0; i < n; i++) {                                           \
+                    int32_t x = ((const int32_t *)src)[(ptrdiff_t)i * src_stride];      \
+                    o[i] = CONVERT_I32(x);                                              \
+                }                                                                       \
+                break;                                                                  \
+            case NUMERIC_DTYPE_BOOL:                                                    \
+                for (int i = 0; i < n; i++) {                                           \
+                    uint8_t x = ((const uint8_t *)src)[(ptrdiff_t)i * src_stride];      \
+                    o[i] = (DST_T)(x ? 1 : 0);                                          \
+                }                                                                       \
+                break;                                                                  \
+        }                                                                               \
+    } while (0)
+
+#define NUMERIC_AS_F64(x) ((double)(x))
+#define NUMERIC_AS_F32(x) ((float)(x))
+#define NUMERIC_AS_I64(x) ((int64_t)(x))
+#define NUMERIC_AS_BOOL(x) ((uint8_t)((x) != 0 ? 1 : 0))
+#define NUMERIC_F_AS_BOOL(x) ((uint8_t)((x) != 0 && !isnan(x) ? 1 : 0))
+
+static void numeric_convert(void *dst, NumericDType dst_dtype,
+                            const void *src, NumericDType src_dtype, int src_stride, int n) {
+    if (n <= 0) return;
+    if (dst_dtype == src_dtype && src_stride == 1) {
+        memcpy(dst, src, (size_t)n * (size_t)numeric_dtype_size(dst_dtype));
+        return;
+    }
+    switch (dst_dtype) {
+        case NUMERIC_DTYPE_F64:
+            NUMERIC_CONVERT_FROM(double, NUMERIC_AS_F64, NUMERIC_AS_F64, NUMERIC_AS_F64, NUMERIC_AS_F64);
+            break;
+        case NUMERIC_DTYPE_F32:
+            NUMERIC_CONVERT_FROM(float, NUMERIC_AS_F32, NUMERIC_AS_F32, NUMERIC_AS_F32, NUMERIC_AS_F32);
+            break;
+        case NUMERIC_DTYPE_I64:
+            NUMERIC_CONVERT_FROM(int64_t, numeric_double_to_i64, numeric_double_to_i64,
+                                 NUMERIC_AS_I64, NUMERIC_AS_I64);
+            break;
+        case NUMERIC_DTYPE_I32:
+            NUMERIC_CONVERT_FROM(int32_t, numeric_double_to_i32, numeric_double_to_i32,
+                                 numeric_i64_to_i32, (int32_t));
+            break;
+        case NUMERIC_DTYPE_BOOL:
+            NUMERIC_CONVERT_FROM(uint8_t, NUMERIC_F_AS_BOOL, NUMERIC_F_AS_BOOL,
+                                 NUMERIC_AS_BOOL, NUMERIC_AS_BOOL);
+            break;
+    }
+}
+
+#undef NUMERIC_CONVERT_FROM
+
+static const void *numeric_array_base(Value *array) {
+    return (const char *)array->numeric_array.data +
+           (size_t)array->numeric_array.offset * (size_t)numeric_dtype_size(array->numeric_array.dtype);
+}
+
+Value numeric_array_astype(Value *array, NumericDType dtype) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return value_null();
+    int n = array->numeric_array.length;
+    Value result = value_numeric_array_with_dtype(n, dtype);
+    if (result.type != VALUE_NUMERIC_ARRAY) return value_null();
+    if (n > 0 && array->numeric_array.data != NULL) {
+        numeric_convert(result.numeric_array.data, dtype, numeric_array_base(array),
+                        array->numeric_array.dtype, array->numeric_array.stride, n);
+    }
+    result.numeric_array.length = n;
+    return result;
+}
+
+Value matrix_astype(Value *matrix, NumericDType dtype) {
+    if (matrix == NULL || matrix->type != VALUE_MATRIX) return value_null();
+    int rows = matrix->matrix.rows;
+    int cols = matrix->matrix.cols;
+    Value result = value_matrix_with_dtype(rows, cols, dtype);
+    if (result.type != VALUE_MATRIX || rows == 0 || cols == 0) return result;
+
+    size_t src_size = (size_t)numeric_dtype_size(matrix->matrix.dtype);
+    size_t dst_size = (size_t)numeric_dtype_size(dtype);
+    const char *src = (const char *)matrix->matrix.data;
+    char *dst = (char *)result.matrix.data;
+    if (matrix->matrix.row_stride == cols && matrix->matrix.col_stride == 1) {
+        numeric_convert(dst, dtype, src + (size_t)matrix->matrix.offset * src_size,
+                        matrix->matrix.dtype, 1, rows * cols);
+        return result;
+    }
+    // 転置 view などは行ごとに列 stride で変換する
+    for (int r = 0; r < rows; r++) {
+        numeric_convert(dst + (size_t)r * (size_t)cols * dst_size, dtype,
+                        src + (size_t)(matrix->matrix.offset + r * matrix->matrix.row_stride) * src_size,
+                        matrix->matrix.dtype, matrix->matrix.col_stride, cols);
+    }
+    return result;
+}
+
+// =============================================================================
+// 浮動小数点の縮約カーネル
+//
+// 合計・内積・偏差平方和は 4 本の部分和 s[i mod 4] に累積し、(s0 + s1) + (s2 + s3)
+// にまとめてから端数を順に足す。-msimd128 付きの WebAssembly ビルドでは
+// f64x2 を 2 本使って同じ順序で加算するので、ネイティブとブラウザで結果が一致する。
+// 依存連鎖が 4 本に分かれるため、スカラーでも逐次加算より速い。
+// =============================================================================
+
+static double numeric_f64_sum(const double *p, int stride, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (stride == 1) {
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            acc01 = wasm_f64x2_add(acc01, wasm_v128_load(p + i));
+            acc23 = wasm_f64x2_add(acc23, wasm_v128_load(p + i + 2));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        s0 += p[(ptrdiff_t)i * stride];
+        s1 += p[(ptrdiff_t)(i + 1) * stride];
+        s2 += p[(ptrdiff_t)(i + 2) * stride];
+        s3 += p[(ptrdiff_t)(i + 3) * stride];
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) total += p[(ptrdiff_t)i * stride];
+    return total;
+}
+
+// f32 は double へ広げてから累積する
+static double numeric_f32_sum(const float *p, int stride, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (stride == 1) {
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            v128_t v = wasm_v128_load(p + i);
+            acc01 = wasm_f64x2_add(acc01, wasm_f64x2_promote_low_f32x4(v));
+            acc23 = wasm_f64x2_add(acc23, wasm_f64x2_promote_low_f32x4(wasm_i64x2_shuffle(v, v, 1, 0)));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        s0 += (double)p[(ptrdiff_t)i * stride];
+        s1 += (double)p[(ptrdiff_t)(i + 1) * stride];
+        s2 += (double)p[(ptrdiff_t)(i + 2) * stride];
+        s3 += (double)p[(ptrdiff_t)(i + 3) * stride];
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) total += (double)p[(ptrdiff_t)i * stride];
+    return total;
+}
+
+static double numeric_f64_dot(const double *a, int as, const double *b, int bs, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (as == 1 && bs == 1) {
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            acc01 = wasm_f64x2_add(acc01, wasm_f64x2_mul(wasm_v128_load(a + i), wasm_v128_load(b + i)));
+            acc23 = wasm_f64x2_add(acc23, wasm_f64x2_mul(wasm_v128_load(a + i + 2), wasm_v128_load(b + i + 2)));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[(ptrdiff_t)i * as] * b[(ptrdiff_t)i * bs];
+        s1 += a[(ptrdiff_t)(i + 1) * as] * b[(ptrdiff_t)(i + 1) * bs];
+        s2 += a[(ptrdiff_t)(i + 2) * as] * b[(ptrdiff_t)(i + 2) * bs];
+        s3 += a[(ptrdiff_t)(i + 3) * as] * b[(ptrdiff_t)(i + 3) * bs];
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) total += a[(ptrdiff_t)i * as] * b[(ptrdiff_t)i * bs];
+    return total;
+}
+
+// float 同士の積は double で正確に表せるので、積も累積も double で行う
+static double numeric_f32_dot(const float *a, int as, const float *b, int bs, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (as == 1 && bs == 1) {
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            v128_t va = wasm_v128_load(a + i);
+            v128_t vb = wasm_v128_load(b + i);
+            acc01 = wasm_f64x2_add(acc01, wasm_f64x2_mul(wasm_f64x2_promote_low_f32x4(va),
+                                                         wasm_f64x2_promote_low_f32x4(vb)));
+            va = wasm_i64x2_shuffle(va, va, 1, 0);
+            vb = wasm_i64x2_shuffle(vb, vb, 1, 0);
+            acc23 = wasm_f64x2_add(acc23, wasm_f64x2_mul(wasm_f64x2_promote_low_f32x4(va),
+                                                         wasm_f64x2_promote_low_f32x4(vb)));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        s0 += (double)a[(ptrdiff_t)i * as] * (double)b[(ptrdiff_t)i * bs];
+        s1 += (double)a[(ptrdiff_t)(i + 1) * as] * (double)b[(ptrdiff_t)(i + 1) * bs];
+        s2 += (double)a[(ptrdiff_t)(i + 2) * as] * (double)b[(ptrdiff_t)(i + 2) * bs];
+        s3 += (double)a[(ptrdiff_t)(i + 3) * as] * (double)b[(ptrdiff_t)(i + 3) * bs];
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) total += (double)a[(ptrdiff_t)i * as] * (double)b[(ptrdiff_t)i * bs];
+    return total;
+}
+
+static double numeric_f64_squared_deviation_sum(const double *p, int stride, int n, double mean) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (stride == 1) {
+        v128_t vm = wasm_f64x2_splat(mean);
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            v128_t d01 = wasm_f64x2_sub(wasm_v128_load(p + i), vm);
+            v128_t d23 = wasm_f64x2_sub(wasm_v128_load(p + i + 2), vm);
+            acc01 = wasm_f64x2_add(acc01, wasm_f64x2_mul(d01, d01));
+            acc23 = wasm_f64x2_add(acc23, wasm_f64x2_mul(d23, d23));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        double d0 = p[(ptrdiff_t)i * stride] - mean;
+        double d1 = p[(ptrdiff_t)(i + 1) * stride] - mean;
+        double d2 = p[(ptrdiff_t)(i + 2) * stride] - mean;
+        double d3 = p[(ptrdiff_t)(i + 3) * stride] - mean;
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) {
+        double d = p[(ptrdiff_t)i * stride] - mean;
+        total += d * d;
+    }
+    return total;
+}
+
+static double numeric_f32_squared_deviation_sum(const float *p, int stride, int n, double mean) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+#if NUMERIC_WASM_SIMD
+    if (stride == 1) {
+        v128_t vm = wasm_f64x2_splat(mean);
+        v128_t acc01 = wasm_f64x2_splat(0.0);
+        v128_t acc23 = wasm_f64x2_splat(0.0);
+        for (; i + 4 <= n; i += 4) {
+            v128_t v = wasm_v128_load(p + i);
+            v128_t d01 = wasm_f64x2_sub(wasm_f64x2_promote_low_f32x4(v), vm);
+            v128_t d23 = wasm_f64x2_sub(wasm_f64x2_promote_low_f32x4(wasm_i64x2_shuffle(v, v, 1, 0)), vm);
+            acc01 = wasm_f64x2_add(acc01, wasm_f64x2_mul(d01, d01));
+            acc23 = wasm_f64x2_add(acc23, wasm_f64x2_mul(d23, d23));
+        }
+        s0 = wasm_f64x2_extract_lane(acc01, 0);
+        s1 = wasm_f64x2_extract_lane(acc01, 1);
+        s2 = wasm_f64x2_extract_lane(acc23, 0);
+        s3 = wasm_f64x2_extract_lane(acc23, 1);
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        double d0 = (double)p[(ptrdiff_t)i * stride] - mean;
+        double d1 = (double)p[(ptrdiff_t)(i + 1) * stride] - mean;
+        double d2 = (double)p[(ptrdiff_t)(i + 2) * stride] - mean;
+        double d3 = (double)p[(ptrdiff_t)(i + 3) * stride] - mean;
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    double total = (s0 + s1) + (s2 + s3);
+    for (; i < n; i++) {
+        double d = (double)p[(ptrdiff_t)i * stride] - mean;
+        total += d * d;
+    }
+    return total;
+}
+
+double numeric_array_sum(Value *array) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return 0.0;
+    int n = array->numeric_array.length;
+    int stride = array->numeric_array.stride;
+    const void *base = numeric_array_base(array);
+    switch (array->numeric_array.dtype) {
+        case NUMERIC_DTYPE_F64:
+            return numeric_f64_sum((const double *)base, stride, n);
+        case NUMERIC_DTYPE_F32:
+            // f32 の合計は丸め誤差が積み重ならないよう double で累積する
+            return numeric_f32_sum((const float *)base, stride, n);
+        case NUMERIC_DTYPE_I64: {
+            const int64_t *p = (const int64_t *)base;
+            uint64_t total = 0;
+            for (int i = 0; i < n; i++) total += (uint64_t)p[(ptrdiff_t)i * stride];
+            return (double)(int64_t)total;
+        }
+        case NUMERIC_DTYPE_I32: {
+            const int32_t *p = (const int32_t *)base;
+            int64_t total = 0;
+            for (int i = 0; i < n; i++) total += p[(ptrdiff_t)i * stride];
+            return (double)total;
+        }
+        case NUMERIC_DTYPE_BOOL: {
+            const uint8_t *p = (const uint8_t *)base;
+            int64_t total = 0;
+            for (int i = 0; i < n; i++) total += p[(ptrdiff_t)i * stride] ? 1 : 0;
+            return (double)total;
+        }
+    }
+    return 0.0;
+}
+
+double numeric_array_dot(Value *left, Value *right) {
+    if (left == NULL || right == NULL ||
+        left->type != VALUE_NUMERIC_ARRAY || right->type != VALUE_NUMERIC_ARRAY) {
+        return 0.0;
+    }
+    int n = left->numeric_array.length < right->numeric_array.length
+          ? left->numeric_array.length : right->numeric_array.length;
+    int ls = left->numeric_array.stride;
+    int rs = right->numeric_array.stride;
+    const void *a = numeric_array_base(left);
+    const void *b = numeric_array_base(right);
+
+    if (left->numeric_array.dtype == right->numeric_array.dtype) {
+        switch (left->numeric_array.dtype) {
+            case NUMERIC_DTYPE_F64:
+                return numeric_f64_dot((const double *)a, ls, (const double *)b, rs, n);
+            case NUMERIC_DTYPE_F32:
+                return numeric_f32_dot((const float *)a, ls, (const float *)b, rs, n);
+            case NUMERIC_DTYPE_I64: {
+                uint64_t total = 0;
+                for (int i = 0; i < n; i++) {
+                    total += (uint64_t)((const int64_t *)a)[(ptrdiff_t)i * ls] *
+                             (uint64_t)((const int64_t *)b)[(ptrdiff_t)i * rs];
+                }
+                return (double)(int64_t)total;
+            }
+            case NUMERIC_DTYPE_I32: {
+                int64_t total = 0;
+                for (int i = 0; i < n; i++) {
+                    total += (int64_t)((const int32_t *)a)[(ptrdiff_t)i * ls] *
+                             (int64_t)((const int32_t *)b)[(ptrdiff_t)i * rs];
+                }
+                return (double)total;
+            }
+            default:
+                break;
+        }
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        total += numeric_array_get(left, i) * numeric_array_get(right, i);
+    }
+    return total;
+}
+
+// 整数 dtype の偏差平方和。要素は型のまま読み、差と二乗は double で計算する
+#define NUMERIC_DEVIATION_LOOP(T)                                 \
+    do {                                                          \
+        const T *p = (const T *)base;                             \
+        for (int i = 0; i < n; i++) {                             \
+            double delta = (double)p[(ptrdiff_t)i * stride] - mean; \
+            total += delta * delta;                               \
+        }                                                         \
+    } while (0)
+
+double numeric_array_squared_deviation_sum(Value *array, double mean) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY) return 0.0;
+    int n = array->numeric_array.length;
+    int stride = array->numeric_array.stride;
+    const void *base = numeric_array_base(array);
+    double total = 0.0;
+    switch (array->numeric_array.dtype) {
+        case NUMERIC_DTYPE_F64:
+            return numeric_f64_squared_deviation_sum((const double *)base, stride, n, mean);
+        case NUMERIC_DTYPE_F32:
+            return numeric_f32_squared_deviation_sum((const float *)base, stride, n, mean);
+        case NUMERIC_DTYPE_I64:
+            NUMERIC_DEVIATION_LOOP(int64_t);
+            break;
+        case NUMERIC_DTYPE_I32:
+            NUMERIC_DEVIATION_LOOP(int32_t);
+            break;
+        case NUMERIC_DTYPE_BOOL:
+            NUMERIC_DEVIATION_LOOP(uint8_t);
+            break;
+    }
+    return total;
+}
+
+double numeric_array_mean(Value *array) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY || array->numeric_array.length == 0) return 0.0;
+    int n = array->numeric_array.length;
+    int stride = array->numeric_array.stride;
+    const void *base = numeric_array_base(array);
+    double total = 0.0;
+    switch (array->numeric_array.dtype) {
+        case NUMERIC_DTYPE_F64:
+        case NUMERIC_DTYPE_F32:
+            total = numeric_array_sum(array);
+            break;
+        case NUMERIC_DTYPE_I64:
+            for (int i = 0; i < n; i++) total += (double)((const int64_t *)base)[(ptrdiff_t)i * stride];
+            break;
+        case NUMERIC_DTYPE_I32:
+            for (int i = 0; i < n; i++) total += ((const int32_t *)base)[(ptrdiff_t)i * stride];
+            break;
+        case NUMERIC_DTYPE_BOOL:
+            for (int i = 0; i < n; i++) total += ((const uint8_t *)base)[(ptrdiff_t)i * stride] ? 1.0 : 0.0;
+            break;
+    }
+    return total / n;
+}
+
+// 型 T のまま比較する（NaN は先頭要素でない限り選ばれない。従来の double ループと同じ）
+#define NUMERIC_MIN_MAX_LOOP(T)                                   \
+    do {                                                          \
+        const T *p = (const T *)base;                             \
+        T lo = p[0];                                              \
+        T hi = p[0];                                              \
+        for (int i = 1; i < n; i++) {                             \
+            T x = p[(ptrdiff_t)i * stride];                       \
+            if (x < lo) lo = x;                                   \
+            if (x > hi) hi = x;                                   \
+        }                                                         \
+        *min_out = (double)lo;                                    \
+        *max_out = (double)hi;                                    \
+    } while (0)
+
+bool numeric_array_min_max(Value *array, double *min_out, double *max_out) {
+    if (array == NULL || array->type != VALUE_NUMERIC_ARRAY || array->numeric_array.length == 0) return false;
+    int n = array->numeric_array.length;
+    int stride = array->numeric_array.stride;
+    const void *base = numeric_array_base(array);
+    switch (array->numeric_array.dtype) {
+        case NUMERIC_DTYPE_F64:  NUMERIC_MIN_MAX_LOOP(double); break;
+        case NUMERIC_DTYPE_F32:  NUMERIC_MIN_MAX_LOOP(float); break;
+        case NUMERIC_DTYPE_I64:  NUMERIC_MIN_MAX_LOOP(int64_t); break;
+        case NUMERIC_DTYPE_I32:  NUMERIC_MIN_MAX_LOOP(int32_t); break;
+        case NUMERIC_DTYPE_BOOL: NUMERIC_MIN_MAX_LOOP(uint8_t); break;
+    }
+    return true;
+}
+
+#undef NUMERIC_MIN_MAX_LOOP
+#undef NUMERIC_DEVIATION_LOOP
+
+bool matrix_matmul_f64(Value *left, Value *right, Value *out) {
+    if (left == NULL || right == NULL || out == NULL ||
+        left->type != VALUE_MATRIX || right->type != VALUE_MATRIX || out->type != VALUE_MATRIX ||
+        left->matrix.dtype != NUMERIC_DTYPE_F64 || right->matrix.dtype != NUMERIC_DTYPE_F64 ||
+        out->matrix.dtype != NUMERIC_DTYPE_F64 || !matrix_is_contiguous(out) ||
+        left->matrix.cols != right->matrix.rows ||
+        out->matrix.rows != left->matrix.rows || out->matrix.cols != right->matrix.cols) {
+        return false;
+    }
+
+    int rows = left->matrix.rows;
+    int inner = left->matrix.cols;
+    int cols = right->matrix.cols;
+    const double *a = (const double *)left->matrix.data + left->matrix.offset;
+    const double *b = (const double *)right->matrix.data + right->matrix.offset;
+    int a_rs = left->matrix.row_stride, a_cs = left->matrix.col_stride;
+    int b_rs = right->matrix.row_stride, b_cs = right->matrix.col_stride;
+    double *c = (double *)out->matrix.data;
+
+    // i-k-j 順: 結果の各行に a[r][k] * b[k][:] を k の昇順で足し込む。
+    // 各要素への加算順は素朴な三重ループと同じなので、SIMD の有無で結果は変わらない
+    for (int r = 0; r < rows; r++) {
+        double *crow = c + (size_t)r * (size_t)cols;
+        for (int j = 0; j < cols; j++) crow[j] = 0.0;
+        for (int k = 0; k < inner; k++) {
+            double s = a[(ptrdiff_t)r * a_rs + (ptrdiff_t)k * a_cs];
+            const double *brow = b + (ptrdiff_t)k * b_rs;
+            int j = 0;
+#if NUMERIC_WASM_SIMD
+            if (b_cs == 1) {
+                v128_t vs = wasm_f64x2_splat(s);
+                for (; j + 2 <= cols; j += 2) {
+                    v128_t prod = wasm_f64x2_mul(vs, wasm_v128_load(brow + j));
+                    wasm_v128_store(crow + j, wasm_f64x2_add(wasm_v128_load(crow + j), prod));
+                }
+            }
+#endif
+            for (; j < cols; j++) crow[j] += s * brow[(ptrdiff_t)j * b_cs];
+        }
+    }
+    return true;
+}
+
 // =============================================================================
 // 辞書操作
 // =============================================================================
@@ -1093,18 +2431,9 @@ static int dict_find_key(Value *dict, const char *key) {
     return dict_find_key_linear(dict, key);
 }
 
-bool dict_set(Value *dict, const char *key, Value value) {
-    if (dict == NULL || dict->type != VALUE_DICT || key == NULL) return false;
-    
-    int idx = dict_find_key(dict, key);
-    
-    if (idx >= 0) {
-        // 既存のキーを更新
-        value_free(&dict->dict.values[idx]);
-        dict->dict.values[idx] = value_copy(value);
-        return true;
-    }
-    
+// keys/values の末尾へ所有済みのキーと値を移します。
+// eager_index が偽なら、まだ索引が無い辞書の索引構築を最初の検索まで遅らせます。
+static bool dict_append_entry(Value *dict, char *key, Value value, bool eager_index) {
     // 容量が足りなければ拡張
     if (dict->dict.length >= dict->dict.capacity) {
         int new_capacity = dict->dict.capacity > 0 ? dict->dict.capacity * 2 : VALUE_INITIAL_CAPACITY;
@@ -1117,17 +2446,15 @@ bool dict_set(Value *dict, const char *key, Value value) {
             dict->dict.keys = new_keys;
             abort();
         }
+        MEM_PROFILE_RESIZE(VALUE_DICT, (sizeof(char *) + sizeof(Value)) * (size_t)dict->dict.capacity,
+                           (sizeof(char *) + sizeof(Value)) * (size_t)new_capacity);
         dict->dict.keys = new_keys;
         dict->dict.values = new_values;
         dict->dict.capacity = new_capacity;
     }
-    
-    // 新しいキーを追加
-    dict->dict.keys[dict->dict.length] = strdup(key);
-    if (dict->dict.keys[dict->dict.length] == NULL) {
-        return false;
-    }
-    dict->dict.values[dict->dict.length] = value_copy(value);
+
+    dict->dict.keys[dict->dict.length] = key;
+    dict->dict.values[dict->dict.length] = value;
     dict->dict.length++;
 
     if (dict->dict.hash_valid) {
@@ -1136,13 +2463,59 @@ bool dict_set(Value *dict, const char *key, Value value) {
         } else {
             dict_hash_insert_slot(dict, dict->dict.length - 1);
         }
-    } else if (dict->dict.length >= DICT_HASH_MIN_LENGTH) {
+    } else if (eager_index && dict->dict.length >= DICT_HASH_MIN_LENGTH) {
         (void)dict_rebuild_hash_index(dict);
     }
-    
+
     return true;
 }
 
+bool dict_set(Value *dict, const char *key, Value value) {
+    if (dict == NULL || dict->type != VALUE_DICT || key == NULL) return false;
+    
+    int idx = dict_find_key(dict, key);
+    
+    if (idx >= 0) {
+        // 既存のキーを更新
+        value_free(&dict->dict.values[idx]);
+        dict->dict.values[idx] = value_copy(value);
+        return true;
+    }
+    
+    // 新しいキーを追加
+    char *owned_key = strdup(key);
+    if (owned_key == NULL) {
+        return false;
+    }
+    return dict_append_entry(dict, owned_key, value_copy(value), true);
+}
+
+bool dict_set_owned(Value *dict, char *key, Value value) {
+    if (dict == NULL || dict->type != VALUE_DICT || key == NULL) {
+        free(key);
+        value_free(&value);
+        return false;
+    }
+
+    int idx = dict_find_key(dict, key);
+    if (idx >= 0) {
+        free(key);
+        value_free(&dict->dict.values[idx]);
+        dict->dict.values[idx] = value;
+        return true;
+    }
+    return dict_append_entry(dict, key, value, true);
+}
+
+bool dict_append_owned(Value *dict, char *key, Value value) {
+    if (dict == NULL || dict->type != VALUE_DICT || key == NULL) {
+        free(key);
+        value_free(&value);
+        return false;
+    }
+    return dict_append_entry(dict, key, value, false);
+}
+
 Value dict_get(Value *dict, const char *key) {
     if (dict == NULL || dict->type != VALUE_DICT || key == NULL) {
         return value_null();
@@ -1240,6 +2613,7 @@ Value string_concat(Value a, Value b) {
     result.string.char_length = a.string.char_length + b.string.char_length;
     result.string.capacity = new_length + 1;
     result.string.data = malloc(result.string.capacity);
+    MEM_PROFILE_ALLOC(VALUE_STRING, (size_t)result.string.capacity);
     
     memcpy(result.string.data, a.string.data, a.string.byte_length);
     memcpy(result.string.data + a.string.byte_length, b.string.data, b.string.byte_length);
@@ -1248,6 +2622,107 @@ Value string_concat(Value a, Value b) {
     return result;
 }
 
+bool string_assign_n(Value *s, const char *data, int length) {
+    if (s == NULL || s->type != VALUE_STRING || length < 0) return false;
+
+    if (length + 1 > s->string.capacity) {
+        int new_capacity = s->string.capacity > 0 ? s->string.capacity : 16;
+        while (new_capacity < length + 1) {
+            new_capacity *= 2;
+        }
+        char *grown = realloc(s->string.data, (size_t)new_capacity);
+        if (grown == NULL) return false;
+        MEM_PROFILE_RESIZE(VALUE_STRING, (size_t)s->string.capacity, (size_t)new_capacity);
+        s->string.data = grown;
+        s->string.capacity = new_capacity;
+    }
+    memcpy(s->string.data, data, (size_t)length);
+    s->string.data[length] = '\0';
+    s->string.byte_length = length;
+    s->string.char_length = utf8_count_chars(data, length);
+    return true;
+}
+
+bool utf8_is_valid(const char *s, size_t length) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0;
+    while (i < length) {
+        unsigned char c = p[i];
+        if (c >= 0x01 && c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t need;
+        unsigned int min;
+        unsigned int cp;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1; min = 0x80; cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            need = 2; min = 0x800; cp = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3; min = 0x10000; cp = c & 0x07;
+        } else {
+            return false;  // NUL・継続バイト・不正な先頭バイト
+        }
+        if (length - i <= need) return false;
+        for (size_t k = 1; k <= need; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+        i += need + 1;
+    }
+    return true;
+}
+
+const uint8_t *bytes_data(const Value *b) {
+    if (b == NULL || b->type != VALUE_BYTES || b->bytes.data == NULL) return NULL;
+    return b->bytes.data + b->bytes.offset;
+}
+
+Value bytes_slice(Value *b, int start, int end) {
+    if (b == NULL || b->type != VALUE_BYTES) return value_null();
+    if (start < 0) start = 0;
+    if (end > b->bytes.length) end = b->bytes.length;
+    if (end < start) end = start;
+
+    Value view = *b;
+    numeric_shared_retain(b->bytes.ref_count);
+    view.ref_count = 1;
+    view.bytes.offset = b->bytes.offset + start;
+    view.bytes.length = end - start;
+    return view;
+}
+
+Value bytes_to_string(Value *b) {
+    if (b == NULL || b->type != VALUE_BYTES) return value_null();
+    const char *data = (const char *)bytes_data(b);
+    int length = b->bytes.length;
+    if (length > 0 && !utf8_is_valid(data, (size_t)length)) return value_null();
+
+    // 単独所有で先頭から始まる view はバッファごと文字列へ引き渡す
+    // （view の末尾より後ろは確保済みなので NUL を置ける）
+    if (b->bytes.offset == 0 && numeric_shared_is_unique(b->bytes.ref_count)) {
+        Value v;
+        v.type = VALUE_STRING;
+        v.is_const = false;
+        v.is_integer = false;
+        v.ref_count = 1;
+        v.string.data = (char *)b->bytes.data;
+        v.string.data[length] = '\0';
+        v.string.byte_length = length;
+        v.string.char_length = utf8_count_chars(v.string.data, length);
+        size_t size = ((BytesBuffer *)b->bytes.ref_count)->size;
+        v.string.capacity = size <= INT_MAX ? (int)size : length + 1;
+        MEM_PROFILE_FREE(VALUE_BYTES, size);
+        MEM_PROFILE_ALLOC(VALUE_STRING, (size_t)v.string.capacity);
+        free(b->bytes.ref_count);
+        *b = value_null();
+        return v;
+    }
+    return value_string_n(data, length);
+}
+
 int string_length(Value *s) {
     if (s == NULL || s->type != VALUE_STRING) {
         return 0;
@@ -1312,11 +2787,15 @@ bool value_is_truthy(Value v) {
             return v.matrix.rows > 0 && v.matrix.cols > 0;
         case VALUE_DICT:
             return v.dict.length > 0;
+        case VALUE_BYTES:
+            return v.bytes.length > 0;
         case VALUE_FUNCTION:
         case VALUE_BUILTIN:
         case VALUE_CLASS:
         case VALUE_INSTANCE:
         case VALUE_GENERATOR:
+        case VALUE_FILE:
+        case VALUE_REGEX:
             return true;
     }
     return false;
@@ -1337,6 +2816,9 @@ const char *value_type_name(ValueType type) {
         case VALUE_CLASS:    return "クラス";
         case VALUE_INSTANCE: return "インスタンス";
         case VALUE_GENERATOR: return "ジェネレータ";
+        case VALUE_FILE:     return "ファイル";
+        case VALUE_BYTES:    return "バイト列";
+        case VALUE_REGEX:    return "正規表現";
     }
     return "不明";
 }
@@ -1434,7 +2916,7 @@ char *value_to_string(Value v) {
                 }
 
                 char elem[64];
-                snprintf(elem, sizeof(elem), "%g", numeric_read_at(v.numeric_array.data, v.numeric_array.dtype, i));
+                snprintf(elem, sizeof(elem), "%g", numeric_array_get(&v, i));
                 size_t elem_len = strlen(elem);
                 while (length + elem_len + 16 >= capacity) {
                     ARRAY_GROW(buffer, length + elem_len + 16, capacity, char, abort());
@@ -1594,6 +3076,40 @@ char *value_to_string(Value v) {
                 snprintf(buffer, 64, "<ジェネレータ: 無効>");
             }
             break;
+        
+        case VALUE_BYTES: {
+            // 先頭 16 バイトまでを 16 進で表示
+            const uint8_t *data = bytes_data(&v);
+            int preview = v.bytes.length < 16 ? v.bytes.length : 16;
+            size_t size = 64 + (size_t)preview * 3;
+            buffer = malloc(size);
+            int written = snprintf(buffer, size, "<バイト列 %d バイト", v.bytes.length);
+            for (int i = 0; i < preview; i++) {
+                written += snprintf(buffer + written, size - (size_t)written, "%s%02x",
+                                    i == 0 ? ": " : " ", data[i]);
+            }
+            snprintf(buffer + written, size - (size_t)written, "%s>",
+                     v.bytes.length > preview ? " …" : "");
+            break;
+        }
+        
+        case VALUE_FILE: {
+            const char *path = v.file.handle != NULL ? v.file.handle->path : "";
+            bool open = v.file.handle != NULL && v.file.handle->fp != NULL;
+            size_t size = strlen(path) + 64;
+            buffer = malloc(size);
+            snprintf(buffer, size, "<ファイル: %s%s>", path, open ? "" : "（閉じ済み）");
+            break;
+        }
+        
+        case VALUE_REGEX: {
+            const char *pattern = v.regex.handle != NULL ? v.regex.handle->pattern : "";
+            const char *flags = v.regex.handle != NULL ? v.regex.handle->flags : "";
+            size_t size = strlen(pattern) + strlen(flags) + 32;
+            buffer = malloc(size);
+            snprintf(buffer, size, "<正規表現 /%s/%s>", pattern, flags);
+            break;
+        }
             
         default:
             buffer = malloc(16);
@@ -1674,6 +3190,17 @@ bool value_equals(Value a, Value b) {
         case VALUE_GENERATOR:
             // ジェネレータの比較
             return a.generator.state == b.generator.state;
+        case VALUE_FILE:
+            return a.file.handle == b.file.handle;
+        case VALUE_REGEX:
+            if (a.regex.handle == b.regex.handle) return true;
+            return a.regex.handle != NULL && b.regex.handle != NULL &&
+                   strcmp(a.regex.handle->pattern, b.regex.handle->pattern) == 0 &&
+                   strcmp(a.regex.handle->flags, b.regex.handle->flags) == 0;
+        case VALUE_BYTES:
+            return a.bytes.length == b.bytes.length &&
+                   (a.bytes.length == 0 ||
+                    memcmp(bytes_data(&a), bytes_data(&b), (size_t)a.bytes.length) == 0);
         case VALUE_INSTANCE:
             // インスタンスは同一性で比較
             return &a == &b;
@@ -1726,3 +3253,237 @@ void value_debug(Value v) {
     value_print(v);
     printf(" }\n");
 }
+
+// =============================================================================
+// メモリ割り当てプロファイル（HAJIMU_MEM_PROFILE ビルドのみ）
+// =============================================================================
+
+#ifdef HAJIMU_MEM_PROFILE
+
+#include <pthread.h>
+#ifndef _WIN32
+#  include <sys/resource.h>
+#endif
+
+#if defined(_MSC_VER)
+#  define MEM_PROFILE_THREAD_LOCAL __declspec(thread)
+#else
+#  define MEM_PROFILE_THREAD_LOCAL __thread
+#endif
+
+#define MEM_PROFILE_TYPE_COUNT (VALUE_REGEX + 1)
+
+typedef struct {
+    long allocs;
+    long copies;
+    long frees;
+    size_t bytes;           // 生成・コピー・拡張で確保した累計
+} MemProfileCounter;
+
+typedef struct {
+    MemProfileSite site;
+    MemProfileCounter total;
+} MemProfileSiteEntry;
+
+bool g_mem_profile_enabled = false;
+
+static pthread_mutex_t g_mem_profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MemProfileCounter g_mem_profile_types[MEM_PROFILE_TYPE_COUNT];
+static long long g_mem_profile_live = 0;
+static long long g_mem_profile_peak = 0;
+static MemProfileSiteEntry *g_mem_profile_sites = NULL;    // 開番地法（key == NULL は空き）
+static int g_mem_profile_site_count = 0;
+static int g_mem_profile_site_capacity = 0;
+static MEM_PROFILE_THREAD_LOCAL MemProfileSite g_mem_profile_current;
+
+void mem_profile_set_enabled(bool enabled) {
+    g_mem_profile_enabled = enabled;
+}
+
+MemProfileSite mem_profile_enter_site(const void *key, const char *name, int line, int column) {
+    MemProfileSite saved = g_mem_profile_current;
+    g_mem_profile_current.key = key;
+    g_mem_profile_current.name = name;
+    g_mem_profile_current.line = line;
+    g_mem_profile_current.column = column;
+    return saved;
+}
+
+void mem_profile_leave_site(MemProfileSite saved) {
+    g_mem_profile_current = saved;
+}
+
+static size_t mem_profile_site_hash(const void *key) {
+    uint64_t x = (uint64_t)(uintptr_t)key;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+// ロック中に呼ぶ。呼び出し位置の外（トップレベルの文）は key == NULL として集計しない
+static MemProfileCounter *mem_profile_site_counter_locked(void) {
+    const MemProfileSite *site = &g_mem_profile_current;
+    if (site->key == NULL) return NULL;
+
+    if ((g_mem_profile_site_count + 1) * 2 > g_mem_profile_site_capacity) {
+        int new_capacity = g_mem_profile_site_capacity < 64 ? 64 : g_mem_profile_site_capacity * 2;
+        MemProfileSiteEntry *grown = calloc((size_t)new_capacity, sizeof(MemProfileSiteEntry));
+        if (grown == NULL) return NULL;
+        size_t mask = (size_t)new_capacity - 1;
+        for (int i = 0; i < g_mem_profile_site_capacity; i++) {
+            if (g_mem_profile_sites[i].site.key == NULL) continue;
+            size_t j = mem_profile_site_hash(g_mem_profile_sites[i].site.key) & mask;
+            while (grown[j].site.key != NULL) j = (j + 1) & mask;
+            grown[j] = g_mem_profile_sites[i];
+        }
+        free(g_mem_profile_sites);
+        g_mem_profile_sites = grown;
+        g_mem_profile_site_capacity = new_capacity;
+    }
+
+    size_t mask = (size_t)g_mem_profile_site_capacity - 1;
+    size_t i = mem_profile_site_hash(site->key) & mask;
+    while (g_mem_profile_sites[i].site.key != NULL && g_mem_profile_sites[i].site.key != site->key) {
+        i = (i + 1) & mask;
+    }
+    if (g_mem_profile_sites[i].site.key == NULL) {
+        g_mem_profile_sites[i].site = *site;
+        g_mem_profile_site_count++;
+    }
+    return &g_mem_profile_sites[i].total;
+}
+
+static void mem_profile_add_live_locked(long long delta) {
+    g_mem_profile_live += delta;
+    if (g_mem_profile_live > g_mem_profile_peak) {
+        g_mem_profile_peak = g_mem_profile_live;
+    }
+}
+
+void mem_profile_record_alloc(ValueType type, size_t bytes) {
+    pthread_mutex_lock(&g_mem_profile_mutex);
+    g_mem_profile_types[type].allocs++;
+    g_mem_profile_types[type].bytes += bytes;
+    MemProfileCounter *site = mem_profile_site_counter_locked();
+    if (site != NULL) {
+        site->allocs++;
+        site->bytes += bytes;
+    }
+    mem_profile_add_live_locked((long long)bytes);
+    pthread_mutex_unlock(&g_mem_profile_mutex);
+}
+
+void mem_profile_record_copy(ValueType type, size_t bytes) {
+    pthread_mutex_lock(&g_mem_profile_mutex);
+    g_mem_profile_types[type].copies++;
+    g_mem_profile_types[type].bytes += bytes;
+    MemProfileCounter *site = mem_profile_site_counter_locked();
+    if (site != NULL) {
+        site->copies++;
+        site->bytes += bytes;
+    }
+    mem_profile_add_live_locked((long long)bytes);
+    pthread_mutex_unlock(&g_mem_profile_mutex);
+}
+
+void mem_profile_record_free(ValueType type, size_t bytes) {
+    pthread_mutex_lock(&g_mem_profile_mutex);
+    g_mem_profile_types[type].frees++;
+    mem_profile_add_live_locked(-(long long)bytes);
+    pthread_mutex_unlock(&g_mem_profile_mutex);
+}
+
+void mem_profile_record_resize(ValueType type, size_t old_bytes, size_t new_bytes) {
+    if (new_bytes <= old_bytes) return;
+    pthread_mutex_lock(&g_mem_profile_mutex);
+    g_mem_profile_types[type].bytes += new_bytes - old_bytes;
+    MemProfileCounter *site = mem_profile_site_counter_locked();
+    if (site != NULL) {
+        site->bytes += new_bytes - old_bytes;
+    }
+    mem_profile_add_live_locked((long long)(new_bytes - old_bytes));
+    pthread_mutex_unlock(&g_mem_profile_mutex);
+}
+
+static void mem_profile_format_bytes(char *out, size_t size, double bytes) {
+    if (bytes >= 1024.0 * 1024.0) {
+        snprintf(out, size, "%.1f MiB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024.0) {
+        snprintf(out, size, "%.1f KiB", bytes / 1024.0);
+    } else {
+        snprintf(out, size, "%.0f B", bytes);
+    }
+}
+
+static int compare_mem_profile_sites(const void *a, const void *b) {
+    const MemProfileSiteEntry *left = *(const MemProfileSiteEntry * const *)a;
+    const MemProfileSiteEntry *right = *(const MemProfileSiteEntry * const *)b;
+    if (left->total.bytes < right->total.bytes) return 1;
+    if (left->total.bytes > right->total.bytes) return -1;
+    long left_count = left->total.allocs + left->total.copies;
+    long right_count = right->total.allocs + right->total.copies;
+    if (left_count < right_count) return 1;
+    if (left_count > right_count) return -1;
+    return 0;
+}
+
+void mem_profile_print(FILE *out, int limit) {
+    pthread_mutex_lock(&g_mem_profile_mutex);
+
+    char peak[32];
+    mem_profile_format_bytes(peak, sizeof(peak), (double)g_mem_profile_peak);
+    fprintf(out, "メモリプロファイル: ピーク使用量（値の本体） %s", peak);
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        char rss[32];
+#ifdef __APPLE__
+        mem_profile_format_bytes(rss, sizeof(rss), (double)usage.ru_maxrss);
+#else
+        mem_profile_format_bytes(rss, sizeof(rss), (double)usage.ru_maxrss * 1024.0);
+#endif
+        fprintf(out, ", ピークRSS %s", rss);
+    }
+#endif
+    fprintf(out, "\n");
+
+    fprintf(out, "型別:\n");
+    fprintf(out, "  %-16s %10s %10s %10s %12s\n", "type", "allocs", "copies", "frees", "bytes");
+    for (int t = 0; t < MEM_PROFILE_TYPE_COUNT; t++) {
+        const MemProfileCounter *c = &g_mem_profile_types[t];
+        if (c->allocs == 0 && c->copies == 0 && c->frees == 0) continue;
+        char bytes[32];
+        mem_profile_format_bytes(bytes, sizeof(bytes), (double)c->bytes);
+        fprintf(out, "  %-16s %10ld %10ld %10ld %12s\n",
+                value_type_name((ValueType)t), c->allocs, c->copies, c->frees, bytes);
+    }
+
+    if (g_mem_profile_site_count > 0) {
+        MemProfileSiteEntry **sorted = malloc(sizeof(MemProfileSiteEntry *) * (size_t)g_mem_profile_site_count);
+        if (sorted != NULL) {
+            int n = 0;
+            for (int i = 0; i < g_mem_profile_site_capacity; i++) {
+                if (g_mem_profile_sites[i].site.key != NULL) sorted[n++] = &g_mem_profile_sites[i];
+            }
+            qsort(sorted, (size_t)n, sizeof(MemProfileSiteEntry *), compare_mem_profile_sites);
+            if (limit <= 0 || limit > n) limit = n;
+            fprintf(out, "呼び出し位置別（上位%d件 / 全%d件）:\n", limit, n);
+            fprintf(out, "  %-22s %10s %10s %12s %10s\n", "call", "allocs", "copies", "bytes", "line:col");
+            for (int i = 0; i < limit; i++) {
+                const MemProfileSiteEntry *e = sorted[i];
+                char bytes[32];
+                mem_profile_format_bytes(bytes, sizeof(bytes), (double)e->total.bytes);
+                fprintf(out, "  %-22s %10ld %10ld %12s %5d:%-4d\n",
+                        e->site.name != NULL ? e->site.name : "(式)",
+                        e->total.allocs, e->total.copies, bytes,
+                        e->site.line, e->site.column);
+            }
+            free(sorted);
+        }
+    }
+
+    pthread_mutex_unlock(&g_mem_profile_mutex);
+}
+
+#endif
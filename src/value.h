@@ -10,6 +10,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 
 // 前方宣言
 struct ASTNode;
@@ -29,6 +30,35 @@ typedef struct GeneratorState {
     int ref_count;              // state を共有するジェネレータ Value 数
 } GeneratorState;
 
+// ファイルハンドルの共有状態
+//
+// ファイル Value はコピー時にこの state を共有し、最後の参照が
+// 解放されたときにバッファをフラッシュしてファイルを閉じます。
+// buffer は setvbuf に渡した stdio バッファで、fclose 後に解放します。
+typedef struct FileHandle {
+    FILE *fp;                   // 開いているストリーム（閉じた後は NULL）
+    char *path;                 // 開いたパス（表示・エラー用）
+    char *buffer;               // stdio バッファ（NULL なら既定バッファ）
+    size_t buffer_size;         // バッファサイズ（バイト）
+    bool readable;              // 読み取り可能か
+    bool writable;              // 書き込み可能か
+    int ref_count;              // state を共有するファイル Value 数
+} FileHandle;
+
+// コンパイル済み正規表現の共有状態
+//
+// 正規表現 Value とパターンキャッシュがこの state を共有し、最後の参照が
+// 解放されたときに destroy で compiled を解放します。regex_t の実体は
+// プラットフォームごとに異なるため、確保と解放は evaluator.c が行います。
+// キャッシュはスレッド間で共有されるため ref_count は atomic に操作します。
+typedef struct RegexHandle {
+    void *compiled;             // regex_t
+    char *pattern;              // 元のパターン
+    char flags[8];              // 指定されたフラグ文字（"i", "m" など）
+    int ref_count;              // state を共有する参照数
+    void (*destroy)(void *compiled);
+} RegexHandle;
+
 // =============================================================================
 // 値の型
 // =============================================================================
@@ -41,6 +71,16 @@ typedef enum {
     NUMERIC_DTYPE_BOOL, // 0/1 の真偽値相当
 } NumericDType;
 
+// dtype ネイティブカーネルで扱う要素ごとの二項演算
+typedef enum {
+    NUMERIC_OP_ADD,
+    NUMERIC_OP_SUB,
+    NUMERIC_OP_MUL,
+    NUMERIC_OP_DIV,
+    NUMERIC_OP_MOD,
+    NUMERIC_OP_POW,
+} NumericBinaryOp;
+
 typedef enum {
     VALUE_NULL,         // null値
     VALUE_NUMBER,       // 数値（double）
@@ -55,6 +95,9 @@ typedef enum {
     VALUE_CLASS,        // クラス定義
     VALUE_INSTANCE,     // クラスインスタンス
     VALUE_GENERATOR,    // ジェネレータ
+    VALUE_FILE,         // ファイルハンドル
+    VALUE_BYTES,        // バイト列（UTF-8 を仮定しないバイナリ）
+    VALUE_REGEX,        // コンパイル済み正規表現
 } ValueType;
 
 // =============================================================================
@@ -95,11 +138,18 @@ struct Value {
         } array;
 
         // 数値ベクトル
+        //
+        // data は行列と同じく ref_count で共有される場合があります。
+        // 要素 i は data[offset + i * stride] にあり、共有中のバッファへ
+        // 書き込む前には numeric_array_make_unique() で複製します。
         struct {
             NumericDType dtype;
             void *data;
             int length;
             int capacity;
+            int offset;       // 共有バッファ内の先頭位置（要素単位）
+            int stride;       // 要素間隔（要素単位）
+            int *ref_count;   // 共有バッファの参照数（NULL なら単独所有）
         } numeric_array;
 
         // 数値行列
@@ -159,6 +209,28 @@ struct Value {
         struct {
             struct GeneratorState *state;   // 共有状態へのポインタ
         } generator;
+        
+        // ファイルハンドル
+        struct {
+            struct FileHandle *handle;      // 共有状態へのポインタ
+        } file;
+        
+        // バイト列
+        //
+        // 中身は変更しない（不変）ため、スライスは同じバッファを指す view です。
+        // 単独所有のバッファは末尾に NUL 用の 1 バイトを余分に確保しており、
+        // 有効な UTF-8 なら文字列へ複製せずに引き渡せます。
+        struct {
+            uint8_t *data;    // 共有バッファ先頭
+            int offset;       // 共有バッファ内の先頭位置（バイト）
+            int length;       // バイト数
+            int *ref_count;   // 共有バッファの参照数（数値ベクトルと同じ atomic 管理）
+        } bytes;
+        
+        // コンパイル済み正規表現
+        struct {
+            struct RegexHandle *handle;     // 共有状態へのポインタ
+        } regex;
     };
 };
 
@@ -246,6 +318,47 @@ Value value_matrix_from_data(const double *data, int rows, int cols);
  */
 Value value_matrix_from_data_with_dtype(const double *data, int rows, int cols, NumericDType dtype);
 
+/**
+ * mmap したファイル領域を読み取り専用の数値ベクトルとして参照する
+ *
+ * mapping（大きさ mapping_size）の所有権を引き取り、data_offset から
+ * length 要素を複製せずに指します。書き込むと自動的に複製され、最後の
+ * 参照が解放された時点で領域を munmap します。
+ */
+Value value_numeric_array_mapped(void *mapping, size_t mapping_size, size_t data_offset,
+                                 NumericDType dtype, int length);
+
+/**
+ * バイト列を作成（data の内容を複製）
+ */
+Value value_bytes(const void *data, int length);
+
+/**
+ * 未初期化の length バイトのバイト列を作成
+ * 作成直後に *out へ直接書き込む（fread など）ためのもので、
+ * 書き込んだバイト数が少なければ bytes.length を縮めて使います。
+ */
+Value value_bytes_alloc(int length, uint8_t **out);
+
+/**
+ * malloc した領域の所有権を引き取ってバイト列にする（複製しない）
+ * data は length + 1 バイト以上確保されている必要があります。
+ */
+Value value_bytes_take(void *data, int length);
+
+/**
+ * mmap したファイル領域を読み取り専用のバイト列として参照する
+ */
+Value value_bytes_mapped(void *mapping, size_t mapping_size, size_t data_offset, int length);
+
+/**
+ * mmap したファイル領域を読み取り専用の数値行列として参照する
+ *
+ * column_major が真なら列優先（Fortran 順）の並びとして扱います。
+ */
+Value value_matrix_mapped(void *mapping, size_t mapping_size, size_t data_offset,
+                          NumericDType dtype, int rows, int cols, bool column_major);
+
 /**
  * ユーザー定義関数を作成
  */
@@ -276,6 +389,30 @@ Value value_generator(void);
  */
 void generator_add_value(Value *gen, Value val);
 
+/**
+ * 開いたストリームからファイルハンドル値を作成
+ * buffer_size が 0 なら stdio の既定バッファを使います。
+ * fp の所有権は値に移り、最後の参照が解放されると閉じられます。
+ */
+Value value_file(FILE *fp, const char *path, size_t buffer_size, bool readable, bool writable);
+
+/**
+ * ファイルハンドルをフラッシュして閉じる（閉じ済みなら何もしない）
+ * 書き込みエラーがあれば false を返します。
+ */
+bool file_handle_close(FileHandle *handle);
+
+/**
+ * コンパイル済み正規表現の値を作成（handle の参照を 1 つ取る）
+ */
+Value value_regex(RegexHandle *handle);
+
+/**
+ * 正規表現の共有状態の参照を増減する（最後の参照で destroy を呼ぶ）
+ */
+void regex_handle_retain(RegexHandle *handle);
+void regex_handle_release(RegexHandle *handle);
+
 /**
  * インスタンスにフィールドを設定
  */
@@ -305,6 +442,7 @@ Value value_dict_with_capacity(int capacity);
  *
  * 文字列・配列・辞書・インスタンスは独立した値としてコピーします。
  * ジェネレータは state を共有し、GeneratorState.ref_count を増やします。
+ * 数値ベクトル・行列は共有バッファの参照数を増やし、書き込み時に複製します。
  */
 Value value_copy(Value v);
 
@@ -390,6 +528,26 @@ void *numeric_array_raw_data(Value *array);
  */
 int numeric_array_length(Value *array);
 
+/**
+ * 数値ベクトルが offset 0・stride 1 の連続配列か判定
+ */
+bool numeric_array_is_contiguous(Value *array);
+
+/**
+ * 共有中または view の数値ベクトルを単独所有の連続バッファへ複製する
+ *
+ * すでに単独所有の連続配列なら何もしません。
+ */
+bool numeric_array_make_unique(Value *array);
+
+/**
+ * 数値ベクトルの部分 view を作成（バッファを共有し、コピーしない）
+ *
+ * 元の要素 start, start + step, ... を length 個参照します。
+ * 共有できないバッファ（プラグイン由来など）の場合はコピーを返します。
+ */
+Value numeric_array_view(Value *array, int start, int length, int step);
+
 // =============================================================================
 // 数値行列操作
 // =============================================================================
@@ -414,6 +572,38 @@ void *matrix_raw_data(Value *matrix);
  */
 bool matrix_is_contiguous(Value *matrix);
 
+/**
+ * 共有中または view の数値行列を単独所有の連続バッファへ複製する
+ *
+ * すでに単独所有の連続行列なら何もしません。
+ */
+bool matrix_make_unique(Value *matrix);
+
+/**
+ * 行を数値ベクトル view として取得（バッファを共有し、コピーしない）
+ */
+Value matrix_row_view(Value *matrix, int row);
+
+/**
+ * 列を数値ベクトル view として取得（バッファを共有し、コピーしない）
+ */
+Value matrix_column_view(Value *matrix, int col);
+
+/**
+ * 連続する行範囲を行列 view として取得（バッファを共有し、コピーしない）
+ */
+Value matrix_rows_view(Value *matrix, int start, int rows);
+
+/**
+ * 転置行列を view として取得（stride を入れ替え、バッファを共有する）
+ */
+Value matrix_transpose_view(Value *matrix);
+
+/**
+ * 2 つの数値ベクトル・行列が同じバッファを共有しているか判定
+ */
+bool numeric_shares_memory(Value *a, Value *b);
+
 // =============================================================================
 // 辞書操作
 // =============================================================================
@@ -423,6 +613,23 @@ bool matrix_is_contiguous(Value *matrix);
  */
 bool dict_set(Value *dict, const char *key, Value value);
 
+/**
+ * 辞書に要素を設定（キーと値の所有権を引き取る）
+ *
+ * key は malloc 済みの文字列、value は呼び出し元が所有する値です。
+ * コピーせずに辞書へ移し、既存キーの場合は渡された key を解放します。
+ * 失敗時も key と value は解放されます。
+ */
+bool dict_set_owned(Value *dict, char *key, Value value);
+
+/**
+ * 重複しないことが分かっているキーを末尾へ追加（所有権を引き取る）
+ *
+ * 既存キーの検索を省略します。JSON 解析のように同じ形のオブジェクトが
+ * 続く場面で、形がすでに検証済みのときだけ使用してください。
+ */
+bool dict_append_owned(Value *dict, char *key, Value value);
+
 /**
  * 辞書から要素を取得
  */
@@ -462,6 +669,34 @@ int dict_length(Value *dict);
  */
 Value string_concat(Value a, Value b);
 
+/**
+ * UTF-8 として正しいバイト列か（NUL を含む場合は偽）
+ */
+bool utf8_is_valid(const char *s, size_t length);
+
+/**
+ * バイト列の先頭ポインタ（view の offset を反映）
+ */
+const uint8_t *bytes_data(const Value *b);
+
+/**
+ * バイト列の部分 view を作成（[start, end)、複製しない）
+ */
+Value bytes_slice(Value *b, int start, int end);
+
+/**
+ * バイト列を文字列に変換（UTF-8 として不正なら null）
+ * b が単独所有で先頭からの view ならバッファを複製せずに引き渡し、
+ * b は null になります。
+ */
+Value bytes_to_string(Value *b);
+
+/**
+ * 文字列の内容を置き換える
+ * 容量が足りれば既存のバッファを再利用します（ループ変数への行の読み込みなど）。
+ */
+bool string_assign_n(Value *s, const char *data, int length);
+
 /**
  * 文字列の長さを取得（文字数）
  */
@@ -507,6 +742,82 @@ int numeric_dtype_size(NumericDType dtype);
  */
 bool numeric_dtype_from_name(const char *name, NumericDType *out_dtype);
 
+// =============================================================================
+// dtype ネイティブの数値カーネル
+// =============================================================================
+
+/**
+ * 二項演算の結果 dtype を決める
+ *
+ * 同じ dtype 同士はその dtype のまま計算します（bool は i64 として数える）。
+ * i32 と i64 は i64、f32 と整数・f64 を含む組み合わせは f64 へ広げます。
+ * 整数同士の除算とべき乗は f64 になります。
+ */
+NumericDType numeric_binary_result_dtype(NumericDType left, NumericDType right, NumericBinaryOp op);
+
+/**
+ * スカラーを相手の dtype に合わせるときの dtype
+ *
+ * 浮動小数の相手にはそのまま合わせ、整数の相手には範囲内の整数値だけを合わせます。
+ * 小数や範囲外の値は f64 として扱います。
+ */
+NumericDType numeric_scalar_dtype(double scalar, NumericDType other);
+
+/**
+ * 同じ dtype の 2 入力を要素ごとに計算し、連続した out へ書き込む
+ *
+ * 入力のポインタが NULL の側は対応するスカラーを使います。stride は要素単位です。
+ * 成功時は -1、除算・剰余で 0 の除数があればその要素番号（何も書き込みません）、
+ * dtype と演算の組み合わせが未対応なら -2 を返します。整数の加減乗算は折り返します。
+ */
+int numeric_binary_kernel(NumericBinaryOp op, NumericDType dtype, void *out,
+                          const void *left, int left_stride, double left_scalar,
+                          const void *right, int right_stride, double right_scalar, int n);
+
+/**
+ * 数値ベクトルを別の dtype の連続ベクトルへ一括変換する
+ *
+ * 整数への変換は切り捨て・範囲で飽和し、NaN は 0 になります。
+ */
+Value numeric_array_astype(Value *array, NumericDType dtype);
+
+/**
+ * 数値行列を別の dtype の連続行列へ一括変換する
+ */
+Value matrix_astype(Value *matrix, NumericDType dtype);
+
+/**
+ * 数値ベクトルの合計（整数 dtype は整数で、f32 は double で累積する）。
+ * 浮動小数点は 4 本の部分和に分けて累積し、WASM SIMD 版と同じ順序で加算する
+ */
+double numeric_array_sum(Value *array);
+
+/**
+ * 2 つの数値ベクトルの内積（同じ dtype なら dtype ネイティブに計算する）
+ */
+double numeric_array_dot(Value *left, Value *right);
+
+/**
+ * 数値ベクトルの平均（整数 dtype も折り返さないよう double で累積する）
+ */
+double numeric_array_mean(Value *array);
+
+/**
+ * 数値ベクトルの偏差平方和 Σ(x - mean)^2（分散・標準偏差用）
+ */
+double numeric_array_squared_deviation_sum(Value *array, double mean);
+
+/**
+ * 数値ベクトルの最小値と最大値を dtype ネイティブに求める（空なら false）
+ */
+bool numeric_array_min_max(Value *array, double *min_out, double *max_out);
+
+/**
+ * f64 行列の積 left × right を連続な f64 行列 out（left の行数 × right の列数）へ書く。
+ * 入力は転置 view などの stride 付きでもよい。dtype や形状が合わなければ false
+ */
+bool matrix_matmul_f64(Value *left, Value *right, Value *out);
+
 /**
  * 値を文字列に変換
  */
@@ -1,12 +1,19 @@
+#ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
+#else
+// ネイティブビルド（tests/wasm_session.sh の ASan テスト）では公開指定は不要
+#define EMSCRIPTEN_KEEPALIVE
+#endif
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ast.h"
 #include "evaluator.h"
 #include "parser.h"
 
-#define HAJIMU_WASM_VERSION "1.5.0"
+#define HAJIMU_WASM_VERSION HAJIMU_VERSION
 
 EMSCRIPTEN_KEEPALIVE
 int hajimu_run_source(const char *source) {
@@ -41,3 +48,188 @@ EMSCRIPTEN_KEEPALIVE
 const char *hajimu_version(void) {
     return HAJIMU_WASM_VERSION;
 }
+
+// =============================================================================
+// セッション API（プレイグラウンド・ノートブック用）
+//
+// 評価器を 1 つ保持し、セルごとのソースを同じグローバル環境で評価する。
+// 前のセルで定義した変数・関数・クラスは次のセルから使え、
+// 評価器の生成や組み込み関数の準備はセッション作成時の 1 回だけで済む。
+//
+//   s = hajimu_session_new()
+//   hajimu_session_eval(s, "変数 x = 1")        → 0（成功）/ 1（エラー）
+//   hajimu_session_eval(s, "x + 1")
+//   hajimu_session_value(s)                     → "2"（最後の式の値。なければ ""）
+//   hajimu_session_output(s)                    → そのセルで表示した内容
+//   hajimu_session_error(s)                     → エラーメッセージ（なければ ""）
+//   hajimu_session_reset(s) / hajimu_session_free(s)
+// =============================================================================
+
+typedef struct {
+    Evaluator *eval;
+    char *output;           // 直前のセルの出力（open_memstream のバッファ）
+    size_t output_length;
+    char *value;            // 直前のセルの最後の式の値
+    char error[1024];       // 直前のセルのエラー
+} HajimuSession;
+
+static void session_clear_results(HajimuSession *session) {
+    free(session->output);
+    session->output = NULL;
+    session->output_length = 0;
+    free(session->value);
+    session->value = NULL;
+    session->error[0] = '\0';
+}
+
+static Evaluator *session_new_evaluator(void) {
+    Evaluator *eval = evaluator_new();
+    if (eval != NULL) eval->current_file = "<browser>";
+    return eval;
+}
+
+EMSCRIPTEN_KEEPALIVE
+HajimuSession *hajimu_session_new(void) {
+    HajimuSession *session = calloc(1, sizeof(HajimuSession));
+    if (session == NULL) return NULL;
+    session->eval = session_new_evaluator();
+    if (session->eval == NULL) {
+        free(session);
+        return NULL;
+    }
+    return session;
+}
+
+/**
+ * トップレベルに「メイン」関数を定義しているか（evaluator_run と同じく定義したセルで実行する）
+ */
+static bool chunk_defines_main(const ASTNode *program) {
+    for (int i = 0; i < program->block.count; i++) {
+        const ASTNode *stmt = program->block.statements[i];
+        if (stmt->type == NODE_FUNCTION_DEF && stmt->function.name != NULL &&
+            strcmp(stmt->function.name, "メイン") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void session_evaluate(HajimuSession *session, ASTNode *program) {
+    Evaluator *eval = session->eval;
+
+    if (chunk_defines_main(program)) {
+        Value result = evaluator_run(eval, program);
+        value_free(&result);
+        return;
+    }
+
+    for (int i = 0; i < program->block.count; i++) {
+        ASTNode *stmt = program->block.statements[i];
+        if (stmt->type != NODE_EXPR_STMT) {
+            // 文の結果も呼び出し側が所有している（クラス定義・関数定義は null）
+            Value result = evaluate(eval, stmt);
+            value_free(&result);
+        } else {
+            Value result = evaluate(eval, stmt->expr_stmt.expression);
+            if (i == program->block.count - 1 && !eval->had_error && !eval->throwing &&
+                result.type != VALUE_NULL) {
+                session->value = value_to_string(result);
+            }
+            value_free(&result);
+        }
+        if (eval->had_error || eval->throwing) break;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+int hajimu_session_eval(HajimuSession *session, const char *source) {
+    if (session == NULL || session->eval == NULL || source == NULL) return 1;
+    session_clear_results(session);
+
+    Evaluator *eval = session->eval;
+    char *source_copy = strdup(source);
+    if (source_copy == NULL) return 1;
+
+    Parser parser;
+    parser_init(&parser, source_copy, "<browser>");
+    ASTNode *program = parse_program(&parser);
+    if (parser_had_error(&parser)) {
+        snprintf(session->error, sizeof(session->error), "%s", parser.error_message);
+        parser_free(&parser);
+        node_free(program);
+        free(source_copy);
+        return 1;
+    }
+    parser_free(&parser);
+
+    // 定義した関数・クラスがこのセルの AST を参照し続けるので、セッションの間は残す
+    evaluator_retain_program(eval, source_copy, program);
+    eval->source_code = source_copy;
+    evaluator_clear_error(eval);
+
+    FILE *out = open_memstream(&session->output, &session->output_length);
+    if (out != NULL) evaluator_set_output(out);
+    session_evaluate(session, program);
+    if (out != NULL) {
+        evaluator_set_output(NULL);
+        fclose(out);
+    }
+
+    // 制御フローの状態を次のセルへ持ち越さない
+    eval->returning = false;
+    eval->breaking = false;
+    eval->continuing = false;
+
+    int status = 0;
+    if (eval->throwing) {
+        char *text = value_to_string(eval->exception_value);
+        snprintf(session->error, sizeof(session->error), "捕捉されない例外: %s",
+                 text != NULL ? text : "");
+        free(text);
+        value_free(&eval->exception_value);
+        eval->exception_value = value_null();
+        eval->throwing = false;
+        status = 1;
+    }
+    if (evaluator_had_error(eval)) {
+        snprintf(session->error, sizeof(session->error), "%s", evaluator_error_message(eval));
+        evaluator_clear_error(eval);
+        status = 1;
+    }
+    return status;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *hajimu_session_output(HajimuSession *session) {
+    return session != NULL && session->output != NULL ? session->output : "";
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *hajimu_session_value(HajimuSession *session) {
+    return session != NULL && session->value != NULL ? session->value : "";
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *hajimu_session_error(HajimuSession *session) {
+    return session != NULL ? session->error : "";
+}
+
+/**
+ * グローバル定義をすべて捨てて新しい評価器に取り替える
+ */
+EMSCRIPTEN_KEEPALIVE
+int hajimu_session_reset(HajimuSession *session) {
+    if (session == NULL) return 1;
+    session_clear_results(session);
+    evaluator_free(session->eval);
+    session->eval = session_new_evaluator();
+    return session->eval != NULL ? 0 : 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void hajimu_session_free(HajimuSession *session) {
+    if (session == NULL) return;
+    session_clear_results(session);
+    evaluator_free(session->eval);
+    free(session);
+}
@@ -34,6 +34,10 @@
 #define REG_NEWLINE   4
 #define REG_NOSUB     8
 
+/* regexec の eflags */
+#define REG_NOTBOL    1   /* 文字列の先頭を行頭として扱わない */
+#define REG_NOTEOL    2
+
 #define REG_NOERROR   0
 #define REG_BADPAT    1   /* Invalid pattern */
 #define REG_NOMATCH   REG_NOERROR + 100  /* No match */
@@ -58,11 +62,13 @@ static int  regcomp_win(regex_t *preg, const char *pattern, int cflags);
 static int  regexec_win(const regex_t *preg, const char *string,
                          size_t nmatch, regmatch_t pmatch[], int eflags);
 static void regfree_win(regex_t *preg);
+static size_t regerror_win(int errcode, const regex_t *preg, char *errbuf, size_t errbuf_size);
 
 /* マクロで標準名に置き換え */
 #define regcomp  regcomp_win
 #define regexec  regexec_win
 #define regfree  regfree_win
+#define regerror regerror_win
 
 /* ============================================================
  * 実装: 単純な前進マッチング
@@ -294,11 +300,11 @@ static int regcomp_win(regex_t *preg, const char *pattern, int cflags) {
 
 static int regexec_win(const regex_t *preg, const char *string,
                         size_t nmatch, regmatch_t pmatch[], int eflags) {
-    (void)eflags;
     if (!preg || !string) return REG_NOMATCH;
     const char *pat = preg->pattern;
     int cflags = preg->cflags;
     int anchored = (pat[0] == '^');
+    if (anchored && (eflags & REG_NOTBOL)) return REG_NOMATCH;
     const char *p = anchored ? pat + 1 : pat;
 
     /* | による選択: 最上位レベルのみ対応 (現実装では未使用) */
@@ -345,5 +351,19 @@ static void regfree_win(regex_t *preg) {
     }
 }
 
+static size_t regerror_win(int errcode, const regex_t *preg, char *errbuf, size_t errbuf_size) {
+    (void)preg;
+    const char *msg = errcode == REG_NOERROR ? "Success"
+                    : errcode == REG_NOMATCH ? "No match"
+                    : "Invalid regular expression";
+    size_t len = strlen(msg) + 1;
+    if (errbuf && errbuf_size > 0) {
+        size_t n = len < errbuf_size ? len : errbuf_size;
+        memcpy(errbuf, msg, n - 1);
+        errbuf[n - 1] = '\0';
+    }
+    return len;
+}
+
 #endif /* _WIN32 */
 #endif /* WIN_REGEX_H */
@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+NIHONGO="${ROOT_DIR}/nihongo"
+TMP_DIR="${TMPDIR:-/tmp}/hajimu-module-cache"
+
+rm -rf "$TMP_DIR"
+mkdir -p "$TMP_DIR"
+export HAJIMU_CACHE_DIR="${TMP_DIR}/cache"
+
+module_file="${TMP_DIR}/lib.jp"
+main_file="${TMP_DIR}/main.jp"
+
+printf '関数 値():\n    戻す 1\n終わり\n' > "$module_file"
+printf '取り込む "lib.jp"\n表示(値())\n' > "$main_file"
+
+expect_run() {
+    local expected_output="$1" expected_cache="$2"
+    local output
+    output="$("$NIHONGO" --profile "$main_file" 2>&1)"
+    if ! grep -qx "$expected_output" <<<"$output" || ! grep -q "$expected_cache" <<<"$output"; then
+        printf '%s\n' "$output"
+        echo "expected output '${expected_output}' with '${expected_cache}'"
+        exit 1
+    fi
+}
+
+expect_run "1" "命中 0, ミス 1, 書込 1"
+expect_run "1" "命中 1, ミス 0, 書込 0"
+
+# 同じサイズ・同じ mtime でも内容が変われば使わない
+touch -r "$module_file" "${TMP_DIR}/mtime"
+printf '関数 値():\n    戻す 2\n終わり\n' > "$module_file"
+touch -r "${TMP_DIR}/mtime" "$module_file"
+expect_run "2" "命中 0, ミス 1, 書込 1"
+
+# 壊れたキャッシュは無視して書き直す
+cache_file="$(ls "$HAJIMU_CACHE_DIR"/*.hjpc)"
+head -c 80 "$cache_file" > "${cache_file}.part"
+mv "${cache_file}.part" "$cache_file"
+expect_run "2" "命中 0, ミス 1, 書込 1"
+expect_run "2" "命中 1, ミス 0, 書込 0"
+
+# 処理系のバージョンが違えば同じソースでもキャッシュを使わない。
+# ビルド識別子をそろえ、バージョンだけを変えた 2 つの実行ファイルで確かめる
+build_variant() {
+    local version="$1" out="$2"
+    local objects=()
+    for object in "${ROOT_DIR}"/build/*.o; do
+        [[ "$object" == */module_cache.o ]] || objects+=("$object")
+    done
+    "${CC:-gcc}" -std=gnu11 -w -I"${ROOT_DIR}/src" \
+        -DHAJIMU_VERSION="\"${version}\"" -DHAJIMU_BUILD_ID='"module-cache-test"' \
+        -c "${ROOT_DIR}/src/module_cache.c" -o "${out}.o"
+    "${CC:-gcc}" "${objects[@]}" "${out}.o" -o "$out" -lm -lcurl -lpthread -ldl
+}
+
+if [[ -f "${ROOT_DIR}/build/main.o" ]]; then
+    build_variant "1.0.0-a" "${TMP_DIR}/nihongo-a"
+    build_variant "1.0.0-b" "${TMP_DIR}/nihongo-b"
+    NIHONGO="${TMP_DIR}/nihongo-a"
+    expect_run "2" "命中 0, ミス 1, 書込 1"
+    expect_run "2" "命中 1, ミス 0, 書込 0"
+    NIHONGO="${TMP_DIR}/nihongo-b"
+    expect_run "2" "命中 0, ミス 1, 書込 1"
+    expect_run "2" "命中 1, ミス 0, 書込 0"
+    NIHONGO="${ROOT_DIR}/nihongo"
+    expect_run "2" "命中 0, ミス 1, 書込 1"
+else
+    echo "module_cache: build/*.o がないのでバージョン違いの確認は省略"
+fi
+
+output="$("$NIHONGO" --no-module-cache --profile "$main_file" 2>&1)"
+if grep -q "モジュールキャッシュ" <<<"$output"; then
+    printf '%s\n' "$output"
+    echo "--no-module-cache still used the cache"
+    exit 1
+fi
+
+echo "module_cache: passed"
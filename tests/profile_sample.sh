@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+NIHONGO="${ROOT_DIR}/nihongo"
+TMP_DIR="${TMPDIR:-/tmp}/hajimu-profile-sample"
+
+rm -rf "$TMP_DIR"
+mkdir -p "$TMP_DIR"
+
+script_file="${TMP_DIR}/busy.jp"
+cat > "$script_file" <<'JP'
+関数 重い(n):
+    変数 合計 = 0
+    i を 0 から n 繰り返す
+        合計 += i % 7
+    終わり
+    戻す 合計
+終わり
+表示(重い(2000000))
+終了(0)
+JP
+
+# 終了() で抜けても atexit で collapsed stack を書き出す
+folded="${TMP_DIR}/exit.folded"
+"$NIHONGO" --profile-sample=997 --profile-sample-out="$folded" "$script_file" > /dev/null 2>&1
+if [ ! -s "$folded" ] || ! grep -q '^<トップレベル>:[0-9]*;重い:[0-9]* [0-9]*$' "$folded"; then
+    echo "終了() 後にプロファイルが書き出されていません: ${folded}"
+    cat "$folded" 2>/dev/null || true
+    exit 1
+fi
+
+# 通常終了では main の停止処理だけが書き出し、atexit で二重に書かない
+sed -i '$d' "$script_file"
+folded="${TMP_DIR}/normal.folded"
+output="$("$NIHONGO" --profile-sample=997 --profile-sample-out="$folded" "$script_file" 2>&1)"
+if [ ! -s "$folded" ] || [ "$(grep -c 'サンプリングプロファイル:' <<<"$output")" -ne 1 ]; then
+    printf '%s\n' "$output"
+    echo "通常終了でプロファイルが 1 回だけ書き出されていません: ${folded}"
+    exit 1
+fi
+
+echo "profile_sample: ok"
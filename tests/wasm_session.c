@@ -0,0 +1,79 @@
+// WASM セッション API（src/wasm_api.c）をネイティブでビルドして呼び出すテスト。
+// tests/wasm_session.sh が AddressSanitizer 付きでビルド・実行する。
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct HajimuSession HajimuSession;
+
+HajimuSession *hajimu_session_new(void);
+int hajimu_session_eval(HajimuSession *session, const char *source);
+const char *hajimu_session_output(HajimuSession *session);
+const char *hajimu_session_value(HajimuSession *session);
+const char *hajimu_session_error(HajimuSession *session);
+int hajimu_session_reset(HajimuSession *session);
+void hajimu_session_free(HajimuSession *session);
+int hajimu_run_source(const char *source);
+
+static int failures = 0;
+
+static void check_str(const char *name, const char *actual, const char *expected) {
+    if (strcmp(actual, expected) == 0) {
+        printf("✓ %s\n", name);
+    } else {
+        printf("✗ %s: \"%s\" != \"%s\"\n", name, actual, expected);
+        failures++;
+    }
+}
+
+static void check_int(const char *name, int actual, int expected) {
+    if (actual == expected) {
+        printf("✓ %s\n", name);
+    } else {
+        printf("✗ %s: %d != %d\n", name, actual, expected);
+        failures++;
+    }
+}
+
+int main(void) {
+    // LeakSanitizer は stdio を書き出さずに終了するので行ごとに出す
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    HajimuSession *s = hajimu_session_new();
+    if (s == NULL) {
+        printf("✗ session_new\n");
+        return 1;
+    }
+
+    check_int("eval 定義", hajimu_session_eval(s, "変数 x = 41\n関数 倍(n):\n    返す n * 2\n終わり"), 0);
+    check_str("定義セルの値は空", hajimu_session_value(s), "");
+    check_int("eval 式", hajimu_session_eval(s, "x + 1"), 0);
+    check_str("前のセルの変数", hajimu_session_value(s), "42");
+    check_int("eval 表示", hajimu_session_eval(s, "表示(倍(x))\n倍(1)"), 0);
+    check_str("出力", hajimu_session_output(s), "82\n");
+    check_str("最後の式の値", hajimu_session_value(s), "2");
+
+    // 文の結果（クラス・配列・辞書）を繰り返し評価しても漏れや二重解放にならない
+    check_int("eval クラス", hajimu_session_eval(s,
+        "型 点:\n    初期化(x):\n        自分.x = x\n    終わり\n終わり\n"
+        "変数 p = 新規 点(3)\n変数 a = [1, [2, 3]]\n変数 d = {\"k\": a}\n"
+        "i を 1 から 3 繰り返す\n    a = [i, d]\n終わり\np.x"), 0);
+    check_str("クラスのセルの値", hajimu_session_value(s), "3");
+
+    check_int("eval 実行時エラー", hajimu_session_eval(s, "未定義の名前 + 1"), 1);
+    check_int("エラー文言あり", hajimu_session_error(s)[0] != '\0', 1);
+    check_int("eval 構文エラー", hajimu_session_eval(s, "変数 = "), 1);
+    check_int("eval 例外", hajimu_session_eval(s, "投げる \"失敗\""), 1);
+    check_int("エラー後も続けられる", hajimu_session_eval(s, "x"), 0);
+    check_str("エラー後の値", hajimu_session_value(s), "41");
+    check_str("エラーは消える", hajimu_session_error(s), "");
+
+    check_int("reset", hajimu_session_reset(s), 0);
+    check_int("reset 後は未定義", hajimu_session_eval(s, "x"), 1);
+    check_int("reset 後も評価できる", hajimu_session_eval(s, "1 + 2"), 0);
+    check_str("reset 後の値", hajimu_session_value(s), "3");
+    hajimu_session_free(s);
+
+    check_int("run_source", hajimu_run_source("変数 y = {\"k\": [1, 2]}\n表示(y[\"k\"][1] + 1)"), 0);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+TMP_DIR="${TMPDIR:-/tmp}/hajimu-wasm-session"
+CC="${CC:-cc}"
+
+rm -rf "$TMP_DIR"
+mkdir -p "$TMP_DIR"
+
+# WASM のセッション API を main.c の代わりにリンクし、ASan 付きのネイティブバイナリで動かす
+sources=()
+for src in "$ROOT_DIR"/src/*.c; do
+    case "$(basename "$src")" in
+        main.c|http_wasm.c) continue ;;
+    esac
+    sources+=("$src")
+done
+
+binary="${TMP_DIR}/wasm_session"
+"$CC" -std=gnu11 -g -O1 -fsanitize=address -fno-omit-frame-pointer -w -I"$ROOT_DIR/src" \
+    "$ROOT_DIR/tests/wasm_session.c" "${sources[@]}" -o "$binary" -lm -lcurl -lpthread -ldl
+
+if ! ASAN_OPTIONS="detect_leaks=1:${ASAN_OPTIONS:-}" "$binary" > "${TMP_DIR}/out.txt" 2>&1; then
+    cat "${TMP_DIR}/out.txt"
+    echo "wasm_session: 失敗"
+    exit 1
+fi
+
+echo "wasm_session: ok"
@@ -70,10 +70,14 @@ SOURCES=(
     src/evaluator.c
     src/diag.c
     src/http.c
+    src/json.c
     src/async.c
     src/bytecode.c
     src/package.c
     src/plugin.c
+    src/trace.c
+    src/module_cache.c
+    src/bench.c
 )
 
 OBJECTS=()